@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AnalyserNode.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/FFTFrame.h"
+#include "LabSound/core/WindowFunctions.h"
+#include "LabSound/extended/AudioContextLock.h"
+#include "spectrogram.hpp"
+
+/* ============================================================
+ * AnalyserNode that keeps its recent analysis frames.
+ *
+ * lab::AnalyserNode only analyses when asked, so a meter polling at 60 Hz
+ * sees whatever the last fftSize samples were at that moment and misses
+ * everything in between. This one also runs its own analysis on the
+ * render thread every `hop` frames, never less than a render quantum, and
+ * keeps the last N results in a ring.
+ * A result has the spectrum in dB, smoothed and Blackman-windowed the way
+ * the spec's analyser does it, followed by the fftSize time-domain samples
+ * it was computed from. The JS thread drains the ring with readFrames().
+ * Nothing allocates after configure().
+ *
+ * The ring is overwritten when the reader falls N frames behind. The
+ * writer announces a slot before it starts on it, so the reader can tell a
+ * copy that raced the overwrite and drop it.
+ * ============================================================ */
+
+class AnalyserFrameNode : public lab::AnalyserNode {
+public:
+  AnalyserFrameNode(lab::AudioContext& ac, int frames, int hop) : lab::AnalyserNode(ac), capacity(size_t(std::max(frames, 0))), hopSize(hop) {}
+
+  // JS thread, with the render lock held (fftSize changes take it anyway):
+  // size everything for the current fftSize and forget the old frames.
+  void
+  configure() {
+    fftLength = int(fftSize());
+    bins = fftLength / 2;
+    // A hop below the quantum would run several FFTs per process() call.
+    hop = std::max<int>(hopSize > 0 ? hopSize : fftLength, lab::AudioNode::ProcessingSizeInFrames);
+    history.assign(size_t(fftLength), 0.f);
+    fftInput.assign(size_t(fftLength), 0.f);
+    smoothed.assign(size_t(bins), 0.f);
+    slots.assign(capacity * frameSize(), 0.f);
+    fill = 0;
+    sinceFrame = 0;
+    begun.store(0, std::memory_order_relaxed);
+    written.store(0, std::memory_order_relaxed);
+    read = 0;
+    if(!capacity)
+      return;
+
+    window.assign(size_t(fftLength), 1.f);
+    lab::ApplyWindowFunctionInplace(lab::window_blackman, window.data(), fftLength);
+    fft = std::make_unique<lab::FFTFrame>(fftLength);
+    scale = fft_magnitude_scale(*fft, fftLength);
+  }
+
+  /* ---------- JS thread ---------- */
+
+  size_t
+  frameSize() const {
+    return size_t(bins) + size_t(fftLength);
+  }
+
+  size_t
+  frameCapacity() const {
+    return capacity;
+  }
+
+  size_t
+  available() const {
+    uint64_t w = written.load(std::memory_order_acquire);
+    return size_t(std::min<uint64_t>(w - read, capacity));
+  }
+
+  uint64_t
+  droppedFrames() const {
+    return dropped;
+  }
+
+  // Scratch for lab's own getters, which fill a vector of the size they
+  // find; their capacity only grows.
+  std::vector<float>&
+  scratch(size_t n) {
+    floats.resize(n);
+    return floats;
+  }
+
+  std::vector<uint8_t>&
+  byteScratch(size_t n) {
+    bytes.resize(n);
+    return bytes;
+  }
+
+  // Copy up to maxFrames of the unread frames, oldest first, back to back
+  // into `out`; returns how many.
+  size_t
+  readFrames(float* out, size_t maxFrames) {
+    if(!capacity)
+      return 0;
+    const size_t size = frameSize();
+    uint64_t w = written.load(std::memory_order_acquire);
+    if(w - read > capacity) {
+      dropped += w - read - capacity;
+      read = w - capacity;
+    }
+
+    size_t n = 0;
+    while(n < maxFrames && read < w) {
+      memcpy(out + n * size, &slots[(read % capacity) * size], size * sizeof(float));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      // The slot is reused for frame read + capacity.
+      if(begun.load(std::memory_order_relaxed) > read + capacity) {
+        dropped++;
+        read++;
+        continue;
+      }
+      read++;
+      n++;
+    }
+    return n;
+  }
+
+  // The newest complete frame without consuming it: frequency data (bins
+  // values) if `time` is false, else time-domain data (fftSize values).
+  bool
+  latest(float* out, size_t count, bool time) const {
+    uint64_t w = written.load(std::memory_order_acquire);
+    if(!capacity || !w)
+      return false;
+    const float* frame = &slots[((w - 1) % capacity) * frameSize()];
+    memcpy(out, frame + (time ? bins : 0), std::min(count, size_t(time ? fftLength : bins)) * sizeof(float));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return begun.load(std::memory_order_relaxed) <= w - 1 + capacity;
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    lab::AnalyserNode::process(r, bufferSize);
+    if(!capacity || !fftLength)
+      return;
+
+    lab::AudioBus* in = input(0)->isConnected() ? input(0)->bus(r) : nullptr;
+    const int channels = in ? int(in->numberOfChannels()) : 0;
+    const float gain = channels ? 1.f / channels : 0.f;
+    for(int i = 0; i < bufferSize; i++) {
+      // Down-mixed to mono, as the spec's analyser does.
+      float x = 0;
+      for(int c = 0; c < channels; c++)
+        x += in->channel(c)->data()[i];
+      history[size_t(fill)] = x * gain;
+      if(++fill == fftLength)
+        fill = 0;
+      if(++sinceFrame >= hop) {
+        sinceFrame = 0;
+        analyse();
+      }
+    }
+  }
+
+private:
+  void
+  analyse() {
+    const uint64_t k = written.load(std::memory_order_relaxed);
+    begun.store(k + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    float* frame = &slots[(k % capacity) * frameSize()];
+    float* time = frame + bins;
+    // Oldest sample first.
+    std::copy(history.begin() + fill, history.end(), time);
+    std::copy(history.begin(), history.begin() + fill, time + (fftLength - fill));
+
+    for(int i = 0; i < fftLength; i++)
+      fftInput[size_t(i)] = time[i] * window[size_t(i)];
+    fft->doFFT(fftInput.data());
+    const float* re = fft->realData();
+    const float* im = fft->imagData();
+
+    const float tau = float(std::clamp(smoothingTimeConstant(), 0.0, 1.0));
+    const float floor = float(minDecibels());
+    for(int b = 0; b < bins; b++) {
+      // imag[0] holds the Nyquist bin, which isn't one of ours.
+      float magnitude = (b ? std::sqrt(re[b] * re[b] + im[b] * im[b]) : std::fabs(re[0])) * scale;
+      smoothed[size_t(b)] = tau * smoothed[size_t(b)] + (1 - tau) * magnitude;
+      frame[b] = smoothed[size_t(b)] > 0 ? 20 * std::log10(smoothed[size_t(b)]) : floor;
+    }
+
+    written.store(k + 1, std::memory_order_release);
+  }
+
+  const size_t capacity;
+  const int hopSize; // 0: fftSize
+
+  int fftLength = 0, bins = 0, hop = 0;
+  std::unique_ptr<lab::FFTFrame> fft;
+  std::vector<float> window, fftInput, smoothed;
+  float scale = 1;
+
+  // Render thread.
+  std::vector<float> history; // last fftSize input samples, circular
+  int fill = 0, sinceFrame = 0;
+
+  std::vector<float> slots; // capacity frames of frameSize()
+  std::atomic<uint64_t> begun{0}, written{0};
+
+  // JS thread.
+  uint64_t read = 0, dropped = 0;
+  std::vector<float> floats;
+  std::vector<uint8_t> bytes;
+};
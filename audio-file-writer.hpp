@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "LabSound/core/AudioBus.h"
+
+/* ============================================================
+ * Incremental WAV / raw PCM writer.
+ *
+ * libnyquist's encode_wav_to_disk() wants the whole recording as one
+ * interleaved nqr::AudioData, which is fine for writeToWav() on a buffer
+ * already in memory but not for streaming a render of unbounded length.
+ * This writer converts and interleaves each block into a fixed-size byte
+ * buffer of `chunkFrames` frames, writes it out when full, and patches the
+ * RIFF sizes on close() -- memory use is independent of the length.
+ *
+ * Samples are 16/24-bit integer PCM or 32-bit IEEE float, little-endian.
+ * RIFF caps the data chunk at 4 GiB; sizes saturate past that. A data
+ * chunk of odd length (24-bit, odd channels x frames) gets RIFF's pad byte,
+ * which its size doesn't count.
+ * ============================================================ */
+
+class AudioFileWriter {
+public:
+  enum Format { WAV, RAW };
+
+  ~AudioFileWriter() {
+    close();
+  }
+
+  bool
+  open(const std::string& path, Format fmt, int channels, int sampleRate, int bitDepth, int chunkFrames) {
+    if(channels <= 0 || (bitDepth != 16 && bitDepth != 24 && bitDepth != 32))
+      return false;
+    if(!(fp = fopen(path.c_str(), "wb")))
+      return false;
+    format = fmt;
+    numChannels = channels;
+    bytesPerSample = bitDepth / 8;
+    rate = sampleRate;
+    chunk.resize(size_t(std::max(1, chunkFrames)) * channels * bytesPerSample);
+    fill = 0;
+    dataBytes = 0;
+    if(format == WAV)
+      return writeHeader();
+    return true;
+  }
+
+  // Append `frames` frames from the start of `bus`.
+  bool
+  write(const lab::AudioBus& bus, int frames) {
+    const size_t frameBytes = size_t(numChannels) * bytesPerSample;
+    for(int i = 0; i < frames; i++) {
+      if(fill + frameBytes > chunk.size() && !flush())
+        return false;
+      for(int c = 0; c < numChannels; c++) {
+        const lab::AudioChannel* ch = bus.channel(std::min(c, bus.numberOfChannels() - 1));
+        encode(ch->data()[i], &chunk[fill]);
+        fill += bytesPerSample;
+      }
+    }
+    return true;
+  }
+
+  bool
+  close() {
+    if(!fp)
+      return true;
+    bool ok = flush();
+    if(ok && format == WAV && (dataBytes & 1))
+      ok = fputc(0, fp) != EOF;
+    if(ok && format == WAV)
+      ok = fseek(fp, 0, SEEK_SET) == 0 && writeHeader();
+    ok = fclose(fp) == 0 && ok;
+    fp = nullptr;
+    return ok;
+  }
+
+private:
+  void
+  encode(float x, uint8_t* out) const {
+    switch(bytesPerSample) {
+      case 2: {
+        int32_t v = int32_t(std::lrint(std::clamp(x, -1.f, 1.f) * 32767.f));
+        out[0] = uint8_t(v), out[1] = uint8_t(v >> 8);
+        break;
+      }
+      case 3: {
+        int32_t v = int32_t(std::lrint(std::clamp(x, -1.f, 1.f) * 8388607.f));
+        out[0] = uint8_t(v), out[1] = uint8_t(v >> 8), out[2] = uint8_t(v >> 16);
+        break;
+      }
+      case 4: {
+        uint32_t v;
+        memcpy(&v, &x, sizeof(v));
+        put32(out, v);
+        break;
+      }
+    }
+  }
+
+  static void
+  put16(uint8_t* p, uint16_t v) {
+    p[0] = uint8_t(v), p[1] = uint8_t(v >> 8);
+  }
+
+  static void
+  put32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v), p[1] = uint8_t(v >> 8), p[2] = uint8_t(v >> 16), p[3] = uint8_t(v >> 24);
+  }
+
+  bool
+  flush() {
+    if(fill && fwrite(chunk.data(), 1, fill, fp) != fill)
+      return false;
+    dataBytes += fill;
+    fill = 0;
+    return true;
+  }
+
+  bool
+  writeHeader() {
+    uint8_t h[44];
+    uint32_t data = uint32_t(std::min<uint64_t>(dataBytes, 0xffffffffu - 37));
+    memcpy(h, "RIFF", 4);
+    put32(h + 4, 36 + data + (data & 1));
+    memcpy(h + 8, "WAVEfmt ", 8);
+    put32(h + 16, 16);
+    put16(h + 20, bytesPerSample == 4 ? 3 : 1); // WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM
+    put16(h + 22, uint16_t(numChannels));
+    put32(h + 24, uint32_t(rate));
+    put32(h + 28, uint32_t(rate) * numChannels * bytesPerSample);
+    put16(h + 32, uint16_t(numChannels * bytesPerSample));
+    put16(h + 34, uint16_t(bytesPerSample * 8));
+    memcpy(h + 36, "data", 4);
+    put32(h + 40, data);
+    return fwrite(h, 1, sizeof(h), fp) == sizeof(h);
+  }
+
+  FILE* fp = nullptr;
+  Format format = WAV;
+  int numChannels = 0, bytesPerSample = 0, rate = 0;
+  std::vector<uint8_t> chunk;
+  size_t fill = 0;
+  uint64_t dataBytes = 0;
+};
@@ -0,0 +1,881 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <quickjs.h>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioParam.h"
+#include "LabSound/extended/AudioContextLock.h"
+#include "dynamic-params.hpp"
+#include "lockfree-ring.hpp"
+
+/* ============================================================
+ * AudioWorklet on a runtime of its own.
+ *
+ * A context's processors live in a separate JSRuntime, WorkletScope, that
+ * the main interpreter never touches: processor code runs on the render
+ * thread without waiting for the JS thread or its garbage. Only one
+ * thread may be inside a runtime at a time, so the scope has a lock. The
+ * JS thread takes it for addModule() and to construct a processor; a
+ * realtime render thread only tries it, and a node whose scope is busy
+ * renders a quantum of silence rather than wait (skippedQuanta).
+ *
+ * Per processor (WorkletProcessor):
+ *
+ *  - inputs, outputs and parameters are built once as Float32Arrays over
+ *    ArrayBuffers of the worklet runtime; each quantum copies the buses
+ *    into and out of them and calls process() with the same three objects.
+ *    An input's array is only rebuilt when its channel count changes;
+ *  - a param is its 128-value array when it changes over the quantum, a
+ *    1-value array when it doesn't (or is k-rate), as in the spec;
+ *  - port.postMessage() in either direction is a structured copy
+ *    (JS_WriteObject/JS_ReadObject) through an SpscMessageRing. Messages
+ *    for the processor are delivered just before its process() call;
+ *    messages for the node wake the JS thread (`wake`);
+ *  - the last reference to a processor may drop on the render thread, so
+ *    it is only queued there (retire()), with an atomic push and nothing
+ *    else; the JS thread frees it and its values in the runtime on its
+ *    next collect(). Once the context is gone, the retire that drops the
+ *    last reference to the scope frees what's queued with it.
+ *
+ * QuickJS's cycle collector isn't incremental and a collection can't be
+ * split, so the runtime's automatic threshold is disabled (reference
+ * counting still frees acyclic garbage at once) and the render thread
+ * runs JS_RunGC() itself, between quanta: at the start of a quantum,
+ * before any processor, already holding the scope, so no processor skips
+ * a quantum for it. It does so about four times a second, and only when
+ * the last collection's cost plus the previous quantum's processing fit
+ * in half the period; a heap that never fits is collected anyway once a
+ * second has gone by.
+ * ============================================================ */
+
+class WorkletProcessor;
+
+class WorkletScope {
+public:
+  struct Definition {
+    JSValue ctor = JS_UNDEFINED;
+    std::vector<DynamicParams::Spec> params;
+    std::vector<bool> kRate;
+  };
+
+  // Any thread: wakes the JS thread once a message for it was queued.
+  std::function<void()> wake;
+
+  std::atomic<uint64_t> skippedQuanta{0}, gcRuns{0};
+
+  WorkletScope(float sampleRate, bool offline) : sampleRate(sampleRate), offline(offline) {
+    if(!portClassId)
+      JS_NewClassID(&portClassId);
+    rt = JS_NewRuntime();
+    JS_SetGCThreshold(rt, size_t(-1));
+#ifndef HAVE_JS_UPDATESTACKTOP
+    // The stack check measures from the thread that created the runtime;
+    // without JS_UpdateStackTop() to re-base it per thread, disable it.
+    JS_SetMaxStackSize(rt, size_t(-1));
+#endif
+    JS_SetModuleLoaderFunc(rt, nullptr, &WorkletScope::loadModule, this);
+    static const JSClassDef portClass = {"AudioWorkletProcessorPort", nullptr};
+    JS_NewClass(rt, portClassId, &portClass);
+
+    ctx = JS_NewContext(rt);
+    JS_SetContextOpaque(ctx, this);
+    global = JS_GetGlobalObject(ctx);
+    float32array = JS_GetPropertyStr(ctx, global, "Float32Array");
+    atomProcess = JS_NewAtom(ctx, "process");
+    atomOnmessage = JS_NewAtom(ctx, "onmessage");
+    atomCurrentFrame = JS_NewAtom(ctx, "currentFrame");
+    atomCurrentTime = JS_NewAtom(ctx, "currentTime");
+
+    portProto = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, portProto, "postMessage", JS_NewCFunction(ctx, &WorkletScope::portPostMessage, "postMessage", 1));
+    JS_SetClassProto(ctx, portClassId, JS_DupValue(ctx, portProto));
+
+    JSValue base = JS_NewCFunction2(ctx, &WorkletScope::processorConstructor, "AudioWorkletProcessor", 0, JS_CFUNC_constructor, 0);
+    JSValue baseProto = JS_NewObject(ctx);
+    JS_SetConstructor(ctx, base, baseProto);
+    JS_FreeValue(ctx, baseProto);
+    JS_SetPropertyStr(ctx, global, "AudioWorkletProcessor", base);
+    JS_SetPropertyStr(ctx, global, "registerProcessor", JS_NewCFunction(ctx, &WorkletScope::registerProcessor, "registerProcessor", 2));
+    JS_SetPropertyStr(ctx, global, "sampleRate", JS_NewFloat64(ctx, sampleRate));
+    JS_SetProperty(ctx, global, atomCurrentFrame, JS_NewInt64(ctx, 0));
+    JS_SetProperty(ctx, global, atomCurrentTime, JS_NewFloat64(ctx, 0));
+
+    JSValue console = JS_NewObject(ctx);
+    for(const char* name : {"log", "info", "warn", "error"})
+      JS_SetPropertyStr(ctx, console, name, JS_NewCFunction(ctx, &WorkletScope::consoleLog, name, 1));
+    JS_SetPropertyStr(ctx, global, "console", console);
+
+    // Four GC opportunities a second, at 128 frames a quantum.
+    gcInterval = std::max(1, int(sampleRate / (4 * lab::AudioNode::ProcessingSizeInFrames)));
+  }
+
+  // Whichever thread drops the last reference; nothing else is in the
+  // runtime by then. Processors retired after the last collect() are
+  // freed here.
+  ~WorkletScope() {
+    freeRetired();
+    for(auto& d : definitions)
+      JS_FreeValue(ctx, d.second.ctor);
+    for(JSValue v : {global, float32array, portProto, pendingPort})
+      JS_FreeValue(ctx, v);
+    for(JSAtom a : {atomProcess, atomOnmessage, atomCurrentFrame, atomCurrentTime})
+      JS_FreeAtom(ctx, a);
+    JS_FreeContext(ctx);
+    JS_FreeRuntime(rt);
+  }
+
+  // Held around everything that runs in this runtime. The JS thread and an
+  // offline render wait for it; a realtime render thread only tries.
+  bool
+  enter(bool wait) {
+    if(wait)
+      lock.lock();
+    else if(!lock.try_lock())
+      return false;
+#ifdef HAVE_JS_UPDATESTACKTOP
+    JS_UpdateStackTop(rt);
+#endif
+    return true;
+  }
+
+  void
+  leave() {
+    // Promise jobs queued by process() or onmessage run before anyone else
+    // gets the runtime.
+    JSContext* job;
+    while(JS_ExecutePendingJob(rt, &job) > 0) {
+    }
+    lock.unlock();
+  }
+
+  bool
+  isOffline() const {
+    return offline;
+  }
+
+  /* ---------- JS thread ---------- */
+
+  // Evaluate the module at `path` (its imports resolve relative to it).
+  // Synchronous: registerProcessor() calls have happened on return.
+  bool
+  addModule(const std::string& path, std::string& error) {
+    std::string source;
+    if(!readFile(path, source)) {
+      error = "cannot read '" + path + "'";
+      return false;
+    }
+    enter(true);
+    moduleError.clear();
+    JSValue ret = JS_Eval(ctx, source.c_str(), source.size(), path.c_str(), JS_EVAL_TYPE_MODULE);
+    if(JS_IsException(ret)) {
+      moduleError = exceptionText(ctx);
+    } else if(JS_IsObject(ret)) {
+      // Newer QuickJS returns the module's evaluation promise, and an error
+      // in the module body rejects it instead of throwing.
+      JSValue then = JS_GetPropertyStr(ctx, ret, "then");
+      if(JS_IsFunction(ctx, then)) {
+        JSValue args[2] = {JS_UNDEFINED, JS_NewCFunction(ctx, &WorkletScope::moduleRejected, "rejected", 1)};
+        JS_FreeValue(ctx, JS_Call(ctx, then, ret, 2, args));
+        JS_FreeValue(ctx, args[1]);
+      }
+      JS_FreeValue(ctx, then);
+    }
+    JS_FreeValue(ctx, ret);
+    leave();
+    // Loading is the one place a lot of garbage is made off the render thread.
+    enter(true);
+    JS_RunGC(rt);
+    lock.unlock();
+    error = moduleError;
+    return error.empty();
+  }
+
+  const Definition*
+  definition(const std::string& name) const {
+    auto it = definitions.find(name);
+    return it == definitions.end() ? nullptr : &it->second;
+  }
+
+  // JS thread: free the processors retired since the last call, taking the
+  // scope lock. The caller holds a reference to the scope.
+  void
+  collect() {
+    if(!retired.load(std::memory_order_relaxed))
+      return;
+    enter(true);
+    freeRetired();
+    lock.unlock();
+  }
+
+  /* ---------- render thread ---------- */
+
+  // First call of each quantum, inside enter(): collect cycles if there's
+  // room for it, then publish the time.
+  void
+  beginQuantum(uint64_t frame, double time, int bufferSize) {
+    if(frame == lastFrame && quanta > 0)
+      return;
+    const double period = bufferSize / double(sampleRate);
+    const double busy = quantumSeconds;
+    lastFrame = frame;
+    quantumSeconds = 0;
+    quanta++;
+    if(++sinceGc >= gcInterval && (busy + gcSeconds < period / 2 || sinceGc >= 4 * gcInterval)) {
+      const auto start = std::chrono::steady_clock::now();
+      JS_RunGC(rt);
+      gcSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      gcRuns.fetch_add(1, std::memory_order_relaxed);
+      sinceGc = 0;
+    }
+    JS_SetProperty(ctx, global, atomCurrentFrame, JS_NewInt64(ctx, int64_t(frame)));
+    JS_SetProperty(ctx, global, atomCurrentTime, JS_NewFloat64(ctx, time));
+  }
+
+  // Render thread time spent in process() this quantum.
+  void
+  addTime(double seconds) {
+    quantumSeconds += seconds;
+  }
+
+  // The exception pending in `ctx`, with its stack if it has one.
+  static std::string
+  exceptionText(JSContext* ctx) {
+    JSValue e = JS_GetException(ctx);
+    std::string text = valueText(ctx, e);
+    if(JS_IsObject(e)) {
+      JSValue stack = JS_GetPropertyStr(ctx, e, "stack");
+      if(JS_IsString(stack))
+        text += "\n" + valueText(ctx, stack);
+      JS_FreeValue(ctx, stack);
+    }
+    JS_FreeValue(ctx, e);
+    return text;
+  }
+
+private:
+  friend class WorkletProcessor;
+
+  // Any thread: queue `p` for collect(). Lock-free and without a wakeup,
+  // as it may be the render thread dropping the last reference.
+  static void retire(WorkletProcessor* p);
+
+  // With the runtime to ourselves.
+  void freeRetired();
+
+  static bool
+  readFile(const std::string& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if(!in)
+      return false;
+    std::ostringstream ss;
+    ss << in.rdbuf();
+    out = ss.str();
+    return true;
+  }
+
+  static std::string
+  valueText(JSContext* ctx, JSValueConst v) {
+    const char* s = JS_ToCString(ctx, v);
+    std::string text = s ? s : "?";
+    JS_FreeCString(ctx, s);
+    return text;
+  }
+
+  static WorkletScope*
+  from(JSContext* ctx) {
+    return static_cast<WorkletScope*>(JS_GetContextOpaque(ctx));
+  }
+
+  static JSModuleDef*
+  loadModule(JSContext* ctx, const char* name, void*) {
+    std::string source;
+    if(!readFile(name, source)) {
+      JS_ThrowTypeError(ctx, "could not load module '%s'", name);
+      return nullptr;
+    }
+    JSValue fn = JS_Eval(ctx, source.c_str(), source.size(), name, JS_EVAL_TYPE_MODULE | JS_EVAL_FLAG_COMPILE_ONLY);
+    if(JS_IsException(fn))
+      return nullptr;
+    JSModuleDef* m = static_cast<JSModuleDef*>(JS_VALUE_GET_PTR(fn));
+    JS_FreeValue(ctx, fn);
+    return m;
+  }
+
+  static JSValue
+  moduleRejected(JSContext* ctx, JSValueConst, int argc, JSValueConst argv[]) {
+    JS_Throw(ctx, JS_DupValue(ctx, argv[0]));
+    from(ctx)->moduleError = exceptionText(ctx);
+    return JS_UNDEFINED;
+  }
+
+  static JSValue
+  consoleLog(JSContext* ctx, JSValueConst, int argc, JSValueConst argv[]) {
+    std::string line;
+    for(int i = 0; i < argc; i++)
+      line += (i ? " " : "") + valueText(ctx, argv[i]);
+    fprintf(stderr, "%s\n", line.c_str());
+    return JS_UNDEFINED;
+  }
+
+  // registerProcessor(name, class): parameterDescriptors is read once, here.
+  static JSValue
+  registerProcessor(JSContext* ctx, JSValueConst, int argc, JSValueConst argv[]) {
+    WorkletScope* scope = from(ctx);
+    if(argc < 2 || !JS_IsString(argv[0]) || !JS_IsConstructor(ctx, argv[1]))
+      return JS_ThrowTypeError(ctx, "registerProcessor(name, processorClass)");
+    std::string name = valueText(ctx, argv[0]);
+    if(name.empty())
+      return JS_ThrowTypeError(ctx, "registerProcessor: name must not be empty");
+    if(scope->definitions.count(name))
+      return JS_ThrowTypeError(ctx, "registerProcessor: '%s' is already registered", name.c_str());
+
+    Definition def;
+    JSValue list = JS_GetPropertyStr(ctx, argv[1], "parameterDescriptors");
+    if(JS_IsException(list))
+      return list;
+    if(!JS_IsUndefined(list)) {
+      uint32_t length = 0;
+      JSValue lenv = JS_GetPropertyStr(ctx, list, "length");
+      JS_ToUint32(ctx, &length, lenv);
+      JS_FreeValue(ctx, lenv);
+      for(uint32_t k = 0; k < length; k++) {
+        JSValue d = JS_GetPropertyUint32(ctx, list, k);
+        DynamicParams::Spec spec;
+        JSValue v = JS_GetPropertyStr(ctx, d, "name");
+        spec.name = JS_IsString(v) ? valueText(ctx, v) : "";
+        JS_FreeValue(ctx, v);
+        static const char* const fields[] = {"defaultValue", "minValue", "maxValue"};
+        float* values[] = {&spec.defaultValue, &spec.minValue, &spec.maxValue};
+        for(int i = 0; i < 3; i++) {
+          double n;
+          v = JS_GetPropertyStr(ctx, d, fields[i]);
+          if(JS_IsNumber(v) && !JS_ToFloat64(ctx, &n, v))
+            *values[i] = float(n);
+          JS_FreeValue(ctx, v);
+        }
+        v = JS_GetPropertyStr(ctx, d, "automationRate");
+        bool kRate = JS_IsString(v) && valueText(ctx, v) == "k-rate";
+        JS_FreeValue(ctx, v);
+        JS_FreeValue(ctx, d);
+
+        bool duplicate = false;
+        for(const auto& s : def.params)
+          duplicate |= s.name == spec.name;
+        if(spec.name.empty() || duplicate || !(spec.minValue <= spec.defaultValue && spec.defaultValue <= spec.maxValue)) {
+          JS_FreeValue(ctx, list);
+          return JS_ThrowTypeError(ctx, "registerProcessor: parameterDescriptors[%u] of '%s' is invalid", k, name.c_str());
+        }
+        def.params.push_back(spec);
+        def.kRate.push_back(kRate);
+      }
+    }
+    JS_FreeValue(ctx, list);
+    def.ctor = JS_DupValue(ctx, argv[1]);
+    scope->definitions.emplace(name, std::move(def));
+    return JS_UNDEFINED;
+  }
+
+  // super() in a processor class: only valid while a node constructs one.
+  static JSValue
+  processorConstructor(JSContext* ctx, JSValueConst new_target, int, JSValueConst*) {
+    WorkletScope* scope = from(ctx);
+    if(JS_IsUndefined(scope->pendingPort))
+      return JS_ThrowTypeError(ctx, "AudioWorkletProcessor can only be constructed by an AudioWorkletNode");
+    JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+    if(JS_IsException(proto))
+      return proto;
+    JSValue obj = JS_NewObjectProto(ctx, proto);
+    JS_FreeValue(ctx, proto);
+    if(JS_IsException(obj))
+      return obj;
+    JS_DefinePropertyValueStr(ctx, obj, "port", scope->pendingPort, JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE);
+    scope->pendingPort = JS_UNDEFINED;
+    return obj;
+  }
+
+  static JSValue portPostMessage(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]);
+
+  static inline JSClassID portClassId = 0;
+
+  JSRuntime* rt = nullptr;
+  JSContext* ctx = nullptr;
+  JSValue global = JS_UNDEFINED, float32array = JS_UNDEFINED, portProto = JS_UNDEFINED;
+  JSValue pendingPort = JS_UNDEFINED; // handed to the next super()
+  JSAtom atomProcess, atomOnmessage, atomCurrentFrame, atomCurrentTime;
+  std::map<std::string, Definition> definitions;
+  std::string moduleError;
+  std::mutex lock;
+  float sampleRate;
+  bool offline;
+
+  uint64_t lastFrame = 0, quanta = 0;
+  double quantumSeconds = 0, gcSeconds = 0; // the last collection's cost
+  int gcInterval = 1, sinceGc = 0;
+
+  std::atomic<WorkletProcessor*> retired{nullptr};
+};
+
+class WorkletProcessor {
+public:
+  enum { MESSAGE_BYTES = 64 << 10 };
+
+  // JS thread -> processor, and back.
+  SpscMessageRing toProcessor{MESSAGE_BYTES}, toMain{MESSAGE_BYTES};
+  // Set once, when process() throws or returns something that isn't
+  // callable; `error` is written before it.
+  std::atomic<bool> failed{false};
+  std::string error;
+
+  // The last reference retires the processor instead of deleting it.
+  static std::shared_ptr<WorkletProcessor>
+  create(std::shared_ptr<WorkletScope> scope, const WorkletScope::Definition& def, int inputs, const std::vector<int>& outputChannels) {
+    return std::shared_ptr<WorkletProcessor>(new WorkletProcessor(std::move(scope), def, inputs, outputChannels), &WorkletScope::retire);
+  }
+
+  /* ---------- JS thread ---------- */
+
+  // Build the buffers and run the processor's constructor with `options`
+  // (structured-cloned from the node's). Takes the scope lock.
+  bool
+  construct(JSValueConst ctor, const std::vector<std::string>& paramNames, const uint8_t* options, size_t size, std::string& errorText) {
+    scope->enter(true);
+    bool ok = build(ctor, paramNames, options, size, errorText);
+    scope->leave();
+    return ok;
+  }
+
+  /* ---------- render thread, inside scope->enter() ---------- */
+
+  // Hand queued messages to port.onmessage. An exception in a handler is
+  // printed, not fatal, as for any event listener.
+  void
+  deliverMessages() {
+    JSContext* ctx = scope->ctx;
+    while(toProcessor.pop(scratch)) {
+      JSValue data = JS_ReadObject(ctx, scratch.data(), scratch.size(), 0);
+      if(JS_IsException(data)) {
+        JS_FreeValue(ctx, JS_GetException(ctx));
+        continue;
+      }
+      JSValue fn = JS_GetProperty(ctx, port, scope->atomOnmessage);
+      if(JS_IsFunction(ctx, fn)) {
+        JSValue ev = JS_NewObject(ctx);
+        JS_SetPropertyStr(ctx, ev, "data", JS_DupValue(ctx, data));
+        JSValue ret = JS_Call(ctx, fn, port, 1, &ev);
+        if(JS_IsException(ret))
+          fprintf(stderr, "AudioWorkletProcessor port.onmessage: %s\n", WorkletScope::exceptionText(ctx).c_str());
+        JS_FreeValue(ctx, ret);
+        JS_FreeValue(ctx, ev);
+      }
+      JS_FreeValue(ctx, fn);
+      JS_FreeValue(ctx, data);
+    }
+  }
+
+  // Resize input k's channel list; rebuilds its array only on a change.
+  float*
+  input(int k, int c) {
+    return inputArrays[k][c].data;
+  }
+
+  void
+  setInputChannels(int k, int channels) {
+    if(channels == inputChannels[k])
+      return;
+    JSContext* ctx = scope->ctx;
+    while(int(inputArrays[k].size()) < channels)
+      inputArrays[k].push_back(newArray(lab::AudioNode::ProcessingSizeInFrames));
+    JSValue list = JS_NewArray(ctx);
+    for(int c = 0; c < channels; c++)
+      JS_SetPropertyUint32(ctx, list, c, JS_DupValue(ctx, inputArrays[k][c].value));
+    JS_SetPropertyUint32(ctx, inputs, k, list);
+    inputChannels[k] = channels;
+  }
+
+  float*
+  output(int k, int c) {
+    return outputArrays[k][c].data;
+  }
+
+  // Param k's buffer for the quantum's values; call setParamConstant()
+  // once they're in.
+  float*
+  param(int k) {
+    return paramArrays[k].full.data;
+  }
+
+  void
+  setParamConstant(int k, int n) {
+    const float* v = paramArrays[k].full.data;
+    bool constant = kRate[k];
+    if(!constant) {
+      constant = true;
+      for(int i = 1; i < n && constant; i++)
+        constant = v[i] == v[0];
+    }
+    if(constant)
+      paramArrays[k].single.data[0] = v[0];
+    if(constant != paramArrays[k].constant) {
+      auto& a = constant ? paramArrays[k].single : paramArrays[k].full;
+      JS_SetProperty(scope->ctx, parameters, paramAtoms[k], JS_DupValue(scope->ctx, a.value));
+      paramArrays[k].constant = constant;
+    }
+  }
+
+  // process(inputs, outputs, parameters) with the outputs zeroed first;
+  // returns its (truthy) keep-alive answer.
+  bool
+  process(int n) {
+    JSContext* ctx = scope->ctx;
+    for(auto& arrays : outputArrays)
+      for(auto& a : arrays)
+        std::fill(a.data, a.data + n, 0.f);
+
+    JSValue fn = JS_GetProperty(ctx, instance, scope->atomProcess);
+    if(!JS_IsFunction(ctx, fn)) {
+      JS_FreeValue(ctx, fn);
+      fail("process is not a function");
+      return false;
+    }
+    JSValue args[3] = {inputs, outputs, parameters};
+    JSValue ret = JS_Call(ctx, fn, instance, 3, args);
+    JS_FreeValue(ctx, fn);
+    if(JS_IsException(ret)) {
+      fail(WorkletScope::exceptionText(ctx));
+      return false;
+    }
+    bool keepAlive = JS_ToBool(ctx, ret);
+    JS_FreeValue(ctx, ret);
+    return keepAlive;
+  }
+
+  int
+  numberOfInputs() const {
+    return int(inputChannels.size());
+  }
+
+  int
+  numberOfOutputs() const {
+    return int(outputChannels.size());
+  }
+
+  int
+  inputChannelCount(int k) const {
+    return inputChannels[k];
+  }
+
+  int
+  outputChannelCount(int k) const {
+    return outputChannels[k];
+  }
+
+  const std::shared_ptr<WorkletScope>&
+  workletScope() const {
+    return scope;
+  }
+
+  // Worklet side of port.postMessage(), on whichever thread holds the
+  // scope: 1 if queued, 0 if the ring was full, -1 if `value` can't be
+  // cloned (with the exception pending).
+  int
+  postToMain(JSValueConst value) {
+    JSContext* ctx = scope->ctx;
+    size_t size;
+    uint8_t* bytes = JS_WriteObject(ctx, &size, value, 0);
+    if(!bytes)
+      return -1;
+    bool ok = toMain.push(bytes, size);
+    js_free(ctx, bytes);
+    if(ok && scope->wake)
+      scope->wake();
+    return ok;
+  }
+
+private:
+  friend class WorkletScope;
+
+  WorkletProcessor(std::shared_ptr<WorkletScope> scope, const WorkletScope::Definition& def, int inputs, const std::vector<int>& outputChannels)
+      : scope(std::move(scope)), kRate(def.kRate), inputChannels(inputs, 0), outputChannels(outputChannels) {}
+
+  struct Array {
+    JSValue value = JS_UNDEFINED;
+    float* data = nullptr;
+  };
+
+  struct Param {
+    Array full, single;
+    bool constant = false;
+  };
+
+  // A zeroed Float32Array of the worklet runtime and its storage; the
+  // array is held for as long as the pointer is used.
+  Array
+  newArray(int length) {
+    JSContext* ctx = scope->ctx;
+    Array a;
+    JSValue n = JS_NewInt32(ctx, length);
+    a.value = JS_CallConstructor(ctx, scope->float32array, 1, &n);
+    size_t offset, bytes, element, size;
+    JSValue ab = JS_GetTypedArrayBuffer(ctx, a.value, &offset, &bytes, &element);
+    uint8_t* base = JS_GetArrayBuffer(ctx, &size, ab);
+    a.data = reinterpret_cast<float*>(base + offset);
+    JS_FreeValue(ctx, ab);
+    return a;
+  }
+
+  void
+  fail(const std::string& text) {
+    if(failed.load(std::memory_order_relaxed))
+      return;
+    error = text;
+    failed.store(true, std::memory_order_release);
+    if(scope->wake)
+      scope->wake();
+  }
+
+  bool
+  build(JSValueConst ctor, const std::vector<std::string>& paramNames, const uint8_t* options, size_t size, std::string& errorText) {
+    JSContext* ctx = scope->ctx;
+    const int quantum = lab::AudioNode::ProcessingSizeInFrames;
+
+    inputs = JS_NewArray(ctx);
+    inputArrays.resize(inputChannels.size());
+    for(size_t k = 0; k < inputChannels.size(); k++)
+      JS_SetPropertyUint32(ctx, inputs, k, JS_NewArray(ctx));
+
+    outputs = JS_NewArray(ctx);
+    outputArrays.resize(outputChannels.size());
+    for(size_t k = 0; k < outputChannels.size(); k++) {
+      JSValue list = JS_NewArray(ctx);
+      for(int c = 0; c < outputChannels[k]; c++) {
+        outputArrays[k].push_back(newArray(quantum));
+        JS_SetPropertyUint32(ctx, list, c, JS_DupValue(ctx, outputArrays[k][c].value));
+      }
+      JS_SetPropertyUint32(ctx, outputs, k, list);
+    }
+
+    parameters = JS_NewObject(ctx);
+    for(const auto& name : paramNames) {
+      Param p;
+      p.full = newArray(quantum);
+      p.single = newArray(1);
+      p.constant = true;
+      JSAtom atom = JS_NewAtom(ctx, name.c_str());
+      JS_SetProperty(ctx, parameters, atom, JS_DupValue(ctx, p.single.value));
+      paramArrays.push_back(p);
+      paramAtoms.push_back(atom);
+    }
+
+    port = JS_NewObjectClass(ctx, WorkletScope::portClassId);
+    JS_SetOpaque(port, this);
+
+    JSValue opts = JS_ReadObject(ctx, options, size, 0);
+    if(JS_IsException(opts)) {
+      errorText = WorkletScope::exceptionText(ctx);
+      return false;
+    }
+    JS_FreeValue(ctx, scope->pendingPort);
+    scope->pendingPort = JS_DupValue(ctx, port);
+    instance = JS_CallConstructor(ctx, ctor, 1, &opts);
+    JS_FreeValue(ctx, opts);
+    JS_FreeValue(ctx, scope->pendingPort);
+    scope->pendingPort = JS_UNDEFINED;
+    if(JS_IsException(instance)) {
+      errorText = WorkletScope::exceptionText(ctx);
+      return false;
+    }
+    if(!JS_IsObject(instance)) {
+      errorText = "the processor constructor did not return an object";
+      return false;
+    }
+    return true;
+  }
+
+  std::shared_ptr<WorkletScope> scope;
+  std::vector<bool> kRate;
+  std::vector<int> inputChannels, outputChannels;
+
+  JSValue instance = JS_UNDEFINED, port = JS_UNDEFINED, inputs = JS_UNDEFINED, outputs = JS_UNDEFINED, parameters = JS_UNDEFINED;
+  std::vector<std::vector<Array>> inputArrays, outputArrays;
+  std::vector<Param> paramArrays;
+  std::vector<JSAtom> paramAtoms;
+  std::vector<uint8_t> scratch;
+  WorkletProcessor* nextRetired = nullptr;
+
+  // Its values in the runtime, from WorkletScope::freeRetired(); `scope`
+  // is gone by then.
+  void
+  release(JSContext* ctx) {
+    // The processor may have stashed its port somewhere; disarm it.
+    if(JS_IsObject(port))
+      JS_SetOpaque(port, nullptr);
+    for(JSValue v : {instance, port, inputs, outputs, parameters})
+      JS_FreeValue(ctx, v);
+    for(auto* list : {&inputArrays, &outputArrays})
+      for(auto& arrays : *list)
+        for(auto& a : arrays)
+          JS_FreeValue(ctx, a.value);
+    for(auto& p : paramArrays) {
+      JS_FreeValue(ctx, p.full.value);
+      JS_FreeValue(ctx, p.single.value);
+    }
+    for(JSAtom a : paramAtoms)
+      JS_FreeAtom(ctx, a);
+  }
+};
+
+inline void
+WorkletScope::retire(WorkletProcessor* p) {
+  // Out of the processor first: once it's listed, collect() may free it.
+  // This may be the last reference, the context being gone, and the
+  // scope's destructor then frees the list.
+  std::shared_ptr<WorkletScope> scope = std::move(p->scope);
+  p->nextRetired = scope->retired.load(std::memory_order_relaxed);
+  while(!scope->retired.compare_exchange_weak(p->nextRetired, p, std::memory_order_release, std::memory_order_relaxed)) {
+  }
+}
+
+inline void
+WorkletScope::freeRetired() {
+  WorkletProcessor* p = retired.exchange(nullptr, std::memory_order_acquire);
+  while(p) {
+    WorkletProcessor* next = p->nextRetired;
+    p->release(ctx);
+    delete p;
+    p = next;
+  }
+}
+
+inline JSValue
+WorkletScope::portPostMessage(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  WorkletProcessor* p = static_cast<WorkletProcessor*>(JS_GetOpaque(this_val, portClassId));
+  if(!p)
+    return JS_ThrowTypeError(ctx, "postMessage: the port's node is gone");
+  // A full ring drops the message (and returns false): the render thread
+  // can't wait for the JS thread to catch up.
+  int ret = p->postToMain(argc > 0 ? argv[0] : JS_UNDEFINED);
+  return ret < 0 ? JS_EXCEPTION : JS_NewBool(ctx, ret > 0);
+}
+
+/* ---------- AudioWorkletNode ---------- */
+
+class AudioWorkletProcessorNode : private DynamicParams, public lab::AudioNode {
+public:
+  AudioWorkletProcessorNode(lab::AudioContext& ac, std::shared_ptr<WorkletProcessor> processor, const std::vector<Spec>& specs)
+      : DynamicParams(specs, processor->numberOfOutputs() ? processor->outputChannelCount(0) : 2), lab::AudioNode(ac, descriptor), processor(std::move(processor)) {
+    for(const auto& s : this->specs)
+      params.push_back(param(s.name.c_str()));
+    initialize();
+  }
+
+  virtual ~AudioWorkletProcessorNode() {
+    uninitialize();
+  }
+
+  const char*
+  name() const override {
+    return "AudioWorklet";
+  }
+
+  int
+  numberOfParams() const {
+    return int(params.size());
+  }
+
+  std::shared_ptr<lab::AudioParam>
+  workletParam(int k) const {
+    return params.at(k);
+  }
+
+  const std::string&
+  paramName(int k) const {
+    return specs.at(k).name;
+  }
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    WorkletScope& scope = *processor->workletScope();
+    const int n = std::min(bufferSize, int(ProcessingSizeInFrames));
+
+    if(processor->failed.load(std::memory_order_relaxed) || !scope.enter(scope.isOffline())) {
+      if(!processor->failed.load(std::memory_order_relaxed))
+        scope.skippedQuanta.fetch_add(1, std::memory_order_relaxed);
+      for(int k = 0; k < numberOfOutputs(); k++)
+        output(k)->bus(r)->zero();
+      return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    scope.beginQuantum(r.context()->currentSampleFrame(), r.context()->currentTime(), bufferSize);
+    processor->deliverMessages();
+
+    for(int k = 0; k < processor->numberOfInputs(); k++) {
+      lab::AudioBus* bus = input(k)->isConnected() ? input(k)->bus(r) : nullptr;
+      int channels = bus ? bus->numberOfChannels() : 0;
+      processor->setInputChannels(k, channels);
+      for(int c = 0; c < channels; c++)
+        memcpy(processor->input(k, c), bus->channel(c)->data(), n * sizeof(float));
+    }
+    for(int k = 0; k < int(params.size()); k++) {
+      params[k]->calculateSampleAccurateValues(r, processor->param(k), n);
+      processor->setParamConstant(k, n);
+    }
+
+    keepAlive = processor->process(n);
+
+    for(int k = 0; k < processor->numberOfOutputs(); k++) {
+      lab::AudioBus* bus = output(k)->bus(r);
+      for(int c = 0; c < bus->numberOfChannels(); c++) {
+        float* dst = bus->channel(c)->mutableData();
+        if(c < processor->outputChannelCount(k))
+          memcpy(dst, processor->output(k, c), n * sizeof(float));
+        else
+          std::fill(dst, dst + n, 0.f);
+      }
+      bus->clearSilentFlag();
+    }
+    scope.addTime(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    scope.leave();
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {}
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // process() returning true keeps the node rendering with silent (or no)
+  // inputs, e.g. a generator; false lets lab skip it until input arrives.
+  bool
+  propagatesSilence(lab::ContextRenderLock&) const override {
+    return !keepAlive || processor->failed.load(std::memory_order_relaxed);
+  }
+
+private:
+  std::shared_ptr<WorkletProcessor> processor;
+  std::vector<std::shared_ptr<lab::AudioParam>> params;
+  bool keepAlive = true;
+};
@@ -0,0 +1,349 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioParam.h"
+#include "LabSound/extended/AudioContextLock.h"
+
+/* ============================================================
+ * Composite effect nodes.
+ *
+ * effects.js builds its delays out of stock nodes -- createPingPongDelay()
+ * is eight of them (delays, feedback gain, panners, mixers), each pulled
+ * separately per quantum with its own bus and summing junction, and the
+ * feedback cycle only closes once per quantum. The nodes here implement
+ * the same blocks as one lab::AudioNode each: one input, one stereo
+ * output, one per-sample loop, and a feedback path that closes inside
+ * that loop (so delay times shorter than a quantum work too).
+ *
+ * CompositeEffectNode is the shared base: it owns the a-rate parameters
+ * declared in the subclass's descriptor and hands process() per-sample
+ * value arrays for them, so a new block is a descriptor plus a loop.
+ * ============================================================ */
+
+// Fractional delay line, linearly interpolated.
+class DelayLine {
+public:
+  void
+  init(size_t maxFrames) {
+    buf.assign(maxFrames + 2, 0.f);
+    pos = 0;
+  }
+
+  void
+  clear() {
+    std::fill(buf.begin(), buf.end(), 0.f);
+  }
+
+  size_t
+  maxFrames() const {
+    return buf.size() - 2;
+  }
+
+  // The sample written `delay` frames ago, 1 <= delay <= maxFrames().
+  float
+  read(float delay) const {
+    const size_t n = buf.size();
+    delay = std::clamp(delay, 1.f, float(n - 2));
+    size_t i = size_t(delay);
+    float frac = delay - float(i);
+    float a = buf[(pos + n - i) % n], b = buf[(pos + n - i - 1) % n];
+    return a + (b - a) * frac;
+  }
+
+  void
+  write(float x) {
+    buf[pos] = x;
+    if(++pos == buf.size())
+      pos = 0;
+  }
+
+private:
+  std::vector<float> buf;
+  size_t pos = 0;
+};
+
+class CompositeEffectNode : public lab::AudioNode {
+public:
+  CompositeEffectNode(lab::AudioContext& ac, const lab::AudioNodeDescriptor& d) : lab::AudioNode(ac, d), descriptors(d.params) {
+    for(const lab::AudioParamDescriptor* p = d.params; p && p->name; p++)
+      params.push_back(param(p->name));
+    values.resize(params.size());
+    for(auto& v : values)
+      v.resize(ProcessingSizeInFrames);
+  }
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    lab::AudioBus* out = output(0)->bus(r);
+    lab::AudioBus* in = input(0)->bus(r);
+    if(!in || !input(0)->isConnected()) {
+      in = nullptr;
+      if(tailTime(r) <= 0) {
+        out->zero();
+        return;
+      }
+    }
+
+    // Grows only if the context's quantum is larger than the default.
+    for(size_t i = 0; i < params.size(); i++) {
+      if(int(values[i].size()) < bufferSize)
+        values[i].resize(bufferSize);
+      params[i]->calculateSampleAccurateValues(r, values[i].data(), bufferSize);
+    }
+    if(int(silence.size()) < bufferSize)
+      silence.assign(bufferSize, 0.f);
+
+    const float* src[2];
+    for(int c = 0; c < 2; c++)
+      src[c] = in ? in->channel(std::min(c, in->numberOfChannels() - 1))->data() : silence.data();
+    float* dst[2] = {out->channel(0)->mutableData(), out->channel(1)->mutableData()};
+
+    render(src, dst, bufferSize, r.context()->sampleRate());
+    out->clearSilentFlag();
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // Parameters in descriptor order (the subclass's enum), null-terminated.
+  const lab::AudioParamDescriptor*
+  paramDescriptors() const {
+    return descriptors;
+  }
+
+  std::shared_ptr<lab::AudioParam>
+  effectParam(int i) const {
+    return params.at(i);
+  }
+
+protected:
+  // Stereo in, stereo out; a mono input arrives as the same channel twice.
+  virtual void render(const float* const* in, float* const* out, int frames, float sampleRate) = 0;
+
+  const float*
+  paramValues(int i) const {
+    return values[i].data();
+  }
+
+  std::vector<std::shared_ptr<lab::AudioParam>> params;
+
+private:
+  const lab::AudioParamDescriptor* descriptors;
+  std::vector<std::vector<float>> values;
+  std::vector<float> silence;
+};
+
+/* ---------- FeedbackDelayNode ---------- */
+
+// Per-channel delay with a feedback loop: createDelay() in one node.
+class FeedbackDelayNode : public CompositeEffectNode {
+public:
+  enum { DELAY_TIME, FEEDBACK, WET, DRY };
+
+  FeedbackDelayNode(lab::AudioContext& ac, double maxDelayTime) : CompositeEffectNode(ac, *desc()), maxDelay(maxDelayTime) {
+    for(auto& line : lines)
+      line.init(size_t(std::ceil(maxDelayTime * ac.sampleRate())) + 1);
+    initialize();
+  }
+
+  virtual ~FeedbackDelayNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioParamDescriptor p[] = {
+        {"delayTime", "DLAY", 0.3, 0, 180},
+        {"feedback", "FDBK", 0.4, -1, 1},
+        {"wet", "WET ", 1, 0, 10},
+        {"dry", "DRY ", 0, 0, 10},
+        {nullptr},
+    };
+    static lab::AudioNodeDescriptor d{p, nullptr, 2};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "FeedbackDelay";
+  }
+
+  double
+  maxDelayTime() const {
+    return maxDelay;
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {
+    for(auto& line : lines)
+      line.clear();
+  }
+
+  // Until the echoes have decayed by 60 dB.
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return echoTail(params[DELAY_TIME]->value(), params[FEEDBACK]->value(), 1);
+  }
+
+  static double
+  echoTail(double delay, double feedback, int taps) {
+    double fb = std::min(std::fabs(feedback), 0.999);
+    double repeats = fb > 0.001 ? std::ceil(std::log(0.001) / std::log(fb)) : 1;
+    return std::max(0.0, delay) * (repeats + taps - 1);
+  }
+
+protected:
+  void
+  render(const float* const* in, float* const* out, int frames, float sampleRate) override {
+    const float *time = paramValues(DELAY_TIME), *feedback = paramValues(FEEDBACK);
+    const float *wet = paramValues(WET), *dry = paramValues(DRY);
+    for(int c = 0; c < 2; c++) {
+      DelayLine& line = lines[c];
+      for(int i = 0; i < frames; i++) {
+        float x = in[c][i];
+        float y = line.read(time[i] * sampleRate);
+        line.write(x + y * std::clamp(feedback[i], -0.999f, 0.999f));
+        out[c][i] = x * dry[i] + y * wet[i];
+      }
+    }
+  }
+
+private:
+  DelayLine lines[2];
+  double maxDelay;
+};
+
+/* ---------- PingPongDelayNode ---------- */
+
+// createPingPongDelay() in one node: the input (summed to mono) feeds the
+// left tap, the left tap feeds the right one, and the right tap feeds back
+// into the left, so echoes alternate L, R, L, ... every delayTime.
+class PingPongDelayNode : public CompositeEffectNode {
+public:
+  enum { DELAY_TIME, FEEDBACK, WET, DRY };
+
+  PingPongDelayNode(lab::AudioContext& ac, double maxDelayTime) : CompositeEffectNode(ac, *desc()), maxDelay(maxDelayTime) {
+    for(auto& line : lines)
+      line.init(size_t(std::ceil(maxDelayTime * ac.sampleRate())) + 1);
+    initialize();
+  }
+
+  virtual ~PingPongDelayNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioParamDescriptor p[] = {
+        {"delayTime", "DLAY", 0.375, 0, 180},
+        {"feedback", "FDBK", 0.45, -1, 1},
+        {"wet", "WET ", 1, 0, 10},
+        {"dry", "DRY ", 0, 0, 10},
+        {nullptr},
+    };
+    static lab::AudioNodeDescriptor d{p, nullptr, 2};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "PingPongDelay";
+  }
+
+  double
+  maxDelayTime() const {
+    return maxDelay;
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {
+    for(auto& line : lines)
+      line.clear();
+  }
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return FeedbackDelayNode::echoTail(params[DELAY_TIME]->value(), params[FEEDBACK]->value(), 2);
+  }
+
+protected:
+  void
+  render(const float* const* in, float* const* out, int frames, float sampleRate) override {
+    const float *time = paramValues(DELAY_TIME), *feedback = paramValues(FEEDBACK);
+    const float *wet = paramValues(WET), *dry = paramValues(DRY);
+    DelayLine &left = lines[0], &right = lines[1];
+    for(int i = 0; i < frames; i++) {
+      float d = time[i] * sampleRate;
+      float l = left.read(d), r = right.read(d);
+      left.write((in[0][i] + in[1][i]) * 0.5f + r * std::clamp(feedback[i], -0.999f, 0.999f));
+      right.write(l);
+      out[0][i] = in[0][i] * dry[i] + l * wet[i];
+      out[1][i] = in[1][i] * dry[i] + r * wet[i];
+    }
+  }
+
+private:
+  DelayLine lines[2];
+  double maxDelay;
+};
+
+/* ---------- StereoWidthNode ---------- */
+
+// Mid/side width: 0 folds to mono, 1 passes through, >1 widens.
+class StereoWidthNode : public CompositeEffectNode {
+public:
+  enum { WIDTH };
+
+  explicit StereoWidthNode(lab::AudioContext& ac) : CompositeEffectNode(ac, *desc()) {
+    initialize();
+  }
+
+  virtual ~StereoWidthNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioParamDescriptor p[] = {
+        {"width", "WDTH", 1, 0, 4},
+        {nullptr},
+    };
+    static lab::AudioNodeDescriptor d{p, nullptr, 2};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "StereoWidth";
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {}
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+protected:
+  void
+  render(const float* const* in, float* const* out, int frames, float) override {
+    const float* width = paramValues(WIDTH);
+    for(int i = 0; i < frames; i++) {
+      float mid = (in[0][i] + in[1][i]) * 0.5f;
+      float side = (in[0][i] - in[1][i]) * 0.5f * width[i];
+      out[0][i] = mid + side;
+      out[1][i] = mid - side;
+    }
+  }
+};
@@ -0,0 +1,59 @@
+// ctx.createGraph(): one call per hit vs. one call per node, connection,
+// automation event and start.
+//
+// Builds HITS djembe hits from drumsampler.js into an OfflineAudioContext,
+// first through the per-call fallback the same function uses where
+// createGraph() doesn't exist and then through createGraph(), and prints the
+// build time per hit for each. Both ways construct the nodes one at a
+// time and queue the connections for lab's update thread, so the gap is
+// what the crossings and argument conversion cost. Each is rendered
+// afterwards and its peak printed, which should match between the two.
+
+import { djembe } from './drumsampler.js';
+
+const isBrowser = typeof globalThis.window !== 'undefined';
+
+const SR = 48000;
+const HITS = 2000;
+const SPACING = 0.01;
+
+async function bench(env, oneCall) {
+  const length = Math.ceil((HITS * SPACING + 1) * SR);
+  const ctx = new env.OfflineAudioContext({ numberOfChannels: 1, length, sampleRate: SR });
+  // djembe() takes the per-call path when the context has no createGraph.
+  if(!oneCall)
+    ctx.createGraph = undefined;
+
+  const t0 = Date.now();
+  for(let i = 0; i < HITS; i++)
+    djembe(ctx, env, i * SPACING).connect(ctx.destination);
+  const build = Math.max(1, Date.now() - t0);
+
+  const buffer = await ctx.startRendering();
+  const data = buffer.getChannelData(0);
+  let peak = 0;
+  for(let i = 0; i < data.length; i++)
+    peak = Math.max(peak, Math.abs(data[i]));
+
+  return { build, perHit: (build * 1000) / HITS, peak };
+}
+
+async function main() {
+  const env = isBrowser ? globalThis : await import('labsound');
+  if(typeof env.OfflineAudioContext.prototype.createGraph !== 'function') {
+    console.log('no ctx.createGraph() here; nothing to compare');
+    return;
+  }
+
+  console.log(`${HITS} djembe hits\n`);
+  console.log('  way          build ms   us per hit   peak');
+
+  const perCall = await bench(env, false);
+  const oneCall = await bench(env, true);
+  for(const [name, r] of [['per call', perCall], ['createGraph', oneCall]])
+    console.log(`  ${name.padEnd(11)}  ${String(r.build).padStart(8)}  ${r.perHit.toFixed(1).padStart(11)}  ${r.peak.toFixed(3)}`);
+
+  console.log(`\ncreateGraph builds a hit ${(perCall.build / oneCall.build).toFixed(2)}x as fast`);
+}
+
+main();
@@ -2,7 +2,9 @@
 //
 // Sample-based: kick / snare / hihat etc. — load a WAV via AudioContext and
 // register it with loadSample(name, buffer). Every trigger() spawns a fresh
-// AudioBufferSourceNode (the WebAudio idiom for sample playback).
+// AudioBufferSourceNode (the WebAudio idiom for sample playback), unless the
+// runtime provides SamplerVoicePool (qjs-labsound): then sample hits go to a
+// pool of preallocated native voices and build no nodes at all.
 //
 // Procedural: tom / cymbal / conga / djembe — synthesized from oscillators
 // + noise + filters + envelopes. Each defineVoice(name, fn) registers a
@@ -10,8 +12,8 @@
 // output AudioNode.
 //
 // Runtime-agnostic: pass in the runtime env ({ GainNode, OscillatorNode,
-// NoiseNode, BiquadFilterNode, AudioBufferSourceNode }) so the same file
-// works in qjs and the browser.
+// NoiseNode, BiquadFilterNode, AudioBufferSourceNode, optionally
+// SamplerVoicePool }) so the same file works in qjs and the browser.
 
 export class DrumSampler {
   constructor(ctx, env, opts = {}) {
@@ -19,6 +21,10 @@ export class DrumSampler {
     this.env = env;
     this.master = new env.GainNode(ctx, { gain: opts.gain ?? 0.7 });
     this.voices = new Map();
+    if(env.SamplerVoicePool) {
+      this.pool = new env.SamplerVoicePool(ctx, { voices: opts.voices ?? 32 });
+      this.pool.connect(this.master);
+    }
   }
 
   connect(dest) { return this.master.connect(dest); }
@@ -39,6 +45,11 @@ export class DrumSampler {
     const v = this.voices.get(name);
     if(!v) throw new Error(`unknown drum voice: ${name}`);
 
+    if(v.kind === 'sample' && this.pool) {
+      this.pool.trigger(v.buffer, t, opts);
+      return;
+    }
+
     // Per-hit gain so each trigger can have its own velocity.
     const hitGain = new this.env.GainNode(this.ctx, { gain: opts.gain ?? 1.0 });
 
@@ -122,6 +133,33 @@ export function conga(ctx, env, t, { freq = 240, decay = 0.25 } = {}) {
 
 // Djembe: pitched sine + highpassed noise. Sine is the body, noise is the slap.
 export function djembe(ctx, env, t, { freq = 180, decay = 0.3 } = {}) {
+  // qjs-labsound builds, wires and schedules the whole hit in one call.
+  if(typeof ctx.createGraph === 'function') {
+    const nodes = ctx.createGraph({
+      nodes: [
+        ['OscillatorNode', { type: 'sine', frequency: freq * 1.8 }],
+        ['NoiseNode', { type: 'white' }],
+        ['BiquadFilterNode', { type: 'highpass', frequency: 900, Q: 0.7 }],
+        ['GainNode', { gain: 0 }],
+        ['GainNode', { gain: 0 }],
+        ['GainNode', { gain: 1.0 }],
+      ],
+      connections: [0, 3, 3, 5, 1, 2, 2, 4, 4, 5],
+      automation: [
+        [0, 'frequency', 'setValueAtTime', freq * 1.8, t],
+        [0, 'frequency', 'exponentialRampToValueAtTime', freq, t + 0.04],
+        [3, 'gain', 'setValueAtTime', 0, t],
+        [3, 'gain', 'linearRampToValueAtTime', 0.7, t + 0.003],
+        [3, 'gain', 'exponentialRampToValueAtTime', 0.001, t + decay],
+        [4, 'gain', 'setValueAtTime', 0, t],
+        [4, 'gain', 'linearRampToValueAtTime', 0.3, t + 0.003],
+        [4, 'gain', 'exponentialRampToValueAtTime', 0.001, t + decay * 0.4],
+      ],
+      start: [[0, t, t + decay + 0.05], [1, t, t + decay + 0.05]],
+    });
+    return nodes[5];
+  }
+
   const osc    = new env.OscillatorNode(ctx, { type: 'sine', frequency: freq * 1.8 });
   const noise  = new env.NoiseNode(ctx, { type: 'white' });
   const hp     = new env.BiquadFilterNode(ctx, { type: 'highpass', frequency: 900, Q: 0.7 });
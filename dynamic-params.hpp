@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioParam.h"
+
+/* ============================================================
+ * AudioParams named at construction.
+ *
+ * lab::AudioNode creates its params from a descriptor list that is
+ * usually a static array. ExpressionNode and AudioWorkletNode only learn
+ * theirs from the options object, so DynamicParams builds the list per
+ * node. lab keeps pointers into it, so it must outlive the node; derive
+ * from it before lab::AudioNode so it is built first and destroyed last.
+ * ============================================================ */
+
+struct DynamicParams {
+  struct Spec {
+    std::string name;
+    float defaultValue = 0, minValue = -3.4e38f, maxValue = 3.4e38f;
+  };
+
+  DynamicParams(const std::vector<Spec>& specs, int channels) : specs(specs), descriptor{describe(), nullptr, channels} {}
+
+  // lab's descriptors have const members, so build the list in place and
+  // hand the node descriptor its address.
+  const lab::AudioParamDescriptor*
+  describe() {
+    descriptors.reserve(specs.size() + 1);
+    for(const auto& s : specs)
+      descriptors.push_back(lab::AudioParamDescriptor{s.name.c_str(), s.name.c_str(), s.defaultValue, s.minValue, s.maxValue});
+    descriptors.push_back(lab::AudioParamDescriptor{nullptr, nullptr, 0, 0, 0});
+    return descriptors.data();
+  }
+
+  std::vector<Spec> specs;
+  std::vector<lab::AudioParamDescriptor> descriptors;
+  lab::AudioNodeDescriptor descriptor;
+};
@@ -23,6 +23,23 @@ export function makeFuzzCurve(drive = 30, steps = 16, size = 1024) {
   return curve;
 }
 
+// tanh saturation with the same shape as makeDistortionCurve(drive), level
+// compensated. Native ExpressionNode when available, where `drive` is an
+// a-rate AudioParam and can be swept; in a browser it's a WaveShaperNode
+// whose curve is fixed at `drive`, and `drive` is null.
+export function createSaturator(ctx, env, { drive = 6 } = {}) {
+  if(env.ExpressionNode) {
+    const node = new env.ExpressionNode(ctx, {
+      expr: 'tanh(x * drive) / tanh(drive)',
+      params: [{ name: 'drive', defaultValue: drive, minValue: 0.1, maxValue: 100 }],
+    });
+    return { input: node, output: node, drive: node.parameters.drive };
+  }
+  const curve = makeDistortionCurve(drive).map(y => y / Math.tanh(drive));
+  const node = new env.WaveShaperNode(ctx, { curve, oversample: '2x' });
+  return { input: node, output: node, drive: null };
+}
+
 // Mono delay with feedback loop. Returns an effect block exposing `input`
 // (where source signal goes) and `output` (the delayed signal). The dry
 // signal is NOT mixed in here — connect both the dry source and `output` to
@@ -30,7 +47,14 @@ export function makeFuzzCurve(drive = 30, steps = 16, size = 1024) {
 //
 //   source ──┬──> dest
 //            └──> delay.input;  delay.output ──> dest
+//
+// With a native FeedbackDelayNode (qjs) the whole block is one node; `delay`
+// and `feedback` then expose its params under the same names as before.
 export function createDelay(ctx, env, { time = 0.3, feedback = 0.4, maxDelayTime = 2.0 } = {}) {
+  if(env.FeedbackDelayNode) {
+    const node = new env.FeedbackDelayNode(ctx, { delayTime: time, feedback, maxDelayTime });
+    return { input: node, output: node, delay: { delayTime: node.delayTime }, feedback: { gain: node.feedback } };
+  }
   const delay = new env.DelayNode(ctx, { delayTime: time, maxDelayTime });
   const fb = new env.GainNode(ctx, { gain: feedback });
   delay.connect(fb);
@@ -41,7 +65,16 @@ export function createDelay(ctx, env, { time = 0.3, feedback = 0.4, maxDelayTime
 // Ping-pong delay: alternating L/R taps with shared feedback. Input is mono,
 // output is a stereo signal already panned. Connect the source to `input`
 // and connect `output` to wherever (e.g. master).
+//
+// Uses the native PingPongDelayNode when the env has one (same taps, one node
+// instead of eight). Its taps share one delayTime, so `left` and `right` are
+// both that AudioParam as `{ delayTime }`: setting either retimes both.
 export function createPingPongDelay(ctx, env, { time = 0.375, feedback = 0.45 } = {}) {
+  if(env.PingPongDelayNode) {
+    const node = new env.PingPongDelayNode(ctx, { delayTime: time, feedback, maxDelayTime: 4.0 });
+    const tap = { delayTime: node.delayTime };
+    return { input: node, output: node, node, left: tap, right: tap, delayTime: node.delayTime, feedback: { gain: node.feedback } };
+  }
   const split  = new env.GainNode(ctx, { gain: 1.0 });
   const dL     = new env.DelayNode(ctx, { delayTime: time, maxDelayTime: 4.0 });
   const dR     = new env.DelayNode(ctx, { delayTime: time, maxDelayTime: 4.0 });
@@ -61,3 +94,32 @@ export function createPingPongDelay(ctx, env, { time = 0.375, feedback = 0.45 }
 
   return { input: split, output: out, left: dL, right: dR, feedback: fb };
 }
+
+// Mid/side stereo width: 0 = mono, 1 = unchanged, 2 = twice the side signal.
+// Native StereoWidthNode when available (`width` is its AudioParam); in a
+// browser it's a splitter/merger M/S matrix whose `side` gain is width / 2.
+// qjs-labsound has no ChannelSplitterNode/ChannelMergerNode (TODO item 7),
+// so there it's the native node or nothing.
+export function createStereoWidth(ctx, env, { width = 1.0 } = {}) {
+  if(env.StereoWidthNode) {
+    const node = new env.StereoWidthNode(ctx, { width });
+    return { input: node, output: node, width: node.width };
+  }
+  if(!env.ChannelSplitterNode || !env.ChannelMergerNode)
+    throw new Error('createStereoWidth: needs StereoWidthNode or ChannelSplitterNode/ChannelMergerNode');
+  const input = new env.GainNode(ctx, { gain: 1.0 });
+  const split = new env.ChannelSplitterNode(ctx, { numberOfOutputs: 2 });
+  const merge = new env.ChannelMergerNode(ctx, { numberOfInputs: 2 });
+  const mid = new env.GainNode(ctx, { gain: 0.5 });
+  const side = new env.GainNode(ctx, { gain: 0.5 * width });
+  const invR = new env.GainNode(ctx, { gain: -1 });
+  const invS = new env.GainNode(ctx, { gain: -1 });
+  input.connect(split);
+  // mid = (L + R) / 2, side = (L - R) / 2 * width
+  split.connect(mid, 0); split.connect(mid, 1);
+  split.connect(side, 0); split.connect(invR, 1); invR.connect(side);
+  // L = mid + side, R = mid - side
+  mid.connect(merge, 0, 0); side.connect(merge, 0, 0);
+  mid.connect(merge, 0, 1); side.connect(invS); invS.connect(merge, 0, 1);
+  return { input, output: merge, side };
+}
@@ -0,0 +1,659 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioParam.h"
+#include "LabSound/extended/AudioContextLock.h"
+#include "dynamic-params.hpp"
+
+/* ============================================================
+ * Per-sample math compiled from an expression.
+ *
+ * ExpressionProgram parses a small C-like expression language once and
+ * compiles it to a flat list of block operations: every instruction runs
+ * over a whole quantum (one simple loop per operator, which the compiler
+ * vectorizes), its result is a register the later instructions read, and
+ * operations on constants are folded away at compile time. ExpressionNode
+ * runs the program once per output channel inside process(), so custom
+ * DSP costs what the same loops written in C++ would -- there is no
+ * callback into QuickJS.
+ *
+ * The language:
+ *
+ *   in0 .. in7  input k (x and in are in0); channel c reads channel c of
+ *               the input, its last one if it has fewer, or silence
+ *   p0 .. pN    the node's a-rate AudioParams, also by name
+ *   t, sr, ch   context time in seconds (a float: coarser than a sample
+ *               after a few minutes), sample rate, output channel
+ *   pi, e       constants
+ *   + - * / %   arithmetic (% is fmod), ^ power (right-associative)
+ *   < > <= >= == != && || !   comparisons and logic, 1 or 0
+ *   c ? a : b   select (both sides are evaluated)
+ *   sin cos tan asin acos atan atan2 sinh cosh tanh exp log log2 log10
+ *   sqrt abs sign floor ceil round fract min max pow fmod clamp mix step
+ * ============================================================ */
+
+class ExpressionProgram {
+public:
+  enum { MAX_INPUTS = 8, MAX_INSTRUCTIONS = 1024 };
+
+  enum Op {
+    // Sources: the register points at data rather than being computed.
+    CONST,
+    INPUT,
+    PARAM,
+    TIME,
+    CHANNEL,
+    // Unary
+    NEG,
+    NOT,
+    SIN,
+    COS,
+    TAN,
+    ASIN,
+    ACOS,
+    ATAN,
+    SINH,
+    COSH,
+    TANH,
+    EXP,
+    LOG,
+    LOG2,
+    LOG10,
+    SQRT,
+    ABS,
+    SIGN,
+    FLOOR,
+    CEIL,
+    ROUND,
+    FRACT,
+    // Binary
+    ADD,
+    SUB,
+    MUL,
+    DIV,
+    MOD,
+    POW,
+    ATAN2,
+    MIN,
+    MAX,
+    LT,
+    GT,
+    LE,
+    GE,
+    EQ,
+    NE,
+    AND,
+    OR,
+    STEP,
+    // Ternary
+    SELECT,
+    CLAMP,
+    MIX,
+  };
+
+  struct Instruction {
+    Op op;
+    int a = -1, b = -1, c = -1; // operand registers
+    int index = 0;              // INPUT / PARAM number
+    float value = 0;            // CONST
+  };
+
+  std::string expression;
+  std::vector<Instruction> code;
+  int result = -1;
+  int inputs = 0; // highest input referenced + 1
+
+  // Compile `expr`; parameter k is `params[k]` or pk. On failure returns
+  // false with a message naming the offending position in `error`.
+  bool
+  compile(const std::string& expr, const std::vector<std::string>& params, float sampleRate, std::string& error) {
+    src = expr.c_str();
+    pos = 0;
+    paramNames = params;
+    this->sampleRate = sampleRate;
+    code.clear();
+    inputs = 0;
+    depth = 0;
+    err.clear();
+    next();
+    int r = parseTernary();
+    if(err.empty() && tok != END)
+      fail("unexpected '" + text + "'");
+    if(err.empty() && int(code.size()) > MAX_INSTRUCTIONS)
+      fail("expression too large");
+    if(!err.empty()) {
+      error = err;
+      code.clear();
+      return false;
+    }
+    expression = expr;
+    result = r;
+    return true;
+  }
+
+  // Run one instruction over n frames; a, b, c are its operands' data.
+  static void
+  exec(Op op, float* d, const float* a, const float* b, const float* c, int n) {
+    switch(op) {
+      case NEG: return map1(d, a, n, [](float x) { return -x; });
+      case NOT: return map1(d, a, n, [](float x) { return x == 0.f ? 1.f : 0.f; });
+      case SIN: return map1(d, a, n, [](float x) { return std::sin(x); });
+      case COS: return map1(d, a, n, [](float x) { return std::cos(x); });
+      case TAN: return map1(d, a, n, [](float x) { return std::tan(x); });
+      case ASIN: return map1(d, a, n, [](float x) { return std::asin(x); });
+      case ACOS: return map1(d, a, n, [](float x) { return std::acos(x); });
+      case ATAN: return map1(d, a, n, [](float x) { return std::atan(x); });
+      case SINH: return map1(d, a, n, [](float x) { return std::sinh(x); });
+      case COSH: return map1(d, a, n, [](float x) { return std::cosh(x); });
+      case TANH: return map1(d, a, n, [](float x) { return std::tanh(x); });
+      case EXP: return map1(d, a, n, [](float x) { return std::exp(x); });
+      case LOG: return map1(d, a, n, [](float x) { return std::log(x); });
+      case LOG2: return map1(d, a, n, [](float x) { return std::log2(x); });
+      case LOG10: return map1(d, a, n, [](float x) { return std::log10(x); });
+      case SQRT: return map1(d, a, n, [](float x) { return std::sqrt(x); });
+      case ABS: return map1(d, a, n, [](float x) { return std::fabs(x); });
+      case SIGN: return map1(d, a, n, [](float x) { return float((x > 0.f) - (x < 0.f)); });
+      case FLOOR: return map1(d, a, n, [](float x) { return std::floor(x); });
+      case CEIL: return map1(d, a, n, [](float x) { return std::ceil(x); });
+      case ROUND: return map1(d, a, n, [](float x) { return std::round(x); });
+      case FRACT: return map1(d, a, n, [](float x) { return x - std::floor(x); });
+      case ADD: return map2(d, a, b, n, [](float x, float y) { return x + y; });
+      case SUB: return map2(d, a, b, n, [](float x, float y) { return x - y; });
+      case MUL: return map2(d, a, b, n, [](float x, float y) { return x * y; });
+      case DIV: return map2(d, a, b, n, [](float x, float y) { return x / y; });
+      case MOD: return map2(d, a, b, n, [](float x, float y) { return std::fmod(x, y); });
+      case POW: return map2(d, a, b, n, [](float x, float y) { return std::pow(x, y); });
+      case ATAN2: return map2(d, a, b, n, [](float x, float y) { return std::atan2(x, y); });
+      case MIN: return map2(d, a, b, n, [](float x, float y) { return std::min(x, y); });
+      case MAX: return map2(d, a, b, n, [](float x, float y) { return std::max(x, y); });
+      case LT: return map2(d, a, b, n, [](float x, float y) { return x < y ? 1.f : 0.f; });
+      case GT: return map2(d, a, b, n, [](float x, float y) { return x > y ? 1.f : 0.f; });
+      case LE: return map2(d, a, b, n, [](float x, float y) { return x <= y ? 1.f : 0.f; });
+      case GE: return map2(d, a, b, n, [](float x, float y) { return x >= y ? 1.f : 0.f; });
+      case EQ: return map2(d, a, b, n, [](float x, float y) { return x == y ? 1.f : 0.f; });
+      case NE: return map2(d, a, b, n, [](float x, float y) { return x != y ? 1.f : 0.f; });
+      case AND: return map2(d, a, b, n, [](float x, float y) { return x != 0.f && y != 0.f ? 1.f : 0.f; });
+      case OR: return map2(d, a, b, n, [](float x, float y) { return x != 0.f || y != 0.f ? 1.f : 0.f; });
+      case STEP: return map2(d, a, b, n, [](float edge, float x) { return x >= edge ? 1.f : 0.f; });
+      case SELECT: return map3(d, a, b, c, n, [](float x, float y, float z) { return x != 0.f ? y : z; });
+      case CLAMP: return map3(d, a, b, c, n, [](float x, float lo, float hi) { return std::min(std::max(x, lo), hi); });
+      case MIX: return map3(d, a, b, c, n, [](float x, float y, float w) { return x + (y - x) * w; });
+      default: return;
+    }
+  }
+
+private:
+  template<class F>
+  static void
+  map1(float* d, const float* a, int n, F f) {
+    for(int i = 0; i < n; i++)
+      d[i] = f(a[i]);
+  }
+
+  template<class F>
+  static void
+  map2(float* d, const float* a, const float* b, int n, F f) {
+    for(int i = 0; i < n; i++)
+      d[i] = f(a[i], b[i]);
+  }
+
+  template<class F>
+  static void
+  map3(float* d, const float* a, const float* b, const float* c, int n, F f) {
+    for(int i = 0; i < n; i++)
+      d[i] = f(a[i], b[i], c[i]);
+  }
+
+  /* ---------- lexer ---------- */
+
+  enum Token { END, NUMBER, IDENT, OP };
+
+  void
+  next() {
+    while(isspace((unsigned char)src[pos]))
+      pos++;
+    start = pos;
+    const char* p = src + pos;
+    if(!*p) {
+      tok = END;
+      text = "end of expression";
+      return;
+    }
+    if(isdigit((unsigned char)*p) || (*p == '.' && isdigit((unsigned char)p[1]))) {
+      char* end;
+      number = strtof(p, &end);
+      pos += end - p;
+      tok = NUMBER;
+    } else if(isalpha((unsigned char)*p) || *p == '_') {
+      while(isalnum((unsigned char)src[pos]) || src[pos] == '_')
+        pos++;
+      tok = IDENT;
+    } else {
+      static const char* const two[] = {"<=", ">=", "==", "!=", "&&", "||"};
+      tok = OP;
+      pos++;
+      for(const char* t : two)
+        if(p[0] == t[0] && p[1] == t[1]) {
+          pos++;
+          break;
+        }
+    }
+    text.assign(src + start, pos - start);
+  }
+
+  bool
+  accept(const char* op) {
+    if(tok == OP && text == op) {
+      next();
+      return true;
+    }
+    return false;
+  }
+
+  void
+  expect(const char* op) {
+    if(!accept(op))
+      fail(std::string("expected '") + op + "' but found '" + text + "'");
+  }
+
+  void
+  fail(const std::string& message) {
+    fail(message, start);
+  }
+
+  void
+  fail(const std::string& message, size_t at) {
+    if(err.empty())
+      err = message + " at " + std::to_string(at);
+  }
+
+  /* ---------- parser; each level returns a register ---------- */
+
+  // A right-nested a ? b : c ? ... recurses here without passing back
+  // through parseUnary, so it counts towards the depth cap too.
+  int
+  parseTernary() {
+    int c = parseBinary(0);
+    if(!accept("?"))
+      return c;
+    if(++depth > maxDepth) {
+      fail("expression nested too deeply");
+      return constant(0);
+    }
+    int a = parseTernary();
+    expect(":");
+    int b = parseTernary();
+    depth--;
+    return emit(SELECT, c, a, b);
+  }
+
+  // Precedence climbing over the binary operators, loosest first.
+  int
+  parseBinary(int level) {
+    static const struct {
+      const char* op;
+      Op code;
+      int level;
+    } table[] = {
+        {"||", OR, 0},
+        {"&&", AND, 1},
+        {"==", EQ, 2},
+        {"!=", NE, 2},
+        {"<", LT, 3},
+        {">", GT, 3},
+        {"<=", LE, 3},
+        {">=", GE, 3},
+        {"+", ADD, 4},
+        {"-", SUB, 4},
+        {"*", MUL, 5},
+        {"/", DIV, 5},
+        {"%", MOD, 5},
+    };
+    if(level > 5)
+      return parseUnary();
+    int lhs = parseBinary(level + 1);
+    for(;;) {
+      const Op* found = nullptr;
+      for(const auto& t : table)
+        if(t.level == level && tok == OP && text == t.op)
+          found = &t.code;
+      if(!found || !err.empty())
+        return lhs;
+      Op code = *found;
+      next();
+      lhs = emit(code, lhs, parseBinary(level + 1));
+    }
+  }
+
+  // Every other nesting level passes through here.
+  int
+  parseUnary() {
+    if(++depth > maxDepth) {
+      fail("expression nested too deeply");
+      return constant(0);
+    }
+    int r;
+    if(accept("-"))
+      r = emit(NEG, parseUnary());
+    else if(accept("+"))
+      r = parseUnary();
+    else if(accept("!"))
+      r = emit(NOT, parseUnary());
+    else
+      r = parsePower();
+    depth--;
+    return r;
+  }
+
+  int
+  parsePower() {
+    int base = parsePrimary();
+    if(accept("^"))
+      return emit(POW, base, parseUnary());
+    return base;
+  }
+
+  int
+  parsePrimary() {
+    if(!err.empty())
+      return constant(0);
+    if(tok == NUMBER) {
+      float v = number;
+      next();
+      return constant(v);
+    }
+    if(accept("(")) {
+      int r = parseTernary();
+      expect(")");
+      return r;
+    }
+    if(tok != IDENT) {
+      fail("unexpected '" + text + "'");
+      return constant(0);
+    }
+    std::string name = text;
+    size_t at = start;
+    next();
+    if(tok == OP && text == "(")
+      return parseCall(name, at);
+    return variable(name, at);
+  }
+
+  int
+  parseCall(const std::string& name, size_t at) {
+    static const struct {
+      const char* name;
+      Op op;
+      int arity;
+    } functions[] = {
+        {"sin", SIN, 1},     {"cos", COS, 1},     {"tan", TAN, 1},         {"asin", ASIN, 1},   {"acos", ACOS, 1},   {"atan", ATAN, 1},
+        {"sinh", SINH, 1},   {"cosh", COSH, 1},   {"tanh", TANH, 1},       {"exp", EXP, 1},     {"log", LOG, 1},     {"log2", LOG2, 1},
+        {"log10", LOG10, 1}, {"sqrt", SQRT, 1},   {"abs", ABS, 1},         {"sign", SIGN, 1},   {"floor", FLOOR, 1}, {"ceil", CEIL, 1},
+        {"round", ROUND, 1}, {"fract", FRACT, 1}, {"atan2", ATAN2, 2},     {"min", MIN, 2},     {"max", MAX, 2},     {"pow", POW, 2},
+        {"fmod", MOD, 2},    {"step", STEP, 2},   {"clamp", CLAMP, 3},     {"mix", MIX, 3},     {"select", SELECT, 3},
+    };
+    expect("(");
+    int args[3] = {-1, -1, -1}, n = 0;
+    if(!accept(")")) {
+      do {
+        int r = parseTernary();
+        if(n < 3)
+          args[n] = r;
+        n++;
+      } while(accept(","));
+      expect(")");
+    }
+    for(const auto& f : functions)
+      if(name == f.name) {
+        if(n != f.arity)
+          fail(name + "() takes " + std::to_string(f.arity) + " argument" + (f.arity > 1 ? "s" : ""), at);
+        return err.empty() ? emit(f.op, args[0], args[1], args[2]) : constant(0);
+      }
+    fail("unknown function '" + name + "'", at);
+    return constant(0);
+  }
+
+  int
+  variable(const std::string& name, size_t at) {
+    for(size_t k = 0; k < paramNames.size(); k++)
+      if(name == paramNames[k])
+        return source(PARAM, int(k));
+    if(name == "x" || name == "in")
+      return input(0);
+    if(name == "t")
+      return source(TIME, 0);
+    if(name == "ch")
+      return source(CHANNEL, 0);
+    if(name == "sr")
+      return constant(sampleRate);
+    if(name == "pi")
+      return constant(float(M_PI));
+    if(name == "e")
+      return constant(float(M_E));
+    char* end;
+    if(name.size() > 2 && name.compare(0, 2, "in") == 0 && isdigit((unsigned char)name[2])) {
+      long k = strtol(name.c_str() + 2, &end, 10);
+      if(!*end && k < MAX_INPUTS)
+        return input(int(k));
+    }
+    if(name.size() > 1 && name[0] == 'p' && isdigit((unsigned char)name[1])) {
+      long k = strtol(name.c_str() + 1, &end, 10);
+      if(!*end && size_t(k) < paramNames.size())
+        return source(PARAM, int(k));
+    }
+    fail("unknown name '" + name + "'", at);
+    return constant(0);
+  }
+
+  int
+  input(int k) {
+    inputs = std::max(inputs, k + 1);
+    return source(INPUT, k);
+  }
+
+  int
+  source(Op op, int index) {
+    for(size_t i = 0; i < code.size(); i++)
+      if(code[i].op == op && code[i].index == index)
+        return int(i);
+    Instruction in{op};
+    in.index = index;
+    code.push_back(in);
+    return int(code.size()) - 1;
+  }
+
+  int
+  constant(float v) {
+    Instruction in{CONST};
+    in.value = v;
+    code.push_back(in);
+    return int(code.size()) - 1;
+  }
+
+  // Append an operation, or fold it if every operand is a constant.
+  int
+  emit(Op op, int a, int b = -1, int c = -1) {
+    auto isConst = [this](int r) { return r < 0 || code[r].op == CONST; };
+    if(isConst(a) && isConst(b) && isConst(c)) {
+      float x = a < 0 ? 0 : code[a].value, y = b < 0 ? 0 : code[b].value, z = c < 0 ? 0 : code[c].value, d;
+      exec(op, &d, &x, &y, &z, 1);
+      return constant(d);
+    }
+    Instruction in{op};
+    in.a = a;
+    in.b = b;
+    in.c = c;
+    code.push_back(in);
+    return int(code.size()) - 1;
+  }
+
+  const char* src = "";
+  size_t pos = 0, start = 0;
+  static constexpr int maxDepth = 200;
+  int depth = 0;
+  Token tok = END;
+  std::string text, err;
+  float number = 0, sampleRate = 0;
+  std::vector<std::string> paramNames;
+};
+
+/* ---------- ExpressionNode ---------- */
+
+class ExpressionNode : private DynamicParams, public lab::AudioNode {
+public:
+  ExpressionNode(lab::AudioContext& ac, std::shared_ptr<const ExpressionProgram> program, const std::vector<Spec>& specs, int channels)
+      : DynamicParams(specs, channels), lab::AudioNode(ac, descriptor), program(std::move(program)), channels(channels) {
+    for(const auto& s : this->specs)
+      params.push_back(param(s.name.c_str()));
+    prepare(ProcessingSizeInFrames);
+    initialize();
+  }
+
+  virtual ~ExpressionNode() {
+    uninitialize();
+  }
+
+  const char*
+  name() const override {
+    return "Expression";
+  }
+
+  int
+  numberOfParams() const {
+    return int(params.size());
+  }
+
+  std::shared_ptr<lab::AudioParam>
+  expressionParam(int k) const {
+    return params.at(k);
+  }
+
+  const std::string&
+  paramName(int k) const {
+    return specs.at(k).name;
+  }
+
+  const std::string&
+  expression() const {
+    return program->expression;
+  }
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    if(bufferSize > frames)
+      prepare(bufferSize);
+    const auto& code = program->code;
+    const int n = bufferSize;
+
+    for(size_t k = 0; k < params.size(); k++)
+      params[k]->calculateSampleAccurateValues(r, paramValues[k].data(), n);
+    if(usesTime) {
+      const double t0 = r.context()->currentTime(), dt = 1.0 / r.context()->sampleRate();
+      for(int i = 0; i < n; i++)
+        time[i] = float(t0 + i * dt);
+    }
+
+    lab::AudioBus* out = output(0)->bus(r);
+    for(int c = 0; c < out->numberOfChannels(); c++) {
+      std::fill(channelIndex.begin(), channelIndex.begin() + n, float(c));
+      for(size_t i = 0; i < code.size(); i++) {
+        const auto& in = code[i];
+        switch(in.op) {
+          case ExpressionProgram::CONST: break; // filled by prepare()
+          case ExpressionProgram::INPUT: reg[i] = inputChannel(r, in.index, c); break;
+          case ExpressionProgram::PARAM: reg[i] = paramValues[in.index].data(); break;
+          case ExpressionProgram::TIME: reg[i] = time.data(); break;
+          case ExpressionProgram::CHANNEL: reg[i] = channelIndex.data(); break;
+          default: {
+            float* d = &storage[i * frames];
+            ExpressionProgram::exec(in.op, d, reg[in.a], in.b >= 0 ? reg[in.b] : nullptr, in.c >= 0 ? reg[in.c] : nullptr, n);
+            reg[i] = d;
+          }
+        }
+      }
+      // A division by zero shouldn't poison every filter downstream.
+      const float* y = reg[program->result];
+      float* dst = out->channel(c)->mutableData();
+      for(int i = 0; i < n; i++)
+        dst[i] = std::isfinite(y[i]) ? y[i] : 0.f;
+    }
+    out->clearSilentFlag();
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {}
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // An expression of t alone is a generator, so silence in is no reason
+  // to stop.
+  bool
+  propagatesSilence(lab::ContextRenderLock&) const override {
+    return false;
+  }
+
+private:
+  // Grows only if the context's quantum is larger than the default.
+  void
+  prepare(int size) {
+    const auto& code = program->code;
+    frames = size;
+    storage.assign(code.size() * frames, 0.f);
+    reg.assign(code.size(), nullptr);
+    usesTime = false;
+    for(size_t i = 0; i < code.size(); i++) {
+      if(code[i].op == ExpressionProgram::CONST) {
+        std::fill(&storage[i * frames], &storage[i * frames] + frames, code[i].value);
+        reg[i] = &storage[i * frames];
+      }
+      usesTime |= code[i].op == ExpressionProgram::TIME;
+    }
+    paramValues.resize(params.size());
+    for(auto& v : paramValues)
+      v.assign(frames, 0.f);
+    time.assign(frames, 0.f);
+    channelIndex.assign(frames, 0.f);
+    silence.assign(frames, 0.f);
+  }
+
+  const float*
+  inputChannel(lab::ContextRenderLock& r, int k, int c) {
+    if(k >= numberOfInputs() || !input(k)->isConnected())
+      return silence.data();
+    lab::AudioBus* bus = input(k)->bus(r);
+    if(!bus || !bus->numberOfChannels())
+      return silence.data();
+    return bus->channel(std::min(c, bus->numberOfChannels() - 1))->data();
+  }
+
+  std::shared_ptr<const ExpressionProgram> program;
+  int channels;
+  std::vector<std::shared_ptr<lab::AudioParam>> params;
+
+  int frames = 0;
+  bool usesTime = false;
+  std::vector<float> storage;     // one block per instruction
+  std::vector<const float*> reg;  // where each instruction's block is
+  std::vector<std::vector<float>> paramValues;
+  std::vector<float> time, channelIndex, silence;
+};
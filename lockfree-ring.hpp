@@ -0,0 +1,161 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+/* ============================================================
+ * Single-producer/single-consumer ring buffer.
+ *
+ * For handing data between the JS thread and LabSound's render thread
+ * without a ContextRenderLock/ContextGraphLock: exactly one thread may
+ * push() and exactly one (other) thread may pop(). Capacity is rounded up
+ * to a power of two and fixed at construction, so neither side allocates
+ * afterwards -- push() simply fails when the ring is full.
+ * ============================================================ */
+
+template<class T> class SpscRing {
+public:
+  explicit SpscRing(size_t capacity) : slots(round_up(capacity)), mask(slots.size() - 1) {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  bool
+  push(T&& value) {
+    size_t w = head.load(std::memory_order_relaxed);
+    if(w - tail.load(std::memory_order_acquire) == slots.size())
+      return false;
+    slots[w & mask] = std::move(value);
+    head.store(w + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool
+  push(const T& value) {
+    T copy(value);
+    return push(std::move(copy));
+  }
+
+  bool
+  pop(T& value) {
+    size_t r = tail.load(std::memory_order_relaxed);
+    if(r == head.load(std::memory_order_acquire))
+      return false;
+    value = std::move(slots[r & mask]);
+    tail.store(r + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Approximate from either side; exact from the consumer when the producer
+  // is idle and vice versa.
+  size_t
+  size() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  size_t
+  capacity() const {
+    return slots.size();
+  }
+
+private:
+  static size_t
+  round_up(size_t n) {
+    size_t p = 2;
+    while(p < n)
+      p <<= 1;
+    return p;
+  }
+
+  std::vector<T> slots;
+  size_t mask;
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
+
+/* ============================================================
+ * Single-producer/single-consumer ring of variable-length messages.
+ *
+ * The same contract as SpscRing, over a fixed byte buffer: each message is
+ * a 32-bit length followed by its bytes, wrapping around the end of the
+ * buffer. push() copies the message in and fails when it doesn't fit;
+ * pop() copies the oldest one out into a vector that keeps its capacity,
+ * so a steady stream of messages doesn't allocate on either side.
+ * ============================================================ */
+
+class SpscMessageRing {
+public:
+  explicit SpscMessageRing(size_t capacity) : bytes(round_up(capacity)), mask(bytes.size() - 1) {}
+
+  SpscMessageRing(const SpscMessageRing&) = delete;
+  SpscMessageRing& operator=(const SpscMessageRing&) = delete;
+
+  bool
+  push(const void* data, size_t size) {
+    size_t w = head.load(std::memory_order_relaxed);
+    if(size > UINT32_MAX || sizeof(uint32_t) + size > bytes.size() - (w - tail.load(std::memory_order_acquire)))
+      return false;
+    uint32_t length = uint32_t(size);
+    copy_in(w, &length, sizeof(length));
+    copy_in(w + sizeof(length), data, size);
+    head.store(w + sizeof(length) + size, std::memory_order_release);
+    return true;
+  }
+
+  bool
+  pop(std::vector<uint8_t>& message) {
+    size_t r = tail.load(std::memory_order_relaxed);
+    if(r == head.load(std::memory_order_acquire))
+      return false;
+    uint32_t length;
+    copy_out(r, &length, sizeof(length));
+    message.resize(length);
+    copy_out(r + sizeof(length), message.data(), length);
+    tail.store(r + sizeof(length) + length, std::memory_order_release);
+    return true;
+  }
+
+  bool
+  empty() const {
+    return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+  }
+
+  // The largest message that fits in an empty ring.
+  size_t
+  maxMessage() const {
+    return bytes.size() - sizeof(uint32_t);
+  }
+
+private:
+  static size_t
+  round_up(size_t n) {
+    size_t p = 64;
+    while(p < n)
+      p <<= 1;
+    return p;
+  }
+
+  void
+  copy_in(size_t at, const void* src, size_t n) {
+    size_t i = at & mask, first = std::min(n, bytes.size() - i);
+    memcpy(&bytes[i], src, first);
+    memcpy(&bytes[0], static_cast<const uint8_t*>(src) + first, n - first);
+  }
+
+  void
+  copy_out(size_t at, void* dst, size_t n) const {
+    size_t i = at & mask, first = std::min(n, bytes.size() - i);
+    memcpy(dst, &bytes[i], first);
+    memcpy(static_cast<uint8_t*>(dst) + first, &bytes[0], n - first);
+  }
+
+  std::vector<uint8_t> bytes;
+  size_t mask;
+  alignas(64) std::atomic<size_t> head{0};
+  alignas(64) std::atomic<size_t> tail{0};
+};
@@ -0,0 +1,398 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/extended/AudioContextLock.h"
+
+/* ============================================================
+ * Parallel rendering of independent branches.
+ *
+ * LabSound pulls the graph depth-first on its one render thread, so two
+ * buses that only meet at a mixer are rendered one after the other.
+ * ParallelMixerNode is such a mixer made explicit: it overrides
+ * pullInputs() to split its input's connections into branches, merge any
+ * branches that share an upstream node (walking both audio inputs and the
+ * connections into each node's AudioParams, so one LFO on two branches'
+ * filters keeps them together), and pull the remaining independent groups
+ * on RenderWorkers -- a small pool of pinned threads -- with the render
+ * thread taking a share and waiting for all of them before it sums the
+ * results. Everything else in the graph renders as before.
+ *
+ * The render lock is held by the render thread throughout, so the
+ * workers run under it by proxy. What they can't be protected from is a
+ * node that pulls another outside lab's connections, which no walk can
+ * see; parallel = false renders such a mixer serially.
+ * ============================================================ */
+
+// Runs the items of one job across the workers and the calling thread.
+// One job at a time; a nested or concurrent run() (a parallel mixer inside
+// a branch of another, or in a second context) runs its items serially.
+// Shared by every ParallelMixerNode alive: the last one to go stops and
+// joins the threads.
+class RenderWorkers {
+public:
+  typedef void (*Fn)(void* arg, int item);
+
+  static std::shared_ptr<RenderWorkers>
+  acquire() {
+    static std::mutex lock;
+    static std::weak_ptr<RenderWorkers> shared;
+    std::lock_guard<std::mutex> guard(lock);
+    std::shared_ptr<RenderWorkers> workers = shared.lock();
+    if(!workers) {
+      workers.reset(new RenderWorkers(int(std::clamp(std::thread::hardware_concurrency(), 2u, 8u)) - 1));
+      shared = workers;
+    }
+    return workers;
+  }
+
+  ~RenderWorkers() {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      stopping = true;
+    }
+    wake.notify_all();
+    for(auto& t : threads)
+      t.join();
+  }
+
+  int
+  size() const {
+    return int(threads.size());
+  }
+
+  void
+  run(Fn fn, void* arg, int n) {
+    if(n <= 0)
+      return;
+    if(n == 1 || onWorker || busy.exchange(true, std::memory_order_acquire)) {
+      for(int i = 0; i < n; i++)
+        fn(arg, i);
+      return;
+    }
+
+    uint64_t epoch;
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      job = Job{fn, arg, n};
+      done.store(0, std::memory_order_relaxed);
+      epoch = (ticket.load(std::memory_order_relaxed) >> 32) + 1;
+      ticket.store(epoch << 32, std::memory_order_release);
+    }
+    wake.notify_all();
+
+    work(job, epoch);
+    while(done.load(std::memory_order_acquire) < n)
+      std::this_thread::yield();
+    busy.store(false, std::memory_order_release);
+  }
+
+private:
+  struct Job {
+    Fn fn = nullptr;
+    void* arg = nullptr;
+    int n = 0;
+  };
+
+  explicit RenderWorkers(int count) {
+    for(int i = 0; i < count; i++)
+      threads.emplace_back([this, i]() { loop(i); });
+  }
+
+  // Claim items of job `epoch` until none are left. The ticket holds the
+  // epoch in its high half, so a worker that wakes up late can't claim an
+  // item of the next job with this one's function.
+  void
+  work(const Job& j, uint64_t epoch) {
+    for(;;) {
+      uint64_t t = ticket.load(std::memory_order_acquire);
+      if((t >> 32) != epoch || int(t & 0xffffffff) >= j.n)
+        return;
+      if(!ticket.compare_exchange_weak(t, t + 1, std::memory_order_acq_rel))
+        continue;
+      j.fn(j.arg, int(t & 0xffffffff));
+      done.fetch_add(1, std::memory_order_release);
+    }
+  }
+
+  void
+  loop(int index) {
+    onWorker = true;
+#ifdef __linux__
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET((index + 1) % std::max(1u, std::thread::hardware_concurrency()), &cpus);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+#endif
+    uint64_t seen = 0;
+    for(;;) {
+      // A quantum is short: spin briefly for the next job before parking.
+      for(int spin = 0; spin < 200 && (ticket.load(std::memory_order_acquire) >> 32) == seen; spin++)
+        std::this_thread::yield();
+
+      Job j;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        wake.wait(guard, [&]() { return stopping || (ticket.load(std::memory_order_acquire) >> 32) != seen; });
+        if(stopping)
+          return;
+        seen = ticket.load(std::memory_order_acquire) >> 32;
+        j = job;
+      }
+      work(j, seen);
+    }
+  }
+
+  std::vector<std::thread> threads;
+  std::mutex lock;
+  std::condition_variable wake;
+  Job job;
+  std::atomic<uint64_t> ticket{0};
+  std::atomic<int> done{0};
+  std::atomic<bool> busy{false};
+  bool stopping = false; // guarded by `lock`
+  static thread_local bool onWorker;
+};
+
+inline thread_local bool RenderWorkers::onWorker = false;
+
+class ParallelMixerNode : public lab::AudioNode {
+public:
+  explicit ParallelMixerNode(lab::AudioContext& ac) : lab::AudioNode(ac, *desc()), workers(RenderWorkers::acquire()) {
+    initialize();
+  }
+
+  virtual ~ParallelMixerNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioNodeDescriptor d{nullptr, nullptr, 2};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "ParallelMixer";
+  }
+
+  /* ---------- JS thread ---------- */
+
+  std::atomic<bool> parallel{true};
+  // As of the last quantum: connections summed, and the independent
+  // groups they were rendered in.
+  std::atomic<int> branchCount{0}, groupCount{0};
+
+  int
+  workerCount() const {
+    return workers->size();
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  pullInputs(lab::ContextRenderLock& r, int bufferSize) override {
+    auto in = input(0);
+    int n = in ? int(in->numberOfRenderingConnections(r)) : 0;
+    branches.resize(n);
+    for(int k = 0; k < n; k++)
+      branches[k] = Branch{raw(in->renderingOutput(r, k)), nullptr, k};
+
+    int groups = n ? 1 : 0;
+    if(n > 1 && parallel.load(std::memory_order_relaxed) && workers->size() > 0)
+      groups = group(r);
+    branchCount.store(n, std::memory_order_relaxed);
+    groupCount.store(groups, std::memory_order_relaxed);
+
+    pass = {this, &r, bufferSize};
+    if(groups > 1)
+      workers->run(&ParallelMixerNode::renderGroup, &pass, groups);
+    else
+      for(auto& b : branches)
+        b.bus = b.output ? b.output->pull(r, nullptr, bufferSize) : nullptr;
+  }
+
+  void
+  process(lab::ContextRenderLock& r, int) override {
+    lab::AudioBus* out = output(0)->bus(r);
+    out->zero();
+    for(auto& b : branches)
+      if(b.bus)
+        out->sumFrom(*b.bus);
+    out->clearSilentFlag();
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {}
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // The input bus is never filled (branches are summed straight from
+  // their outputs), so lab's silence check would always see silence; with
+  // no branch left there really is nothing to mix.
+  bool
+  propagatesSilence(lab::ContextRenderLock&) const override {
+    return branches.empty();
+  }
+
+private:
+  struct Branch {
+    lab::AudioNodeOutput* output = nullptr;
+    lab::AudioBus* bus = nullptr;
+    int group = 0; // union-find parent, then group index
+  };
+
+  struct Pass {
+    ParallelMixerNode* self = nullptr;
+    lab::ContextRenderLock* r = nullptr;
+    int bufferSize = 0;
+  };
+
+  static lab::AudioNodeOutput*
+  raw(lab::AudioNodeOutput* p) {
+    return p;
+  }
+
+  static lab::AudioNodeOutput*
+  raw(const std::shared_ptr<lab::AudioNodeOutput>& p) {
+    return p.get();
+  }
+
+  static void
+  renderGroup(void* arg, int g) {
+    Pass& p = *static_cast<Pass*>(arg);
+    for(auto& b : p.self->branches)
+      if(b.group == g && b.output)
+        b.bus = b.output->pull(*p.r, nullptr, p.bufferSize);
+  }
+
+  int
+  find(int k) {
+    while(branches[k].group != k)
+      k = branches[k].group = branches[branches[k].group].group;
+    return k;
+  }
+
+  // Walk upstream of every branch through audio inputs and AudioParam
+  // connections, merging branches that reach a common node; then renumber
+  // the roots 0..groups-1. `marks` and `stack` keep their capacity.
+  int
+  group(lab::ContextRenderLock& r) {
+    ++epoch;
+    for(int k = 0; k < int(branches.size()); k++) {
+      if(!branches[k].output)
+        continue;
+      stack.clear();
+      stack.push_back(branches[k].output->sourceNode());
+      while(!stack.empty()) {
+        lab::AudioNode* node = stack.back();
+        stack.pop_back();
+        Mark& m = mark(node);
+        if(m.epoch == epoch) {
+          int a = find(k), b = find(m.branch);
+          if(a != b)
+            branches[std::max(a, b)].group = std::min(a, b);
+          continue;
+        }
+        m.epoch = epoch;
+        m.branch = k;
+        for(int i = 0; i < node->numberOfInputs(); i++) {
+          auto input = node->input(i);
+          for(int j = 0; input && j < int(input->numberOfRenderingConnections(r)); j++)
+            if(lab::AudioNodeOutput* o = raw(input->renderingOutput(r, j)))
+              stack.push_back(o->sourceNode());
+        }
+        // Modulators are pulled by the param they drive, from whichever
+        // thread renders that node.
+        for(const auto& param : node->params())
+          for(int j = 0; param && j < int(param->numberOfRenderingConnections(r)); j++)
+            if(lab::AudioNodeOutput* o = raw(param->renderingOutput(r, j)))
+              stack.push_back(o->sourceNode());
+      }
+    }
+
+    int groups = 0;
+    roots.assign(branches.size(), -1);
+    for(int k = 0; k < int(branches.size()); k++) {
+      int root = find(k);
+      if(roots[root] < 0)
+        roots[root] = groups++;
+    }
+    for(int k = 0; k < int(branches.size()); k++)
+      branches[k].group = roots[find(k)];
+    return groups;
+  }
+
+  struct Mark {
+    lab::AudioNode* node = nullptr;
+    uint64_t epoch = 0;
+    int branch = 0;
+  };
+
+  // Open-addressed node -> mark table; stale epochs count as empty, so
+  // nothing needs clearing between quanta.
+  Mark&
+  mark(lab::AudioNode* node) {
+    if(marks.empty() || used * 2 >= marks.size()) {
+      std::vector<Mark> old;
+      old.swap(marks);
+      marks.resize(std::max<size_t>(64, old.size() * 2));
+      used = 0;
+      for(auto& m : old)
+        if(m.node && m.epoch == epoch)
+          slot(m.node) = m;
+    }
+    return slot(node);
+  }
+
+  Mark&
+  slot(lab::AudioNode* node) {
+    size_t mask = marks.size() - 1;
+    size_t h = (reinterpret_cast<uintptr_t>(node) >> 4) * 0x9e3779b97f4a7c15ull;
+    for(size_t i = h & mask;; i = (i + 1) & mask) {
+      Mark& m = marks[i];
+      if(m.node == node)
+        return m;
+      if(!m.node || m.epoch != epoch) {
+        if(!m.node)
+          used++;
+        m = Mark{node, 0, 0};
+        return m;
+      }
+    }
+  }
+
+  std::shared_ptr<RenderWorkers> workers;
+  std::vector<Branch> branches;
+  std::vector<lab::AudioNode*> stack;
+  std::vector<int> roots;
+  std::vector<Mark> marks;
+  size_t used = 0;
+  uint64_t epoch = 0;
+  Pass pass;
+};
@@ -0,0 +1,507 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/FFTFrame.h"
+#include "LabSound/extended/AudioContextLock.h"
+
+/* ============================================================
+ * Two-stage partitioned convolution for long impulse responses.
+ *
+ * lab::ConvolverNode does all of its work inside the render callback. Here
+ * the impulse response is split in two. The head, the first 2*T frames,
+ * is convolved on the render thread with small `partitionSize` (B)
+ * partitions. The tail is convolved by a worker thread per instance with
+ * large T-frame partitions.
+ *
+ * Tail block k, input frames [kT, (k+1)T), is complete at stream time
+ * (k+1)T. Its output is first needed at (k+2)T because the tail response
+ * starts 2T frames in. The worker therefore has a full T-frame period per
+ * block, and the render thread only pays for the head. When B is larger
+ * than the render quantum, input is buffered up to B frames and the node
+ * reports B - quantum frames of latency.
+ * ============================================================ */
+
+// One channel of uniformly partitioned overlap-save convolution. The kernel
+// is cut into `block`-frame partitions and each is transformed once with a
+// 2*block FFT. Every input block is then multiplied against all partitions
+// through a frequency-domain delay line.
+class UpolsConvolver {
+public:
+  void
+  init(const float* kernel, size_t length, int blockSize, float gain) {
+    block = blockSize;
+    fft = std::make_unique<lab::FFTFrame>(2 * block);
+    parts = std::max<size_t>(1, (length + block - 1) / block);
+    kernelRe.assign(parts * block, 0.f);
+    kernelIm.assign(parts * block, 0.f);
+    lineRe.assign(parts * block, 0.f);
+    lineIm.assign(parts * block, 0.f);
+    accRe.assign(block, 0.f);
+    accIm.assign(block, 0.f);
+    window.assign(2 * block, 0.f);
+    result.assign(2 * block, 0.f);
+    newest = 0;
+
+    std::vector<float> padded(2 * block);
+    for(size_t p = 0; p < parts; p++) {
+      std::fill(padded.begin(), padded.end(), 0.f);
+      size_t begin = std::min(length, p * block), n = std::min<size_t>(block, length - begin);
+      for(size_t i = 0; i < n; i++)
+        padded[i] = kernel[begin + i] * gain;
+      fft->doFFT(padded.data());
+      std::copy(fft->realData(), fft->realData() + block, &kernelRe[p * block]);
+      std::copy(fft->imagData(), fft->imagData() + block, &kernelIm[p * block]);
+    }
+    scale = calibrate();
+  }
+
+  // `block` frames in, `block` frames out.
+  void
+  process(const float* in, float* out) {
+    std::copy(window.begin() + block, window.end(), window.begin());
+    std::copy(in, in + block, window.begin() + block);
+    fft->doFFT(window.data());
+
+    newest = (newest + parts - 1) % parts;
+    std::copy(fft->realData(), fft->realData() + block, &lineRe[newest * block]);
+    std::copy(fft->imagData(), fft->imagData() + block, &lineIm[newest * block]);
+
+    std::fill(accRe.begin(), accRe.end(), 0.f);
+    std::fill(accIm.begin(), accIm.end(), 0.f);
+    for(size_t p = 0; p < parts; p++) {
+      size_t slot = (newest + p) % parts;
+      multiplyAdd(&lineRe[slot * block], &lineIm[slot * block], &kernelRe[p * block], &kernelIm[p * block]);
+    }
+
+    std::copy(accRe.begin(), accRe.end(), fft->realData());
+    std::copy(accIm.begin(), accIm.end(), fft->imagData());
+    fft->doInverseFFT(result.data());
+    for(int i = 0; i < block; i++)
+      out[i] = result[block + i] * scale;
+  }
+
+  void
+  reset() {
+    std::fill(lineRe.begin(), lineRe.end(), 0.f);
+    std::fill(lineIm.begin(), lineIm.end(), 0.f);
+    std::fill(window.begin(), window.end(), 0.f);
+  }
+
+private:
+  // FFTFrame packs the (real) Nyquist bin into imag[0] next to the DC bin,
+  // so bin 0 is two real products rather than one complex one.
+  void
+  multiplyAdd(const float* xr, const float* xi, const float* hr, const float* hi) {
+    float* ar = accRe.data();
+    float* ai = accIm.data();
+    float dc = ar[0] + xr[0] * hr[0], nyquist = ai[0] + xi[0] * hi[0];
+    for(int i = 0; i < block; i++) {
+      ar[i] += xr[i] * hr[i] - xi[i] * hi[i];
+      ai[i] += xr[i] * hi[i] + xi[i] * hr[i];
+    }
+    ar[0] = dc;
+    ai[0] = nyquist;
+  }
+
+  // FFT backends differ in how they scale the round trip. Convolve a unit
+  // impulse with a unit kernel and divide out whatever comes back.
+  float
+  calibrate() {
+    std::vector<float> x(2 * block, 0.f), xr(block), xi(block);
+    x[block] = 1;
+    fft->doFFT(x.data());
+    std::copy(fft->realData(), fft->realData() + block, xr.begin());
+    std::copy(fft->imagData(), fft->imagData() + block, xi.begin());
+    std::fill(x.begin(), x.end(), 0.f);
+    x[0] = 1;
+    fft->doFFT(x.data());
+    std::vector<float> hr(fft->realData(), fft->realData() + block), hi(fft->imagData(), fft->imagData() + block);
+
+    std::fill(accRe.begin(), accRe.end(), 0.f);
+    std::fill(accIm.begin(), accIm.end(), 0.f);
+    multiplyAdd(xr.data(), xi.data(), hr.data(), hi.data());
+    std::copy(accRe.begin(), accRe.end(), fft->realData());
+    std::copy(accIm.begin(), accIm.end(), fft->imagData());
+    fft->doInverseFFT(result.data());
+    return result[block] != 0 ? 1 / result[block] : 1;
+  }
+
+  int block = 0;
+  size_t parts = 0, newest = 0;
+  float scale = 1;
+  std::unique_ptr<lab::FFTFrame> fft;
+  std::vector<float> kernelRe, kernelIm, lineRe, lineIm, accRe, accIm, window, result;
+};
+
+// A stereo pair of head/tail convolvers, the FIFOs that bridge the render
+// quantum and B, and the tail worker thread. Immutable once built, apart
+// from its streaming state. The node swaps in a whole new engine when the
+// impulse changes.
+class ConvolutionEngine {
+public:
+  enum { CHANNELS = 2, SLOTS = 4 };
+
+  ConvolutionEngine(const lab::AudioBus& impulse, int blockSize, float gain, int quantum, float sampleRate)
+      : B(blockSize), T(std::max(8 * blockSize, 1024)), length(impulse.length()), rate(sampleRate) {
+    size_t headLength = std::min<size_t>(length, 2 * size_t(T));
+    tail = length > headLength;
+    for(int c = 0; c < CHANNELS; c++) {
+      const float* kernel = impulse.channel(std::min(c, impulse.numberOfChannels() - 1))->data();
+      Channel& ch = channels[c];
+      ch.head.init(kernel, headLength, B, gain);
+      ch.in.assign(B, 0.f);
+      ch.out.assign(B, 0.f);
+      ch.queue.assign(2 * B, 0.f);
+      if(tail) {
+        ch.tail.init(kernel + headLength, length - headLength, T, gain);
+        for(int s = 0; s < SLOTS; s++) {
+          ch.tailIn[s].assign(T, 0.f);
+          ch.tailOut[s].assign(T, 0.f);
+        }
+      }
+    }
+    latency = std::max(0, B - quantum);
+    queued = latency;
+    if(tail)
+      worker = std::thread([this]() { run(); });
+  }
+
+  ~ConvolutionEngine() {
+    if(worker.joinable()) {
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        quit = true;
+      }
+      wake.notify_one();
+      worker.join();
+    }
+  }
+
+  int
+  latencyFrames() const {
+    return latency;
+  }
+
+  size_t
+  impulseLength() const {
+    return length;
+  }
+
+  float
+  workerLoad() const {
+    return tailLoad.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  lateBlocks() const {
+    return late.load(std::memory_order_relaxed);
+  }
+
+  // Render thread: `frames` frames per channel in, the same number out,
+  // delayed by latencyFrames().
+  void
+  process(const float* const in[CHANNELS], float* const out[CHANNELS], int frames) {
+    for(int done = 0; done < frames;) {
+      int n = std::min(frames - done, B - filled);
+      for(int c = 0; c < CHANNELS; c++)
+        std::copy(in[c] + done, in[c] + done + n, channels[c].in.begin() + filled);
+      filled += n;
+      if(filled == B) {
+        processBlock();
+        filled = 0;
+      }
+      int avail = std::min(n, queued);
+      for(int c = 0; c < CHANNELS; c++) {
+        const std::vector<float>& q = channels[c].queue;
+        for(int i = 0; i < avail; i++)
+          out[c][done + i] = q[(queueRead + i) % q.size()];
+        std::fill(out[c] + done + avail, out[c] + done + n, 0.f);
+      }
+      queueRead = (queueRead + avail) % (2 * B);
+      queued -= avail;
+      done += n;
+    }
+  }
+
+  // Render thread (AudioNode::reset): let the worker go idle, then clear.
+  void
+  reset() {
+    while(completed.load(std::memory_order_acquire) < submitted.load(std::memory_order_relaxed))
+      std::this_thread::yield();
+    std::lock_guard<std::mutex> guard(lock);
+    for(auto& ch : channels) {
+      ch.head.reset();
+      ch.tail.reset();
+      std::fill(ch.queue.begin(), ch.queue.end(), 0.f);
+    }
+    submitted.store(0, std::memory_order_relaxed);
+    completed.store(0, std::memory_order_relaxed);
+    blocks = 0;
+    filled = 0;
+    queueRead = 0;
+    queued = latency;
+  }
+
+private:
+  struct Channel {
+    UpolsConvolver head, tail;
+    std::vector<float> in, out, queue;
+    std::vector<float> tailIn[SLOTS], tailOut[SLOTS];
+  };
+
+  void
+  processBlock() {
+    uint64_t n = blocks * B;
+    uint64_t k = n / T;
+    size_t offset = n % T;
+
+    for(auto& ch : channels)
+      ch.head.process(ch.in.data(), ch.out.data());
+
+    if(tail) {
+      for(auto& ch : channels)
+        std::copy(ch.in.begin(), ch.in.end(), ch.tailIn[k % SLOTS].begin() + offset);
+      if(offset + B == size_t(T)) {
+        submitted.store(k + 1, std::memory_order_release);
+        wake.notify_one();
+      }
+
+      // Output frames [n, n+B) take the tail of input block k-2.
+      if(k >= 2) {
+        uint64_t j = k - 2;
+        if(offset == 0 && completed.load(std::memory_order_acquire) <= j) {
+          late.fetch_add(1, std::memory_order_relaxed);
+          while(completed.load(std::memory_order_acquire) <= j)
+            std::this_thread::yield();
+        }
+        for(auto& ch : channels) {
+          const float* t = ch.tailOut[j % SLOTS].data() + offset;
+          for(int i = 0; i < B; i++)
+            ch.out[i] += t[i];
+        }
+      }
+    }
+
+    size_t write = (queueRead + queued) % (2 * B);
+    for(auto& ch : channels)
+      for(int i = 0; i < B; i++)
+        ch.queue[(write + i) % ch.queue.size()] = ch.out[i];
+    queued += B;
+    blocks++;
+  }
+
+  void
+  run() {
+    for(;;) {
+      uint64_t k;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        // The render thread notifies without taking the lock, so a wakeup
+        // can slip in before the wait; the timeout bounds what that costs.
+        while(!quit && submitted.load(std::memory_order_acquire) <= completed.load(std::memory_order_relaxed))
+          wake.wait_for(guard, std::chrono::milliseconds(1));
+        if(quit)
+          return;
+        k = completed.load(std::memory_order_relaxed);
+      }
+      auto start = std::chrono::steady_clock::now();
+      for(auto& ch : channels)
+        ch.tail.process(ch.tailIn[k % SLOTS].data(), ch.tailOut[k % SLOTS].data());
+      completed.store(k + 1, std::memory_order_release);
+
+      // Time taken relative to the T-frame period it had.
+      std::chrono::duration<float> took = std::chrono::steady_clock::now() - start;
+      float load = took.count() * rate / float(T);
+      tailLoad.store(tailLoad.load(std::memory_order_relaxed) * 0.9f + load * 0.1f, std::memory_order_relaxed);
+    }
+  }
+
+  const int B, T;
+  const size_t length;
+  const float rate;
+  bool tail = false;
+  int latency = 0;
+  Channel channels[CHANNELS];
+
+  // Render thread only.
+  uint64_t blocks = 0;
+  int filled = 0, queued = 0;
+  size_t queueRead = 0;
+
+  std::atomic<uint64_t> submitted{0}, completed{0}, late{0};
+  std::atomic<float> tailLoad{0};
+  std::mutex lock;
+  std::condition_variable wake;
+  bool quit = false; // guarded by `lock`
+  std::thread worker;
+};
+
+class PartitionedConvolverNode : public lab::AudioNode {
+public:
+  PartitionedConvolverNode(lab::AudioContext& ac, int partitionSize) : lab::AudioNode(ac, *desc()), block(partitionSize) {
+    initialize();
+  }
+
+  virtual ~PartitionedConvolverNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioNodeDescriptor d{nullptr, nullptr, 0};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "PartitionedConvolver";
+  }
+
+  /* ---------- JS thread ---------- */
+
+  // Transforms the whole impulse up front, then swaps the new engine in
+  // under the render lock. The old engine, worker thread included, is torn
+  // down here rather than on the render thread.
+  void
+  setImpulse(lab::AudioContext* ac, std::shared_ptr<lab::AudioBus> bus) {
+    std::shared_ptr<ConvolutionEngine> fresh;
+    if(bus && bus->length() > 0 && bus->numberOfChannels() > 0)
+      fresh = std::make_shared<ConvolutionEngine>(*bus, block, normalize ? normalizationScale(*bus, ac->sampleRate()) : 1.f, lab::AudioNode::ProcessingSizeInFrames,
+                                                   ac->sampleRate());
+    {
+      lab::ContextRenderLock r(ac, "PartitionedConvolverNode.setImpulse");
+      std::swap(engine, fresh);
+      impulse = std::move(bus);
+    }
+  }
+
+  std::shared_ptr<lab::AudioBus>
+  getImpulse() const {
+    return impulse;
+  }
+
+  bool
+  getNormalize() const {
+    return normalize;
+  }
+
+  void
+  setNormalize(lab::AudioContext* ac, bool enable) {
+    if(enable == normalize)
+      return;
+    normalize = enable;
+    setImpulse(ac, impulse);
+  }
+
+  int
+  partitionSize() const {
+    return block;
+  }
+
+  int
+  latencyFrames() const {
+    return engine ? engine->latencyFrames() : std::max(0, block - lab::AudioNode::ProcessingSizeInFrames);
+  }
+
+  // Fractions of real time: the render-thread share of each quantum, and
+  // the worker's share of each tail period.
+  float
+  renderLoad() const {
+    return headLoad.load(std::memory_order_relaxed);
+  }
+
+  float
+  workerLoad() const {
+    return engine ? engine->workerLoad() : 0;
+  }
+
+  uint64_t
+  lateBlocks() const {
+    return engine ? engine->lateBlocks() : 0;
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    lab::AudioBus* out = output(0)->bus(r);
+    if(!engine) {
+      out->zero();
+      return;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    lab::AudioBus* in = input(0)->bus(r);
+    int inChannels = in->numberOfChannels();
+    const float* src[ConvolutionEngine::CHANNELS];
+    float* dst[ConvolutionEngine::CHANNELS];
+    for(int c = 0; c < ConvolutionEngine::CHANNELS; c++) {
+      src[c] = in->channel(std::min(c, inChannels - 1))->data();
+      dst[c] = out->channel(std::min(c, out->numberOfChannels() - 1))->mutableData();
+    }
+    engine->process(src, dst, bufferSize);
+    out->clearSilentFlag();
+
+    std::chrono::duration<float> took = std::chrono::steady_clock::now() - start;
+    float load = took.count() * r.context()->sampleRate() / float(bufferSize);
+    headLoad.store(headLoad.load(std::memory_order_relaxed) * 0.9f + load * 0.1f, std::memory_order_relaxed);
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {
+    if(engine)
+      engine->reset();
+  }
+
+  double
+  tailTime(lab::ContextRenderLock& r) const override {
+    return engine ? double(engine->impulseLength()) / r.context()->sampleRate() : 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock& r) const override {
+    return double(latencyFrames()) / r.context()->sampleRate();
+  }
+
+private:
+  // The WebAudio spec's ConvolverNode normalization (equal-power against a
+  // calibrated reference).
+  static float
+  normalizationScale(const lab::AudioBus& bus, float sampleRate) {
+    const float GainCalibration = 0.00125f, GainCalibrationSampleRate = 44100, MinPower = 0.000125f;
+    double power = 0;
+    for(int c = 0; c < bus.numberOfChannels(); c++) {
+      const float* p = bus.channel(c)->data();
+      for(int i = 0; i < bus.length(); i++)
+        power += double(p[i]) * p[i];
+    }
+    float scale = 1 / std::max(MinPower, float(std::sqrt(power / (double(bus.numberOfChannels()) * bus.length()))));
+    scale *= GainCalibration;
+    if(sampleRate > 0)
+      scale *= GainCalibrationSampleRate / sampleRate;
+    if(bus.numberOfChannels() == 4)
+      scale *= 0.5f;
+    return scale;
+  }
+
+  const int block;
+  bool normalize = true;
+  std::shared_ptr<lab::AudioBus> impulse;
+  std::shared_ptr<ConvolutionEngine> engine;
+  std::atomic<float> headLoad{0};
+};
@@ -9,6 +9,7 @@
 #include "LabSound/core/SampledAudioNode.h"
 #include "LabSound/extended/AudioContextLock.h"
 #include "LabSound/extended/AudioFileReader.h"
+#include "LabSound/extended/ADSRNode.h"
 #include "LabSound/extended/NoiseNode.h"
 #include "LabSound/core/AudioSetting.h"
 #include "LabSound/core/DelayNode.h"
@@ -18,17 +19,51 @@
 #include "LabSound/core/AnalyserNode.h"
 #include "LabSound/core/DynamicsCompressorNode.h"
 #include "LabSound/core/ConstantSourceNode.h"
+#include "libnyquist/Decoders.h"
 #include "libnyquist/Encoders.h"
+#include "sampler-voice-pool.hpp"
+#include "partitioned-convolver.hpp"
+#include "composite-effects.hpp"
+#include "render-profiler.hpp"
+#include "render-monitor.hpp"
+#include "parallel-mixer.hpp"
+#include "expression-node.hpp"
+#include "audio-worklet.hpp"
+#include "stk-node.hpp"
+#include "sequencer.hpp"
+#include "analyser-frames.hpp"
+#include "spectrogram.hpp"
+#include "rtaudio-device.hpp"
+#include "audio-file-writer.hpp"
+
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
 #include <cstring>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
 extern int js_stk_init(JSContext* ctx, JSModuleDef* m);
 extern "C" void js_init_module_stk(JSContext* ctx, JSModuleDef*);
 
 static JSClassID js_audiocontext_class_id;
+static JSClassID js_audionode_class_id;
+// Kind tags of AudioNode wrappers (JsAudioNode::kind), not JS classes:
+// every node wrapper is a js_audionode_class_id object.
 static JSClassID js_audiodestinationnode_class_id;
 static JSClassID js_audiolistener_class_id;
 static JSClassID js_audiodevice_class_id;
@@ -44,9 +79,20 @@ static JSClassID js_convolvernode_class_id;
 static JSClassID js_analysernode_class_id;
 static JSClassID js_dynamicscompressornode_class_id;
 static JSClassID js_constantsourcenode_class_id;
+static JSClassID js_samplervoicepool_class_id;
 static JSClassID js_audiobuffer_class_id;
 static JSClassID js_audiosetting_class_id;
 static JSClassID js_audioparam_class_id;
+static JSClassID js_audioworklet_class_id, js_messageport_class_id;
+static JSClassID js_adsrnode_class_id;
+static JSClassID js_feedbackdelaynode_class_id;
+static JSClassID js_pingpongdelaynode_class_id;
+static JSClassID js_stereowidthnode_class_id;
+static JSClassID js_parallelmixernode_class_id;
+static JSClassID js_expressionnode_class_id;
+static JSClassID js_audioworkletnode_class_id;
+static JSClassID js_stknode_class_id;
+static JSClassID js_sequencer_class_id;
 
 // Shared prototypes so connect/disconnect (and start/stop for scheduled
 // sources) are inherited via the JS prototype chain instead of duplicated
@@ -71,26 +117,107 @@ static JSValue convolvernode_proto, convolvernode_ctor;
 static JSValue analysernode_proto, analysernode_ctor;
 static JSValue dynamicscompressornode_proto, dynamicscompressornode_ctor;
 static JSValue constantsourcenode_proto, constantsourcenode_ctor;
+static JSValue samplervoicepool_proto, samplervoicepool_ctor;
 static JSValue audiobuffer_proto, audiobuffer_ctor;
 static JSValue audiosetting_proto;
 static JSValue audioparam_proto;
+static JSValue audioworklet_proto, messageport_proto;
+static JSValue float32array_ctor;
+static JSValue adsrnode_proto, adsrnode_ctor;
+static JSValue feedbackdelaynode_proto, feedbackdelaynode_ctor;
+static JSValue pingpongdelaynode_proto, pingpongdelaynode_ctor;
+static JSValue stereowidthnode_proto, stereowidthnode_ctor;
+static JSValue parallelmixernode_proto, parallelmixernode_ctor;
+static JSValue expressionnode_proto, expressionnode_ctor;
+static JSValue audioworkletnode_proto, audioworkletnode_ctor;
+static JSValue stknode_proto, stknode_ctor;
+static JSValue sequencer_proto, sequencer_ctor;
 
 typedef std::shared_ptr<lab::AudioContext> AudioContextPtr;
 typedef std::shared_ptr<lab::AudioDestinationNode> AudioDestinationNodePtr;
 typedef std::shared_ptr<lab::AudioListener> AudioListenerPtr;
 typedef std::shared_ptr<lab::AudioDevice> AudioDevicePtr;
 
+struct NodeRegistry;
+
 struct JsAudioNode {
+  JSClassID kind; // which js_xxxnode_class_id this wrapper is
   std::shared_ptr<lab::AudioNode> node;
   AudioContextPtr ctx;
+  // Set by anchor_node_in_context; the finalizer drops this wrapper's claim.
+  std::shared_ptr<NodeRegistry> registry;
+};
+
+// Keeps every node built through a JS constructor alive natively -- lab's
+// graph only holds raw back-pointers, so the shared_ptr must outlive the
+// wrapper -- until it can no longer make or pass on sound: no JS wrapper
+// left, not a playing/scheduled source, no connected inputs, not producing
+// on its own (propagatesSilence()), and its tail/latency has rung out. Its outputs are then disconnected, and once
+// lab has applied that the entry is dropped. Nodes downstream of it lose
+// their last input in the process and follow on later sweeps.
+struct NodeRegistry {
+  enum State { LIVE, IDLE, DISCONNECTING };
+  // lab::AudioContext::connect() only queues the connection for its update
+  // thread, so a freshly wired node can look input-less for a moment; it
+  // has to stay that way for this much context time before it counts.
+  static constexpr double GRACE_TIME = 0.05;
+  struct Entry {
+    std::shared_ptr<lab::AudioNode> node;
+    int wrappers = 0;
+    State state = LIVE;
+    double idleUntil = 0;
+    uint32_t id = 0; // AudioNode.nodeId, what getRenderProfile() reports
+  };
+  std::unordered_map<lab::AudioNode*, Entry> entries;
+  uint64_t reclaimed = 0;
+  uint32_t anchored = 0;
+  uint32_t nextId = 0;
+  // Created by the first renderProfiling assignment; follows `entries`.
+  std::shared_ptr<RenderProfilerNode> profiler;
+};
+
+// Opaque of both AudioContext and OfflineAudioContext objects.
+struct OfflineRenderTask;
+
+struct JsAudioContext {
+  AudioContextPtr ac;
+  std::shared_ptr<NodeRegistry> nodes = std::make_shared<NodeRegistry>();
+  int32_t length = 0; // OfflineAudioContext render length in frames
+  // ctx.renderQuantumSize: frames per offline render pass, or per device
+  // callback; never less than lab's graph quantum, ProcessingSizeInFrames.
+  int32_t renderQuantum = lab::AudioNode::ProcessingSizeInFrames;
+  std::shared_ptr<OfflineRenderTask> render;
+  // Realtime contexts only: the output stream (rtaudio-device.hpp), for
+  // baseLatency/outputLatency and its render-thread health
+  // (render-monitor.hpp), and the object ctx.renderStats refills and
+  // returns on every read.
+  std::shared_ptr<RtAudioDevice> device;
+  std::string sinkId; // as the spec reports it: "" for the default output
+  JSValue stats = JS_UNDEFINED, statsCounters = JS_UNDEFINED, statsDurations = JS_UNDEFINED, statsIntervals = JS_UNDEFINED;
+  // ctx.audioWorklet, both made on first access.
+  std::shared_ptr<WorkletScope> worklet;
+  JSValue audioWorklet = JS_UNDEFINED;
 };
 
 struct JsAudioParam {
   std::shared_ptr<lab::AudioParam> param;
 };
 
+struct JsChannelView;
+
+// `views` lists the live getChannelData() ArrayBuffers of the buffer. It is
+// shared with each view's free callback since a view can outlive the
+// AudioBuffer object it came from.
 struct JsAudioBuffer {
   std::shared_ptr<lab::AudioBus> bus;
+  std::shared_ptr<std::vector<JsChannelView*>> views = std::make_shared<std::vector<JsChannelView*>>();
+};
+
+struct JsChannelView {
+  std::shared_ptr<lab::AudioBus> bus;
+  std::shared_ptr<std::vector<JsChannelView*>> views;
+  JSValue buffer;  // not a reference: the free callback unlists the view
+  bool detaching;  // set by acquire_audio_buffer for JS_DetachArrayBuffer
 };
 
 // Shim so DelayNode.delayTime can be `delay.delayTime.value = 0.3` isomorphic
@@ -102,35 +229,34 @@ struct JsAudioSetting {
 
 /* ---------- helpers ---------- */
 
+// Every AudioNode wrapper is an object of the one js_audionode_class_id
+// class; which node type it wraps is the kind at the head of its
+// JsAudioNode. The js_xxxnode_class_id tags are handed out by
+// new_audio_node_kind() in js_labsound_init, so resolving a wrapper --
+// connect()/disconnect() do it for both ends on every call -- is a single
+// JS_GetOpaque() with any quickjs. audio_node_kinds holds their names.
+static std::vector<const char*> audio_node_kinds{nullptr};
+
+static void
+new_audio_node_kind(JSClassID* kind, const char* name) {
+  if(!*kind) {
+    *kind = audio_node_kinds.size();
+    audio_node_kinds.push_back(name);
+  }
+}
+
 static JsAudioNode*
 any_audio_node(JSValueConst v) {
-  void* p;
-  if((p = JS_GetOpaque(v, js_audiodestinationnode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_oscillatornode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_gainnode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_biquadfilternode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_audiobuffersourcenode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_noisenode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_delaynode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_waveshapernode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_stereopannernode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_convolvernode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_analysernode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_dynamicscompressornode_class_id)))
-    return static_cast<JsAudioNode*>(p);
-  if((p = JS_GetOpaque(v, js_constantsourcenode_class_id)))
-    return static_cast<JsAudioNode*>(p);
+  return static_cast<JsAudioNode*>(JS_GetOpaque(v, js_audionode_class_id));
+}
+
+// JS_GetOpaque2() for one node type: throws unless `v` wraps that kind.
+static JsAudioNode*
+get_audio_node(JSContext* ctx, JSValueConst v, JSClassID kind) {
+  JsAudioNode* w = any_audio_node(v);
+  if(w && w->kind == kind)
+    return w;
+  JS_ThrowTypeError(ctx, "not a %s", audio_node_kinds[kind]);
   return nullptr;
 }
 
@@ -153,6 +279,43 @@ make_audio_setting_js(JSContext* ctx, std::shared_ptr<lab::AudioSetting> s) {
   return obj;
 }
 
+// The elements of a Float32Array, or of a Float64Array when T is double, or
+// null with an exception pending. JS_GetTypedArrayBuffer() only reports the
+// element size, which an Int32Array or a BigInt64Array shares, so the type
+// comes from JS_GetTypedArrayType() where quickjs has it (see
+// CMakeLists.txt), else from the global constructor.
+template<class T>
+static T*
+float_array_data(JSContext* ctx, JSValueConst val, size_t* count, const char* what) {
+  const bool f64 = sizeof(T) == sizeof(double);
+#ifdef HAVE_JS_GETTYPEDARRAYTYPE
+  bool typed = JS_GetTypedArrayType(val) == (f64 ? JS_TYPED_ARRAY_FLOAT64 : JS_TYPED_ARRAY_FLOAT32);
+#else
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue ctor = JS_GetPropertyStr(ctx, global, f64 ? "Float64Array" : "Float32Array");
+  JS_FreeValue(ctx, global);
+  int r = JS_IsInstanceOf(ctx, val, ctor);
+  JS_FreeValue(ctx, ctor);
+  if(r < 0)
+    return nullptr;
+  bool typed = r > 0;
+#endif
+  if(!typed) {
+    JS_ThrowTypeError(ctx, "%s must be a %s", what, f64 ? "Float64Array" : "Float32Array");
+    return nullptr;
+  }
+  size_t byte_offset = 0, byte_length = 0, bytes_per_element = 0, ab_size = 0;
+  JSValue buf = JS_GetTypedArrayBuffer(ctx, val, &byte_offset, &byte_length, &bytes_per_element);
+  if(JS_IsException(buf))
+    return nullptr;
+  uint8_t* ab_data = JS_GetArrayBuffer(ctx, &ab_size, buf);
+  JS_FreeValue(ctx, buf);
+  if(!ab_data)
+    return nullptr;
+  *count = byte_length / sizeof(T);
+  return reinterpret_cast<T*>(ab_data + byte_offset);
+}
+
 // Read a 1-D float buffer from either a Float32Array or a plain Array.
 static int
 read_float_array(JSContext* ctx, JSValueConst val, std::vector<float>& out) {
@@ -192,22 +355,102 @@ read_float_array(JSContext* ctx, JSValueConst val, std::vector<float>& out) {
 }
 
 // quickjs.h has no JS_NewFloat32Array-style helper, so build one the same
-// way JS code would: wrap a copied ArrayBuffer with the global constructor.
+// way JS code would: wrap an ArrayBuffer with the global constructor (looked
+// up once in js_labsound_init rather than per call).
 static JSValue
-make_float32_array(JSContext* ctx, const float* data, size_t count) {
-  JSValue ab = JS_NewArrayBufferCopy(ctx, reinterpret_cast<const uint8_t*>(data), count * sizeof(float));
+make_float32_array_from(JSContext* ctx, JSValue ab) {
   if(JS_IsException(ab))
     return ab;
-  JSValue global = JS_GetGlobalObject(ctx);
-  JSValue ctor = JS_GetPropertyStr(ctx, global, "Float32Array");
   JSValue args[1] = {ab};
-  JSValue ta = JS_CallConstructor(ctx, ctor, 1, args);
-  JS_FreeValue(ctx, ctor);
-  JS_FreeValue(ctx, global);
+  JSValue ta = JS_CallConstructor(ctx, float32array_ctor, 1, args);
   JS_FreeValue(ctx, ab);
   return ta;
 }
 
+static std::shared_ptr<lab::AudioBus>
+clone_audio_bus(const lab::AudioBus& src) {
+  auto bus = std::make_shared<lab::AudioBus>(src.numberOfChannels(), src.length(), true);
+  bus->setSampleRate(src.sampleRate());
+  for(int c = 0; c < src.numberOfChannels(); c++)
+    memcpy(bus->channel(c)->mutableData(), src.channel(c)->data(), sizeof(float) * src.length());
+  return bus;
+}
+
+// True when something besides this wrapper and its own channel views holds
+// the bus -- a SampledAudioNode/ConvolverNode the render thread reads from,
+// or a second AudioBuffer object (e.g. from ConvolverNode.buffer).
+static bool
+audio_buffer_is_shared(JsAudioBuffer* w) {
+  long holders = w->bus.use_count() - 1;
+  for(JsChannelView* v : *w->views)
+    holders -= v->bus == w->bus;
+  return holders > 0;
+}
+
+// Copy-on-write: before JS gets write access to the samples (a channel view
+// or copyToChannel), detach from any other holder so the render thread never
+// sees a write in flight. Read-mostly buffers that were never handed to a
+// node stay at exactly one copy.
+static void
+audio_buffer_make_writable(JsAudioBuffer* w) {
+  if(audio_buffer_is_shared(w))
+    w->bus = clone_audio_bus(*w->bus);
+}
+
+// The other half of the copy-on-write, the spec's "acquire the content":
+// a node gets the bus itself, and every channel view JS still has is
+// detached so it can't write under the render thread. getChannelData()
+// afterwards makes a new view, on a copy while the node holds the bus.
+static std::shared_ptr<lab::AudioBus>
+acquire_audio_buffer(JSContext* ctx, JsAudioBuffer* w) {
+  std::vector<JsChannelView*> live;
+  live.swap(*w->views);
+  for(JsChannelView* v : live) {
+    v->detaching = true;
+    JS_DetachArrayBuffer(ctx, v->buffer);
+  }
+  return w->bus;
+}
+
+// Detaching calls this first, and the ArrayBuffer's finalizer calls it
+// again with no data.
+static void
+js_channel_view_free(JSRuntime* rt, void* opaque, void* ptr) {
+  JsChannelView* v = static_cast<JsChannelView*>(opaque);
+  if(v->views) {
+    auto& live = *v->views;
+    live.erase(std::remove(live.begin(), live.end(), v), live.end());
+    v->views.reset();
+    v->bus.reset();
+  }
+  if(v->detaching) {
+    v->detaching = false;
+    return;
+  }
+  v->~JsChannelView();
+  js_free_rt(rt, v);
+}
+
+// A Float32Array aliasing one channel of the bus (spec: getChannelData
+// returns the buffer's own storage). The view keeps the bus alive on its own.
+static JSValue
+make_channel_view(JSContext* ctx, JsAudioBuffer* w, int channel) {
+  audio_buffer_make_writable(w);
+  lab::AudioChannel* ch = w->bus->channel(channel);
+  auto* v = static_cast<JsChannelView*>(js_mallocz(ctx, sizeof(JsChannelView)));
+  if(!v)
+    return JS_EXCEPTION;
+  new(v) JsChannelView{w->bus, w->views, JS_UNDEFINED, false};
+  JSValue ab = JS_NewArrayBuffer(ctx, reinterpret_cast<uint8_t*>(ch->mutableData()), ch->length() * sizeof(float), js_channel_view_free, v, false);
+  if(JS_IsException(ab)) {
+    js_channel_view_free(JS_GetRuntime(ctx), v, nullptr);
+    return ab;
+  }
+  v->buffer = ab;
+  w->views->push_back(v);
+  return make_float32_array_from(ctx, ab);
+}
+
 static JSValue
 make_audio_buffer_js(JSContext* ctx, std::shared_ptr<lab::AudioBus> bus) {
   auto* w = static_cast<JsAudioBuffer*>(js_mallocz(ctx, sizeof(JsAudioBuffer)));
@@ -262,38 +505,242 @@ write_bus_to_wav(lab::AudioBus* bus, const std::string& path, bool mixToMono) {
   return nqr::EncoderError::NoError == nqr::encode_wav_to_disk(params, &fileData, path);
 }
 
-// Anchor a node JS object into a hidden "__nodes" array on its AudioContext
-// AND give the node a JS-level "context" back-reference. lab's graph holds
-// raw back-pointers to nodes, so letting QuickJS finalize a node wrapper
-// while audio is still rendering corrupts the graph. The cycle node→context→
-// __nodes→node is fine — QuickJS's cycle collector handles it, and as long
-// as anything from the outside reaches one node, the whole graph stays live.
+// The inverse, for decoding on worker threads: lab::MakeBusFromMemory()
+// goes through one NyquistIO shared behind LabSound's file I/O mutex, so
+// concurrent decodes would just queue on it. Each caller brings its own
+// NyquistIO instead. Deinterleaves like lab::MakeBusFromSampleData().
+static std::shared_ptr<lab::AudioBus>
+decode_bus_from_memory(nqr::NyquistIO& io, const std::vector<uint8_t>& bytes, bool mixToMono, std::string& error) {
+  nqr::AudioData audio;
+  try {
+    io.Load(&audio, bytes);
+  } catch(const std::exception& e) {
+    error = e.what();
+    return nullptr;
+  }
+  int numberOfChannels = audio.channelCount;
+  if(numberOfChannels <= 0 || audio.samples.empty()) {
+    error = "no audio data";
+    return nullptr;
+  }
+  size_t length = audio.samples.size() / numberOfChannels;
+  auto bus = std::make_shared<lab::AudioBus>(mixToMono ? 1 : numberOfChannels, int(length), true);
+  bus->setSampleRate(float(audio.sampleRate));
+  const float* src = audio.samples.data();
+  if(mixToMono) {
+    float* dst = bus->channel(0)->mutableData();
+    for(size_t i = 0; i < length; i++) {
+      float sum = 0;
+      for(int c = 0; c < numberOfChannels; c++)
+        sum += src[i * numberOfChannels + c];
+      dst[i] = sum / float(numberOfChannels);
+    }
+  } else {
+    for(int c = 0; c < numberOfChannels; c++) {
+      float* dst = bus->channel(c)->mutableData();
+      for(size_t i = 0; i < length; i++)
+        dst[i] = src[i * numberOfChannels + c];
+    }
+  }
+  return bus;
+}
+
+// Process-wide cache of decoded files for createBufferFromFile(), keyed by
+// path + mtime/size + mixToMono so an edited file is reloaded. Entries are the
+// very buses handed out (AudioBuffer copy-on-write keeps them pristine), and
+// are shared across contexts and across runtimes on other threads, hence
+// the mutex. `budget` bounds the bytes of sample data the cache keeps
+// alive; least recently used entries go first.
+static struct SampleCache {
+  struct Entry {
+    std::string key;
+    std::shared_ptr<lab::AudioBus> bus;
+    size_t bytes;
+  };
+  std::mutex lock;
+  std::list<Entry> lru; // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> index;
+  size_t bytes = 0, budget = size_t(256) << 20;
+  uint64_t hits = 0, misses = 0, evictions = 0;
+
+  // Caller holds `lock`.
+  void
+  trim() {
+    while(bytes > budget && !lru.empty()) {
+      bytes -= lru.back().bytes;
+      index.erase(lru.back().key);
+      lru.pop_back();
+      evictions++;
+    }
+  }
+} & sample_cache = *new SampleCache;
+
+static std::shared_ptr<lab::AudioBus>
+sample_cache_load(const char* path, bool mixToMono) {
+  struct stat st;
+  if(stat(path, &st) == -1)
+    return nullptr;
+  std::string key = std::string(path) + '\0' + std::to_string(st.st_mtim.tv_sec) + '.' + std::to_string(st.st_mtim.tv_nsec) + '\0' + std::to_string(st.st_size) + '\0' +
+                    (mixToMono ? 'm' : 's');
+  {
+    std::lock_guard<std::mutex> guard(sample_cache.lock);
+    auto it = sample_cache.index.find(key);
+    if(it != sample_cache.index.end()) {
+      sample_cache.lru.splice(sample_cache.lru.begin(), sample_cache.lru, it->second);
+      sample_cache.hits++;
+      return it->second->bus;
+    }
+    sample_cache.misses++;
+  }
+
+  // Decode unlocked; if another thread got there first, keep its bus.
+  auto bus = lab::MakeBusFromFile(path, mixToMono);
+  if(!bus)
+    return nullptr;
+  size_t bytes = size_t(bus->numberOfChannels()) * bus->length() * sizeof(float);
+
+  std::lock_guard<std::mutex> guard(sample_cache.lock);
+  auto it = sample_cache.index.find(key);
+  if(it != sample_cache.index.end())
+    return it->second->bus;
+  if(bytes > sample_cache.budget)
+    return bus;
+  sample_cache.lru.push_front({key, bus, bytes});
+  sample_cache.index.emplace(std::move(key), sample_cache.lru.begin());
+  sample_cache.bytes += bytes;
+  sample_cache.trim();
+  return bus;
+}
+
+// The part of "can it still make sound" that the graph lock answers. A
+// node that passes it may still be a generator (StkNode, ExpressionNode,
+// AudioWorkletNode, SamplerVoicePool, ...); node_registry_producing() asks
+// that under the render lock.
+static bool
+node_registry_busy(lab::AudioNode* node) {
+  if(auto* s = dynamic_cast<lab::AudioScheduledSourceNode*>(node))
+    if(s->isPlayingOrScheduled())
+      return true;
+  for(int i = 0; i < node->numberOfInputs(); i++)
+    if(node->input(i)->isConnected())
+      return true;
+  return false;
+}
+
+// Whether lab would still run process() with silence in: for lab's own
+// nodes, until their tail has rung out after the last audible input; for
+// ours, while they have something to play.
+static bool
+node_registry_producing(lab::ContextRenderLock& r, lab::AudioNode* node) {
+  return !node->propagatesSilence(r);
+}
+
+static void
+node_registry_sweep(NodeRegistry& reg, const AudioContextPtr& ac) {
+  double now = ac->currentTime();
+  std::vector<NodeRegistry::Entry*> quiet;
+  std::vector<std::shared_ptr<lab::AudioNode>> finished, released;
+
+  {
+    lab::ContextGraphLock gLock(ac.get(), "NodeRegistry.sweep");
+    for(auto it = reg.entries.begin(); it != reg.entries.end();) {
+      NodeRegistry::Entry& e = it->second;
+      if(e.wrappers > 0) {
+        ++it;
+        continue;
+      }
+      switch(e.state) {
+        case NodeRegistry::LIVE:
+        case NodeRegistry::IDLE:
+          if(node_registry_busy(e.node.get()))
+            e.state = NodeRegistry::LIVE;
+          else
+            quiet.push_back(&e);
+          break;
+        case NodeRegistry::DISCONNECTING: {
+          bool connected = false;
+          for(int i = 0; i < e.node->numberOfOutputs() && !connected; i++)
+            connected = e.node->output(i)->isConnected();
+          if(!connected) {
+            if(reg.profiler)
+              reg.profiler->remove(ac.get(), e.node.get());
+            released.push_back(std::move(e.node));
+            it = reg.entries.erase(it);
+            reg.reclaimed++;
+            continue;
+          }
+          break;
+        }
+      }
+      ++it;
+    }
+  }
+
+  if(!quiet.empty()) {
+    lab::ContextRenderLock rLock(ac.get(), "NodeRegistry.sweep");
+    for(auto* e : quiet) {
+      if(node_registry_producing(rLock, e->node.get()))
+        e->state = NodeRegistry::LIVE;
+      else if(e->state == NodeRegistry::LIVE) {
+        e->state = NodeRegistry::IDLE;
+        e->idleUntil = now + NodeRegistry::GRACE_TIME + e->node->tailTime(rLock) + e->node->latencyTime(rLock);
+      } else if(now >= e->idleUntil) {
+        e->state = NodeRegistry::DISCONNECTING;
+        finished.push_back(e->node);
+      }
+    }
+  }
+
+  for(auto& node : finished)
+    for(int i = 0; i < node->numberOfOutputs(); i++)
+      ac->disconnect(node, i);
+  // `released` drops the last references here, outside the graph lock.
+}
+
+static void
+node_registry_release(NodeRegistry& reg, lab::AudioNode* node) {
+  auto it = reg.entries.find(node);
+  if(it != reg.entries.end() && it->second.wrappers > 0)
+    it->second.wrappers--;
+}
+
+// Register a node with its AudioContext's NodeRegistry AND give the node a
+// JS-level "context" back-reference. The registry (not the JS object graph)
+// is what keeps the lab::AudioNode alive while it can still render, so node
+// wrappers are ordinary garbage to QuickJS. Sweeping is amortized over node
+// creation, which is also what makes churn (one-shot voices) grow the
+// registry in the first place.
 static void
 anchor_node_in_context(JSContext* ctx, JSValueConst ac_jsval, JSValueConst node_jsval) {
-  if(JS_IsUndefined(ac_jsval) || !JS_IsObject(ac_jsval))
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque(ac_jsval, js_audiocontext_class_id));
+  JsAudioNode* w = any_audio_node(node_jsval);
+  if(!jac || !w)
     return;
 
   JS_SetPropertyStr(ctx, node_jsval, "context", JS_DupValue(ctx, ac_jsval));
 
-  JSValue arr = JS_GetPropertyStr(ctx, ac_jsval, "__nodes");
-  if(JS_IsUndefined(arr) || JS_IsException(arr)) {
-    JS_FreeValue(ctx, arr);
-    arr = JS_NewArray(ctx);
-    JS_SetPropertyStr(ctx, ac_jsval, "__nodes", JS_DupValue(ctx, arr));
+  NodeRegistry::Entry& e = jac->nodes->entries[w->node.get()];
+  if(!e.node) {
+    e.node = w->node;
+    e.id = ++jac->nodes->nextId;
+    if(jac->nodes->profiler)
+      jac->nodes->profiler->add(jac->ac.get(), e.node, e.id);
+  }
+  e.wrappers++;
+  w->registry = jac->nodes;
+
+  if(++jac->nodes->anchored % 32 == 0) {
+    node_registry_sweep(*jac->nodes, jac->ac);
+    if(jac->worklet)
+      jac->worklet->collect();
   }
-  uint32_t len = 0;
-  JSValue len_v = JS_GetPropertyStr(ctx, arr, "length");
-  JS_ToUint32(ctx, &len, len_v);
-  JS_FreeValue(ctx, len_v);
-  JS_SetPropertyUint32(ctx, arr, len, JS_DupValue(ctx, node_jsval));
-  JS_FreeValue(ctx, arr);
 }
 
 static JSValue
-make_audio_node_js(JSContext* ctx, JSValueConst proto, JSClassID class_id, std::shared_ptr<lab::AudioNode> node, AudioContextPtr ac) {
+make_audio_node_js(JSContext* ctx, JSValueConst proto, JSClassID kind, std::shared_ptr<lab::AudioNode> node, AudioContextPtr ac) {
   auto* w = static_cast<JsAudioNode*>(js_mallocz(ctx, sizeof(JsAudioNode)));
-  new(w) JsAudioNode{std::move(node), std::move(ac)};
-  JSValue obj = JS_NewObjectProtoClass(ctx, proto, class_id);
+  new(w) JsAudioNode{kind, std::move(node), std::move(ac)};
+  JSValue obj = JS_NewObjectProtoClass(ctx, proto, js_audionode_class_id);
   if(JS_IsException(obj)) {
     w->~JsAudioNode();
     js_free(ctx, w);
@@ -317,37 +764,487 @@ make_audio_param_js(JSContext* ctx, std::shared_ptr<lab::AudioParam> param) {
   return obj;
 }
 
+/* ---------- device selection ---------- */
+//
+// lab::AudioDevice_RtAudio::MakeAudioDeviceList() opens every device on the
+// host to probe it, which on ALSA/Pulse takes hundreds of milliseconds. It
+// only runs when a device is asked for by name or through
+// AudioContext.getDevices(), and the list is kept until
+// getDevices({refresh: true}). The default device alone comes from the
+// list if it's been built, or else RtAudioDevice::defaultDevice(), which
+// probes just that one.
+
+static struct DeviceCache {
+  std::mutex lock;
+  std::vector<lab::AudioDeviceInfo> devices;
+  bool valid = false;
+} & device_cache = *new DeviceCache;
+
+static std::vector<lab::AudioDeviceInfo>
+device_list(bool refresh = false) {
+  std::lock_guard<std::mutex> guard(device_cache.lock);
+  if(!device_cache.valid || refresh) {
+    device_cache.devices = lab::AudioDevice_RtAudio::MakeAudioDeviceList();
+    device_cache.valid = true;
+  }
+  return device_cache.devices;
+}
+
+// By identifier (getDevices()' deviceId) or, with index >= 0, by index;
+// neither is the default device. info.index is -1 if nothing matches.
+static lab::AudioDeviceInfo
+find_device(const std::string& name, int32_t index, bool input) {
+  auto usable = [input](const lab::AudioDeviceInfo& d) { return (input ? d.num_input_channels : d.num_output_channels) > 0; };
+  if(name.empty() && index < 0) {
+    {
+      std::lock_guard<std::mutex> guard(device_cache.lock);
+      if(device_cache.valid) {
+        for(const auto& d : device_cache.devices)
+          if((input ? d.is_default_input : d.is_default_output) && usable(d))
+            return d;
+        return lab::AudioDeviceInfo{};
+      }
+    }
+    return RtAudioDevice::defaultDevice(input);
+  }
+  for(const auto& d : device_list())
+    if((index >= 0 ? d.index == index : d.identifier == name) && usable(d))
+      return d;
+  return lab::AudioDeviceInfo{};
+}
+
+static lab::AudioStreamConfig
+output_device_config(const lab::AudioDeviceInfo& info) {
+  lab::AudioStreamConfig config;
+  if(info.index != -1) {
+    config.device_index = info.index;
+    config.desired_channels = std::min(uint32_t(2), info.num_output_channels);
+    config.desired_samplerate = info.nominal_samplerate;
+  } else {
+    config.device_index = 0;
+    config.desired_channels = 2;
+    config.desired_samplerate = 44100;
+  }
+  return config;
+}
+
+static lab::AudioStreamConfig
+input_device_config(const lab::AudioDeviceInfo& info, uint32_t channels, float sampleRate) {
+  lab::AudioStreamConfig config;
+  if(info.index != -1) {
+    config.device_index = info.index;
+    config.desired_channels = std::min(channels, info.num_input_channels);
+    config.desired_samplerate = sampleRate;
+  }
+  return config;
+}
+
+// The default output and input, as the AudioDevice class opens them.
 static std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig>
 get_default_device_config() {
-  const auto devices = lab::AudioDevice_RtAudio::MakeAudioDeviceList();
-  lab::AudioDeviceInfo outInfo, inInfo;
-  for(const auto& info : devices) {
-    if(info.is_default_output)
-      outInfo = info;
-    if(info.is_default_input)
-      inInfo = info;
-  }
-
-  lab::AudioStreamConfig outputConfig;
-  if(outInfo.index != -1) {
-    outputConfig.device_index = outInfo.index;
-    outputConfig.desired_channels = std::min(uint32_t(2), outInfo.num_output_channels);
-    outputConfig.desired_samplerate = outInfo.nominal_samplerate;
+  lab::AudioStreamConfig outputConfig = output_device_config(find_device("", -1, false));
+  lab::AudioStreamConfig inputConfig = input_device_config(find_device("", -1, true), 1, outputConfig.desired_samplerate);
+  return {inputConfig, outputConfig};
+}
+
+/* ---------- background work ---------- */
+//
+// Long jobs run off the JS thread and settle a promise back on it. Each
+// JSRuntime has its own AsyncState: a worker posts its finished AsyncTask to
+// the `done` list of the state the task was started on and pokes that
+// state's self-pipe; the pipe is watched with os.setReadHandler() (qjs's
+// 'os' module, reached through a dynamic import) for as long as any task is
+// running, which also keeps js_std_loop from exiting under a render. The
+// handler drains completions, settles their promises and lets running tasks
+// report progress. Without an 'os' module, whatever polls a task
+// (ctx.renderedFrames) drains too.
+
+struct AsyncState;
+
+struct AsyncTask {
+  JSValue resolving[2] = {JS_UNDEFINED, JS_UNDEFINED};
+  // Set by async_start(): where the task settles.
+  JSContext* ctx = nullptr;
+  std::shared_ptr<AsyncState> state;
+
+  virtual ~AsyncTask() {}
+  // JS thread, on every drain while running.
+  virtual void
+  poll(JSContext* ctx) {}
+  // JS thread, once the worker has posted: the value to resolve with, or
+  // JS_EXCEPTION to reject with the pending exception.
+  virtual JSValue settle(JSContext* ctx) = 0;
+  // JS thread, after settling: release any JSValues the task holds.
+  virtual void
+  release(JSContext* ctx) {}
+};
+
+typedef std::shared_ptr<AsyncTask> AsyncTaskPtr;
+
+struct AsyncState {
+  std::mutex lock;
+  std::vector<AsyncTaskPtr> done;    // guarded by `lock`
+  std::vector<AsyncTaskPtr> running; // JS thread only
+  int pipe[2] = {-1, -1};
+  bool watching = false;
+
+  ~AsyncState() {
+    for(int fd : pipe)
+      if(fd != -1)
+        close(fd);
+  }
+};
+
+// One per runtime while it has tasks: qjs runs each os.Worker on its own
+// thread with its own runtime, and their tasks must not meet.
+static std::mutex async_states_lock;
+static std::unordered_map<JSRuntime*, std::shared_ptr<AsyncState>> async_states;
+
+// JS thread. Null with an exception pending if the pipe can't be made.
+static std::shared_ptr<AsyncState>
+async_state(JSContext* ctx) {
+  std::lock_guard<std::mutex> guard(async_states_lock);
+  auto& state = async_states[JS_GetRuntime(ctx)];
+  if(!state) {
+    auto fresh = std::make_shared<AsyncState>();
+    if(pipe(fresh->pipe) == -1) {
+      fresh->pipe[0] = fresh->pipe[1] = -1;
+      async_states.erase(JS_GetRuntime(ctx));
+      JS_ThrowInternalError(ctx, "pipe() failed: %s", strerror(errno));
+      return nullptr;
+    }
+    for(int fd : fresh->pipe) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+      fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+    state = std::move(fresh);
+  }
+  return state;
+}
+
+// Any thread.
+static void
+async_wake(AsyncState& state) {
+  char c = 0;
+  if(write(state.pipe[1], &c, 1) < 0) {
+    // Full pipe: a wakeup is already pending.
+  }
+}
+
+// Worker thread, once: hand the task back to the JS thread.
+static void
+async_post(AsyncTaskPtr task) {
+  std::shared_ptr<AsyncState> state = task->state;
+  {
+    std::lock_guard<std::mutex> guard(state->lock);
+    state->done.push_back(std::move(task));
+  }
+  async_wake(*state);
+}
+
+// JS thread. Returns whether tasks are still running.
+static bool
+async_drain(AsyncState& state) {
+  std::vector<AsyncTaskPtr> done;
+  {
+    std::lock_guard<std::mutex> guard(state.lock);
+    done.swap(state.done);
+  }
+
+  // poll()/settle() call back into JS, which may start new tasks.
+  std::vector<AsyncTaskPtr> running = state.running;
+  for(auto& task : running)
+    if(std::find(done.begin(), done.end(), task) == done.end())
+      task->poll(task->ctx);
+
+  for(auto& task : done) {
+    auto it = std::find(state.running.begin(), state.running.end(), task);
+    if(it != state.running.end())
+      state.running.erase(it);
+
+    JSContext* ctx = task->ctx;
+    JSValue value = task->settle(ctx);
+    bool ok = !JS_IsException(value);
+    if(!ok)
+      value = JS_GetException(ctx);
+    JSValue ret = JS_Call(ctx, task->resolving[ok ? 0 : 1], JS_UNDEFINED, 1, &value);
+    JS_FreeValue(ctx, ret);
+    JS_FreeValue(ctx, value);
+    JS_FreeValue(ctx, task->resolving[0]);
+    JS_FreeValue(ctx, task->resolving[1]);
+    task->resolving[0] = task->resolving[1] = JS_UNDEFINED;
+    task->release(ctx);
+  }
+  return !state.running.empty();
+}
+
+// JS thread: drop a runtime's state once nothing is running or watched, so
+// a runtime freed later (an os.Worker's) leaves no entry or pipe behind; the
+// next async_start() makes a new one.
+static void
+async_forget(JSContext* ctx, const std::shared_ptr<AsyncState>& state) {
+  std::lock_guard<std::mutex> guard(async_states_lock);
+  auto it = async_states.find(JS_GetRuntime(ctx));
+  if(it != async_states.end() && it->second == state && state->running.empty() && !state->watching)
+    async_states.erase(it);
+}
+
+// JS thread: drain this runtime's completions, if it has a task.
+static void
+async_poll(JSContext* ctx) {
+  std::shared_ptr<AsyncState> state;
+  {
+    std::lock_guard<std::mutex> guard(async_states_lock);
+    auto it = async_states.find(JS_GetRuntime(ctx));
+    if(it != async_states.end())
+      state = it->second;
+  }
+  if(state && !async_drain(*state))
+    async_forget(ctx, state);
+}
+
+// The os.setReadHandler() callback. Only this path empties the pipe, so a
+// polled drain can never leave the handler registered with nothing left to
+// wake it; returning false tells the handler to unregister itself.
+static JSValue
+js_async_drain(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  std::shared_ptr<AsyncState> state = async_state(ctx);
+  if(!state)
+    return JS_EXCEPTION;
+  char buf[64];
+  while(read(state->pipe[0], buf, sizeof(buf)) > 0) {
+  }
+  bool pending = async_drain(*state);
+  if(!pending) {
+    state->watching = false;
+    async_forget(ctx, state);
+  }
+  return JS_NewBool(ctx, pending);
+}
+
+static void
+async_watch(JSContext* ctx, AsyncState& state) {
+  static const char src[] = "(fd, drain) => import('os').then(os => os.setReadHandler(fd, () => drain() || os.setReadHandler(fd, null)), () => {})";
+  JSValue fn = JS_Eval(ctx, src, sizeof(src) - 1, "<labsound>", JS_EVAL_TYPE_GLOBAL);
+  if(JS_IsException(fn)) {
+    JS_FreeValue(ctx, JS_GetException(ctx));
+    return;
+  }
+  JSValue args[2] = {JS_NewInt32(ctx, state.pipe[0]), JS_NewCFunction(ctx, js_async_drain, "drain", 0)};
+  JSValue ret = JS_Call(ctx, fn, JS_UNDEFINED, 2, args);
+  if(JS_IsException(ret))
+    JS_FreeValue(ctx, JS_GetException(ctx));
+  JS_FreeValue(ctx, ret);
+  JS_FreeValue(ctx, args[1]);
+  JS_FreeValue(ctx, fn);
+  state.watching = true;
+}
+
+// JS thread: register a task and return its promise. The caller then starts
+// the work, which must end in exactly one async_post(task).
+static JSValue
+async_start(JSContext* ctx, AsyncTaskPtr task) {
+  std::shared_ptr<AsyncState> state = async_state(ctx);
+  if(!state)
+    return JS_EXCEPTION;
+  JSValue promise = JS_NewPromiseCapability(ctx, task->resolving);
+  if(JS_IsException(promise))
+    return promise;
+  task->ctx = ctx;
+  task->state = state;
+  state->running.push_back(std::move(task));
+  if(!state->watching)
+    async_watch(ctx, *state);
+  return promise;
+}
+
+// Fixed pool of detached worker threads for short jobs (decoding, analysis)
+// that should run in parallel rather than one thread each. Jobs end in
+// async_post() like any other task. Never destroyed: workers may still be
+// waiting on it during static destruction.
+static struct WorkerPool {
+  std::mutex lock;
+  std::condition_variable wake;
+  std::deque<std::function<void()>> jobs;
+  size_t threads = 0, idle = 0;
+} & worker_pool = *new WorkerPool;
+
+static void
+worker_pool_submit(std::function<void()> job) {
+  std::lock_guard<std::mutex> guard(worker_pool.lock);
+  worker_pool.jobs.push_back(std::move(job));
+  size_t limit = std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8);
+  if(worker_pool.idle == 0 && worker_pool.threads < limit) {
+    worker_pool.threads++;
+    std::thread([]() {
+      std::unique_lock<std::mutex> guard(worker_pool.lock);
+      for(;;) {
+        worker_pool.idle++;
+        worker_pool.wake.wait(guard, []() { return !worker_pool.jobs.empty(); });
+        worker_pool.idle--;
+        auto job = std::move(worker_pool.jobs.front());
+        worker_pool.jobs.pop_front();
+        guard.unlock();
+        job();
+        guard.lock();
+      }
+    }).detach();
   } else {
-    outputConfig.device_index = 0;
-    outputConfig.desired_channels = 2;
-    outputConfig.desired_samplerate = 44100;
+    worker_pool.wake.notify_one();
+  }
+}
+
+// decodeAudioData() on the worker pool. Decodes a copy of the caller's
+// bytes: the ArrayBuffer can be detached, transferred or resized while the
+// worker runs, and the spec detaches it outright anyway.
+struct DecodeTask : AsyncTask {
+  std::vector<uint8_t> bytes;
+  std::shared_ptr<lab::AudioBus> result;
+  std::string error;
+
+  void
+  run() {
+    thread_local nqr::NyquistIO io;
+    result = decode_bus_from_memory(io, bytes, false, error);
+    std::vector<uint8_t>().swap(bytes);
   }
 
-  lab::AudioStreamConfig inputConfig;
-  if(inInfo.index != -1) {
-    inputConfig.device_index = inInfo.index;
-    inputConfig.desired_channels = std::min(uint32_t(1), inInfo.num_input_channels);
-    inputConfig.desired_samplerate = outputConfig.desired_samplerate;
+  JSValue
+  settle(JSContext* ctx) override {
+    if(!result)
+      return JS_ThrowInternalError(ctx, "decodeAudioData: failed to decode: %s", error.c_str());
+    return make_audio_buffer_js(ctx, result);
   }
-  return {inputConfig, outputConfig};
+};
+
+// An offline render's lifecycle. It leaves RENDER_RUNNING exactly once,
+// by compare-and-swap, so a cancel and the render finishing can't both win.
+enum { RENDER_RUNNING, RENDER_FINISHED, RENDER_CANCELLED, RENDER_FAILED };
+
+// Pull `length` frames from an offline destination, `block` frames per pass,
+// handing each pass to sink(bus, offset, frames). lab pulls its graph one
+// ProcessingSizeInFrames quantum at a time, so a pass is block / quantum
+// pulls back to back, each rendered straight into its slice of the block
+// through a non-owning view bus. Stops early once `status` has left
+// RENDER_RUNNING; `rendered` tracks progress for other threads, which
+// `state` is woken about.
+template<class Sink>
+static int32_t
+offline_render_loop(lab::AudioDestinationNode* dest, int numberOfChannels, int32_t length, int32_t block, std::atomic<int32_t>& rendered, const std::atomic<int>& status, AsyncState& state, Sink&& sink) {
+  const int quantum = lab::AudioNode::ProcessingSizeInFrames;
+  // Wake the JS thread about 64 times over the render for onprogress.
+  const int32_t wakeEvery = std::max<int32_t>(block, length / 64);
+  lab::AudioBus scratch(numberOfChannels, block, true);
+  lab::AudioBus slice(numberOfChannels, quantum, false);
+  int32_t done = 0, nextWake = wakeEvery;
+  while(done < length && status.load(std::memory_order_relaxed) == RENDER_RUNNING) {
+    int n = std::min<int32_t>(block, length - done);
+    for(int32_t f = 0; f < n; f += quantum) {
+      for(int c = 0; c < numberOfChannels; c++)
+        slice.setChannelMemory(c, scratch.channel(c)->mutableData() + f, quantum);
+      dest->offlineRender(&slice, quantum);
+    }
+    if(!sink(scratch, done, n))
+      break;
+    done += n;
+    rendered.store(done, std::memory_order_relaxed);
+    if(done >= nextWake) {
+      nextWake += wakeEvery;
+      async_wake(state);
+    }
+  }
+  return done;
 }
 
+// startRendering()/renderToFile() on a thread of its own, joined when the
+// task is released. The context object is held until the promise settles
+// so ctx.onprogress stays reachable. With `file` set the quanta are encoded
+// straight to disk and `result` is unused.
+struct OfflineRenderTask : AsyncTask {
+  AudioContextPtr ac;
+  JSValue context = JS_UNDEFINED;
+  std::shared_ptr<lab::AudioBus> result;
+  std::unique_ptr<AudioFileWriter> file;
+  int numberOfChannels = 0;
+  int32_t length = 0, reported = 0, block = lab::AudioNode::ProcessingSizeInFrames;
+  std::atomic<int32_t> rendered{0};
+  std::atomic<int> status{RENDER_RUNNING};
+  std::thread thread;
+
+  // Any thread: leave RENDER_RUNNING for `to`, unless something else did
+  // first. Returns whether this call made the transition.
+  bool
+  finish(int to) {
+    int expected = RENDER_RUNNING;
+    return status.compare_exchange_strong(expected, to, std::memory_order_acq_rel);
+  }
+
+  bool
+  cancel() {
+    return finish(RENDER_CANCELLED);
+  }
+
+  void
+  run() {
+    auto dest = ac->destinationNode();
+    bool ok = true;
+    offline_render_loop(dest.get(), numberOfChannels, length, block, rendered, status, *state, [&](lab::AudioBus& bus, int32_t offset, int n) {
+      if(file)
+        return ok = file->write(bus, n);
+      for(int c = 0; c < numberOfChannels; c++)
+        memcpy(result->channel(c)->mutableData() + offset, bus.channel(c)->data(), n * sizeof(float));
+      return true;
+    });
+    // A cancelled render still leaves a valid (shorter) file behind.
+    if(file && !file->close())
+      ok = false;
+    finish(ok ? RENDER_FINISHED : RENDER_FAILED);
+  }
+
+  // ctx.onprogress({renderedFrames, length}), whenever there's news.
+  void
+  poll(JSContext* ctx) override {
+    int32_t frames = rendered.load(std::memory_order_relaxed);
+    if(frames == reported)
+      return;
+    reported = frames;
+    JSValue fn = JS_GetPropertyStr(ctx, context, "onprogress");
+    if(JS_IsFunction(ctx, fn)) {
+      JSValue ev = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, ev, "renderedFrames", JS_NewInt32(ctx, frames));
+      JS_SetPropertyStr(ctx, ev, "length", JS_NewInt32(ctx, length));
+      JSValue ret = JS_Call(ctx, fn, context, 1, &ev);
+      if(JS_IsException(ret))
+        JS_FreeValue(ctx, JS_GetException(ctx));
+      JS_FreeValue(ctx, ret);
+      JS_FreeValue(ctx, ev);
+    }
+    JS_FreeValue(ctx, fn);
+  }
+
+  JSValue
+  settle(JSContext* ctx) override {
+    poll(ctx);
+    const char* fn = file ? "renderToFile" : "startRendering";
+    switch(status.load(std::memory_order_acquire)) {
+      case RENDER_FAILED: return JS_ThrowInternalError(ctx, "%s: write failed after %d of %d frames", fn, int(rendered), int(length));
+      case RENDER_CANCELLED: return JS_ThrowInternalError(ctx, "%s: cancelled after %d of %d frames", fn, int(rendered), int(length));
+    }
+    if(file)
+      return JS_NewInt32(ctx, rendered);
+    return make_audio_buffer_js(ctx, result);
+  }
+
+  // The thread has posted, so this only waits for it to return.
+  void
+  release(JSContext* ctx) override {
+    JS_FreeValue(ctx, context);
+    context = JS_UNDEFINED;
+    if(thread.joinable())
+      thread.join();
+  }
+};
+
 /* ---------- AudioContext / OfflineAudioContext ---------- */
 //
 // Per spec these are two separate constructors sharing a common
@@ -360,34 +1257,186 @@ get_default_device_config() {
 // prototype so the exposed members and [Symbol.toStringTag] match spec --
 // e.g. only OfflineAudioContext instances have startRendering()/length.
 
+// contextOptions.renderQuantumSize (or the spec's renderSizeHint): a power
+// of two from 32 to 16384, or "default". lab's graph quantum is the
+// compile-time ProcessingSizeInFrames, so the size sets the frames per
+// offline render pass or device callback instead, and is a hint below that
+// quantum, as the spec allows: smaller sizes round up to it.
+// ctx.renderQuantumSize reports the size in effect. Returns 0 when not
+// given, -1 with an exception pending.
+static int32_t
+get_render_quantum_option(JSContext* ctx, JSValueConst options, const char* fn) {
+  int32_t size = 0;
+  for(const char* name : {"renderQuantumSize", "renderSizeHint"}) {
+    JSValue v = JS_GetPropertyStr(ctx, options, name);
+    if(JS_IsUndefined(v))
+      continue;
+    if(JS_IsString(v)) {
+      const char* str = JS_ToCString(ctx, v);
+      bool valid = str && !strcmp(str, "default");
+      JS_FreeCString(ctx, str);
+      JS_FreeValue(ctx, v);
+      if(!valid)
+        return JS_ThrowTypeError(ctx, "%s: %s must be a number or \"default\"", fn, name), -1;
+      return 0;
+    }
+    int r = JS_ToInt32(ctx, &size, v);
+    JS_FreeValue(ctx, v);
+    if(r)
+      return -1;
+    if(size < 32 || size > 16384 || (size & (size - 1)))
+      return JS_ThrowRangeError(ctx, "%s: %s must be a power of two from 32 to 16384", fn, name), -1;
+    return size;
+  }
+  return 0;
+}
+
+// contextOptions.latencyHint -> RtAudio buffering. "interactive" (the
+// default) is one quantum per callback over two buffers; "balanced" and
+// "playback" trade latency for headroom against dropouts. A number asks
+// for about that many seconds across the two buffers, in whole quanta.
+// Returns -1 with an exception pending.
+static int
+get_latency_hint_option(JSContext* ctx, JSValueConst options, float sampleRate, RtAudioDevice::Buffering& b) {
+  const unsigned int quantum = lab::AudioNode::ProcessingSizeInFrames;
+  JSValue v = JS_GetPropertyStr(ctx, options, "latencyHint");
+  int ret = 0;
+  if(JS_IsString(v)) {
+    const char* str = JS_ToCString(ctx, v);
+    if(str && !strcmp(str, "interactive"))
+      b = {quantum, 2, true};
+    else if(str && !strcmp(str, "balanced"))
+      b = {quantum * 4, 2, false};
+    else if(str && !strcmp(str, "playback"))
+      b = {quantum * 16, 4, false};
+    else
+      ret = (JS_ThrowTypeError(ctx, "AudioContext: latencyHint must be \"interactive\", \"balanced\", \"playback\" or a number of seconds"), -1);
+    JS_FreeCString(ctx, str);
+  } else if(!JS_IsUndefined(v)) {
+    double seconds;
+    if(JS_ToFloat64(ctx, &seconds, v))
+      ret = -1;
+    else if(!std::isfinite(seconds))
+      ret = (JS_ThrowTypeError(ctx, "AudioContext: latencyHint must be finite"), -1);
+    else {
+      double frames = std::ceil(std::max(0.0, seconds) * sampleRate / 2 / quantum) * quantum;
+      b.frames = unsigned(std::clamp(frames, double(quantum), 64.0 * quantum));
+      b.buffers = 2;
+      b.minimizeLatency = b.frames <= 2 * quantum;
+    }
+  }
+  JS_FreeValue(ctx, v);
+  return ret;
+}
+
+// contextOptions.sinkId / inputDevice: a device identifier as
+// getDevices() reports it, or its index. Returns 1 and fills in `name` or
+// `index` if given, 0 if not ("" is the default device too), -1 with an
+// exception pending.
+static int
+get_device_option(JSContext* ctx, JSValueConst options, const char* prop, std::string& name, int32_t& index) {
+  JSValue v = JS_GetPropertyStr(ctx, options, prop);
+  int ret = 0;
+  if(JS_IsNumber(v)) {
+    ret = JS_ToInt32(ctx, &index, v) ? -1 : 1;
+  } else if(JS_IsString(v)) {
+    const char* str = JS_ToCString(ctx, v);
+    if(!str)
+      ret = -1;
+    else if(*str) {
+      name = str;
+      ret = 1;
+    }
+    JS_FreeCString(ctx, str);
+  } else if(!JS_IsUndefined(v) && !JS_IsNull(v)) {
+    // The spec's AudioSinkOptions ({type: "none"}) needs a context that
+    // renders without a device; there is no such thing here.
+    ret = (JS_ThrowTypeError(ctx, "AudioContext: %s must be a device id or index", prop), -1);
+  }
+  JS_FreeValue(ctx, v);
+  return ret;
+}
+
 static JSValue
 js_audiocontext_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   JSValue proto, obj = JS_UNDEFINED;
 
   // contextOptions.sampleRate is honored as a best-effort request to the
-  // underlying device; latencyHint/sinkId are accepted (for API
-  // compatibility with browser code) but not implemented by this fixed
-  // default-RtAudio-device backend.
+  // device, latencyHint picks its buffering (rtaudio-device.hpp), and
+  // renderQuantumSize, when given, overrides the frames per callback; below
+  // lab's quantum it rounds up to one, as a smaller callback would still
+  // wait on a whole quantum.
+  // sinkId names the output device; without it the default output is
+  // opened without enumerating the others. Input is opened only when asked
+  // for with inputDevice (not in the spec; "default" for the default
+  // input) and inputChannels (default 1).
   double sampleRate = 0;
+  int32_t renderQuantum = 0, inputChannels = 1;
+  RtAudioDevice::Buffering buffering;
+  std::string sinkName, inputName;
+  int32_t sinkIndex = -1, inputIndex = -1;
+  bool wantInput = false;
   if(argc > 0 && JS_IsObject(argv[0])) {
     JSValue v = JS_GetPropertyStr(ctx, argv[0], "sampleRate");
     if(JS_IsNumber(v))
       JS_ToFloat64(ctx, &sampleRate, v);
     JS_FreeValue(ctx, v);
-  }
 
-  auto ac = std::make_shared<lab::AudioContext>(/* isOffline */ false, /* autoDispatchEvents */ true);
+    int r;
+    if(get_device_option(ctx, argv[0], "sinkId", sinkName, sinkIndex) < 0)
+      return JS_EXCEPTION;
+    if((r = get_device_option(ctx, argv[0], "inputDevice", inputName, inputIndex)) < 0)
+      return JS_EXCEPTION;
+    wantInput = r > 0;
+    if(inputName == "default")
+      inputName.clear();
+    v = JS_GetPropertyStr(ctx, argv[0], "inputChannels");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &inputChannels, v);
+    JS_FreeValue(ctx, v);
+  }
 
-  auto cfg = get_default_device_config();
+  lab::AudioDeviceInfo outInfo = find_device(sinkName, sinkIndex, false);
+  if(outInfo.index == -1 && (!sinkName.empty() || sinkIndex >= 0)) {
+    if(sinkIndex >= 0)
+      return JS_ThrowRangeError(ctx, "AudioContext: no output device with index %d", sinkIndex);
+    return JS_ThrowRangeError(ctx, "AudioContext: no output device '%s'", sinkName.c_str());
+  }
+  std::pair<lab::AudioStreamConfig, lab::AudioStreamConfig> cfg;
+  cfg.second = output_device_config(outInfo);
   if(sampleRate > 0)
     cfg.second.desired_samplerate = static_cast<float>(sampleRate);
-  auto device = std::make_shared<lab::AudioDevice_RtAudio>(cfg.first, cfg.second);
+  if(wantInput) {
+    lab::AudioDeviceInfo inInfo = find_device(inputName, inputIndex, true);
+    if(inInfo.index == -1)
+      return JS_ThrowRangeError(ctx, "AudioContext: no input device '%s'", inputIndex >= 0 ? std::to_string(inputIndex).c_str() : inputName.c_str());
+    cfg.first = input_device_config(inInfo, uint32_t(std::max(1, inputChannels)), cfg.second.desired_samplerate);
+  }
+
+  if(argc > 0 && JS_IsObject(argv[0])) {
+    if(get_latency_hint_option(ctx, argv[0], cfg.second.desired_samplerate, buffering) < 0)
+      return JS_EXCEPTION;
+    if((renderQuantum = get_render_quantum_option(ctx, argv[0], "AudioContext")) < 0)
+      return JS_EXCEPTION;
+    if(renderQuantum > 0)
+      buffering.frames = std::max<int32_t>(renderQuantum, lab::AudioNode::ProcessingSizeInFrames);
+  }
+
+  auto device = std::make_shared<RtAudioDevice>(cfg.first, cfg.second, buffering);
+  if(!device->isOpen())
+    return JS_ThrowInternalError(ctx, "AudioContext: %s", device->error().c_str());
+
+  auto ac = std::make_shared<lab::AudioContext>(/* isOffline */ false, /* autoDispatchEvents */ true);
   auto dest = std::make_shared<lab::AudioDestinationNode>(*ac, device);
   device->setDestinationNode(dest);
   ac->setDestinationNode(dest);
 
-  auto* sac = static_cast<AudioContextPtr*>(js_mallocz(ctx, sizeof(AudioContextPtr)));
-  new(sac) AudioContextPtr(ac);
+  auto* sac = static_cast<JsAudioContext*>(js_mallocz(ctx, sizeof(JsAudioContext)));
+  new(sac) JsAudioContext{ac};
+  sac->device = device;
+  if(!sinkName.empty() || sinkIndex >= 0)
+    sac->sinkId = outInfo.identifier;
+  sac->renderQuantum = std::max<int32_t>(device->bufferFrames(), lab::AudioNode::ProcessingSizeInFrames);
 
   proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
@@ -404,7 +1453,10 @@ js_audiocontext_constructor(JSContext* ctx, JSValueConst new_target, int argc, J
   return obj;
 
 fail:
-  sac->~AudioContextPtr();
+  // As in the finalizer: the device holds the destination, which holds
+  // the device.
+  device->setDestinationNode(nullptr);
+  sac->~JsAudioContext();
   js_free(ctx, sac);
   JS_FreeValue(ctx, obj);
   return JS_EXCEPTION;
@@ -414,11 +1466,11 @@ static JSValue
 js_offlineaudiocontext_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   JSValue proto, obj = JS_UNDEFINED;
 
-  int32_t numberOfChannels = 0, length = 0;
+  int32_t numberOfChannels = 0, length = 0, renderQuantum = 0;
   double sampleRate = 0;
 
   if(argc > 0 && JS_IsObject(argv[0])) {
-    // new OfflineAudioContext({numberOfChannels, length, sampleRate})
+    // new OfflineAudioContext({numberOfChannels, length, sampleRate, renderQuantumSize})
     JSValue v = JS_GetPropertyStr(ctx, argv[0], "numberOfChannels");
     JS_ToInt32(ctx, &numberOfChannels, v);
     JS_FreeValue(ctx, v);
@@ -430,6 +1482,9 @@ js_offlineaudiocontext_constructor(JSContext* ctx, JSValueConst new_target, int
     v = JS_GetPropertyStr(ctx, argv[0], "sampleRate");
     JS_ToFloat64(ctx, &sampleRate, v);
     JS_FreeValue(ctx, v);
+
+    if((renderQuantum = get_render_quantum_option(ctx, argv[0], "OfflineAudioContext")) < 0)
+      return JS_EXCEPTION;
   } else {
     // new OfflineAudioContext(numberOfChannels, length, sampleRate)
     if(argc > 0)
@@ -456,8 +1511,8 @@ js_offlineaudiocontext_constructor(JSContext* ctx, JSValueConst new_target, int
   device->setDestinationNode(dest);
   ac->setDestinationNode(dest);
 
-  auto* sac = static_cast<AudioContextPtr*>(js_mallocz(ctx, sizeof(AudioContextPtr)));
-  new(sac) AudioContextPtr(ac);
+  auto* sac = static_cast<JsAudioContext*>(js_mallocz(ctx, sizeof(JsAudioContext)));
+  new(sac) JsAudioContext{ac};
 
   proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
@@ -470,12 +1525,13 @@ js_offlineaudiocontext_constructor(JSContext* ctx, JSValueConst new_target, int
   if(JS_IsException(obj))
     goto fail;
 
+  sac->length = length;
+  sac->renderQuantum = std::max<int32_t>(renderQuantum, lab::AudioNode::ProcessingSizeInFrames);
   JS_SetOpaque(obj, sac);
-  JS_SetPropertyStr(ctx, obj, "__offlineLength", JS_NewInt32(ctx, length));
   return obj;
 
 fail:
-  sac->~AudioContextPtr();
+  sac->~JsAudioContext();
   js_free(ctx, sac);
   JS_FreeValue(ctx, obj);
   return JS_EXCEPTION;
@@ -489,47 +1545,61 @@ enum {
   AC_PROP_CURRENTSAMPLEFRAME,
   AC_PROP_PREDICTED_CURRENTTIME,
   AC_PROP_LENGTH,
+  AC_PROP_LIVE_NODES,
+  AC_PROP_RECLAIMED_NODES,
+  AC_PROP_RENDERED_FRAMES,
+  AC_PROP_RENDER_QUANTUM_SIZE,
+  AC_PROP_BASE_LATENCY,
+  AC_PROP_OUTPUT_LATENCY,
+  AC_PROP_SINK_ID,
 };
 
 static JSValue
 js_audiocontext_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  AudioContextPtr* sac = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
   if(!sac)
     return JS_EXCEPTION;
 
   switch(magic) {
-    case AC_PROP_SAMPLERATE: return JS_NewFloat64(ctx, (*sac)->sampleRate());
+    case AC_PROP_SAMPLERATE: return JS_NewFloat64(ctx, sac->ac->sampleRate());
     case AC_PROP_DESTINATION: {
-      auto dest = (*sac)->destinationNode();
+      auto dest = sac->ac->destinationNode();
       if(!dest)
         return JS_NULL;
-      return make_audio_node_js(ctx, audiodestinationnode_proto, js_audiodestinationnode_class_id, std::static_pointer_cast<lab::AudioNode>(dest), *sac);
+      return make_audio_node_js(ctx, audiodestinationnode_proto, js_audiodestinationnode_class_id, std::static_pointer_cast<lab::AudioNode>(dest), sac->ac);
     }
     case AC_PROP_LISTENER: {
-      auto al = (*sac)->listener();
+      auto al = sac->ac->listener();
       JSValue ret = JS_NewObjectProtoClass(ctx, audiolistener_proto, js_audiolistener_class_id);
       auto* p = static_cast<AudioListenerPtr*>(js_mallocz(ctx, sizeof(AudioListenerPtr)));
       new(p) AudioListenerPtr(al);
       JS_SetOpaque(ret, p);
       return ret;
     }
-    case AC_PROP_CURRENTTIME: return JS_NewFloat64(ctx, (*sac)->currentTime());
-    case AC_PROP_CURRENTSAMPLEFRAME: return JS_NewInt64(ctx, (*sac)->currentSampleFrame());
-    case AC_PROP_PREDICTED_CURRENTTIME: return JS_NewFloat64(ctx, (*sac)->predictedCurrentTime());
-    case AC_PROP_LENGTH: {
-      JSValue lenv = JS_GetPropertyStr(ctx, this_val, "__offlineLength");
-      int32_t length = 0;
-      JS_ToInt32(ctx, &length, lenv);
-      JS_FreeValue(ctx, lenv);
-      return JS_NewInt32(ctx, length);
-    }
+    case AC_PROP_CURRENTTIME: return JS_NewFloat64(ctx, sac->ac->currentTime());
+    case AC_PROP_CURRENTSAMPLEFRAME: return JS_NewInt64(ctx, sac->ac->currentSampleFrame());
+    case AC_PROP_PREDICTED_CURRENTTIME: return JS_NewFloat64(ctx, sac->ac->predictedCurrentTime());
+    case AC_PROP_LENGTH: return JS_NewInt32(ctx, sac->length);
+    case AC_PROP_LIVE_NODES:
+      node_registry_sweep(*sac->nodes, sac->ac);
+      return JS_NewInt64(ctx, int64_t(sac->nodes->entries.size()));
+    case AC_PROP_RECLAIMED_NODES:
+      node_registry_sweep(*sac->nodes, sac->ac);
+      return JS_NewInt64(ctx, int64_t(sac->nodes->reclaimed));
+    case AC_PROP_RENDERED_FRAMES:
+      async_poll(ctx);
+      return JS_NewInt32(ctx, sac->render ? sac->render->rendered.load() : 0);
+    case AC_PROP_RENDER_QUANTUM_SIZE: return JS_NewInt32(ctx, sac->renderQuantum);
+    case AC_PROP_BASE_LATENCY: return JS_NewFloat64(ctx, sac->device ? sac->device->baseLatency() : 0);
+    case AC_PROP_OUTPUT_LATENCY: return JS_NewFloat64(ctx, sac->device ? sac->device->outputLatency() : 0);
+    case AC_PROP_SINK_ID: return JS_NewString(ctx, sac->sinkId.c_str());
   }
   return JS_UNDEFINED;
 }
 
 static JSValue
 js_audiocontext_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  AudioContextPtr* sac = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
   if(!sac)
     return JS_EXCEPTION;
   if(argc < 2)
@@ -545,7 +1615,7 @@ js_audiocontext_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValue
       JS_ToInt32(ctx, &destIdx, argv[2]);
     if(argc > 3)
       JS_ToInt32(ctx, &srcIdx, argv[3]);
-    (*sac)->connect(dst->node, src->node, destIdx, srcIdx);
+    sac->ac->connect(dst->node, src->node, destIdx, srcIdx);
     return JS_UNDEFINED;
   }
 
@@ -554,7 +1624,7 @@ js_audiocontext_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValue
     int srcIdx = 0;
     if(argc > 3)
       JS_ToInt32(ctx, &srcIdx, argv[3]);
-    (*sac)->connectParam(dstParam->param, src->node, srcIdx);
+    sac->ac->connectParam(dstParam->param, src->node, srcIdx);
     return JS_UNDEFINED;
   }
 
@@ -563,7 +1633,7 @@ js_audiocontext_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValue
 
 static JSValue
 js_audiocontext_decode_audio_data(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  AudioContextPtr* sac = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
   if(!sac)
     return JS_EXCEPTION;
   if(argc < 1)
@@ -574,27 +1644,22 @@ js_audiocontext_decode_audio_data(JSContext* ctx, JSValueConst this_val, int arg
   if(!buf)
     return JS_ThrowTypeError(ctx, "argument must be an ArrayBuffer");
 
-  std::vector<uint8_t> data(buf, buf + size);
-  auto bus = lab::MakeBusFromMemory(data, false);
-  if(!bus)
-    return JS_ThrowInternalError(ctx, "decodeAudioData: failed to decode");
+  auto task = std::make_shared<DecodeTask>();
+  task->bytes.assign(buf, buf + size);
+  JSValue promise = async_start(ctx, task);
+  if(JS_IsException(promise))
+    return promise;
 
-  JSValue ab = make_audio_buffer_js(ctx, bus);
-  // Return a resolved Promise for browser-compat. await on a non-Promise
-  // also works, so callers can use `await ctx.decodeAudioData(...)` in both
-  // qjs and browsers.
-  JSValue resolving[2];
-  JSValue promise = JS_NewPromiseCapability(ctx, resolving);
-  JS_Call(ctx, resolving[0], JS_UNDEFINED, 1, &ab);
-  JS_FreeValue(ctx, resolving[0]);
-  JS_FreeValue(ctx, resolving[1]);
-  JS_FreeValue(ctx, ab);
+  worker_pool_submit([task]() {
+    task->run();
+    async_post(task);
+  });
   return promise;
 }
 
 static JSValue
 js_audiocontext_create_buffer_from_file(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  AudioContextPtr* sac = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
   if(!sac)
     return JS_EXCEPTION;
   if(argc < 1)
@@ -608,7 +1673,7 @@ js_audiocontext_create_buffer_from_file(JSContext* ctx, JSValueConst this_val, i
   if(argc > 1)
     mixToMono = JS_ToBool(ctx, argv[1]);
 
-  auto bus = lab::MakeBusFromFile(path, mixToMono);
+  auto bus = sample_cache_load(path, mixToMono);
   JS_FreeCString(ctx, path);
   if(!bus)
     return JS_ThrowInternalError(ctx, "createBufferFromFile: failed to load");
@@ -616,1232 +1681,3074 @@ js_audiocontext_create_buffer_from_file(JSContext* ctx, JSValueConst this_val, i
   return make_audio_buffer_js(ctx, bus);
 }
 
+// AudioContext.sampleCache: the createBufferFromFile() cache's counters.
 static JSValue
-js_audiocontext_start_rendering(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  AudioContextPtr* sac = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
-  if(!sac)
-    return JS_EXCEPTION;
-  AudioContextPtr ac = *sac;
-  if(!ac->isOfflineContext())
-    return JS_ThrowTypeError(ctx, "startRendering is only valid on an offline AudioContext");
+js_audiocontext_sample_cache(JSContext* ctx, JSValueConst this_val) {
+  std::lock_guard<std::mutex> guard(sample_cache.lock);
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "hits", JS_NewInt64(ctx, int64_t(sample_cache.hits)));
+  JS_SetPropertyStr(ctx, obj, "misses", JS_NewInt64(ctx, int64_t(sample_cache.misses)));
+  JS_SetPropertyStr(ctx, obj, "evictions", JS_NewInt64(ctx, int64_t(sample_cache.evictions)));
+  JS_SetPropertyStr(ctx, obj, "entries", JS_NewInt64(ctx, int64_t(sample_cache.lru.size())));
+  JS_SetPropertyStr(ctx, obj, "bytes", JS_NewInt64(ctx, int64_t(sample_cache.bytes)));
+  JS_SetPropertyStr(ctx, obj, "budget", JS_NewInt64(ctx, int64_t(sample_cache.budget)));
+  return obj;
+}
 
-  auto dest = ac->destinationNode();
-  if(!dest || !dest->device())
-    return JS_ThrowInternalError(ctx, "offline AudioContext has no destination");
+// AudioContext.getDevices({refresh}): the host's audio devices, enumerated
+// once and cached (see "device selection"); refresh re-probes them. A
+// device's deviceId or index can be passed as sinkId / inputDevice.
+static JSValue
+js_audiocontext_get_devices(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  bool refresh = false;
+  if(argc > 0 && JS_IsObject(argv[0])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[0], "refresh");
+    refresh = JS_ToBool(ctx, v);
+    JS_FreeValue(ctx, v);
+  }
 
-  JSValue lenv = JS_GetPropertyStr(ctx, this_val, "__offlineLength");
-  int32_t length = 0;
-  JS_ToInt32(ctx, &length, lenv);
-  JS_FreeValue(ctx, lenv);
-  if(length <= 0)
-    return JS_ThrowTypeError(ctx, "offline AudioContext has no render length");
+  const auto devices = device_list(refresh);
+  JSValue arr = JS_NewArray(ctx);
+  for(size_t i = 0; i < devices.size(); i++) {
+    const lab::AudioDeviceInfo& d = devices[i];
+    JSValue obj = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, obj, "deviceId", JS_NewString(ctx, d.identifier.c_str()));
+    JS_SetPropertyStr(ctx, obj, "index", JS_NewInt32(ctx, d.index));
+    JS_SetPropertyStr(ctx, obj, "outputChannels", JS_NewUint32(ctx, d.num_output_channels));
+    JS_SetPropertyStr(ctx, obj, "inputChannels", JS_NewUint32(ctx, d.num_input_channels));
+    JS_SetPropertyStr(ctx, obj, "sampleRate", JS_NewFloat64(ctx, d.nominal_samplerate));
+    JSValue rates = JS_NewArray(ctx);
+    for(size_t j = 0; j < d.supported_samplerates.size(); j++)
+      JS_SetPropertyUint32(ctx, rates, uint32_t(j), JS_NewFloat64(ctx, d.supported_samplerates[j]));
+    JS_SetPropertyStr(ctx, obj, "sampleRates", rates);
+    JS_SetPropertyStr(ctx, obj, "isDefaultOutput", JS_NewBool(ctx, d.is_default_output));
+    JS_SetPropertyStr(ctx, obj, "isDefaultInput", JS_NewBool(ctx, d.is_default_input));
+    JS_SetPropertyUint32(ctx, arr, uint32_t(i), obj);
+  }
+  return arr;
+}
 
-  int numberOfChannels = static_cast<int>(dest->device()->getOutputConfig().desired_channels);
-  auto result = std::make_shared<lab::AudioBus>(numberOfChannels, length, true);
-  result->setSampleRate(ac->sampleRate());
+// AudioContext.sampleCacheBudget = bytes; 0 disables caching.
+static JSValue
+js_audiocontext_sample_cache_budget(JSContext* ctx, JSValueConst this_val) {
+  std::lock_guard<std::mutex> guard(sample_cache.lock);
+  return JS_NewInt64(ctx, int64_t(sample_cache.budget));
+}
 
-  const int quantum = lab::AudioNode::ProcessingSizeInFrames;
-  lab::AudioBus scratch(numberOfChannels, quantum, true);
-  int rendered = 0;
-  while(rendered < length) {
-    dest->offlineRender(&scratch, quantum);
-    int n = std::min(quantum, length - rendered);
-    for(int c = 0; c < numberOfChannels; c++)
-      memcpy(result->channel(c)->mutableData() + rendered, scratch.channel(c)->data(), n * sizeof(float));
-    rendered += n;
-  }
-
-  JSValue ab = make_audio_buffer_js(ctx, result);
-  // Resolved Promise for browser-compat, same trick as decodeAudioData.
-  JSValue resolving[2];
-  JSValue promise = JS_NewPromiseCapability(ctx, resolving);
-  JS_Call(ctx, resolving[0], JS_UNDEFINED, 1, &ab);
-  JS_FreeValue(ctx, resolving[0]);
-  JS_FreeValue(ctx, resolving[1]);
-  JS_FreeValue(ctx, ab);
-  return promise;
+static JSValue
+js_audiocontext_set_sample_cache_budget(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  int64_t budget;
+  if(JS_ToInt64(ctx, &budget, value))
+    return JS_EXCEPTION;
+  if(budget < 0)
+    return JS_ThrowRangeError(ctx, "sampleCacheBudget must be >= 0");
+  std::lock_guard<std::mutex> guard(sample_cache.lock);
+  sample_cache.budget = size_t(budget);
+  sample_cache.trim();
+  return JS_UNDEFINED;
 }
 
-static void
-js_audiocontext_finalizer(JSRuntime* rt, JSValue val) {
-  AudioContextPtr* sac = static_cast<AudioContextPtr*>(JS_GetOpaque(val, js_audiocontext_class_id));
-  if(sac) {
-    sac->~AudioContextPtr();
-    js_free_rt(rt, sac);
-  }
+static JSValue
+js_audiocontext_clear_sample_cache(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  std::lock_guard<std::mutex> guard(sample_cache.lock);
+  sample_cache.lru.clear();
+  sample_cache.index.clear();
+  sample_cache.bytes = 0;
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_audiocontext_class = {
-    .class_name = "AudioContext",
-    .finalizer = js_audiocontext_finalizer,
-};
+// Common to startRendering()/renderToFile(): validate the context and
+// return its render length, or -1 with an exception pending.
+static int32_t
+offline_render_check(JSContext* ctx, JsAudioContext* sac, const char* fn) {
+  AudioContextPtr ac = sac->ac;
+  if(!ac->isOfflineContext())
+    return JS_ThrowTypeError(ctx, "%s is only valid on an offline AudioContext", fn), -1;
 
-// Shared BaseAudioContext-equivalent members, applied to both
-// audiocontext_proto and offlineaudiocontext_proto.
-static const JSCFunctionListEntry js_baseaudiocontext_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("sampleRate", js_audiocontext_get, 0, AC_PROP_SAMPLERATE),
-    JS_CGETSET_MAGIC_DEF("destination", js_audiocontext_get, 0, AC_PROP_DESTINATION),
-    JS_CGETSET_MAGIC_DEF("destinationNode", js_audiocontext_get, 0, AC_PROP_DESTINATION),
-    JS_CGETSET_MAGIC_DEF("listener", js_audiocontext_get, 0, AC_PROP_LISTENER),
-    JS_CGETSET_MAGIC_DEF("currentTime", js_audiocontext_get, 0, AC_PROP_CURRENTTIME),
-    JS_CGETSET_MAGIC_DEF("currentSampleFrame", js_audiocontext_get, 0, AC_PROP_CURRENTSAMPLEFRAME),
-    JS_CGETSET_MAGIC_DEF("predictedCurrentTime", js_audiocontext_get, 0, AC_PROP_PREDICTED_CURRENTTIME),
-    JS_CFUNC_DEF("connect", 2, js_audiocontext_connect),
-    JS_CFUNC_DEF("decodeAudioData", 1, js_audiocontext_decode_audio_data),
-    JS_CFUNC_DEF("createBufferFromFile", 1, js_audiocontext_create_buffer_from_file),
-};
+  auto dest = ac->destinationNode();
+  if(!dest || !dest->device())
+    return JS_ThrowInternalError(ctx, "offline AudioContext has no destination"), -1;
 
-// AudioContext-only.
-static const JSCFunctionListEntry js_audiocontext_funcs[] = {
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioContext", JS_PROP_CONFIGURABLE),
-};
+  if(sac->length <= 0)
+    return JS_ThrowTypeError(ctx, "offline AudioContext has no render length"), -1;
+  if(sac->render)
+    return JS_ThrowInternalError(ctx, "%s: already rendering or rendered", fn), -1;
+  return sac->length;
+}
 
-// OfflineAudioContext-only: startRendering()/length have no meaning (and no
-// spec presence) on a realtime AudioContext.
-static const JSCFunctionListEntry js_offlineaudiocontext_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("length", js_audiocontext_get, 0, AC_PROP_LENGTH),
-    JS_CFUNC_DEF("startRendering", 0, js_audiocontext_start_rendering),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "OfflineAudioContext", JS_PROP_CONFIGURABLE),
-};
+static JSValue
+offline_render_start(JSContext* ctx, JSValueConst this_val, JsAudioContext* sac, std::shared_ptr<OfflineRenderTask> task) {
+  JSValue promise = async_start(ctx, task);
+  if(JS_IsException(promise))
+    return promise;
+  task->context = JS_DupValue(ctx, this_val);
+  sac->render = task;
+
+  // Joined by release() once the promise has settled.
+  task->thread = std::thread([task]() {
+    task->run();
+    async_post(task);
+  });
+  return promise;
+}
 
-/* ---------- shared AudioNode methods ---------- */
+static JSValue
+js_audiocontext_start_rendering(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  int32_t length = offline_render_check(ctx, sac, "startRendering");
+  if(length < 0)
+    return JS_EXCEPTION;
+
+  AudioContextPtr ac = sac->ac;
+  auto task = std::make_shared<OfflineRenderTask>();
+  task->ac = ac;
+  task->length = length;
+  task->block = sac->renderQuantum;
+  task->numberOfChannels = static_cast<int>(ac->destinationNode()->device()->getOutputConfig().desired_channels);
+  task->result = std::make_shared<lab::AudioBus>(task->numberOfChannels, length, true);
+  task->result->setSampleRate(ac->sampleRate());
+  return offline_render_start(ctx, this_val, sac, task);
+}
 
+// Not in the spec: renderToFile(path, {format, bitDepth, chunkFrames}) is
+// startRendering() without the AudioBuffer -- each quantum is converted and
+// written as it comes off the graph, so memory stays at `chunkFrames`
+// frames however long the render. format is "wav" (default) or "raw"
+// (headerless interleaved little-endian samples); bitDepth 16, 24 or 32
+// (float). Resolves with the number of frames written.
 static JSValue
-js_audionode_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioNode* src = any_audio_node(this_val);
-  if(!src)
-    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
+js_audiocontext_render_to_file(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "connect requires a destination");
+    return JS_ThrowTypeError(ctx, "renderToFile requires a file path");
+  int32_t length = offline_render_check(ctx, sac, "renderToFile");
+  if(length < 0)
+    return JS_EXCEPTION;
 
-  JsAudioNode* dst = any_audio_node(argv[0]);
-  if(dst) {
-    int srcIdx = 0, dstIdx = 0;
-    if(argc > 1)
-      JS_ToInt32(ctx, &srcIdx, argv[1]);
-    if(argc > 2)
-      JS_ToInt32(ctx, &dstIdx, argv[2]);
-    src->ctx->connect(dst->node, src->node, dstIdx, srcIdx);
-    return JS_DupValue(ctx, argv[0]);
-  }
+  AudioFileWriter::Format format = AudioFileWriter::WAV;
+  int32_t bitDepth = 16, chunkFrames = 4096;
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "format");
+    if(JS_IsException(v))
+      return JS_EXCEPTION;
+    if(!JS_IsUndefined(v)) {
+      const char* s = JS_ToCString(ctx, v);
+      JS_FreeValue(ctx, v);
+      if(!s)
+        return JS_EXCEPTION;
+      bool valid = !strcmp(s, "wav") || !strcmp(s, "raw");
+      if(valid && !strcmp(s, "raw"))
+        format = AudioFileWriter::RAW;
+      JS_FreeCString(ctx, s);
+      if(!valid)
+        return JS_ThrowRangeError(ctx, "renderToFile: format must be \"wav\" or \"raw\"");
+    }
 
-  JsAudioParam* dstParam = any_audio_param(argv[0]);
-  if(dstParam) {
-    // AudioNode.connect(destinationParam, output) — no chaining return value,
-    // matching the spec (an AudioParam isn't itself connectable further).
-    int srcIdx = 0;
-    if(argc > 1)
-      JS_ToInt32(ctx, &srcIdx, argv[1]);
-    src->ctx->connectParam(dstParam->param, src->node, srcIdx);
-    return JS_UNDEFINED;
+    v = JS_GetPropertyStr(ctx, argv[1], "bitDepth");
+    int r = JS_IsUndefined(v) ? 0 : JS_ToInt32(ctx, &bitDepth, v);
+    JS_FreeValue(ctx, v);
+    if(r < 0)
+      return JS_EXCEPTION;
+
+    v = JS_GetPropertyStr(ctx, argv[1], "chunkFrames");
+    r = JS_IsUndefined(v) ? 0 : JS_ToInt32(ctx, &chunkFrames, v);
+    JS_FreeValue(ctx, v);
+    if(r < 0)
+      return JS_EXCEPTION;
   }
+  if(bitDepth != 16 && bitDepth != 24 && bitDepth != 32)
+    return JS_ThrowRangeError(ctx, "renderToFile: bitDepth must be 16, 24 or 32");
+  if(chunkFrames < 1 || chunkFrames > (1 << 20))
+    return JS_ThrowRangeError(ctx, "renderToFile: chunkFrames out of range");
+
+  AudioContextPtr ac = sac->ac;
+  auto task = std::make_shared<OfflineRenderTask>();
+  task->ac = ac;
+  task->length = length;
+  task->block = sac->renderQuantum;
+  task->numberOfChannels = static_cast<int>(ac->destinationNode()->device()->getOutputConfig().desired_channels);
+  task->file = std::make_unique<AudioFileWriter>();
 
-  return JS_ThrowTypeError(ctx, "destination must be an AudioNode or AudioParam");
+  const char* path = JS_ToCString(ctx, argv[0]);
+  if(!path)
+    return JS_EXCEPTION;
+  bool ok = task->file->open(path, format, task->numberOfChannels, int(ac->sampleRate()), bitDepth, chunkFrames);
+  if(!ok) {
+    JS_ThrowInternalError(ctx, "renderToFile: cannot open '%s': %s", path, strerror(errno));
+    JS_FreeCString(ctx, path);
+    return JS_EXCEPTION;
+  }
+  JS_FreeCString(ctx, path);
+  return offline_render_start(ctx, this_val, sac, task);
 }
 
+// Not in the spec: stop a startRendering() in progress. Its promise rejects.
 static JSValue
-js_audionode_disconnect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioNode* src = any_audio_node(this_val);
-  if(!src)
-    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
-  if(argc < 1) {
-    src->ctx->disconnect(src->node, 0);
-    return JS_UNDEFINED;
-  }
-
-  JsAudioNode* dst = any_audio_node(argv[0]);
-  if(dst) {
-    src->ctx->disconnect(dst->node, src->node, 0, 0);
-    return JS_UNDEFINED;
-  }
+js_audiocontext_cancel_rendering(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  if(sac->render)
+    sac->render->cancel();
+  return JS_UNDEFINED;
+}
 
-  JsAudioParam* dstParam = any_audio_param(argv[0]);
-  if(dstParam) {
-    src->ctx->disconnectParam(dstParam->param, src->node, 0);
-    return JS_UNDEFINED;
+/* ---------- render profiling (render-profiler.hpp) ---------- */
+//
+// Not in the spec. ctx.renderProfiling = "off" | "sampled" | "full" turns on
+// accumulation of lab's per-node process timings: "full" samples every
+// quantum, "sampled" every RENDER_PROFILE_INTERVAL-th one and is cheap
+// enough to leave on. getRenderProfile() reports what has been gathered
+// since the last reset; nodes are identified by AudioNode.nodeId and their
+// lab type name, and are also summed per type so short-lived voices that
+// are long gone still show up.
+
+enum { RENDER_PROFILE_INTERVAL = 16 };
+
+static RenderProfilerNode*
+render_profiler(JsAudioContext* sac) {
+  NodeRegistry& reg = *sac->nodes;
+  if(!reg.profiler) {
+    reg.profiler = std::make_shared<RenderProfilerNode>(*sac->ac);
+    for(auto& it : reg.entries)
+      if(it.second.node)
+        reg.profiler->track(it.second.node, it.second.id);
+    sac->ac->addAutomaticPullNode(reg.profiler);
   }
-
-  return JS_ThrowTypeError(ctx, "destination must be an AudioNode or AudioParam");
+  return reg.profiler.get();
 }
 
-static void
-js_audionode_finalize_with(JSRuntime* rt, JSValue val, JSClassID cid) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque(val, cid));
-  if(w) {
-    w->~JsAudioNode();
-    js_free_rt(rt, w);
-  }
+static const char*
+render_profiling_mode(int interval) {
+  return interval <= 0 ? "off" : interval == 1 ? "full" : "sampled";
 }
 
-static const JSCFunctionListEntry js_audionode_funcs[] = {
-    JS_CFUNC_DEF("connect", 1, js_audionode_connect),
-    JS_CFUNC_DEF("disconnect", 0, js_audionode_disconnect),
-};
+static JSValue
+js_audiocontext_get_render_profiling(JSContext* ctx, JSValueConst this_val) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  return JS_NewString(ctx, render_profiling_mode(sac->nodes->profiler ? sac->nodes->profiler->getInterval() : 0));
+}
 
-/* ---------- shared AudioScheduledSourceNode methods ---------- */
-// start(when)/stop(when) are defined on lab::AudioScheduledSourceNode itself,
-// so Oscillator/Noise/AudioBufferSource can all share one implementation.
-// AudioBufferSourceNode overrides start() on its own proto for its extra
-// offset/loop arguments but still inherits this stop().
+static JSValue
+js_audiocontext_set_render_profiling(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  const char* mode = JS_ToCString(ctx, value);
+  if(!mode)
+    return JS_EXCEPTION;
+  int interval = !strcmp(mode, "off") ? 0 : !strcmp(mode, "full") ? 1 : !strcmp(mode, "sampled") ? int(RENDER_PROFILE_INTERVAL) : -1;
+  JS_FreeCString(ctx, mode);
+  if(interval < 0)
+    return JS_ThrowRangeError(ctx, "renderProfiling must be \"off\", \"sampled\" or \"full\"");
+  if(interval || sac->nodes->profiler)
+    render_profiler(sac)->setInterval(interval);
+  return JS_UNDEFINED;
+}
 
 static JSValue
-js_scheduledsource_start(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioNode* w = any_audio_node(this_val);
-  if(!w)
-    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
-  auto s = std::dynamic_pointer_cast<lab::AudioScheduledSourceNode>(w->node);
-  if(!s)
-    return JS_ThrowInternalError(ctx, "not a scheduled source node");
-  float when = 0.0f;
-  if(argc > 0) {
-    double t;
-    if(JS_ToFloat64(ctx, &t, argv[0]))
-      return JS_EXCEPTION;
-    when = (float)t;
-  }
-  s->start(when);
+js_audiocontext_reset_render_profile(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  if(sac->nodes->profiler)
+    sac->nodes->profiler->reset(sac->ac.get());
   return JS_UNDEFINED;
 }
 
+// getRenderProfile({reset = false}) -> {mode, quanta, sampledQuanta,
+// sampleInterval, quantumDuration, renderTime, load, peakLoad,
+// untrackedNodes, nodes, types}.
+// Times are in seconds of render-thread time, summed over sampled quanta
+// only. `load` is the mean fraction of each quantum's real-time budget
+// spent in profiled nodes, and `peakLoad` is the worst single quantum.
+// `nodes` ({id, type, time, calls, worstTime, share}) lists live nodes,
+// most expensive first. `types` has the same totals per lab node type,
+// including nodes that have since been reclaimed. The profiler tracks at
+// most 1024 nodes and 64 types; `untrackedNodes` counts the nodes it had no
+// room for, and further types are summed under "other".
 static JSValue
-js_scheduledsource_stop(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioNode* w = any_audio_node(this_val);
-  if(!w)
-    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
-  auto s = std::dynamic_pointer_cast<lab::AudioScheduledSourceNode>(w->node);
-  if(!s)
-    return JS_ThrowInternalError(ctx, "not a scheduled source node");
-  float when = 0.0f;
-  if(argc > 0) {
-    double t;
-    if(JS_ToFloat64(ctx, &t, argv[0]))
-      return JS_EXCEPTION;
-    when = (float)t;
+js_audiocontext_get_render_profile(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  bool reset = false;
+  if(argc > 0 && JS_IsObject(argv[0])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[0], "reset");
+    reset = JS_ToBool(ctx, v);
+    JS_FreeValue(ctx, v);
   }
-  s->stop(when);
-  return JS_UNDEFINED;
+
+  RenderProfilerNode::Snapshot snap;
+  if(sac->nodes->profiler) {
+    snap = sac->nodes->profiler->snapshot(sac->ac.get());
+    if(reset)
+      sac->nodes->profiler->reset(sac->ac.get());
+  }
+
+  const double us = 1e-6;
+  double quantum = double(snap.quantumFrames ? snap.quantumFrames : int(lab::AudioNode::ProcessingSizeInFrames)) / sac->ac->sampleRate();
+  double renderTime = snap.renderTime * us;
+
+  JSValue obj = JS_NewObject(ctx);
+  JS_SetPropertyStr(ctx, obj, "mode", JS_NewString(ctx, render_profiling_mode(snap.interval)));
+  JS_SetPropertyStr(ctx, obj, "quanta", JS_NewInt64(ctx, int64_t(snap.quanta)));
+  JS_SetPropertyStr(ctx, obj, "sampledQuanta", JS_NewInt64(ctx, int64_t(snap.sampled)));
+  JS_SetPropertyStr(ctx, obj, "sampleInterval", JS_NewInt32(ctx, snap.interval));
+  JS_SetPropertyStr(ctx, obj, "quantumDuration", JS_NewFloat64(ctx, quantum));
+  JS_SetPropertyStr(ctx, obj, "renderTime", JS_NewFloat64(ctx, renderTime));
+  JS_SetPropertyStr(ctx, obj, "load", JS_NewFloat64(ctx, snap.sampled ? renderTime / (double(snap.sampled) * quantum) : 0));
+  JS_SetPropertyStr(ctx, obj, "peakLoad", JS_NewFloat64(ctx, snap.worstQuantum * us / quantum));
+  JS_SetPropertyStr(ctx, obj, "untrackedNodes", JS_NewInt64(ctx, int64_t(snap.untracked)));
+
+  std::sort(snap.nodes.begin(), snap.nodes.end(), [](const auto& a, const auto& b) { return a.time > b.time; });
+  JSValue nodes = JS_NewArray(ctx);
+  uint32_t i = 0;
+  for(const auto& n : snap.nodes) {
+    JSValue e = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, e, "id", JS_NewUint32(ctx, n.id));
+    JS_SetPropertyStr(ctx, e, "type", JS_NewString(ctx, n.type));
+    JS_SetPropertyStr(ctx, e, "time", JS_NewFloat64(ctx, n.time * us));
+    JS_SetPropertyStr(ctx, e, "calls", JS_NewInt64(ctx, int64_t(n.calls)));
+    JS_SetPropertyStr(ctx, e, "worstTime", JS_NewFloat64(ctx, n.worst * us));
+    JS_SetPropertyStr(ctx, e, "share", JS_NewFloat64(ctx, snap.renderTime > 0 ? n.time / snap.renderTime : 0));
+    JS_SetPropertyUint32(ctx, nodes, i++, e);
+  }
+  JS_SetPropertyStr(ctx, obj, "nodes", nodes);
+
+  std::sort(snap.types.begin(), snap.types.end(), [](const auto& a, const auto& b) { return a.time > b.time; });
+  JSValue types = JS_NewArray(ctx);
+  i = 0;
+  for(const auto& t : snap.types) {
+    JSValue e = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, e, "type", JS_NewString(ctx, t.type));
+    JS_SetPropertyStr(ctx, e, "time", JS_NewFloat64(ctx, t.time * us));
+    JS_SetPropertyStr(ctx, e, "calls", JS_NewInt64(ctx, int64_t(t.calls)));
+    JS_SetPropertyStr(ctx, e, "worstTime", JS_NewFloat64(ctx, t.worst * us));
+    JS_SetPropertyStr(ctx, e, "share", JS_NewFloat64(ctx, snap.renderTime > 0 ? t.time / snap.renderTime : 0));
+    JS_SetPropertyUint32(ctx, types, i++, e);
+  }
+  JS_SetPropertyStr(ctx, obj, "types", types);
+  return obj;
 }
 
-static const JSCFunctionListEntry js_audioscheduledsourcenode_funcs[] = {
-    JS_CFUNC_DEF("start", 0, js_scheduledsource_start),
-    JS_CFUNC_DEF("stop", 0, js_scheduledsource_stop),
+/* ---------- render stats (render-monitor.hpp) ---------- */
+//
+// Not in the spec. ctx.renderStats is meant to be polled, so it returns the
+// same object every time, with its typed arrays refilled in place:
+//
+//   counters   Float64Array indexed by the constants on the object
+//              (counts since the last resetRenderStats(); jitter in
+//              seconds, load as a callback's time over its period)
+//   durations  Float32Array ring of per-quantum render times, in seconds;
+//              the newest is at (counters[DURATIONS_HEAD] - 1) % length
+//   intervals  Float32Array ring of device callback intervals, in seconds
+//
+// null on an OfflineAudioContext, which has no real-time deadline.
+
+enum {
+  RS_QUANTA,
+  RS_CALLBACKS,
+  RS_XRUNS,
+  RS_LATE_CALLBACKS,
+  RS_MEAN_JITTER,
+  RS_MAX_JITTER,
+  RS_MEAN_LOAD,
+  RS_PEAK_LOAD,
+  RS_DURATIONS_HEAD,
+  RS_INTERVALS_HEAD,
+  RS_COUNT,
 };
 
-/* ---------- AudioDestinationNode ---------- */
+static const JSCFunctionListEntry js_renderstats_consts[] = {
+    JS_PROP_INT32_DEF("QUANTA", RS_QUANTA, 0),
+    JS_PROP_INT32_DEF("CALLBACKS", RS_CALLBACKS, 0),
+    JS_PROP_INT32_DEF("XRUNS", RS_XRUNS, 0),
+    JS_PROP_INT32_DEF("LATE_CALLBACKS", RS_LATE_CALLBACKS, 0),
+    JS_PROP_INT32_DEF("MEAN_JITTER", RS_MEAN_JITTER, 0),
+    JS_PROP_INT32_DEF("MAX_JITTER", RS_MAX_JITTER, 0),
+    JS_PROP_INT32_DEF("MEAN_LOAD", RS_MEAN_LOAD, 0),
+    JS_PROP_INT32_DEF("PEAK_LOAD", RS_PEAK_LOAD, 0),
+    JS_PROP_INT32_DEF("DURATIONS_HEAD", RS_DURATIONS_HEAD, 0),
+    JS_PROP_INT32_DEF("INTERVALS_HEAD", RS_INTERVALS_HEAD, 0),
+};
+
+// Backing store of a typed array we created, or null (with an exception
+// pending) if script has since detached it.
+template<class T>
+static T*
+typed_array_data(JSContext* ctx, JSValueConst ta, size_t count) {
+  size_t byte_offset = 0, byte_length = 0, bytes_per_element = 0, ab_size = 0;
+  JSValue buf = JS_GetTypedArrayBuffer(ctx, ta, &byte_offset, &byte_length, &bytes_per_element);
+  if(JS_IsException(buf))
+    return nullptr;
+  uint8_t* ab_data = JS_GetArrayBuffer(ctx, &ab_size, buf);
+  JS_FreeValue(ctx, buf);
+  if(!ab_data)
+    return nullptr;
+  if(byte_length < count * sizeof(T)) {
+    JS_ThrowTypeError(ctx, "renderStats: array was resized");
+    return nullptr;
+  }
+  return reinterpret_cast<T*>(ab_data + byte_offset);
+}
 
 static JSValue
-js_audiodestinationnode_get_name(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_audiodestinationnode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  return JS_NewString(ctx, w->node->name());
+render_stats_new(JSContext* ctx, JsAudioContext* sac) {
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue float64array_ctor = JS_GetPropertyStr(ctx, global, "Float64Array");
+  JS_FreeValue(ctx, global);
+  JSValue n = JS_NewInt32(ctx, RS_COUNT);
+  JSValue counters = JS_CallConstructor(ctx, float64array_ctor, 1, &n);
+  JS_FreeValue(ctx, float64array_ctor);
+  JSValue durations = JS_UNDEFINED, intervals = JS_UNDEFINED, obj = JS_UNDEFINED;
+  if(JS_IsException(counters))
+    goto fail;
+  n = JS_NewInt32(ctx, RenderMonitor::DURATIONS);
+  durations = JS_CallConstructor(ctx, float32array_ctor, 1, &n);
+  if(JS_IsException(durations))
+    goto fail;
+  n = JS_NewInt32(ctx, RenderMonitor::INTERVALS);
+  intervals = JS_CallConstructor(ctx, float32array_ctor, 1, &n);
+  if(JS_IsException(intervals))
+    goto fail;
+  obj = JS_NewObject(ctx);
+  if(JS_IsException(obj))
+    goto fail;
+
+  JS_SetPropertyFunctionList(ctx, obj, js_renderstats_consts, countof(js_renderstats_consts));
+  JS_DefinePropertyValueStr(ctx, obj, "counters", JS_DupValue(ctx, counters), JS_PROP_ENUMERABLE);
+  JS_DefinePropertyValueStr(ctx, obj, "durations", JS_DupValue(ctx, durations), JS_PROP_ENUMERABLE);
+  JS_DefinePropertyValueStr(ctx, obj, "intervals", JS_DupValue(ctx, intervals), JS_PROP_ENUMERABLE);
+  // Only a complete set is kept, so a failed first read can simply retry.
+  sac->statsCounters = counters;
+  sac->statsDurations = durations;
+  sac->statsIntervals = intervals;
+  return obj;
+
+fail:
+  JS_FreeValue(ctx, counters);
+  JS_FreeValue(ctx, durations);
+  JS_FreeValue(ctx, intervals);
+  return JS_EXCEPTION;
 }
 
 static JSValue
-js_audiodestinationnode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  return JS_ThrowTypeError(ctx, "use AudioContext.destination instead");
+js_audiocontext_get_render_stats(JSContext* ctx, JSValueConst this_val) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  if(!sac->device)
+    return JS_NULL;
+  if(JS_IsUndefined(sac->stats)) {
+    JSValue obj = render_stats_new(ctx, sac);
+    if(JS_IsException(obj))
+      return obj;
+    sac->stats = obj;
+  }
+
+  double* counters = typed_array_data<double>(ctx, sac->statsCounters, RS_COUNT);
+  float* durations = typed_array_data<float>(ctx, sac->statsDurations, RenderMonitor::DURATIONS);
+  float* intervals = typed_array_data<float>(ctx, sac->statsIntervals, RenderMonitor::INTERVALS);
+  if(!counters || !durations || !intervals)
+    return JS_EXCEPTION;
+
+  const RenderMonitor& m = sac->device->monitor();
+  const auto relaxed = std::memory_order_relaxed;
+  uint64_t quanta = m.quanta.load(relaxed), callbacks = m.callbacks.load(relaxed);
+  counters[RS_QUANTA] = double(quanta);
+  counters[RS_CALLBACKS] = double(callbacks);
+  counters[RS_XRUNS] = double(m.xruns.load(relaxed));
+  counters[RS_LATE_CALLBACKS] = double(m.lateCallbacks.load(relaxed));
+  counters[RS_MEAN_JITTER] = callbacks ? m.jitterSum.load(relaxed) / double(callbacks) : 0;
+  counters[RS_MAX_JITTER] = m.maxJitter.load(relaxed);
+  counters[RS_MEAN_LOAD] = callbacks ? m.loadSum.load(relaxed) / double(callbacks) : 0;
+  counters[RS_PEAK_LOAD] = m.peakLoad.load(relaxed);
+  counters[RS_DURATIONS_HEAD] = double(m.durationsHead.load(std::memory_order_acquire));
+  counters[RS_INTERVALS_HEAD] = double(m.intervalsHead.load(std::memory_order_acquire));
+  for(int i = 0; i < RenderMonitor::DURATIONS; i++)
+    durations[i] = m.durations[i].load(relaxed);
+  for(int i = 0; i < RenderMonitor::INTERVALS; i++)
+    intervals[i] = m.intervals[i].load(relaxed);
+  return JS_DupValue(ctx, sac->stats);
 }
 
-static void
-js_audiodestinationnode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_audiodestinationnode_class_id);
+static JSValue
+js_audiocontext_reset_render_stats(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  if(sac->device)
+    sac->device->monitor().clear();
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_audiodestinationnode_class = {
-    .class_name = "AudioDestinationNode",
-    .finalizer = js_audiodestinationnode_finalizer,
+/* ---------- AudioWorklet (audio-worklet.hpp) ---------- */
+//
+// ctx.audioWorklet.addModule(path) evaluates a processor module in the
+// context's WorkletScope: a QuickJS runtime of its own, run by the render
+// thread, created on first use. `new AudioWorkletNode(ctx, name, options)`
+// then constructs one of its processors. Where this differs from the spec:
+//
+//  - addModule() takes a file path and evaluates it before returning; the
+//    promise is already settled;
+//  - the processor is constructed on the JS thread, during the node's
+//    constructor, so an exception there throws from `new AudioWorkletNode`
+//    instead of firing processorerror;
+//  - postMessage() copies with QuickJS's own serializer (no transfer
+//    lists, no functions) into a 64 KB ring per direction, and returns
+//    false instead of queueing without bound when the ring is full.
+//
+// A port with an onmessage or onprocessorerror handler is kept alive and
+// polled like a background task (see async_start()), which also keeps
+// js_std_loop running until the port is closed or the handlers cleared.
+
+struct JsAudioWorklet {
+  std::shared_ptr<WorkletScope> scope;
 };
 
-static const JSCFunctionListEntry js_audiodestinationnode_funcs[] = {
-    JS_CGETSET_DEF("name", js_audiodestinationnode_get_name, NULL),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioDestinationNode", JS_PROP_CONFIGURABLE),
+enum {
+  AW_PROP_GC_RUNS,
+  AW_PROP_SKIPPED_QUANTA,
 };
 
-/* ---------- OscillatorNode ---------- */
-
-static lab::OscillatorType
-parse_oscillator_type(const char* s) {
-  if(!s)
-    return lab::OscillatorType::SINE;
-  if(!strcmp(s, "sine"))
-    return lab::OscillatorType::SINE;
-  if(!strcmp(s, "square"))
-    return lab::OscillatorType::SQUARE;
-  if(!strcmp(s, "sawtooth"))
-    return lab::OscillatorType::SAWTOOTH;
-  if(!strcmp(s, "triangle"))
-    return lab::OscillatorType::TRIANGLE;
-  if(!strcmp(s, "fast-sine"))
-    return lab::OscillatorType::FAST_SINE;
-  if(!strcmp(s, "falling-sawtooth"))
-    return lab::OscillatorType::FALLING_SAWTOOTH;
-  return lab::OscillatorType::SINE;
+static JSValue
+js_audiocontext_get_audio_worklet(JSContext* ctx, JSValueConst this_val) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  if(JS_IsUndefined(sac->audioWorklet)) {
+    if(!sac->worklet) {
+      std::shared_ptr<AsyncState> state = async_state(ctx);
+      if(!state)
+        return JS_EXCEPTION;
+      sac->worklet = std::make_shared<WorkletScope>(sac->ac->sampleRate(), sac->ac->isOfflineContext());
+      sac->worklet->wake = [state]() { async_wake(*state); };
+    }
+    JSValue obj = JS_NewObjectProtoClass(ctx, audioworklet_proto, js_audioworklet_class_id);
+    if(JS_IsException(obj))
+      return obj;
+    auto* w = static_cast<JsAudioWorklet*>(js_mallocz(ctx, sizeof(JsAudioWorklet)));
+    new(w) JsAudioWorklet{sac->worklet};
+    JS_SetOpaque(obj, w);
+    sac->audioWorklet = obj;
+  }
+  return JS_DupValue(ctx, sac->audioWorklet);
 }
 
-static const char*
-osc_type_to_string(lab::OscillatorType t) {
-  switch(t) {
-    case lab::OscillatorType::SINE: return "sine";
-    case lab::OscillatorType::FAST_SINE: return "fast-sine";
-    case lab::OscillatorType::SQUARE: return "square";
-    case lab::OscillatorType::SAWTOOTH: return "sawtooth";
-    case lab::OscillatorType::FALLING_SAWTOOTH: return "falling-sawtooth";
-    case lab::OscillatorType::TRIANGLE: return "triangle";
-    case lab::OscillatorType::CUSTOM: return "custom";
-    default: return "sine";
+static JSValue
+js_audioworklet_add_module(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioWorklet* w = static_cast<JsAudioWorklet*>(JS_GetOpaque2(ctx, this_val, js_audioworklet_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+  const char* path = argc > 0 ? JS_ToCString(ctx, argv[0]) : nullptr;
+  if(!path)
+    return JS_ThrowTypeError(ctx, "addModule requires a module path");
+
+  JSValue resolving[2];
+  JSValue promise = JS_NewPromiseCapability(ctx, resolving);
+  if(JS_IsException(promise)) {
+    JS_FreeCString(ctx, path);
+    return promise;
+  }
+  std::string error;
+  bool ok = w->scope->addModule(path, error);
+  JSValue value = JS_UNDEFINED;
+  if(!ok) {
+    value = JS_NewError(ctx);
+    JS_SetPropertyStr(ctx, value, "message", JS_NewString(ctx, ("addModule('" + std::string(path) + "'): " + error).c_str()));
   }
+  JS_FreeCString(ctx, path);
+  JSValue ret = JS_Call(ctx, resolving[ok ? 0 : 1], JS_UNDEFINED, 1, &value);
+  JS_FreeValue(ctx, ret);
+  JS_FreeValue(ctx, value);
+  JS_FreeValue(ctx, resolving[0]);
+  JS_FreeValue(ctx, resolving[1]);
+  return promise;
 }
 
 static JSValue
-js_oscillator_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  if(argc < 1)
-    return JS_ThrowTypeError(ctx, "OscillatorNode requires an AudioContext");
-
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+js_audioworklet_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioWorklet* w = static_cast<JsAudioWorklet*>(JS_GetOpaque2(ctx, this_val, js_audioworklet_class_id));
+  if(!w)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
+  switch(magic) {
+    case AW_PROP_GC_RUNS: return JS_NewInt64(ctx, int64_t(w->scope->gcRuns.load(std::memory_order_relaxed)));
+    case AW_PROP_SKIPPED_QUANTA: return JS_NewInt64(ctx, int64_t(w->scope->skippedQuanta.load(std::memory_order_relaxed)));
+  }
+  return JS_UNDEFINED;
+}
 
-  auto osc = std::make_shared<lab::OscillatorNode>(*ac);
+static void
+js_audioworklet_finalizer(JSRuntime* rt, JSValue val) {
+  JsAudioWorklet* w = static_cast<JsAudioWorklet*>(JS_GetOpaque(val, js_audioworklet_class_id));
+  if(w) {
+    w->~JsAudioWorklet();
+    js_free_rt(rt, w);
+  }
+}
 
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v;
+static JSClassDef js_audioworklet_class = {
+    .class_name = "AudioWorklet",
+    .finalizer = js_audioworklet_finalizer,
+};
 
-    v = JS_GetPropertyStr(ctx, argv[1], "type");
-    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
-      const char* s = JS_ToCString(ctx, v);
-      if(s) {
-        osc->setType(parse_oscillator_type(s));
-        JS_FreeCString(ctx, s);
-      }
-    }
-    JS_FreeValue(ctx, v);
+static const JSCFunctionListEntry js_audioworklet_funcs[] = {
+    JS_CFUNC_DEF("addModule", 1, js_audioworklet_add_module),
+    JS_CGETSET_MAGIC_DEF("gcRuns", js_audioworklet_get, 0, AW_PROP_GC_RUNS),
+    JS_CGETSET_MAGIC_DEF("skippedQuanta", js_audioworklet_get, 0, AW_PROP_SKIPPED_QUANTA),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioWorklet", JS_PROP_CONFIGURABLE),
+};
 
-    v = JS_GetPropertyStr(ctx, argv[1], "frequency");
-    if(JS_IsNumber(v)) {
-      double f;
-      JS_ToFloat64(ctx, &f, v);
-      osc->frequency()->setValue((float)f);
-    }
-    JS_FreeValue(ctx, v);
+// AudioWorkletNode.port. `task` is set while a handler is, and holds the
+// port object until it's cleared again.
+struct PortTask;
 
-    v = JS_GetPropertyStr(ctx, argv[1], "detune");
-    if(JS_IsNumber(v)) {
-      double d;
-      JS_ToFloat64(ctx, &d, v);
-      osc->detune()->setValue((float)d);
+struct JsMessagePort {
+  std::shared_ptr<WorkletProcessor> processor;
+  JSValue onmessage = JS_UNDEFINED, onprocessorerror = JS_UNDEFINED;
+  std::shared_ptr<PortTask> task;
+  std::vector<uint8_t> message; // what toMain.pop() copies into
+  bool closed = false, errorReported = false;
+};
+
+// JS thread: dispatch what the processor sent, then its failure if any.
+static void
+message_port_deliver(JSContext* ctx, JSValueConst obj) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque(obj, js_messageport_class_id));
+  if(p)
+    p->processor->workletScope()->collect();
+  while(p && !p->closed && JS_IsFunction(ctx, p->onmessage) && p->processor->toMain.pop(p->message)) {
+    JSValue data = JS_ReadObject(ctx, p->message.data(), p->message.size(), 0);
+    if(JS_IsException(data)) {
+      JS_FreeValue(ctx, JS_GetException(ctx));
+      continue;
     }
-    JS_FreeValue(ctx, v);
+    JSValue ev = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, ev, "data", data);
+    // The handler may replace itself.
+    JSValue fn = JS_DupValue(ctx, p->onmessage);
+    JSValue ret = JS_Call(ctx, fn, obj, 1, &ev);
+    if(JS_IsException(ret))
+      JS_FreeValue(ctx, JS_GetException(ctx));
+    JS_FreeValue(ctx, ret);
+    JS_FreeValue(ctx, fn);
+    JS_FreeValue(ctx, ev);
+  }
+  if(p && !p->errorReported && p->processor->failed.load(std::memory_order_acquire) && JS_IsFunction(ctx, p->onprocessorerror)) {
+    p->errorReported = true;
+    JSValue ev = JS_NewObject(ctx);
+    JS_SetPropertyStr(ctx, ev, "type", JS_NewString(ctx, "processorerror"));
+    JS_SetPropertyStr(ctx, ev, "message", JS_NewString(ctx, p->processor->error.c_str()));
+    JSValue fn = JS_DupValue(ctx, p->onprocessorerror);
+    JSValue ret = JS_Call(ctx, fn, obj, 1, &ev);
+    if(JS_IsException(ret))
+      JS_FreeValue(ctx, JS_GetException(ctx));
+    JS_FreeValue(ctx, ret);
+    JS_FreeValue(ctx, fn);
+    JS_FreeValue(ctx, ev);
+  }
+}
+
+// Never settles on its own: the port deactivates it by posting it.
+struct PortTask : AsyncTask {
+  JSValue port = JS_UNDEFINED;
+
+  void
+  poll(JSContext* ctx) override {
+    message_port_deliver(ctx, port);
   }
 
-  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
-  if(JS_IsException(proto))
-    return JS_EXCEPTION;
-  if(!JS_IsObject(proto)) {
-    JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, oscillatornode_proto);
+  JSValue
+  settle(JSContext* ctx) override {
+    return JS_UNDEFINED;
   }
 
-  JSValue obj = make_audio_node_js(ctx, proto, js_oscillatornode_class_id, std::static_pointer_cast<lab::AudioNode>(osc), ac);
-  JS_FreeValue(ctx, proto);
-  anchor_node_in_context(ctx, argv[0], obj);
-  return obj;
+  void
+  release(JSContext* ctx) override {
+    JS_FreeValue(ctx, port);
+    port = JS_UNDEFINED;
+  }
+};
+
+// Listen while a handler is set and the port is open.
+static void
+message_port_update(JSContext* ctx, JSValueConst obj, JsMessagePort* p) {
+  bool active = !p->closed && (JS_IsFunction(ctx, p->onmessage) || JS_IsFunction(ctx, p->onprocessorerror));
+  if(active && !p->task) {
+    auto task = std::make_shared<PortTask>();
+    task->port = JS_DupValue(ctx, obj);
+    JSValue promise = async_start(ctx, task);
+    if(JS_IsException(promise)) {
+      JS_FreeValue(ctx, JS_GetException(ctx));
+      JS_FreeValue(ctx, task->port);
+      return;
+    }
+    JS_FreeValue(ctx, promise);
+    p->task = task;
+    // Deliver whatever arrived while nobody was listening.
+    async_wake(*task->state);
+  } else if(!active && p->task) {
+    async_post(p->task);
+    p->task.reset();
+  }
 }
 
 enum {
-  OSC_PROP_TYPE,
-  OSC_PROP_FREQUENCY,
-  OSC_PROP_DETUNE,
+  MP_PROP_ONMESSAGE,
+  MP_PROP_ONPROCESSORERROR,
 };
 
 static JSValue
-js_oscillator_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_oscillatornode_class_id));
-  if(!w)
+js_messageport_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque2(ctx, this_val, js_messageport_class_id));
+  if(!p)
     return JS_EXCEPTION;
-  auto osc = std::dynamic_pointer_cast<lab::OscillatorNode>(w->node);
-  if(!osc)
-    return JS_ThrowInternalError(ctx, "not an OscillatorNode");
-  switch(magic) {
-    case OSC_PROP_TYPE: return JS_NewString(ctx, osc_type_to_string(osc->type()));
-    case OSC_PROP_FREQUENCY: return make_audio_param_js(ctx, osc->frequency());
-    case OSC_PROP_DETUNE: return make_audio_param_js(ctx, osc->detune());
-  }
-  return JS_UNDEFINED;
+  return JS_DupValue(ctx, magic == MP_PROP_ONMESSAGE ? p->onmessage : p->onprocessorerror);
 }
 
 static JSValue
-js_oscillator_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_oscillatornode_class_id));
-  if(!w)
+js_messageport_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque2(ctx, this_val, js_messageport_class_id));
+  if(!p)
     return JS_EXCEPTION;
-  auto osc = std::dynamic_pointer_cast<lab::OscillatorNode>(w->node);
-  if(!osc)
-    return JS_ThrowInternalError(ctx, "not an OscillatorNode");
-  if(magic == OSC_PROP_TYPE) {
-    const char* s = JS_ToCString(ctx, value);
-    if(s) {
-      osc->setType(parse_oscillator_type(s));
-      JS_FreeCString(ctx, s);
-    }
-  }
+  JSValue& slot = magic == MP_PROP_ONMESSAGE ? p->onmessage : p->onprocessorerror;
+  JS_FreeValue(ctx, slot);
+  slot = JS_IsFunction(ctx, value) ? JS_DupValue(ctx, value) : JS_NULL;
+  message_port_update(ctx, this_val, p);
   return JS_UNDEFINED;
 }
 
-static void
-js_oscillatornode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_oscillatornode_class_id);
-}
-
-static JSClassDef js_oscillatornode_class = {
-    .class_name = "OscillatorNode",
-    .finalizer = js_oscillatornode_finalizer,
-};
-
-static const JSCFunctionListEntry js_oscillatornode_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("type", js_oscillator_get, js_oscillator_set, OSC_PROP_TYPE),
-    JS_CGETSET_MAGIC_DEF("frequency", js_oscillator_get, 0, OSC_PROP_FREQUENCY),
-    JS_CGETSET_MAGIC_DEF("detune", js_oscillator_get, 0, OSC_PROP_DETUNE),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "OscillatorNode", JS_PROP_CONFIGURABLE),
-};
-
-/* ---------- GainNode ---------- */
-
 static JSValue
-js_gain_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  if(argc < 1)
-    return JS_ThrowTypeError(ctx, "GainNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+js_messageport_post_message(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque2(ctx, this_val, js_messageport_class_id));
+  if(!p)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto g = std::make_shared<lab::GainNode>(*ac);
-
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "gain");
-    if(JS_IsNumber(v)) {
-      double f;
-      JS_ToFloat64(ctx, &f, v);
-      g->gain()->setValue((float)f);
-    }
-    JS_FreeValue(ctx, v);
-  }
-
-  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
-  if(JS_IsException(proto))
+  if(p->closed)
+    return JS_FALSE;
+  size_t size;
+  uint8_t* bytes = JS_WriteObject(ctx, &size, argc > 0 ? argv[0] : JS_UNDEFINED, 0);
+  if(!bytes)
     return JS_EXCEPTION;
-  if(!JS_IsObject(proto)) {
-    JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, gainnode_proto);
+  if(size > p->processor->toProcessor.maxMessage()) {
+    js_free(ctx, bytes);
+    return JS_ThrowRangeError(ctx, "postMessage: message of %zu bytes is too large", size);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_gainnode_class_id, std::static_pointer_cast<lab::AudioNode>(g), ac);
-  JS_FreeValue(ctx, proto);
-  anchor_node_in_context(ctx, argv[0], obj);
-  return obj;
+  bool ok = p->processor->toProcessor.push(bytes, size);
+  js_free(ctx, bytes);
+  return JS_NewBool(ctx, ok);
 }
 
 static JSValue
-js_gain_get_gain(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_gainnode_class_id));
-  if(!w)
+js_messageport_start(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_messageport_close(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque2(ctx, this_val, js_messageport_class_id));
+  if(!p)
     return JS_EXCEPTION;
-  auto g = std::dynamic_pointer_cast<lab::GainNode>(w->node);
-  if(!g)
-    return JS_ThrowInternalError(ctx, "not a GainNode");
-  return make_audio_param_js(ctx, g->gain());
+  p->closed = true;
+  message_port_update(ctx, this_val, p);
+  return JS_UNDEFINED;
+}
+
+static void
+js_messageport_mark(JSRuntime* rt, JSValueConst val, JS_MarkFunc* mark_func) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque(val, js_messageport_class_id));
+  if(p) {
+    JS_MarkValue(rt, p->onmessage, mark_func);
+    JS_MarkValue(rt, p->onprocessorerror, mark_func);
+  }
 }
 
 static void
-js_gainnode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_gainnode_class_id);
+js_messageport_finalizer(JSRuntime* rt, JSValue val) {
+  JsMessagePort* p = static_cast<JsMessagePort*>(JS_GetOpaque(val, js_messageport_class_id));
+  if(p) {
+    JS_FreeValueRT(rt, p->onmessage);
+    JS_FreeValueRT(rt, p->onprocessorerror);
+    p->~JsMessagePort();
+    js_free_rt(rt, p);
+  }
 }
 
-static JSClassDef js_gainnode_class = {
-    .class_name = "GainNode",
-    .finalizer = js_gainnode_finalizer,
+static JSClassDef js_messageport_class = {
+    .class_name = "MessagePort",
+    .finalizer = js_messageport_finalizer,
+    .gc_mark = js_messageport_mark,
 };
 
-static const JSCFunctionListEntry js_gainnode_funcs[] = {
-    JS_CGETSET_DEF("gain", js_gain_get_gain, NULL),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "GainNode", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_messageport_funcs[] = {
+    JS_CFUNC_DEF("postMessage", 1, js_messageport_post_message),
+    JS_CFUNC_DEF("start", 0, js_messageport_start),
+    JS_CFUNC_DEF("close", 0, js_messageport_close),
+    JS_CGETSET_MAGIC_DEF("onmessage", js_messageport_get, js_messageport_set, MP_PROP_ONMESSAGE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "MessagePort", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- BiquadFilterNode ---------- */
-
-static lab::FilterType
-parse_filter_type(const char* s) {
-  if(!s)
-    return lab::FilterType::LOWPASS;
-  if(!strcmp(s, "lowpass"))
-    return lab::FilterType::LOWPASS;
-  if(!strcmp(s, "highpass"))
-    return lab::FilterType::HIGHPASS;
-  if(!strcmp(s, "bandpass"))
-    return lab::FilterType::BANDPASS;
-  if(!strcmp(s, "lowshelf"))
-    return lab::FilterType::LOWSHELF;
-  if(!strcmp(s, "highshelf"))
-    return lab::FilterType::HIGHSHELF;
-  if(!strcmp(s, "peaking"))
-    return lab::FilterType::PEAKING;
-  if(!strcmp(s, "notch"))
-    return lab::FilterType::NOTCH;
-  if(!strcmp(s, "allpass"))
-    return lab::FilterType::ALLPASS;
-  return lab::FilterType::LOWPASS;
-}
+static void
+js_audiocontext_finalizer(JSRuntime* rt, JSValue val) {
 
-static const char*
-filter_type_to_string(lab::FilterType t) {
-  switch(t) {
-    case lab::FilterType::LOWPASS: return "lowpass";
-    case lab::FilterType::HIGHPASS: return "highpass";
-    case lab::FilterType::BANDPASS: return "bandpass";
-    case lab::FilterType::LOWSHELF: return "lowshelf";
-    case lab::FilterType::HIGHSHELF: return "highshelf";
-    case lab::FilterType::PEAKING: return "peaking";
-    case lab::FilterType::NOTCH: return "notch";
-    case lab::FilterType::ALLPASS: return "allpass";
-    default: return "lowpass";
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque(val, js_audiocontext_class_id));
+  if(sac) {
+    // The device holds the destination, which holds the device.
+    if(sac->device) {
+      sac->device->stop();
+      sac->device->setDestinationNode(nullptr);
+    }
+    // Node wrappers can outlive the context object and still point at the
+    // registry; leave it empty for them rather than dangling. As in
+    // node_registry_sweep, entries leave under the graph lock and the last
+    // references drop outside it.
+    std::unordered_map<lab::AudioNode*, NodeRegistry::Entry> released;
+    {
+      lab::ContextGraphLock gLock(sac->ac.get(), "AudioContext.finalize");
+      released.swap(sac->nodes->entries);
+    }
+    released.clear();
+    if(sac->nodes->profiler) {
+      sac->ac->removeAutomaticPullNode(sac->nodes->profiler);
+      sac->nodes->profiler.reset();
+    }
+    for(JSValue v : {sac->stats, sac->statsCounters, sac->statsDurations, sac->statsIntervals, sac->audioWorklet})
+      JS_FreeValueRT(rt, v);
+    // Worklet nodes retire their processors as the graph goes; free them
+    // before the scope they hold.
+    std::shared_ptr<WorkletScope> worklet = std::move(sac->worklet);
+    sac->~JsAudioContext();
+    js_free_rt(rt, sac);
+    if(worklet)
+      worklet->collect();
   }
 }
 
-static JSValue
-js_biquadfilter_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  if(argc < 1)
-    return JS_ThrowTypeError(ctx, "BiquadFilterNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
-    return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto f = std::make_shared<lab::BiquadFilterNode>(*ac);
+static JSClassDef js_audiocontext_class = {
+    .class_name = "AudioContext",
+    .finalizer = js_audiocontext_finalizer,
+};
 
-  // lab's BiquadFilterNode descriptor sets initialChannelCount=0, so the
-  // AudioNode base class doesn't add an output and any connection sourced
-  // from it would silently no-op. Add a stereo output under a graph lock.
-  if(f->numberOfOutputs() == 0) {
-    lab::ContextGraphLock gLock(ac.get(), "BiquadFilterNode.addOutput");
-    f->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(f.get(), 2)));
-  }
+// Shared BaseAudioContext-equivalent members, applied to both
+// audiocontext_proto and offlineaudiocontext_proto.
+// Defined with the node constructors it calls (see createGraph below).
+static JSValue js_audiocontext_create_graph(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]);
 
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v;
+static const JSCFunctionListEntry js_baseaudiocontext_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("sampleRate", js_audiocontext_get, 0, AC_PROP_SAMPLERATE),
+    JS_CGETSET_MAGIC_DEF("destination", js_audiocontext_get, 0, AC_PROP_DESTINATION),
+    JS_CGETSET_MAGIC_DEF("destinationNode", js_audiocontext_get, 0, AC_PROP_DESTINATION),
+    JS_CGETSET_MAGIC_DEF("listener", js_audiocontext_get, 0, AC_PROP_LISTENER),
+    JS_CGETSET_MAGIC_DEF("currentTime", js_audiocontext_get, 0, AC_PROP_CURRENTTIME),
+    JS_CGETSET_MAGIC_DEF("currentSampleFrame", js_audiocontext_get, 0, AC_PROP_CURRENTSAMPLEFRAME),
+    JS_CGETSET_MAGIC_DEF("predictedCurrentTime", js_audiocontext_get, 0, AC_PROP_PREDICTED_CURRENTTIME),
+    JS_CGETSET_MAGIC_DEF("renderQuantumSize", js_audiocontext_get, 0, AC_PROP_RENDER_QUANTUM_SIZE),
+    JS_CGETSET_MAGIC_DEF("liveNodes", js_audiocontext_get, 0, AC_PROP_LIVE_NODES),
+    JS_CGETSET_MAGIC_DEF("reclaimedNodes", js_audiocontext_get, 0, AC_PROP_RECLAIMED_NODES),
+    JS_CGETSET_DEF("renderProfiling", js_audiocontext_get_render_profiling, js_audiocontext_set_render_profiling),
+    JS_CFUNC_DEF("getRenderProfile", 0, js_audiocontext_get_render_profile),
+    JS_CFUNC_DEF("resetRenderProfile", 0, js_audiocontext_reset_render_profile),
+    JS_CGETSET_DEF("renderStats", js_audiocontext_get_render_stats, 0),
+    JS_CFUNC_DEF("resetRenderStats", 0, js_audiocontext_reset_render_stats),
+    JS_CGETSET_DEF("audioWorklet", js_audiocontext_get_audio_worklet, 0),
+    JS_CFUNC_DEF("connect", 2, js_audiocontext_connect),
+    JS_CFUNC_DEF("createGraph", 1, js_audiocontext_create_graph),
+    JS_CFUNC_DEF("decodeAudioData", 1, js_audiocontext_decode_audio_data),
+    JS_CFUNC_DEF("createBufferFromFile", 1, js_audiocontext_create_buffer_from_file),
+};
 
-    v = JS_GetPropertyStr(ctx, argv[1], "type");
-    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
-      const char* s = JS_ToCString(ctx, v);
-      if(s) {
-        f->setType(parse_filter_type(s));
-        JS_FreeCString(ctx, s);
-      }
-    }
-    JS_FreeValue(ctx, v);
+// Static members of the AudioContext constructor. The sample cache and the
+// device list are process-wide, not per context.
+static const JSCFunctionListEntry js_audiocontext_static_funcs[] = {
+    JS_CGETSET_DEF("sampleCache", js_audiocontext_sample_cache, 0),
+    JS_CGETSET_DEF("sampleCacheBudget", js_audiocontext_sample_cache_budget, js_audiocontext_set_sample_cache_budget),
+    JS_CFUNC_DEF("clearSampleCache", 0, js_audiocontext_clear_sample_cache),
+    JS_CFUNC_DEF("getDevices", 0, js_audiocontext_get_devices),
+};
 
-    v = JS_GetPropertyStr(ctx, argv[1], "frequency");
-    if(JS_IsNumber(v)) {
-      double d;
-      JS_ToFloat64(ctx, &d, v);
-      f->frequency()->setValue((float)d);
-    }
-    JS_FreeValue(ctx, v);
+// AudioContext-only.
+static const JSCFunctionListEntry js_audiocontext_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("baseLatency", js_audiocontext_get, 0, AC_PROP_BASE_LATENCY),
+    JS_CGETSET_MAGIC_DEF("outputLatency", js_audiocontext_get, 0, AC_PROP_OUTPUT_LATENCY),
+    JS_CGETSET_MAGIC_DEF("sinkId", js_audiocontext_get, 0, AC_PROP_SINK_ID),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioContext", JS_PROP_CONFIGURABLE),
+};
 
-    v = JS_GetPropertyStr(ctx, argv[1], "Q");
-    if(JS_IsNumber(v)) {
-      double d;
-      JS_ToFloat64(ctx, &d, v);
-      f->q()->setValue((float)d);
-    }
-    JS_FreeValue(ctx, v);
+// OfflineAudioContext-only: startRendering()/length have no meaning (and no
+// spec presence) on a realtime AudioContext.
+static const JSCFunctionListEntry js_offlineaudiocontext_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("length", js_audiocontext_get, 0, AC_PROP_LENGTH),
+    JS_CGETSET_MAGIC_DEF("renderedFrames", js_audiocontext_get, 0, AC_PROP_RENDERED_FRAMES),
+    JS_CFUNC_DEF("startRendering", 0, js_audiocontext_start_rendering),
+    JS_CFUNC_DEF("renderToFile", 1, js_audiocontext_render_to_file),
+    JS_CFUNC_DEF("cancelRendering", 0, js_audiocontext_cancel_rendering),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "OfflineAudioContext", JS_PROP_CONFIGURABLE),
+};
 
-    v = JS_GetPropertyStr(ctx, argv[1], "detune");
-    if(JS_IsNumber(v)) {
-      double d;
-      JS_ToFloat64(ctx, &d, v);
-      f->detune()->setValue((float)d);
-    }
-    JS_FreeValue(ctx, v);
+/* ---------- shared AudioNode methods ---------- */
 
-    v = JS_GetPropertyStr(ctx, argv[1], "gain");
-    if(JS_IsNumber(v)) {
-      double d;
-      JS_ToFloat64(ctx, &d, v);
-      f->gain()->setValue((float)d);
-    }
-    JS_FreeValue(ctx, v);
+static JSValue
+js_audionode_connect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioNode* src = any_audio_node(this_val);
+  if(!src)
+    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "connect requires a destination");
+
+  JsAudioNode* dst = any_audio_node(argv[0]);
+  if(dst) {
+    int srcIdx = 0, dstIdx = 0;
+    if(argc > 1)
+      JS_ToInt32(ctx, &srcIdx, argv[1]);
+    if(argc > 2)
+      JS_ToInt32(ctx, &dstIdx, argv[2]);
+    src->ctx->connect(dst->node, src->node, dstIdx, srcIdx);
+    return JS_DupValue(ctx, argv[0]);
   }
 
-  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
-  if(JS_IsException(proto))
-    return JS_EXCEPTION;
-  if(!JS_IsObject(proto)) {
-    JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, biquadfilternode_proto);
+  JsAudioParam* dstParam = any_audio_param(argv[0]);
+  if(dstParam) {
+    // AudioNode.connect(destinationParam, output) — no chaining return value,
+    // matching the spec (an AudioParam isn't itself connectable further).
+    int srcIdx = 0;
+    if(argc > 1)
+      JS_ToInt32(ctx, &srcIdx, argv[1]);
+    src->ctx->connectParam(dstParam->param, src->node, srcIdx);
+    return JS_UNDEFINED;
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_biquadfilternode_class_id, std::static_pointer_cast<lab::AudioNode>(f), ac);
-  JS_FreeValue(ctx, proto);
-  anchor_node_in_context(ctx, argv[0], obj);
-  return obj;
-}
 
-enum {
-  BQ_PROP_TYPE,
-  BQ_PROP_FREQUENCY,
-  BQ_PROP_Q,
-  BQ_PROP_DETUNE,
-  BQ_PROP_GAIN,
-};
+  return JS_ThrowTypeError(ctx, "destination must be an AudioNode or AudioParam");
+}
 
 static JSValue
-js_biquadfilter_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_biquadfilternode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  auto f = std::dynamic_pointer_cast<lab::BiquadFilterNode>(w->node);
-  if(!f)
-    return JS_ThrowInternalError(ctx, "not a BiquadFilterNode");
-  switch(magic) {
-    case BQ_PROP_TYPE: return JS_NewString(ctx, filter_type_to_string(f->type()));
-    case BQ_PROP_FREQUENCY: return make_audio_param_js(ctx, f->frequency());
-    case BQ_PROP_Q: return make_audio_param_js(ctx, f->q());
-    case BQ_PROP_DETUNE: return make_audio_param_js(ctx, f->detune());
-    case BQ_PROP_GAIN: return make_audio_param_js(ctx, f->gain());
+js_audionode_disconnect(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioNode* src = any_audio_node(this_val);
+  if(!src)
+    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
+  if(argc < 1) {
+    src->ctx->disconnect(src->node, 0);
+    return JS_UNDEFINED;
   }
-  return JS_UNDEFINED;
-}
 
-static JSValue
-js_biquadfilter_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_biquadfilternode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  auto f = std::dynamic_pointer_cast<lab::BiquadFilterNode>(w->node);
-  if(!f)
-    return JS_ThrowInternalError(ctx, "not a BiquadFilterNode");
-  if(magic == BQ_PROP_TYPE) {
-    const char* s = JS_ToCString(ctx, value);
-    if(s) {
-      f->setType(parse_filter_type(s));
-      JS_FreeCString(ctx, s);
-    }
+  JsAudioNode* dst = any_audio_node(argv[0]);
+  if(dst) {
+    src->ctx->disconnect(dst->node, src->node, 0, 0);
+    return JS_UNDEFINED;
   }
-  return JS_UNDEFINED;
+
+  JsAudioParam* dstParam = any_audio_param(argv[0]);
+  if(dstParam) {
+    src->ctx->disconnectParam(dstParam->param, src->node, 0);
+    return JS_UNDEFINED;
+  }
+
+  return JS_ThrowTypeError(ctx, "destination must be an AudioNode or AudioParam");
 }
 
 static void
-js_biquadfilternode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_biquadfilternode_class_id);
+js_audionode_finalizer(JSRuntime* rt, JSValue val) {
+  JsAudioNode* w = any_audio_node(val);
+  if(w) {
+    if(w->kind == js_analysernode_class_id && w->ctx)
+      w->ctx->removeAutomaticPullNode(w->node);
+    if(w->registry)
+      node_registry_release(*w->registry, w->node.get());
+    w->~JsAudioNode();
+    js_free_rt(rt, w);
+  }
 }
 
-static JSClassDef js_biquadfilternode_class = {
-    .class_name = "BiquadFilterNode",
-    .finalizer = js_biquadfilternode_finalizer,
+static JSClassDef js_audionode_class = {
+    .class_name = "AudioNode",
+    .finalizer = js_audionode_finalizer,
 };
 
+// Not in the spec: the id getRenderProfile() lists this node under; null
+// for nodes not created through a JS constructor (e.g. the destination).
 static JSValue
-js_audionode_io_count(JSContext* ctx, JSValueConst this_val, int magic) {
+js_audionode_get_node_id(JSContext* ctx, JSValueConst this_val) {
   JsAudioNode* w = any_audio_node(this_val);
   if(!w)
-    return JS_EXCEPTION;
-  return JS_NewInt32(ctx, magic == 0 ? w->node->numberOfInputs() : w->node->numberOfOutputs());
+    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
+  if(w->registry) {
+    auto it = w->registry->entries.find(w->node.get());
+    if(it != w->registry->entries.end())
+      return JS_NewUint32(ctx, it->second.id);
+  }
+  return JS_NULL;
 }
 
-static const JSCFunctionListEntry js_biquadfilternode_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("type", js_biquadfilter_get, js_biquadfilter_set, BQ_PROP_TYPE),
-    JS_CGETSET_MAGIC_DEF("frequency", js_biquadfilter_get, 0, BQ_PROP_FREQUENCY),
-    JS_CGETSET_MAGIC_DEF("Q", js_biquadfilter_get, 0, BQ_PROP_Q),
-    JS_CGETSET_MAGIC_DEF("detune", js_biquadfilter_get, 0, BQ_PROP_DETUNE),
-    JS_CGETSET_MAGIC_DEF("gain", js_biquadfilter_get, 0, BQ_PROP_GAIN),
-    JS_CGETSET_MAGIC_DEF("numberOfInputs", js_audionode_io_count, 0, 0),
-    JS_CGETSET_MAGIC_DEF("numberOfOutputs", js_audionode_io_count, 0, 1),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "BiquadFilterNode", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_audionode_funcs[] = {
+    JS_CFUNC_DEF("connect", 1, js_audionode_connect),
+    JS_CFUNC_DEF("disconnect", 0, js_audionode_disconnect),
+    JS_CGETSET_DEF("nodeId", js_audionode_get_node_id, 0),
 };
 
-/* ---------- AudioParam ---------- */
+/* ---------- shared AudioScheduledSourceNode methods ---------- */
+// start(when)/stop(when) are defined on lab::AudioScheduledSourceNode itself,
+// so Oscillator/Noise/AudioBufferSource can all share one implementation.
+// AudioBufferSourceNode overrides start() on its own proto for its extra
+// offset/loop arguments but still inherits this stop().
 
 static JSValue
-js_audioparam_get_value(JSContext* ctx, JSValueConst this_val) {
-  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+js_scheduledsource_start(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioNode* w = any_audio_node(this_val);
   if(!w)
-    return JS_EXCEPTION;
-  return JS_NewFloat64(ctx, w->param->value());
+    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
+  auto s = std::dynamic_pointer_cast<lab::AudioScheduledSourceNode>(w->node);
+  if(!s)
+    return JS_ThrowInternalError(ctx, "not a scheduled source node");
+  float when = 0.0f;
+  if(argc > 0) {
+    double t;
+    if(JS_ToFloat64(ctx, &t, argv[0]))
+      return JS_EXCEPTION;
+    when = (float)t;
+  }
+  s->start(when);
+  return JS_UNDEFINED;
 }
 
 static JSValue
-js_audioparam_set_value(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+js_scheduledsource_stop(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioNode* w = any_audio_node(this_val);
   if(!w)
-    return JS_EXCEPTION;
-  double f;
-  if(JS_ToFloat64(ctx, &f, value))
-    return JS_EXCEPTION;
-  w->param->setValue((float)f);
+    return JS_ThrowTypeError(ctx, "this is not an AudioNode");
+  auto s = std::dynamic_pointer_cast<lab::AudioScheduledSourceNode>(w->node);
+  if(!s)
+    return JS_ThrowInternalError(ctx, "not a scheduled source node");
+  float when = 0.0f;
+  if(argc > 0) {
+    double t;
+    if(JS_ToFloat64(ctx, &t, argv[0]))
+      return JS_EXCEPTION;
+    when = (float)t;
+  }
+  s->stop(when);
   return JS_UNDEFINED;
 }
 
-enum {
-  AP_METHOD_SET_VALUE_AT_TIME,
-  AP_METHOD_LINEAR_RAMP,
-  AP_METHOD_EXPONENTIAL_RAMP,
-  AP_METHOD_SET_TARGET_AT_TIME,
-  AP_METHOD_CANCEL_SCHEDULED,
+static const JSCFunctionListEntry js_audioscheduledsourcenode_funcs[] = {
+    JS_CFUNC_DEF("start", 0, js_scheduledsource_start),
+    JS_CFUNC_DEF("stop", 0, js_scheduledsource_stop),
 };
 
+/* ---------- AudioDestinationNode ---------- */
+
 static JSValue
-js_audioparam_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
-  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+js_audiodestinationnode_get_name(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_audiodestinationnode_class_id);
   if(!w)
     return JS_EXCEPTION;
+  return JS_NewString(ctx, w->node->name());
+}
 
-  double a = 0, b = 0, c = 0;
-  switch(magic) {
-    case AP_METHOD_CANCEL_SCHEDULED: {
-      if(argc < 1)
-        return JS_ThrowTypeError(ctx, "cancelScheduledValues requires (startTime)");
-      if(JS_ToFloat64(ctx, &a, argv[0]))
-        return JS_EXCEPTION;
-      w->param->cancelScheduledValues((float)a);
-      break;
-    }
-    case AP_METHOD_SET_VALUE_AT_TIME:
-    case AP_METHOD_LINEAR_RAMP:
-    case AP_METHOD_EXPONENTIAL_RAMP: {
-      if(argc < 2)
-        return JS_ThrowTypeError(ctx, "method requires (value, time)");
-      if(JS_ToFloat64(ctx, &a, argv[0]))
-        return JS_EXCEPTION;
-      if(JS_ToFloat64(ctx, &b, argv[1]))
-        return JS_EXCEPTION;
-      if(magic == AP_METHOD_SET_VALUE_AT_TIME)
-        w->param->setValueAtTime((float)a, (float)b);
-      else if(magic == AP_METHOD_LINEAR_RAMP)
-        w->param->linearRampToValueAtTime((float)a, (float)b);
-      else
-        w->param->exponentialRampToValueAtTime((float)a, (float)b);
-      break;
+static JSValue
+js_audiodestinationnode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  return JS_ThrowTypeError(ctx, "use AudioContext.destination instead");
+}
+
+static const JSCFunctionListEntry js_audiodestinationnode_funcs[] = {
+    JS_CGETSET_DEF("name", js_audiodestinationnode_get_name, NULL),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioDestinationNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- OscillatorNode ---------- */
+
+static lab::OscillatorType
+parse_oscillator_type(const char* s) {
+  if(!s)
+    return lab::OscillatorType::SINE;
+  if(!strcmp(s, "sine"))
+    return lab::OscillatorType::SINE;
+  if(!strcmp(s, "square"))
+    return lab::OscillatorType::SQUARE;
+  if(!strcmp(s, "sawtooth"))
+    return lab::OscillatorType::SAWTOOTH;
+  if(!strcmp(s, "triangle"))
+    return lab::OscillatorType::TRIANGLE;
+  if(!strcmp(s, "fast-sine"))
+    return lab::OscillatorType::FAST_SINE;
+  if(!strcmp(s, "falling-sawtooth"))
+    return lab::OscillatorType::FALLING_SAWTOOTH;
+  return lab::OscillatorType::SINE;
+}
+
+static const char*
+osc_type_to_string(lab::OscillatorType t) {
+  switch(t) {
+    case lab::OscillatorType::SINE: return "sine";
+    case lab::OscillatorType::FAST_SINE: return "fast-sine";
+    case lab::OscillatorType::SQUARE: return "square";
+    case lab::OscillatorType::SAWTOOTH: return "sawtooth";
+    case lab::OscillatorType::FALLING_SAWTOOTH: return "falling-sawtooth";
+    case lab::OscillatorType::TRIANGLE: return "triangle";
+    case lab::OscillatorType::CUSTOM: return "custom";
+    default: return "sine";
+  }
+}
+
+static JSValue
+js_oscillator_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "OscillatorNode requires an AudioContext");
+
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+
+  auto osc = std::make_shared<lab::OscillatorNode>(*ac);
+
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v;
+
+    v = JS_GetPropertyStr(ctx, argv[1], "type");
+    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
+      const char* s = JS_ToCString(ctx, v);
+      if(s) {
+        osc->setType(parse_oscillator_type(s));
+        JS_FreeCString(ctx, s);
+      }
     }
-    case AP_METHOD_SET_TARGET_AT_TIME: {
-      if(argc < 3)
-        return JS_ThrowTypeError(ctx, "setTargetAtTime requires (target, time, timeConstant)");
-      if(JS_ToFloat64(ctx, &a, argv[0]))
-        return JS_EXCEPTION;
-      if(JS_ToFloat64(ctx, &b, argv[1]))
-        return JS_EXCEPTION;
-      if(JS_ToFloat64(ctx, &c, argv[2]))
-        return JS_EXCEPTION;
-      w->param->setTargetAtTime((float)a, (float)b, (float)c);
-      break;
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "frequency");
+    if(JS_IsNumber(v)) {
+      double f;
+      JS_ToFloat64(ctx, &f, v);
+      osc->frequency()->setValue((float)f);
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "detune");
+    if(JS_IsNumber(v)) {
+      double d;
+      JS_ToFloat64(ctx, &d, v);
+      osc->detune()->setValue((float)d);
     }
+    JS_FreeValue(ctx, v);
   }
-  return JS_DupValue(ctx, this_val);
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, oscillatornode_proto);
+  }
+
+  JSValue obj = make_audio_node_js(ctx, proto, js_oscillatornode_class_id, std::static_pointer_cast<lab::AudioNode>(osc), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
 }
 
 enum {
-  AP_PROP_NAME,
-  AP_PROP_MIN,
-  AP_PROP_MAX,
-  AP_PROP_DEFAULT,
+  OSC_PROP_TYPE,
+  OSC_PROP_FREQUENCY,
+  OSC_PROP_DETUNE,
 };
 
 static JSValue
-js_audioparam_get_meta(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+js_oscillator_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_oscillatornode_class_id);
   if(!w)
     return JS_EXCEPTION;
+  auto osc = std::dynamic_pointer_cast<lab::OscillatorNode>(w->node);
+  if(!osc)
+    return JS_ThrowInternalError(ctx, "not an OscillatorNode");
   switch(magic) {
-    case AP_PROP_NAME: return JS_NewString(ctx, w->param->name().c_str());
-    case AP_PROP_MIN: return JS_NewFloat64(ctx, w->param->minValue());
-    case AP_PROP_MAX: return JS_NewFloat64(ctx, w->param->maxValue());
-    case AP_PROP_DEFAULT: return JS_NewFloat64(ctx, w->param->defaultValue());
+    case OSC_PROP_TYPE: return JS_NewString(ctx, osc_type_to_string(osc->type()));
+    case OSC_PROP_FREQUENCY: return make_audio_param_js(ctx, osc->frequency());
+    case OSC_PROP_DETUNE: return make_audio_param_js(ctx, osc->detune());
+  }
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_oscillator_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_oscillatornode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto osc = std::dynamic_pointer_cast<lab::OscillatorNode>(w->node);
+  if(!osc)
+    return JS_ThrowInternalError(ctx, "not an OscillatorNode");
+  if(magic == OSC_PROP_TYPE) {
+    const char* s = JS_ToCString(ctx, value);
+    if(s) {
+      osc->setType(parse_oscillator_type(s));
+      JS_FreeCString(ctx, s);
+    }
   }
   return JS_UNDEFINED;
 }
 
-static void
-js_audioparam_finalizer(JSRuntime* rt, JSValue val) {
-  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque(val, js_audioparam_class_id));
-  if(w) {
-    w->~JsAudioParam();
-    js_free_rt(rt, w);
+static const JSCFunctionListEntry js_oscillatornode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("type", js_oscillator_get, js_oscillator_set, OSC_PROP_TYPE),
+    JS_CGETSET_MAGIC_DEF("frequency", js_oscillator_get, 0, OSC_PROP_FREQUENCY),
+    JS_CGETSET_MAGIC_DEF("detune", js_oscillator_get, 0, OSC_PROP_DETUNE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "OscillatorNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- GainNode ---------- */
+
+static JSValue
+js_gain_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "GainNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+  auto g = std::make_shared<lab::GainNode>(*ac);
+
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "gain");
+    if(JS_IsNumber(v)) {
+      double f;
+      JS_ToFloat64(ctx, &f, v);
+      g->gain()->setValue((float)f);
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, gainnode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_gainnode_class_id, std::static_pointer_cast<lab::AudioNode>(g), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
+
+static JSValue
+js_gain_get_gain(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_gainnode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto g = std::dynamic_pointer_cast<lab::GainNode>(w->node);
+  if(!g)
+    return JS_ThrowInternalError(ctx, "not a GainNode");
+  return make_audio_param_js(ctx, g->gain());
+}
+
+static const JSCFunctionListEntry js_gainnode_funcs[] = {
+    JS_CGETSET_DEF("gain", js_gain_get_gain, NULL),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "GainNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- BiquadFilterNode ---------- */
+
+static lab::FilterType
+parse_filter_type(const char* s) {
+  if(!s)
+    return lab::FilterType::LOWPASS;
+  if(!strcmp(s, "lowpass"))
+    return lab::FilterType::LOWPASS;
+  if(!strcmp(s, "highpass"))
+    return lab::FilterType::HIGHPASS;
+  if(!strcmp(s, "bandpass"))
+    return lab::FilterType::BANDPASS;
+  if(!strcmp(s, "lowshelf"))
+    return lab::FilterType::LOWSHELF;
+  if(!strcmp(s, "highshelf"))
+    return lab::FilterType::HIGHSHELF;
+  if(!strcmp(s, "peaking"))
+    return lab::FilterType::PEAKING;
+  if(!strcmp(s, "notch"))
+    return lab::FilterType::NOTCH;
+  if(!strcmp(s, "allpass"))
+    return lab::FilterType::ALLPASS;
+  return lab::FilterType::LOWPASS;
+}
+
+static const char*
+filter_type_to_string(lab::FilterType t) {
+  switch(t) {
+    case lab::FilterType::LOWPASS: return "lowpass";
+    case lab::FilterType::HIGHPASS: return "highpass";
+    case lab::FilterType::BANDPASS: return "bandpass";
+    case lab::FilterType::LOWSHELF: return "lowshelf";
+    case lab::FilterType::HIGHSHELF: return "highshelf";
+    case lab::FilterType::PEAKING: return "peaking";
+    case lab::FilterType::NOTCH: return "notch";
+    case lab::FilterType::ALLPASS: return "allpass";
+    default: return "lowpass";
+  }
+}
+
+static JSValue
+js_biquadfilter_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "BiquadFilterNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+  auto f = std::make_shared<lab::BiquadFilterNode>(*ac);
+
+  // lab's BiquadFilterNode descriptor sets initialChannelCount=0, so the
+  // AudioNode base class doesn't add an output and any connection sourced
+  // from it would silently no-op. Add a stereo output under a graph lock.
+  if(f->numberOfOutputs() == 0) {
+    lab::ContextGraphLock gLock(ac.get(), "BiquadFilterNode.addOutput");
+    f->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(f.get(), 2)));
+  }
+
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v;
+
+    v = JS_GetPropertyStr(ctx, argv[1], "type");
+    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
+      const char* s = JS_ToCString(ctx, v);
+      if(s) {
+        f->setType(parse_filter_type(s));
+        JS_FreeCString(ctx, s);
+      }
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "frequency");
+    if(JS_IsNumber(v)) {
+      double d;
+      JS_ToFloat64(ctx, &d, v);
+      f->frequency()->setValue((float)d);
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "Q");
+    if(JS_IsNumber(v)) {
+      double d;
+      JS_ToFloat64(ctx, &d, v);
+      f->q()->setValue((float)d);
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "detune");
+    if(JS_IsNumber(v)) {
+      double d;
+      JS_ToFloat64(ctx, &d, v);
+      f->detune()->setValue((float)d);
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "gain");
+    if(JS_IsNumber(v)) {
+      double d;
+      JS_ToFloat64(ctx, &d, v);
+      f->gain()->setValue((float)d);
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, biquadfilternode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_biquadfilternode_class_id, std::static_pointer_cast<lab::AudioNode>(f), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
+
+enum {
+  BQ_PROP_TYPE,
+  BQ_PROP_FREQUENCY,
+  BQ_PROP_Q,
+  BQ_PROP_DETUNE,
+  BQ_PROP_GAIN,
+};
+
+static JSValue
+js_biquadfilter_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_biquadfilternode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto f = std::dynamic_pointer_cast<lab::BiquadFilterNode>(w->node);
+  if(!f)
+    return JS_ThrowInternalError(ctx, "not a BiquadFilterNode");
+  switch(magic) {
+    case BQ_PROP_TYPE: return JS_NewString(ctx, filter_type_to_string(f->type()));
+    case BQ_PROP_FREQUENCY: return make_audio_param_js(ctx, f->frequency());
+    case BQ_PROP_Q: return make_audio_param_js(ctx, f->q());
+    case BQ_PROP_DETUNE: return make_audio_param_js(ctx, f->detune());
+    case BQ_PROP_GAIN: return make_audio_param_js(ctx, f->gain());
+  }
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_biquadfilter_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_biquadfilternode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto f = std::dynamic_pointer_cast<lab::BiquadFilterNode>(w->node);
+  if(!f)
+    return JS_ThrowInternalError(ctx, "not a BiquadFilterNode");
+  if(magic == BQ_PROP_TYPE) {
+    const char* s = JS_ToCString(ctx, value);
+    if(s) {
+      f->setType(parse_filter_type(s));
+      JS_FreeCString(ctx, s);
+    }
+  }
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_audionode_io_count(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w = any_audio_node(this_val);
+  if(!w)
+    return JS_EXCEPTION;
+  return JS_NewInt32(ctx, magic == 0 ? w->node->numberOfInputs() : w->node->numberOfOutputs());
+}
+
+static const JSCFunctionListEntry js_biquadfilternode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("type", js_biquadfilter_get, js_biquadfilter_set, BQ_PROP_TYPE),
+    JS_CGETSET_MAGIC_DEF("frequency", js_biquadfilter_get, 0, BQ_PROP_FREQUENCY),
+    JS_CGETSET_MAGIC_DEF("Q", js_biquadfilter_get, 0, BQ_PROP_Q),
+    JS_CGETSET_MAGIC_DEF("detune", js_biquadfilter_get, 0, BQ_PROP_DETUNE),
+    JS_CGETSET_MAGIC_DEF("gain", js_biquadfilter_get, 0, BQ_PROP_GAIN),
+    JS_CGETSET_MAGIC_DEF("numberOfInputs", js_audionode_io_count, 0, 0),
+    JS_CGETSET_MAGIC_DEF("numberOfOutputs", js_audionode_io_count, 0, 1),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "BiquadFilterNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioParam ---------- */
+
+static JSValue
+js_audioparam_get_value(JSContext* ctx, JSValueConst this_val) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+  return JS_NewFloat64(ctx, w->param->value());
+}
+
+static JSValue
+js_audioparam_set_value(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+  double f;
+  if(JS_ToFloat64(ctx, &f, value))
+    return JS_EXCEPTION;
+  w->param->setValue((float)f);
+  return JS_UNDEFINED;
+}
+
+// Also the op codes of schedule()'s packed records, so keep the order.
+enum {
+  AP_METHOD_SET_VALUE_AT_TIME,
+  AP_METHOD_LINEAR_RAMP,
+  AP_METHOD_EXPONENTIAL_RAMP,
+  AP_METHOD_SET_TARGET_AT_TIME,
+  AP_METHOD_CANCEL_SCHEDULED,
+  AP_METHOD_COUNT,
+};
+
+static void
+audioparam_apply(lab::AudioParam& param, int op, double a, double b, double c) {
+  switch(op) {
+    case AP_METHOD_SET_VALUE_AT_TIME: param.setValueAtTime((float)a, (float)b); break;
+    case AP_METHOD_LINEAR_RAMP: param.linearRampToValueAtTime((float)a, (float)b); break;
+    case AP_METHOD_EXPONENTIAL_RAMP: param.exponentialRampToValueAtTime((float)a, (float)b); break;
+    case AP_METHOD_SET_TARGET_AT_TIME: param.setTargetAtTime((float)a, (float)b, (float)c); break;
+    case AP_METHOD_CANCEL_SCHEDULED: param.cancelScheduledValues((float)b); break;
+  }
+}
+
+static JSValue
+js_audioparam_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+
+  double a = 0, b = 0, c = 0;
+  switch(magic) {
+    case AP_METHOD_CANCEL_SCHEDULED: {
+      if(argc < 1)
+        return JS_ThrowTypeError(ctx, "cancelScheduledValues requires (startTime)");
+      if(JS_ToFloat64(ctx, &b, argv[0]))
+        return JS_EXCEPTION;
+      break;
+    }
+    case AP_METHOD_SET_VALUE_AT_TIME:
+    case AP_METHOD_LINEAR_RAMP:
+    case AP_METHOD_EXPONENTIAL_RAMP: {
+      if(argc < 2)
+        return JS_ThrowTypeError(ctx, "method requires (value, time)");
+      if(JS_ToFloat64(ctx, &a, argv[0]))
+        return JS_EXCEPTION;
+      if(JS_ToFloat64(ctx, &b, argv[1]))
+        return JS_EXCEPTION;
+      break;
+    }
+    case AP_METHOD_SET_TARGET_AT_TIME: {
+      if(argc < 3)
+        return JS_ThrowTypeError(ctx, "setTargetAtTime requires (target, time, timeConstant)");
+      if(JS_ToFloat64(ctx, &a, argv[0]))
+        return JS_EXCEPTION;
+      if(JS_ToFloat64(ctx, &b, argv[1]))
+        return JS_EXCEPTION;
+      if(JS_ToFloat64(ctx, &c, argv[2]))
+        return JS_EXCEPTION;
+      break;
+    }
+  }
+  audioparam_apply(*w->param, magic, a, b, c);
+  return JS_DupValue(ctx, this_val);
+}
+
+static JSValue
+js_audioparam_set_value_curve(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+  if(argc < 3)
+    return JS_ThrowTypeError(ctx, "setValueCurveAtTime requires (values, startTime, duration)");
+
+  std::vector<float> curve;
+  if(read_float_array(ctx, argv[0], curve) < 0)
+    return JS_ThrowTypeError(ctx, "values must be a Float32Array or array of numbers");
+  if(curve.size() < 2)
+    return JS_ThrowRangeError(ctx, "setValueCurveAtTime: values must have at least 2 entries");
+  double startTime, duration;
+  if(JS_ToFloat64(ctx, &startTime, argv[1]) || JS_ToFloat64(ctx, &duration, argv[2]))
+    return JS_EXCEPTION;
+  if(!(startTime >= 0))
+    return JS_ThrowRangeError(ctx, "setValueCurveAtTime: startTime must be >= 0");
+  if(!(duration > 0))
+    return JS_ThrowRangeError(ctx, "setValueCurveAtTime: duration must be > 0");
+  w->param->setValueCurveAtTime(std::move(curve), (float)startTime, (float)duration);
+  return JS_DupValue(ctx, this_val);
+}
+
+// Not in the spec: schedule(events[, count]) applies a whole automation
+// sequence in one call. `events` is a Float64Array of packed 4-double
+// records [op, value, time, timeConstant], op being one of the AudioParam
+// constants SET_VALUE_AT_TIME, LINEAR_RAMP, EXPONENTIAL_RAMP,
+// SET_TARGET_AT_TIME, CANCEL_SCHEDULED (value/timeConstant unused where the
+// method has none). `count` limits it to the first records, so one array
+// can be reused. Records are all checked before any is applied.
+static JSValue
+js_audioparam_schedule(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "schedule requires a Float64Array");
+
+  // count first: its valueOf() could detach the array.
+  uint32_t n = UINT32_MAX;
+  bool limited = argc > 1 && !JS_IsUndefined(argv[1]);
+  if(limited && JS_ToUint32(ctx, &n, argv[1]))
+    return JS_EXCEPTION;
+  size_t count = 0;
+  const double* events = float_array_data<double>(ctx, argv[0], &count, "events");
+  if(!events)
+    return JS_EXCEPTION;
+  count /= 4;
+  if(limited) {
+    if(n > count)
+      return JS_ThrowRangeError(ctx, "schedule: count exceeds the records in events");
+    count = n;
+  }
+
+  for(size_t i = 0; i < count; i++) {
+    const double* e = events + i * 4;
+    if(!(e[0] >= 0 && e[0] < double(AP_METHOD_COUNT)) || e[0] != int(e[0]))
+      return JS_ThrowRangeError(ctx, "schedule: bad op %g in record %zu", e[0], i);
+    if(!(e[2] >= 0))
+      return JS_ThrowRangeError(ctx, "schedule: negative time in record %zu", i);
+  }
+  for(size_t i = 0; i < count; i++) {
+    const double* e = events + i * 4;
+    audioparam_apply(*w->param, int(e[0]), e[1], e[2], e[3]);
+  }
+  return JS_DupValue(ctx, this_val);
+}
+
+enum {
+  AP_PROP_NAME,
+  AP_PROP_MIN,
+  AP_PROP_MAX,
+  AP_PROP_DEFAULT,
+};
+
+static JSValue
+js_audioparam_get_meta(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque2(ctx, this_val, js_audioparam_class_id));
+  if(!w)
+    return JS_EXCEPTION;
+  switch(magic) {
+    case AP_PROP_NAME: return JS_NewString(ctx, w->param->name().c_str());
+    case AP_PROP_MIN: return JS_NewFloat64(ctx, w->param->minValue());
+    case AP_PROP_MAX: return JS_NewFloat64(ctx, w->param->maxValue());
+    case AP_PROP_DEFAULT: return JS_NewFloat64(ctx, w->param->defaultValue());
+  }
+  return JS_UNDEFINED;
+}
+
+static void
+js_audioparam_finalizer(JSRuntime* rt, JSValue val) {
+  JsAudioParam* w = static_cast<JsAudioParam*>(JS_GetOpaque(val, js_audioparam_class_id));
+  if(w) {
+    w->~JsAudioParam();
+    js_free_rt(rt, w);
+  }
+}
+
+static JSClassDef js_audioparam_class = {
+    .class_name = "AudioParam",
+    .finalizer = js_audioparam_finalizer,
+};
+
+static const JSCFunctionListEntry js_audioparam_funcs[] = {
+    JS_CGETSET_DEF("value", js_audioparam_get_value, js_audioparam_set_value),
+    JS_CGETSET_MAGIC_DEF("name", js_audioparam_get_meta, 0, AP_PROP_NAME),
+    JS_CGETSET_MAGIC_DEF("minValue", js_audioparam_get_meta, 0, AP_PROP_MIN),
+    JS_CGETSET_MAGIC_DEF("maxValue", js_audioparam_get_meta, 0, AP_PROP_MAX),
+    JS_CGETSET_MAGIC_DEF("defaultValue", js_audioparam_get_meta, 0, AP_PROP_DEFAULT),
+    JS_CFUNC_MAGIC_DEF("setValueAtTime", 2, js_audioparam_method, AP_METHOD_SET_VALUE_AT_TIME),
+    JS_CFUNC_MAGIC_DEF("linearRampToValueAtTime", 2, js_audioparam_method, AP_METHOD_LINEAR_RAMP),
+    JS_CFUNC_MAGIC_DEF("exponentialRampToValueAtTime", 2, js_audioparam_method, AP_METHOD_EXPONENTIAL_RAMP),
+    JS_CFUNC_MAGIC_DEF("setTargetAtTime", 3, js_audioparam_method, AP_METHOD_SET_TARGET_AT_TIME),
+    JS_CFUNC_MAGIC_DEF("cancelScheduledValues", 1, js_audioparam_method, AP_METHOD_CANCEL_SCHEDULED),
+    JS_CFUNC_DEF("setValueCurveAtTime", 3, js_audioparam_set_value_curve),
+    JS_CFUNC_DEF("schedule", 1, js_audioparam_schedule),
+    JS_PROP_INT32_DEF("SET_VALUE_AT_TIME", AP_METHOD_SET_VALUE_AT_TIME, 0),
+    JS_PROP_INT32_DEF("LINEAR_RAMP", AP_METHOD_LINEAR_RAMP, 0),
+    JS_PROP_INT32_DEF("EXPONENTIAL_RAMP", AP_METHOD_EXPONENTIAL_RAMP, 0),
+    JS_PROP_INT32_DEF("SET_TARGET_AT_TIME", AP_METHOD_SET_TARGET_AT_TIME, 0),
+    JS_PROP_INT32_DEF("CANCEL_SCHEDULED", AP_METHOD_CANCEL_SCHEDULED, 0),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioParam", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioListener (kept minimal) ---------- */
+
+static JSValue
+js_audiolistener_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue proto, obj = JS_UNDEFINED;
+  auto* sal = static_cast<AudioListenerPtr*>(js_mallocz(ctx, sizeof(AudioListenerPtr)));
+  new(sal) AudioListenerPtr(std::make_shared<lab::AudioListener>());
+
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+  if(!JS_IsObject(proto))
+    proto = JS_DupValue(ctx, audiolistener_proto);
+  obj = JS_NewObjectProtoClass(ctx, proto, js_audiolistener_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+  JS_SetOpaque(obj, sal);
+  return obj;
+
+fail:
+  sal->~AudioListenerPtr();
+  js_free(ctx, sal);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+static void
+js_audiolistener_finalizer(JSRuntime* rt, JSValue val) {
+  AudioListenerPtr* sal = static_cast<AudioListenerPtr*>(JS_GetOpaque(val, js_audiolistener_class_id));
+  if(sal) {
+    sal->~AudioListenerPtr();
+    js_free_rt(rt, sal);
+  }
+}
+
+static JSClassDef js_audiolistener_class = {
+    .class_name = "AudioListener",
+    .finalizer = js_audiolistener_finalizer,
+};
+
+static const JSCFunctionListEntry js_audiolistener_funcs[] = {
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioListener", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioDevice (kept) ---------- */
+
+static JSValue
+js_audiodevice_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  JSValue proto, obj = JS_UNDEFINED;
+  auto cfg = get_default_device_config();
+  auto* sad = static_cast<AudioDevicePtr*>(js_mallocz(ctx, sizeof(AudioDevicePtr)));
+  new(sad) AudioDevicePtr(std::make_shared<lab::AudioDevice_RtAudio>(cfg.first, cfg.second));
+
+  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    goto fail;
+  if(!JS_IsObject(proto))
+    proto = JS_DupValue(ctx, audiodevice_proto);
+  obj = JS_NewObjectProtoClass(ctx, proto, js_audiodevice_class_id);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    goto fail;
+  JS_SetOpaque(obj, sad);
+  return obj;
+
+fail:
+  sad->~AudioDevicePtr();
+  js_free(ctx, sad);
+  JS_FreeValue(ctx, obj);
+  return JS_EXCEPTION;
+}
+
+enum { DEVICE_DESTINATION_NODE };
+
+static JSValue
+js_audiodevice_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  AudioDevicePtr* sad = static_cast<AudioDevicePtr*>(JS_GetOpaque2(ctx, this_val, js_audiodevice_class_id));
+  if(!sad)
+    return JS_EXCEPTION;
+  if(magic == DEVICE_DESTINATION_NODE) {
+    JsAudioNode* w = get_audio_node(ctx, value, js_audiodestinationnode_class_id);
+    if(!w)
+      return JS_ThrowInternalError(ctx, "value must be AudioDestinationNode");
+    auto dest = std::dynamic_pointer_cast<lab::AudioDestinationNode>(w->node);
+    if(!dest)
+      return JS_ThrowInternalError(ctx, "value must be AudioDestinationNode");
+    (*sad)->setDestinationNode(dest);
+  }
+  return JS_UNDEFINED;
+}
+
+static void
+js_audiodevice_finalizer(JSRuntime* rt, JSValue val) {
+  AudioDevicePtr* sad = static_cast<AudioDevicePtr*>(JS_GetOpaque(val, js_audiodevice_class_id));
+  if(sad) {
+    sad->~AudioDevicePtr();
+    js_free_rt(rt, sad);
+  }
+}
+
+static JSClassDef js_audiodevice_class = {
+    .class_name = "AudioDevice",
+    .finalizer = js_audiodevice_finalizer,
+};
+
+static const JSCFunctionListEntry js_audiodevice_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("destinationNode", 0, js_audiodevice_set, DEVICE_DESTINATION_NODE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioDevice", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioBuffer ---------- */
+
+enum {
+  AB_PROP_DURATION,
+  AB_PROP_SAMPLERATE,
+  AB_PROP_NUMCHANNELS,
+  AB_PROP_LENGTH,
+};
+
+static JSValue
+js_audiobuffer_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
+  if(!w || !w->bus)
+    return JS_EXCEPTION;
+  switch(magic) {
+    case AB_PROP_DURATION: return JS_NewFloat64(ctx, double(w->bus->length()) / w->bus->sampleRate());
+    case AB_PROP_SAMPLERATE: return JS_NewFloat64(ctx, w->bus->sampleRate());
+    case AB_PROP_NUMCHANNELS: return JS_NewInt32(ctx, w->bus->numberOfChannels());
+    case AB_PROP_LENGTH: return JS_NewInt32(ctx, w->bus->length());
+  }
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_audiobuffer_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1 || !JS_IsObject(argv[0]))
+    return JS_ThrowTypeError(ctx, "AudioBuffer requires {numberOfChannels, length, sampleRate}");
+
+  int32_t numberOfChannels = 1, length = 0;
+  double sampleRate = 44100;
+
+  JSValue v = JS_GetPropertyStr(ctx, argv[0], "numberOfChannels");
+  if(JS_IsNumber(v))
+    JS_ToInt32(ctx, &numberOfChannels, v);
+  JS_FreeValue(ctx, v);
+
+  v = JS_GetPropertyStr(ctx, argv[0], "length");
+  if(JS_IsNumber(v))
+    JS_ToInt32(ctx, &length, v);
+  JS_FreeValue(ctx, v);
+
+  v = JS_GetPropertyStr(ctx, argv[0], "sampleRate");
+  if(JS_IsNumber(v))
+    JS_ToFloat64(ctx, &sampleRate, v);
+  JS_FreeValue(ctx, v);
+
+  if(length <= 0)
+    return JS_ThrowTypeError(ctx, "AudioBuffer requires a positive length");
+  if(numberOfChannels <= 0)
+    return JS_ThrowTypeError(ctx, "AudioBuffer requires numberOfChannels >= 1");
+
+  auto bus = std::make_shared<lab::AudioBus>(numberOfChannels, length, true);
+  bus->setSampleRate(static_cast<float>(sampleRate));
+  return make_audio_buffer_js(ctx, bus);
+}
+
+enum {
+  AB_METHOD_GET_CHANNEL_DATA,
+  AB_METHOD_COPY_TO_CHANNEL,
+  AB_METHOD_COPY_FROM_CHANNEL,
+};
+
+static JSValue
+js_audiobuffer_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
+  if(!w || !w->bus)
+    return JS_EXCEPTION;
+
+  switch(magic) {
+    case AB_METHOD_GET_CHANNEL_DATA: {
+      // getChannelData(channel)
+      if(argc < 1)
+        return JS_ThrowTypeError(ctx, "channel index required");
+      int32_t channel = 0;
+      JS_ToInt32(ctx, &channel, argv[0]);
+      if(channel < 0 || channel >= w->bus->numberOfChannels())
+        return JS_ThrowRangeError(ctx, "channel index out of range");
+      return make_channel_view(ctx, w, channel);
+    }
+
+    case AB_METHOD_COPY_TO_CHANNEL: {
+      // copyToChannel(source, channelNumber, startInChannel = 0)
+      if(argc < 2)
+        return JS_ThrowTypeError(ctx, "copyToChannel requires (source, channelNumber)");
+      int32_t channel = 0;
+      JS_ToInt32(ctx, &channel, argv[1]);
+      if(channel < 0 || channel >= w->bus->numberOfChannels())
+        return JS_ThrowRangeError(ctx, "channel index out of range");
+      std::vector<float> src;
+      if(read_float_array(ctx, argv[0], src) != 0)
+        return JS_ThrowTypeError(ctx, "source must be a Float32Array or array-like");
+      int32_t startInChannel = 0;
+      if(argc > 2)
+        JS_ToInt32(ctx, &startInChannel, argv[2]);
+      audio_buffer_make_writable(w);
+      lab::AudioChannel* ch = w->bus->channel(channel);
+      if(startInChannel < 0 || startInChannel > ch->length())
+        return JS_ThrowRangeError(ctx, "startInChannel out of range");
+      size_t count = std::min(src.size(), size_t(ch->length() - startInChannel));
+      memcpy(ch->mutableData() + startInChannel, src.data(), count * sizeof(float));
+      return JS_UNDEFINED;
+    }
+
+    case AB_METHOD_COPY_FROM_CHANNEL: {
+      // copyFromChannel(destination, channelNumber, startInChannel = 0)
+      if(argc < 2)
+        return JS_ThrowTypeError(ctx, "copyFromChannel requires (destination, channelNumber)");
+      int32_t channel = 0;
+      JS_ToInt32(ctx, &channel, argv[1]);
+      if(channel < 0 || channel >= w->bus->numberOfChannels())
+        return JS_ThrowRangeError(ctx, "channel index out of range");
+      lab::AudioChannel* ch = w->bus->channel(channel);
+      size_t byte_offset = 0, byte_length = 0, bytes_per_element = 0;
+      JSValue buf = JS_GetTypedArrayBuffer(ctx, argv[0], &byte_offset, &byte_length, &bytes_per_element);
+      if(JS_IsException(buf) || bytes_per_element != sizeof(float))
+        return JS_ThrowTypeError(ctx, "destination must be a Float32Array");
+      size_t ab_size = 0;
+      uint8_t* ab_data = JS_GetArrayBuffer(ctx, &ab_size, buf);
+      JS_FreeValue(ctx, buf);
+      if(!ab_data)
+        return JS_EXCEPTION;
+      int32_t startInChannel = 0;
+      if(argc > 2)
+        JS_ToInt32(ctx, &startInChannel, argv[2]);
+      if(startInChannel < 0 || startInChannel > ch->length())
+        return JS_ThrowRangeError(ctx, "startInChannel out of range");
+      size_t destCount = byte_length / sizeof(float);
+      size_t count = std::min(destCount, size_t(ch->length() - startInChannel));
+      memcpy(reinterpret_cast<float*>(ab_data + byte_offset), ch->data() + startInChannel, count * sizeof(float));
+      return JS_UNDEFINED;
+    }
+  }
+  return JS_UNDEFINED;
+}
+
+static JSValue
+js_audiobuffer_write_wav(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
+  if(!w || !w->bus)
+    return JS_EXCEPTION;
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "writeToWav requires a file path");
+  const char* path = JS_ToCString(ctx, argv[0]);
+  if(!path)
+    return JS_EXCEPTION;
+  bool mixToMono = argc > 1 ? JS_ToBool(ctx, argv[1]) : false;
+  bool ok = write_bus_to_wav(w->bus.get(), path, mixToMono);
+  JS_FreeCString(ctx, path);
+  if(!ok)
+    return JS_ThrowInternalError(ctx, "writeToWav: failed to write file");
+  return JS_UNDEFINED;
+}
+
+// spectrogram({fftSize = 2048, hop = fftSize / 4, window = 'hann', channel})
+// -> Promise<Float32Array>. Not in the spec: the STFT (spectrogram.hpp) of
+// the whole buffer, frame-major with fftSize / 2 + 1 linear magnitudes per
+// frame, so frames = result.length / (fftSize / 2 + 1). `channel` picks one
+// channel; by default they're mixed down. The frames are split into
+// segments across the worker pool, all writing into the one result.
+static void
+js_spectrogram_free(JSRuntime* rt, void* opaque, void* ptr) {
+  delete static_cast<std::vector<float>*>(opaque);
+}
+
+struct SpectrogramTask : AsyncTask {
+  std::unique_ptr<Spectrogram> stft;
+  std::vector<float>* result = nullptr;
+  std::atomic<int> remaining{0};
+
+  ~SpectrogramTask() {
+    delete result;
+  }
+
+  JSValue
+  settle(JSContext* ctx) override {
+    std::vector<float>* data = result;
+    result = nullptr;
+    JSValue ab = JS_NewArrayBuffer(ctx, reinterpret_cast<uint8_t*>(data->data()), data->size() * sizeof(float), js_spectrogram_free, data, false);
+    if(JS_IsException(ab))
+      delete data;
+    return make_float32_array_from(ctx, ab);
+  }
+};
+
+static const struct {
+  const char* name;
+  lab::WindowType type;
+} spectrogram_windows[] = {
+    {"rectangle", lab::window_rectangle},
+    {"hann", lab::window_hann},
+    {"hamming", lab::window_hamming},
+    {"blackman", lab::window_blackman},
+    {"blackman-harris", lab::window_blackman_harris},
+    {"nuttall", lab::window_nuttall},
+    {"flat-top", lab::window_flat_top},
+};
+
+static JSValue
+js_audiobuffer_spectrogram(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
+  if(!w || !w->bus)
+    return JS_EXCEPTION;
+
+  int32_t fftSize = 2048, hop = 0, channel = -1;
+  lab::WindowType window = lab::window_hann;
+  if(argc > 0 && JS_IsObject(argv[0])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[0], "fftSize");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &fftSize, v);
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[0], "hop");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &hop, v);
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[0], "channel");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &channel, v);
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[0], "window");
+    if(JS_IsString(v)) {
+      const char* s = JS_ToCString(ctx, v);
+      bool found = false;
+      for(auto& win : spectrogram_windows)
+        if(s && !strcmp(s, win.name)) {
+          window = win.type;
+          found = true;
+        }
+      if(s && !found)
+        JS_ThrowRangeError(ctx, "spectrogram: unknown window '%s'", s);
+      JS_FreeCString(ctx, s);
+      if(!found) {
+        JS_FreeValue(ctx, v);
+        return JS_EXCEPTION;
+      }
+    }
+    JS_FreeValue(ctx, v);
+  }
+  if(fftSize < 32 || fftSize > 32768 || (fftSize & (fftSize - 1)))
+    return JS_ThrowRangeError(ctx, "spectrogram: fftSize must be a power of two in [32, 32768]");
+  if(!hop)
+    hop = fftSize / 4;
+  if(hop < 1)
+    return JS_ThrowRangeError(ctx, "spectrogram: hop must be positive");
+  if(channel >= w->bus->numberOfChannels())
+    return JS_ThrowRangeError(ctx, "spectrogram: channel out of range");
+
+  auto task = std::make_shared<SpectrogramTask>();
+  // Analysis isn't an acquire, it mustn't detach the caller's views; a
+  // buffer JS can still write to is copied instead.
+  auto bus = w->views->empty() ? w->bus : clone_audio_bus(*w->bus);
+  task->stft = std::make_unique<Spectrogram>(std::move(bus), fftSize, hop, window, channel);
+  const size_t frames = task->stft->frames(), bins = size_t(task->stft->bins());
+  if(frames * bins > size_t(INT32_MAX) / sizeof(float))
+    return JS_ThrowRangeError(ctx, "spectrogram: result too large, use a larger hop");
+  task->result = new std::vector<float>(frames * bins);
+
+  JSValue promise = async_start(ctx, task);
+  if(JS_IsException(promise))
+    return promise;
+
+  // A few segments per worker so uneven thread speeds even out, but no
+  // fewer than 16 frames each.
+  const size_t segments = std::clamp<size_t>(frames / 16, 1, 4 * std::clamp<size_t>(std::thread::hardware_concurrency(), 1, 8));
+  task->remaining.store(int(segments));
+  for(size_t k = 0; k < segments; k++) {
+    const size_t first = frames * k / segments, last = frames * (k + 1) / segments;
+    worker_pool_submit([task, first, last, bins]() {
+      task->stft->compute(first, last, task->result->data() + first * bins);
+      if(task->remaining.fetch_sub(1) == 1)
+        async_post(task);
+    });
+  }
+  return promise;
+}
+
+static void
+js_audiobuffer_finalizer(JSRuntime* rt, JSValue val) {
+  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque(val, js_audiobuffer_class_id));
+  if(w) {
+    w->~JsAudioBuffer();
+    js_free_rt(rt, w);
+  }
+}
+
+static JSClassDef js_audiobuffer_class = {
+    .class_name = "AudioBuffer",
+    .finalizer = js_audiobuffer_finalizer,
+};
+
+static const JSCFunctionListEntry js_audiobuffer_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("duration", js_audiobuffer_get, 0, AB_PROP_DURATION),
+    JS_CGETSET_MAGIC_DEF("sampleRate", js_audiobuffer_get, 0, AB_PROP_SAMPLERATE),
+    JS_CGETSET_MAGIC_DEF("numberOfChannels", js_audiobuffer_get, 0, AB_PROP_NUMCHANNELS),
+    JS_CGETSET_MAGIC_DEF("length", js_audiobuffer_get, 0, AB_PROP_LENGTH),
+    JS_CFUNC_MAGIC_DEF("getChannelData", 1, js_audiobuffer_method, AB_METHOD_GET_CHANNEL_DATA),
+    JS_CFUNC_MAGIC_DEF("copyToChannel", 2, js_audiobuffer_method, AB_METHOD_COPY_TO_CHANNEL),
+    JS_CFUNC_MAGIC_DEF("copyFromChannel", 2, js_audiobuffer_method, AB_METHOD_COPY_FROM_CHANNEL),
+    JS_CFUNC_DEF("writeToWav", 1, js_audiobuffer_write_wav),
+    JS_CFUNC_DEF("spectrogram", 0, js_audiobuffer_spectrogram),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioBuffer", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioBufferSourceNode (lab::SampledAudioNode) ---------- */
+
+static JSValue
+js_absource_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "AudioBufferSourceNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+
+  auto src = std::make_shared<lab::SampledAudioNode>(*ac);
+
+  bool wantLoop = false;
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v;
+
+    v = JS_GetPropertyStr(ctx, argv[1], "buffer");
+    if(!JS_IsUndefined(v) && !JS_IsNull(v)) {
+      JsAudioBuffer* ab = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, v, js_audiobuffer_class_id));
+      if(ab && ab->bus)
+        src->setBus(acquire_audio_buffer(ctx, ab));
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "loop");
+    if(!JS_IsUndefined(v))
+      wantLoop = JS_ToBool(ctx, v);
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "playbackRate");
+    if(JS_IsNumber(v)) {
+      double d; JS_ToFloat64(ctx, &d, v);
+      src->playbackRate()->setValue((float)d);
+    }
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "detune");
+    if(JS_IsNumber(v)) {
+      double d; JS_ToFloat64(ctx, &d, v);
+      src->detune()->setValue((float)d);
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, audiobuffersourcenode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_audiobuffersourcenode_class_id, std::static_pointer_cast<lab::AudioNode>(src), ac);
+  JS_FreeValue(ctx, proto);
+  if(wantLoop)
+    JS_SetPropertyStr(ctx, obj, "loop", JS_TRUE);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
+
+static JSValue
+js_absource_start(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_audiobuffersourcenode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto src = std::dynamic_pointer_cast<lab::SampledAudioNode>(w->node);
+  if(!src)
+    return JS_ThrowInternalError(ctx, "not a SampledAudioNode");
+
+  double when = 0, offset = 0;
+  if(argc > 0)
+    JS_ToFloat64(ctx, &when, argv[0]);
+  if(argc > 1)
+    JS_ToFloat64(ctx, &offset, argv[1]);
+
+  bool wantLoop = false;
+  JSValue lv = JS_GetPropertyStr(ctx, this_val, "loop");
+  if(!JS_IsUndefined(lv))
+    wantLoop = JS_ToBool(ctx, lv);
+  JS_FreeValue(ctx, lv);
+  int loopCount = wantLoop ? -1 : 0;
+
+  if(offset > 0)
+    src->start((float)when, (float)offset, loopCount);
+  else
+    src->start((float)when, loopCount);
+  return JS_UNDEFINED;
+}
+
+enum {
+  ABSRC_PROP_PLAYBACKRATE,
+  ABSRC_PROP_DETUNE,
+};
+
+static JSValue
+js_absource_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_audiobuffersourcenode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto src = std::dynamic_pointer_cast<lab::SampledAudioNode>(w->node);
+  if(!src)
+    return JS_ThrowInternalError(ctx, "not a SampledAudioNode");
+  switch(magic) {
+    case ABSRC_PROP_PLAYBACKRATE: return make_audio_param_js(ctx, src->playbackRate());
+    case ABSRC_PROP_DETUNE: return make_audio_param_js(ctx, src->detune());
+  }
+  return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_audiobuffersourcenode_funcs[] = {
+    JS_CFUNC_DEF("start", 0, js_absource_start),
+    JS_CGETSET_MAGIC_DEF("playbackRate", js_absource_get, 0, ABSRC_PROP_PLAYBACKRATE),
+    JS_CGETSET_MAGIC_DEF("detune", js_absource_get, 0, ABSRC_PROP_DETUNE),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioBufferSourceNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- NoiseNode ---------- */
+
+static lab::NoiseNode::NoiseType
+parse_noise_type(const char* s) {
+  if(!s)
+    return lab::NoiseNode::WHITE;
+  if(!strcmp(s, "white")) return lab::NoiseNode::WHITE;
+  if(!strcmp(s, "pink")) return lab::NoiseNode::PINK;
+  if(!strcmp(s, "brown")) return lab::NoiseNode::BROWN;
+  return lab::NoiseNode::WHITE;
+}
+
+static const char*
+noise_type_to_string(lab::NoiseNode::NoiseType t) {
+  switch(t) {
+    case lab::NoiseNode::PINK: return "pink";
+    case lab::NoiseNode::BROWN: return "brown";
+    case lab::NoiseNode::WHITE:
+    default: return "white";
+  }
+}
+
+static JSValue
+js_noise_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "NoiseNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+  auto n = std::make_shared<lab::NoiseNode>(*ac);
+
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "type");
+    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
+      const char* s = JS_ToCString(ctx, v);
+      if(s) {
+        n->setType(parse_noise_type(s));
+        JS_FreeCString(ctx, s);
+      }
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, noisenode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_noisenode_class_id, std::static_pointer_cast<lab::AudioNode>(n), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
+
+static JSValue
+js_noise_get_type(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_noisenode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto n = std::dynamic_pointer_cast<lab::NoiseNode>(w->node);
+  if(!n)
+    return JS_ThrowInternalError(ctx, "not a NoiseNode");
+  return JS_NewString(ctx, noise_type_to_string(n->type()));
+}
+
+static JSValue
+js_noise_set_type(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_noisenode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto n = std::dynamic_pointer_cast<lab::NoiseNode>(w->node);
+  if(!n)
+    return JS_ThrowInternalError(ctx, "not a NoiseNode");
+  const char* s = JS_ToCString(ctx, value);
+  if(s) {
+    n->setType(parse_noise_type(s));
+    JS_FreeCString(ctx, s);
+  }
+  return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_noisenode_funcs[] = {
+    JS_CGETSET_DEF("type", js_noise_get_type, js_noise_set_type),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "NoiseNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioSetting (delayTime shim) ---------- */
+
+static JSValue
+js_audiosetting_get_value(JSContext* ctx, JSValueConst this_val) {
+  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque2(ctx, this_val, js_audiosetting_class_id));
+  if(!w || !w->setting)
+    return JS_EXCEPTION;
+  return JS_NewFloat64(ctx, w->setting->valueFloat());
+}
+
+static JSValue
+js_audiosetting_set_value(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque2(ctx, this_val, js_audiosetting_class_id));
+  if(!w || !w->setting)
+    return JS_EXCEPTION;
+  double d;
+  if(JS_ToFloat64(ctx, &d, value))
+    return JS_EXCEPTION;
+  w->setting->setFloat(static_cast<float>(d));
+  return JS_UNDEFINED;
+}
+
+// All AudioParam-like methods collapse to immediate setFloat. AudioSetting
+// has no scheduler in lab, so the time arg is ignored. This keeps scripts
+// that use setValueAtTime / linearRamp on DelayNode.delayTime running cleanly
+// in qjs even though they only get the final value, not a smooth ramp.
+static JSValue
+js_audiosetting_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque2(ctx, this_val, js_audiosetting_class_id));
+  if(!w || !w->setting)
+    return JS_EXCEPTION;
+  if(argc < 1)
+    return JS_DupValue(ctx, this_val);
+  double d;
+  if(JS_ToFloat64(ctx, &d, argv[0]))
+    return JS_EXCEPTION;
+  w->setting->setFloat(static_cast<float>(d));
+  return JS_DupValue(ctx, this_val);
+}
+
+static void
+js_audiosetting_finalizer(JSRuntime* rt, JSValue val) {
+  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque(val, js_audiosetting_class_id));
+  if(w) {
+    w->~JsAudioSetting();
+    js_free_rt(rt, w);
+  }
+}
+
+static JSClassDef js_audiosetting_class = {
+    .class_name = "AudioParam",
+    .finalizer = js_audiosetting_finalizer,
+};
+
+static const JSCFunctionListEntry js_audiosetting_funcs[] = {
+    JS_CGETSET_DEF("value", js_audiosetting_get_value, js_audiosetting_set_value),
+    JS_CFUNC_DEF("setValueAtTime", 2, js_audiosetting_method),
+    JS_CFUNC_DEF("linearRampToValueAtTime", 2, js_audiosetting_method),
+    JS_CFUNC_DEF("exponentialRampToValueAtTime", 2, js_audiosetting_method),
+    JS_CFUNC_DEF("setTargetAtTime", 3, js_audiosetting_method),
+    JS_CFUNC_DEF("cancelScheduledValues", 1, js_audiosetting_method),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioParam", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- DelayNode ---------- */
+
+static JSValue
+js_delay_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "DelayNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+
+  double maxDelay = 2.0;
+  double initialDelay = 0.0;
+  bool haveInitial = false;
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "maxDelayTime");
+    if(JS_IsNumber(v))
+      JS_ToFloat64(ctx, &maxDelay, v);
+    JS_FreeValue(ctx, v);
+
+    v = JS_GetPropertyStr(ctx, argv[1], "delayTime");
+    if(JS_IsNumber(v)) {
+      JS_ToFloat64(ctx, &initialDelay, v);
+      haveInitial = true;
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  auto d = std::make_shared<lab::DelayNode>(*ac, maxDelay);
+
+  if(d->numberOfOutputs() == 0) {
+    lab::ContextGraphLock gLock(ac.get(), "DelayNode.addOutput");
+    d->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(d.get(), 2)));
+  }
+
+  if(haveInitial)
+    d->delayTime()->setFloat(static_cast<float>(initialDelay));
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, delaynode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_delaynode_class_id, std::static_pointer_cast<lab::AudioNode>(d), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
+
+static JSValue
+js_delay_get_delaytime(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_delaynode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto d = std::dynamic_pointer_cast<lab::DelayNode>(w->node);
+  if(!d)
+    return JS_ThrowInternalError(ctx, "not a DelayNode");
+  return make_audio_setting_js(ctx, d->delayTime());
+}
+
+static const JSCFunctionListEntry js_delaynode_funcs[] = {
+    JS_CGETSET_DEF("delayTime", js_delay_get_delaytime, NULL),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "DelayNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- WaveShaperNode ---------- */
+
+static lab::OverSampleType
+parse_oversample(const char* s) {
+  if(!s)
+    return lab::OverSampleType::NONE;
+  if(!strcmp(s, "none")) return lab::OverSampleType::NONE;
+  if(!strcmp(s, "2x"))   return lab::OverSampleType::_2X;
+  if(!strcmp(s, "4x"))   return lab::OverSampleType::_4X;
+  return lab::OverSampleType::NONE;
+}
+
+static const char*
+oversample_to_string(lab::OverSampleType t) {
+  switch(t) {
+    case lab::OverSampleType::_2X: return "2x";
+    case lab::OverSampleType::_4X: return "4x";
+    case lab::OverSampleType::NONE:
+    default: return "none";
   }
 }
 
-static JSClassDef js_audioparam_class = {
-    .class_name = "AudioParam",
-    .finalizer = js_audioparam_finalizer,
-};
+static JSValue
+js_waveshaper_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "WaveShaperNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+  auto ws = std::make_shared<lab::WaveShaperNode>(*ac);
 
-static const JSCFunctionListEntry js_audioparam_funcs[] = {
-    JS_CGETSET_DEF("value", js_audioparam_get_value, js_audioparam_set_value),
-    JS_CGETSET_MAGIC_DEF("name", js_audioparam_get_meta, 0, AP_PROP_NAME),
-    JS_CGETSET_MAGIC_DEF("minValue", js_audioparam_get_meta, 0, AP_PROP_MIN),
-    JS_CGETSET_MAGIC_DEF("maxValue", js_audioparam_get_meta, 0, AP_PROP_MAX),
-    JS_CGETSET_MAGIC_DEF("defaultValue", js_audioparam_get_meta, 0, AP_PROP_DEFAULT),
-    JS_CFUNC_MAGIC_DEF("setValueAtTime", 2, js_audioparam_method, AP_METHOD_SET_VALUE_AT_TIME),
-    JS_CFUNC_MAGIC_DEF("linearRampToValueAtTime", 2, js_audioparam_method, AP_METHOD_LINEAR_RAMP),
-    JS_CFUNC_MAGIC_DEF("exponentialRampToValueAtTime", 2, js_audioparam_method, AP_METHOD_EXPONENTIAL_RAMP),
-    JS_CFUNC_MAGIC_DEF("setTargetAtTime", 3, js_audioparam_method, AP_METHOD_SET_TARGET_AT_TIME),
-    JS_CFUNC_MAGIC_DEF("cancelScheduledValues", 1, js_audioparam_method, AP_METHOD_CANCEL_SCHEDULED),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioParam", JS_PROP_CONFIGURABLE),
-};
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v;
 
-/* ---------- AudioListener (kept minimal) ---------- */
+    v = JS_GetPropertyStr(ctx, argv[1], "curve");
+    if(!JS_IsUndefined(v) && !JS_IsNull(v)) {
+      std::vector<float> curve;
+      if(read_float_array(ctx, v, curve) == 0 && !curve.empty())
+        ws->setCurve(curve);
+    }
+    JS_FreeValue(ctx, v);
 
-static JSValue
-js_audiolistener_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  JSValue proto, obj = JS_UNDEFINED;
-  auto* sal = static_cast<AudioListenerPtr*>(js_mallocz(ctx, sizeof(AudioListenerPtr)));
-  new(sal) AudioListenerPtr(std::make_shared<lab::AudioListener>());
+    v = JS_GetPropertyStr(ctx, argv[1], "oversample");
+    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
+      const char* s = JS_ToCString(ctx, v);
+      if(s) {
+        ws->setOversample(parse_oversample(s));
+        JS_FreeCString(ctx, s);
+      }
+    }
+    JS_FreeValue(ctx, v);
+  }
 
-  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
-    goto fail;
-  if(!JS_IsObject(proto))
-    proto = JS_DupValue(ctx, audiolistener_proto);
-  obj = JS_NewObjectProtoClass(ctx, proto, js_audiolistener_class_id);
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, waveshapernode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_waveshapernode_class_id, std::static_pointer_cast<lab::AudioNode>(ws), ac);
   JS_FreeValue(ctx, proto);
-  if(JS_IsException(obj))
-    goto fail;
-  JS_SetOpaque(obj, sal);
+  anchor_node_in_context(ctx, argv[0], obj);
   return obj;
+}
 
-fail:
-  sal->~AudioListenerPtr();
-  js_free(ctx, sal);
-  JS_FreeValue(ctx, obj);
-  return JS_EXCEPTION;
+static JSValue
+js_waveshaper_get_oversample(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_waveshapernode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto ws = std::dynamic_pointer_cast<lab::WaveShaperNode>(w->node);
+  if(!ws)
+    return JS_ThrowInternalError(ctx, "not a WaveShaperNode");
+  return JS_NewString(ctx, oversample_to_string(ws->oversample()));
 }
 
-static void
-js_audiolistener_finalizer(JSRuntime* rt, JSValue val) {
-  AudioListenerPtr* sal = static_cast<AudioListenerPtr*>(JS_GetOpaque(val, js_audiolistener_class_id));
-  if(sal) {
-    sal->~AudioListenerPtr();
-    js_free_rt(rt, sal);
+static JSValue
+js_waveshaper_set_oversample(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_waveshapernode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto ws = std::dynamic_pointer_cast<lab::WaveShaperNode>(w->node);
+  if(!ws)
+    return JS_ThrowInternalError(ctx, "not a WaveShaperNode");
+  const char* s = JS_ToCString(ctx, value);
+  if(s) {
+    ws->setOversample(parse_oversample(s));
+    JS_FreeCString(ctx, s);
   }
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_audiolistener_class = {
-    .class_name = "AudioListener",
-    .finalizer = js_audiolistener_finalizer,
-};
+static JSValue
+js_waveshaper_set_curve(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_waveshapernode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto ws = std::dynamic_pointer_cast<lab::WaveShaperNode>(w->node);
+  if(!ws)
+    return JS_ThrowInternalError(ctx, "not a WaveShaperNode");
+  std::vector<float> curve;
+  if(read_float_array(ctx, value, curve) == 0 && !curve.empty())
+    ws->setCurve(curve);
+  return JS_UNDEFINED;
+}
 
-static const JSCFunctionListEntry js_audiolistener_funcs[] = {
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioListener", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_waveshapernode_funcs[] = {
+    JS_CGETSET_DEF("oversample", js_waveshaper_get_oversample, js_waveshaper_set_oversample),
+    JS_CGETSET_DEF("curve", NULL, js_waveshaper_set_curve),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "WaveShaperNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- AudioDevice (kept) ---------- */
+/* ---------- StereoPannerNode ---------- */
 
 static JSValue
-js_audiodevice_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  JSValue proto, obj = JS_UNDEFINED;
-  auto cfg = get_default_device_config();
-  auto* sad = static_cast<AudioDevicePtr*>(js_mallocz(ctx, sizeof(AudioDevicePtr)));
-  new(sad) AudioDevicePtr(std::make_shared<lab::AudioDevice_RtAudio>(cfg.first, cfg.second));
+js_stereopanner_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "StereoPannerNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
+    return JS_EXCEPTION;
+  AudioContextPtr ac = jac->ac;
+  auto sp = std::make_shared<lab::StereoPannerNode>(*ac);
 
-  proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "pan");
+    if(JS_IsNumber(v)) {
+      double d; JS_ToFloat64(ctx, &d, v);
+      sp->pan()->setValue(static_cast<float>(d));
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
-    goto fail;
-  if(!JS_IsObject(proto))
-    proto = JS_DupValue(ctx, audiodevice_proto);
-  obj = JS_NewObjectProtoClass(ctx, proto, js_audiodevice_class_id);
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, stereopannernode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_stereopannernode_class_id, std::static_pointer_cast<lab::AudioNode>(sp), ac);
   JS_FreeValue(ctx, proto);
-  if(JS_IsException(obj))
-    goto fail;
-  JS_SetOpaque(obj, sad);
+  anchor_node_in_context(ctx, argv[0], obj);
   return obj;
-
-fail:
-  sad->~AudioDevicePtr();
-  js_free(ctx, sad);
-  JS_FreeValue(ctx, obj);
-  return JS_EXCEPTION;
 }
 
-enum { DEVICE_DESTINATION_NODE };
-
 static JSValue
-js_audiodevice_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
-  AudioDevicePtr* sad = static_cast<AudioDevicePtr*>(JS_GetOpaque2(ctx, this_val, js_audiodevice_class_id));
-  if(!sad)
+js_stereopanner_get_pan(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_stereopannernode_class_id);
+  if(!w)
     return JS_EXCEPTION;
-  if(magic == DEVICE_DESTINATION_NODE) {
-    JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, value, js_audiodestinationnode_class_id));
-    if(!w)
-      return JS_ThrowInternalError(ctx, "value must be AudioDestinationNode");
-    auto dest = std::dynamic_pointer_cast<lab::AudioDestinationNode>(w->node);
-    if(!dest)
-      return JS_ThrowInternalError(ctx, "value must be AudioDestinationNode");
-    (*sad)->setDestinationNode(dest);
-  }
-  return JS_UNDEFINED;
-}
-
-static void
-js_audiodevice_finalizer(JSRuntime* rt, JSValue val) {
-  AudioDevicePtr* sad = static_cast<AudioDevicePtr*>(JS_GetOpaque(val, js_audiodevice_class_id));
-  if(sad) {
-    sad->~AudioDevicePtr();
-    js_free_rt(rt, sad);
-  }
+  auto sp = std::dynamic_pointer_cast<lab::StereoPannerNode>(w->node);
+  if(!sp)
+    return JS_ThrowInternalError(ctx, "not a StereoPannerNode");
+  return make_audio_param_js(ctx, sp->pan());
 }
 
-static JSClassDef js_audiodevice_class = {
-    .class_name = "AudioDevice",
-    .finalizer = js_audiodevice_finalizer,
-};
-
-static const JSCFunctionListEntry js_audiodevice_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("destinationNode", 0, js_audiodevice_set, DEVICE_DESTINATION_NODE),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioDevice", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_stereopannernode_funcs[] = {
+    JS_CGETSET_DEF("pan", js_stereopanner_get_pan, NULL),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "StereoPannerNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- AudioBuffer ---------- */
-
-enum {
-  AB_PROP_DURATION,
-  AB_PROP_SAMPLERATE,
-  AB_PROP_NUMCHANNELS,
-  AB_PROP_LENGTH,
-};
+/* ---------- ConvolverNode ---------- */
+//
+// Backed by lab::ConvolverNode, or -- when constructed with a
+// `partitionSize` or `latencyFrames` option -- by PartitionedConvolverNode
+// (partitioned-convolver.hpp), which moves most of a long impulse
+// response's cost to a worker thread. Same JS class either way.
 
 static JSValue
-js_audiobuffer_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
-  if(!w || !w->bus)
+js_convolver_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "ConvolverNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  switch(magic) {
-    case AB_PROP_DURATION: return JS_NewFloat64(ctx, double(w->bus->length()) / w->bus->sampleRate());
-    case AB_PROP_SAMPLERATE: return JS_NewFloat64(ctx, w->bus->sampleRate());
-    case AB_PROP_NUMCHANNELS: return JS_NewInt32(ctx, w->bus->numberOfChannels());
-    case AB_PROP_LENGTH: return JS_NewInt32(ctx, w->bus->length());
-  }
-  return JS_UNDEFINED;
-}
+  AudioContextPtr ac = jac->ac;
 
-static JSValue
-js_audiobuffer_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  if(argc < 1 || !JS_IsObject(argv[0]))
-    return JS_ThrowTypeError(ctx, "AudioBuffer requires {numberOfChannels, length, sampleRate}");
+  JsAudioBuffer* buf = nullptr;
+  int normalize = -1;
+  int32_t partitionSize = 0, latencyFrames = -1;
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "buffer");
+    if(JS_IsObject(v))
+      buf = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, v, js_audiobuffer_class_id));
+    JS_FreeValue(ctx, v);
 
-  int32_t numberOfChannels = 1, length = 0;
-  double sampleRate = 44100;
+    v = JS_GetPropertyStr(ctx, argv[1], "normalize");
+    if(!JS_IsUndefined(v) && !JS_IsException(v))
+      normalize = JS_ToBool(ctx, v);
+    JS_FreeValue(ctx, v);
 
-  JSValue v = JS_GetPropertyStr(ctx, argv[0], "numberOfChannels");
-  if(JS_IsNumber(v))
-    JS_ToInt32(ctx, &numberOfChannels, v);
-  JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[1], "partitionSize");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &partitionSize, v);
+    JS_FreeValue(ctx, v);
 
-  v = JS_GetPropertyStr(ctx, argv[0], "length");
-  if(JS_IsNumber(v))
-    JS_ToInt32(ctx, &length, v);
-  JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[1], "latencyFrames");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &latencyFrames, v);
+    JS_FreeValue(ctx, v);
+  }
 
-  v = JS_GetPropertyStr(ctx, argv[0], "sampleRate");
-  if(JS_IsNumber(v))
-    JS_ToFloat64(ctx, &sampleRate, v);
-  JS_FreeValue(ctx, v);
+  // latencyFrames picks the largest partition that fits in that latency.
+  const int quantum = lab::AudioNode::ProcessingSizeInFrames;
+  if(!partitionSize && latencyFrames >= 0)
+    for(partitionSize = quantum; partitionSize * 2 - quantum <= latencyFrames && partitionSize < 16384;)
+      partitionSize *= 2;
+  if(partitionSize && (partitionSize < quantum || partitionSize > 16384 || (partitionSize & (partitionSize - 1))))
+    return JS_ThrowRangeError(ctx, "ConvolverNode: partitionSize must be a power of two from %d to 16384", quantum);
 
-  if(length <= 0)
-    return JS_ThrowTypeError(ctx, "AudioBuffer requires a positive length");
-  if(numberOfChannels <= 0)
-    return JS_ThrowTypeError(ctx, "AudioBuffer requires numberOfChannels >= 1");
+  std::shared_ptr<lab::AudioNode> node;
+  if(partitionSize) {
+    auto conv = std::make_shared<PartitionedConvolverNode>(*ac, partitionSize);
+    {
+      lab::ContextGraphLock gLock(ac.get(), "ConvolverNode.addInput");
+      conv->addInput(gLock, std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(conv.get())));
+      conv->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(conv.get(), 2)));
+    }
+    if(normalize >= 0)
+      conv->setNormalize(ac.get(), normalize);
+    if(buf && buf->bus)
+      conv->setImpulse(ac.get(), acquire_audio_buffer(ctx, buf));
+    node = conv;
+  } else {
+    auto conv = std::make_shared<lab::ConvolverNode>(*ac);
+    if(buf && buf->bus)
+      conv->setImpulse(acquire_audio_buffer(ctx, buf));
+    if(normalize >= 0)
+      conv->setNormalize(normalize);
+    node = conv;
+  }
 
-  auto bus = std::make_shared<lab::AudioBus>(numberOfChannels, length, true);
-  bus->setSampleRate(static_cast<float>(sampleRate));
-  return make_audio_buffer_js(ctx, bus);
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, convolvernode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_convolvernode_class_id, node, ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
 }
 
-enum {
-  AB_METHOD_GET_CHANNEL_DATA,
-  AB_METHOD_COPY_TO_CHANNEL,
-  AB_METHOD_COPY_FROM_CHANNEL,
-};
+static JsAudioNode*
+get_convolver(JSContext* ctx, JSValueConst this_val, std::shared_ptr<lab::ConvolverNode>& conv, std::shared_ptr<PartitionedConvolverNode>& part) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_convolvernode_class_id);
+  if(!w)
+    return nullptr;
+  if(!(conv = std::dynamic_pointer_cast<lab::ConvolverNode>(w->node)) && !(part = std::dynamic_pointer_cast<PartitionedConvolverNode>(w->node))) {
+    JS_ThrowInternalError(ctx, "not a ConvolverNode");
+    return nullptr;
+  }
+  return w;
+}
 
 static JSValue
-js_audiobuffer_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
-  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
-  if(!w || !w->bus)
+js_convolver_get_buffer(JSContext* ctx, JSValueConst this_val) {
+  std::shared_ptr<lab::ConvolverNode> conv;
+  std::shared_ptr<PartitionedConvolverNode> part;
+  if(!get_convolver(ctx, this_val, conv, part))
     return JS_EXCEPTION;
+  auto impulse = conv ? conv->getImpulse() : part->getImpulse();
+  if(!impulse)
+    return JS_NULL;
+  return make_audio_buffer_js(ctx, impulse);
+}
 
-  switch(magic) {
-    case AB_METHOD_GET_CHANNEL_DATA: {
-      // getChannelData(channel)
-      if(argc < 1)
-        return JS_ThrowTypeError(ctx, "channel index required");
-      int32_t channel = 0;
-      JS_ToInt32(ctx, &channel, argv[0]);
-      if(channel < 0 || channel >= w->bus->numberOfChannels())
-        return JS_ThrowRangeError(ctx, "channel index out of range");
-      lab::AudioChannel* ch = w->bus->channel(channel);
-      return make_float32_array(ctx, ch->data(), ch->length());
-    }
-
-    case AB_METHOD_COPY_TO_CHANNEL: {
-      // copyToChannel(source, channelNumber, startInChannel = 0)
-      if(argc < 2)
-        return JS_ThrowTypeError(ctx, "copyToChannel requires (source, channelNumber)");
-      int32_t channel = 0;
-      JS_ToInt32(ctx, &channel, argv[1]);
-      if(channel < 0 || channel >= w->bus->numberOfChannels())
-        return JS_ThrowRangeError(ctx, "channel index out of range");
-      lab::AudioChannel* ch = w->bus->channel(channel);
-      std::vector<float> src;
-      if(read_float_array(ctx, argv[0], src) != 0)
-        return JS_ThrowTypeError(ctx, "source must be a Float32Array or array-like");
-      int32_t startInChannel = 0;
-      if(argc > 2)
-        JS_ToInt32(ctx, &startInChannel, argv[2]);
-      if(startInChannel < 0 || startInChannel > ch->length())
-        return JS_ThrowRangeError(ctx, "startInChannel out of range");
-      size_t count = std::min(src.size(), size_t(ch->length() - startInChannel));
-      memcpy(ch->mutableData() + startInChannel, src.data(), count * sizeof(float));
-      return JS_UNDEFINED;
-    }
-
-    case AB_METHOD_COPY_FROM_CHANNEL: {
-      // copyFromChannel(destination, channelNumber, startInChannel = 0)
-      if(argc < 2)
-        return JS_ThrowTypeError(ctx, "copyFromChannel requires (destination, channelNumber)");
-      int32_t channel = 0;
-      JS_ToInt32(ctx, &channel, argv[1]);
-      if(channel < 0 || channel >= w->bus->numberOfChannels())
-        return JS_ThrowRangeError(ctx, "channel index out of range");
-      lab::AudioChannel* ch = w->bus->channel(channel);
-      size_t byte_offset = 0, byte_length = 0, bytes_per_element = 0;
-      JSValue buf = JS_GetTypedArrayBuffer(ctx, argv[0], &byte_offset, &byte_length, &bytes_per_element);
-      if(JS_IsException(buf) || bytes_per_element != sizeof(float))
-        return JS_ThrowTypeError(ctx, "destination must be a Float32Array");
-      size_t ab_size = 0;
-      uint8_t* ab_data = JS_GetArrayBuffer(ctx, &ab_size, buf);
-      JS_FreeValue(ctx, buf);
-      if(!ab_data)
-        return JS_EXCEPTION;
-      int32_t startInChannel = 0;
-      if(argc > 2)
-        JS_ToInt32(ctx, &startInChannel, argv[2]);
-      if(startInChannel < 0 || startInChannel > ch->length())
-        return JS_ThrowRangeError(ctx, "startInChannel out of range");
-      size_t destCount = byte_length / sizeof(float);
-      size_t count = std::min(destCount, size_t(ch->length() - startInChannel));
-      memcpy(reinterpret_cast<float*>(ab_data + byte_offset), ch->data() + startInChannel, count * sizeof(float));
-      return JS_UNDEFINED;
-    }
-  }
+static JSValue
+js_convolver_set_buffer(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  std::shared_ptr<lab::ConvolverNode> conv;
+  std::shared_ptr<PartitionedConvolverNode> part;
+  JsAudioNode* w = get_convolver(ctx, this_val, conv, part);
+  if(!w)
+    return JS_EXCEPTION;
+  JsAudioBuffer* buf = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, value, js_audiobuffer_class_id));
+  if(!buf)
+    return JS_EXCEPTION;
+  if(conv)
+    conv->setImpulse(acquire_audio_buffer(ctx, buf));
+  else
+    part->setImpulse(w->ctx.get(), acquire_audio_buffer(ctx, buf));
   return JS_UNDEFINED;
 }
 
 static JSValue
-js_audiobuffer_write_wav(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, this_val, js_audiobuffer_class_id));
-  if(!w || !w->bus)
+js_convolver_get_normalize(JSContext* ctx, JSValueConst this_val) {
+  std::shared_ptr<lab::ConvolverNode> conv;
+  std::shared_ptr<PartitionedConvolverNode> part;
+  if(!get_convolver(ctx, this_val, conv, part))
     return JS_EXCEPTION;
-  if(argc < 1)
-    return JS_ThrowTypeError(ctx, "writeToWav requires a file path");
-  const char* path = JS_ToCString(ctx, argv[0]);
-  if(!path)
+  return JS_NewBool(ctx, conv ? conv->normalize() : part->getNormalize());
+}
+
+static JSValue
+js_convolver_set_normalize(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  std::shared_ptr<lab::ConvolverNode> conv;
+  std::shared_ptr<PartitionedConvolverNode> part;
+  JsAudioNode* w = get_convolver(ctx, this_val, conv, part);
+  if(!w)
     return JS_EXCEPTION;
-  bool mixToMono = argc > 1 ? JS_ToBool(ctx, argv[1]) : false;
-  bool ok = write_bus_to_wav(w->bus.get(), path, mixToMono);
-  JS_FreeCString(ctx, path);
-  if(!ok)
-    return JS_ThrowInternalError(ctx, "writeToWav: failed to write file");
+  if(conv)
+    conv->setNormalize(JS_ToBool(ctx, value));
+  else
+    part->setNormalize(w->ctx.get(), JS_ToBool(ctx, value));
   return JS_UNDEFINED;
 }
 
-static void
-js_audiobuffer_finalizer(JSRuntime* rt, JSValue val) {
-  JsAudioBuffer* w = static_cast<JsAudioBuffer*>(JS_GetOpaque(val, js_audiobuffer_class_id));
-  if(w) {
-    w->~JsAudioBuffer();
-    js_free_rt(rt, w);
+enum {
+  CONV_PROP_PARTITION_SIZE,
+  CONV_PROP_LATENCY_FRAMES,
+  CONV_PROP_CPU_LOAD,
+};
+
+// partitionSize/latencyFrames, and cpuLoad = {render, worker, lateBlocks}:
+// the smoothed fraction of real time spent on the render thread per
+// quantum and on the worker per tail block, and how often the render thread
+// had to wait for the worker. null/0 for a plain lab::ConvolverNode.
+static JSValue
+js_convolver_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  std::shared_ptr<lab::ConvolverNode> conv;
+  std::shared_ptr<PartitionedConvolverNode> part;
+  if(!get_convolver(ctx, this_val, conv, part))
+    return JS_EXCEPTION;
+  switch(magic) {
+    case CONV_PROP_PARTITION_SIZE: return part ? JS_NewInt32(ctx, part->partitionSize()) : JS_NULL;
+    case CONV_PROP_LATENCY_FRAMES: return JS_NewInt32(ctx, part ? part->latencyFrames() : 0);
+    case CONV_PROP_CPU_LOAD: {
+      if(!part)
+        return JS_NULL;
+      JSValue obj = JS_NewObject(ctx);
+      JS_SetPropertyStr(ctx, obj, "render", JS_NewFloat64(ctx, part->renderLoad()));
+      JS_SetPropertyStr(ctx, obj, "worker", JS_NewFloat64(ctx, part->workerLoad()));
+      JS_SetPropertyStr(ctx, obj, "lateBlocks", JS_NewInt64(ctx, int64_t(part->lateBlocks())));
+      return obj;
+    }
   }
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_audiobuffer_class = {
-    .class_name = "AudioBuffer",
-    .finalizer = js_audiobuffer_finalizer,
-};
-
-static const JSCFunctionListEntry js_audiobuffer_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("duration", js_audiobuffer_get, 0, AB_PROP_DURATION),
-    JS_CGETSET_MAGIC_DEF("sampleRate", js_audiobuffer_get, 0, AB_PROP_SAMPLERATE),
-    JS_CGETSET_MAGIC_DEF("numberOfChannels", js_audiobuffer_get, 0, AB_PROP_NUMCHANNELS),
-    JS_CGETSET_MAGIC_DEF("length", js_audiobuffer_get, 0, AB_PROP_LENGTH),
-    JS_CFUNC_MAGIC_DEF("getChannelData", 1, js_audiobuffer_method, AB_METHOD_GET_CHANNEL_DATA),
-    JS_CFUNC_MAGIC_DEF("copyToChannel", 2, js_audiobuffer_method, AB_METHOD_COPY_TO_CHANNEL),
-    JS_CFUNC_MAGIC_DEF("copyFromChannel", 2, js_audiobuffer_method, AB_METHOD_COPY_FROM_CHANNEL),
-    JS_CFUNC_DEF("writeToWav", 1, js_audiobuffer_write_wav),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioBuffer", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_convolvernode_funcs[] = {
+    JS_CGETSET_DEF("buffer", js_convolver_get_buffer, js_convolver_set_buffer),
+    JS_CGETSET_DEF("normalize", js_convolver_get_normalize, js_convolver_set_normalize),
+    JS_CGETSET_MAGIC_DEF("partitionSize", js_convolver_get, 0, CONV_PROP_PARTITION_SIZE),
+    JS_CGETSET_MAGIC_DEF("latencyFrames", js_convolver_get, 0, CONV_PROP_LATENCY_FRAMES),
+    JS_CGETSET_MAGIC_DEF("cpuLoad", js_convolver_get, 0, CONV_PROP_CPU_LOAD),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ConvolverNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- AudioBufferSourceNode (lab::SampledAudioNode) ---------- */
+/* ---------- AnalyserNode ---------- */
+//
+// An AnalyserFrameNode (analyser-frames.hpp): besides the spec's getters it
+// analyses every `hopSize` frames (default fftSize) on the render thread
+// and keeps the last `frames` results (default 16; 0 turns it off), which
+// readFrames(Float32Array, maxFrames) drains. The get*Data() methods return
+// the newest of those frames rather than analysing on the JS thread.
 
 static JSValue
-js_absource_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_analyser_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "AudioBufferSourceNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "AnalyserNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-
-  auto src = std::make_shared<lab::SampledAudioNode>(*ac);
+  AudioContextPtr ac = jac->ac;
 
-  bool wantLoop = false;
+  int32_t frames = 16, hopSize = 0;
   if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v;
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "frames");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &frames, v);
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[1], "hopSize");
+    if(JS_IsNumber(v)) {
+      JS_ToInt32(ctx, &hopSize, v);
+      // Less than a quantum apart, analyses would pile up in one process().
+      if(hopSize < lab::AudioNode::ProcessingSizeInFrames || hopSize > 65536)
+        hopSize = -1;
+    }
+    JS_FreeValue(ctx, v);
+  }
+  if(frames < 0 || frames > 1024)
+    return JS_ThrowRangeError(ctx, "AnalyserNode: frames must be in [0, 1024]");
+  if(hopSize < 0)
+    return JS_ThrowRangeError(ctx, "AnalyserNode: hopSize must be in [%d, 65536]", lab::AudioNode::ProcessingSizeInFrames);
+  auto an = std::make_shared<AnalyserFrameNode>(*ac, frames, hopSize);
 
-    v = JS_GetPropertyStr(ctx, argv[1], "buffer");
-    if(!JS_IsUndefined(v) && !JS_IsNull(v)) {
-      JsAudioBuffer* ab = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, v, js_audiobuffer_class_id));
-      if(ab && ab->bus)
-        src->setBus(ab->bus);
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "fftSize");
+    if(JS_IsNumber(v)) {
+      int32_t fftSize = 2048;
+      JS_ToInt32(ctx, &fftSize, v);
+      lab::ContextRenderLock renderLock(ac.get(), "AnalyserNode.fftSize");
+      an->setFftSize(renderLock, fftSize);
     }
     JS_FreeValue(ctx, v);
 
-    v = JS_GetPropertyStr(ctx, argv[1], "loop");
-    if(!JS_IsUndefined(v))
-      wantLoop = JS_ToBool(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[1], "minDecibels");
+    if(JS_IsNumber(v)) {
+      double d; JS_ToFloat64(ctx, &d, v);
+      an->setMinDecibels(d);
+    }
     JS_FreeValue(ctx, v);
 
-    v = JS_GetPropertyStr(ctx, argv[1], "playbackRate");
+    v = JS_GetPropertyStr(ctx, argv[1], "maxDecibels");
     if(JS_IsNumber(v)) {
       double d; JS_ToFloat64(ctx, &d, v);
-      src->playbackRate()->setValue((float)d);
+      an->setMaxDecibels(d);
     }
     JS_FreeValue(ctx, v);
 
-    v = JS_GetPropertyStr(ctx, argv[1], "detune");
+    v = JS_GetPropertyStr(ctx, argv[1], "smoothingTimeConstant");
     if(JS_IsNumber(v)) {
       double d; JS_ToFloat64(ctx, &d, v);
-      src->detune()->setValue((float)d);
+      an->setSmoothingTimeConstant(d);
     }
     JS_FreeValue(ctx, v);
   }
+  {
+    lab::ContextRenderLock renderLock(ac.get(), "AnalyserNode.configure");
+    an->configure();
+  }
+
+  // Per LabSound's AnalyserNode.h: an analyser not connected to destination
+  // must be registered as an automatic pull node, or it never processes.
+  ac->addAutomaticPullNode(an);
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, audiobuffersourcenode_proto);
-  }
-  JSValue obj = make_audio_node_js(ctx, proto, js_audiobuffersourcenode_class_id, std::static_pointer_cast<lab::AudioNode>(src), ac);
-  JS_FreeValue(ctx, proto);
-  if(wantLoop)
-    JS_SetPropertyStr(ctx, obj, "loop", JS_TRUE);
-  anchor_node_in_context(ctx, argv[0], obj);
-  return obj;
-}
-
-static JSValue
-js_absource_start(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_audiobuffersourcenode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  auto src = std::dynamic_pointer_cast<lab::SampledAudioNode>(w->node);
-  if(!src)
-    return JS_ThrowInternalError(ctx, "not a SampledAudioNode");
-
-  double when = 0, offset = 0;
-  if(argc > 0)
-    JS_ToFloat64(ctx, &when, argv[0]);
-  if(argc > 1)
-    JS_ToFloat64(ctx, &offset, argv[1]);
-
-  bool wantLoop = false;
-  JSValue lv = JS_GetPropertyStr(ctx, this_val, "loop");
-  if(!JS_IsUndefined(lv))
-    wantLoop = JS_ToBool(ctx, lv);
-  JS_FreeValue(ctx, lv);
-  int loopCount = wantLoop ? -1 : 0;
+    proto = JS_DupValue(ctx, analysernode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_analysernode_class_id, std::static_pointer_cast<lab::AudioNode>(an), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
 
-  if(offset > 0)
-    src->start((float)when, (float)offset, loopCount);
-  else
-    src->start((float)when, loopCount);
-  return JS_UNDEFINED;
+static AnalyserFrameNode*
+get_analyser(JSContext* ctx, JSValueConst this_val, JsAudioNode** pw = nullptr) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_analysernode_class_id);
+  if(!w)
+    return nullptr;
+  if(pw)
+    *pw = w;
+  return static_cast<AnalyserFrameNode*>(w->node.get());
 }
 
 enum {
-  ABSRC_PROP_PLAYBACKRATE,
-  ABSRC_PROP_DETUNE,
+  AN_PROP_FFTSIZE,
+  AN_PROP_FREQUENCYBINCOUNT,
+  AN_PROP_MINDECIBELS,
+  AN_PROP_MAXDECIBELS,
+  AN_PROP_SMOOTHINGTIMECONSTANT,
+  AN_PROP_FRAME_SIZE,
+  AN_PROP_AVAILABLE_FRAMES,
+  AN_PROP_DROPPED_FRAMES,
 };
 
 static JSValue
-js_absource_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_audiobuffersourcenode_class_id));
-  if(!w)
+js_analyser_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  AnalyserFrameNode* an = get_analyser(ctx, this_val);
+  if(!an)
     return JS_EXCEPTION;
-  auto src = std::dynamic_pointer_cast<lab::SampledAudioNode>(w->node);
-  if(!src)
-    return JS_ThrowInternalError(ctx, "not a SampledAudioNode");
   switch(magic) {
-    case ABSRC_PROP_PLAYBACKRATE: return make_audio_param_js(ctx, src->playbackRate());
-    case ABSRC_PROP_DETUNE: return make_audio_param_js(ctx, src->detune());
+    case AN_PROP_FFTSIZE: return JS_NewInt32(ctx, static_cast<int32_t>(an->fftSize()));
+    case AN_PROP_FREQUENCYBINCOUNT: return JS_NewInt32(ctx, static_cast<int32_t>(an->frequencyBinCount()));
+    case AN_PROP_MINDECIBELS: return JS_NewFloat64(ctx, an->minDecibels());
+    case AN_PROP_MAXDECIBELS: return JS_NewFloat64(ctx, an->maxDecibels());
+    case AN_PROP_SMOOTHINGTIMECONSTANT: return JS_NewFloat64(ctx, an->smoothingTimeConstant());
+    case AN_PROP_FRAME_SIZE: return JS_NewInt64(ctx, int64_t(an->frameSize()));
+    case AN_PROP_AVAILABLE_FRAMES: return JS_NewInt64(ctx, int64_t(an->available()));
+    case AN_PROP_DROPPED_FRAMES: return JS_NewInt64(ctx, int64_t(an->droppedFrames()));
   }
   return JS_UNDEFINED;
 }
 
-static void
-js_audiobuffersourcenode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_audiobuffersourcenode_class_id);
+static JSValue
+js_analyser_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  JsAudioNode* w;
+  AnalyserFrameNode* an = get_analyser(ctx, this_val, &w);
+  if(!an)
+    return JS_EXCEPTION;
+  switch(magic) {
+    case AN_PROP_FFTSIZE: {
+      int32_t fftSize = 2048;
+      JS_ToInt32(ctx, &fftSize, value);
+      lab::ContextRenderLock renderLock(w->ctx.get(), "AnalyserNode.fftSize");
+      an->setFftSize(renderLock, fftSize);
+      an->configure();
+      break;
+    }
+    case AN_PROP_MINDECIBELS: {
+      double d; JS_ToFloat64(ctx, &d, value);
+      an->setMinDecibels(d);
+      break;
+    }
+    case AN_PROP_MAXDECIBELS: {
+      double d; JS_ToFloat64(ctx, &d, value);
+      an->setMaxDecibels(d);
+      break;
+    }
+    case AN_PROP_SMOOTHINGTIMECONSTANT: {
+      double d; JS_ToFloat64(ctx, &d, value);
+      an->setSmoothingTimeConstant(d);
+      break;
+    }
+  }
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_audiobuffersourcenode_class = {
-    .class_name = "AudioBufferSourceNode",
-    .finalizer = js_audiobuffersourcenode_finalizer,
+enum {
+  AN_METHOD_GET_FLOAT_FREQUENCY_DATA,
+  AN_METHOD_GET_BYTE_FREQUENCY_DATA,
+  AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA,
+  AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA,
 };
 
-static const JSCFunctionListEntry js_audiobuffersourcenode_funcs[] = {
-    JS_CFUNC_DEF("start", 0, js_absource_start),
-    JS_CGETSET_MAGIC_DEF("playbackRate", js_absource_get, 0, ABSRC_PROP_PLAYBACKRATE),
-    JS_CGETSET_MAGIC_DEF("detune", js_absource_get, 0, ABSRC_PROP_DETUNE),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioBufferSourceNode", JS_PROP_CONFIGURABLE),
-};
+static JSValue
+js_analyser_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  AnalyserFrameNode* an = get_analyser(ctx, this_val);
+  if(!an)
+    return JS_EXCEPTION;
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "requires a typed array argument");
 
-/* ---------- NoiseNode ---------- */
+  size_t byte_offset = 0, byte_length = 0, bytes_per_element = 0;
+  JSValue buf = JS_GetTypedArrayBuffer(ctx, argv[0], &byte_offset, &byte_length, &bytes_per_element);
+  if(JS_IsException(buf))
+    return JS_ThrowTypeError(ctx, "argument must be a typed array");
+  size_t ab_size = 0;
+  uint8_t* ab_data = JS_GetArrayBuffer(ctx, &ab_size, buf);
+  JS_FreeValue(ctx, buf);
+  if(!ab_data)
+    return JS_EXCEPTION;
 
-static lab::NoiseNode::NoiseType
-parse_noise_type(const char* s) {
-  if(!s)
-    return lab::NoiseNode::WHITE;
-  if(!strcmp(s, "white")) return lab::NoiseNode::WHITE;
-  if(!strcmp(s, "pink")) return lab::NoiseNode::PINK;
-  if(!strcmp(s, "brown")) return lab::NoiseNode::BROWN;
-  return lab::NoiseNode::WHITE;
+  // required size per spec: frequencyBinCount for frequency-domain data,
+  // fftSize for time-domain data. Only fill as many values as the smaller
+  // of that and what the caller's array can hold, per spec. The newest
+  // ring frame is used when there is one; lab's own analysis (the byte
+  // spectrum's `resample` too) writes into the node's scratch vectors.
+  const bool time = magic == AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA || magic == AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA;
+  const bool resample = magic == AN_METHOD_GET_BYTE_FREQUENCY_DATA && argc > 1 && JS_ToBool(ctx, argv[1]);
+  const size_t limit = time ? an->fftSize() : an->frequencyBinCount();
+  switch(magic) {
+    case AN_METHOD_GET_FLOAT_FREQUENCY_DATA:
+    case AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA: {
+      size_t len = std::min(byte_length / sizeof(float), limit);
+      float* dst = reinterpret_cast<float*>(ab_data + byte_offset);
+      if(an->latest(dst, len, time))
+        break;
+      std::vector<float>& data = an->scratch(len);
+      if(time)
+        an->getFloatTimeDomainData(data);
+      else
+        an->getFloatFrequencyData(data);
+      memcpy(dst, data.data(), len * sizeof(float));
+      break;
+    }
+    case AN_METHOD_GET_BYTE_FREQUENCY_DATA:
+    case AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA: {
+      size_t len = std::min(byte_length, limit);
+      uint8_t* dst = ab_data + byte_offset;
+      std::vector<float>& data = an->scratch(len);
+      if(!resample && an->latest(data.data(), len, time)) {
+        // The spec's conversions.
+        const double lo = an->minDecibels(), range = an->maxDecibels() - lo;
+        for(size_t i = 0; i < len; i++) {
+          double x = time ? 128 * (1 + data[i]) : 255 * (data[i] - lo) / range;
+          dst[i] = uint8_t(std::clamp(std::floor(x), 0.0, 255.0));
+        }
+        break;
+      }
+      std::vector<uint8_t>& bytes = an->byteScratch(len);
+      if(time)
+        an->getByteTimeDomainData(bytes);
+      else
+        an->getByteFrequencyData(bytes, resample);
+      memcpy(dst, bytes.data(), len);
+      break;
+    }
+  }
+  return JS_UNDEFINED;
 }
 
-static const char*
-noise_type_to_string(lab::NoiseNode::NoiseType t) {
-  switch(t) {
-    case lab::NoiseNode::PINK: return "pink";
-    case lab::NoiseNode::BROWN: return "brown";
-    case lab::NoiseNode::WHITE:
-    default: return "white";
-  }
+// Not in the spec: readFrames(Float32Array, maxFrames) copies the frames
+// analysed since the last call, oldest first, each frameSize floats:
+// frequencyBinCount dB values, then the fftSize samples they came from.
+// Returns the number copied; frames the ring overwrote before they were
+// read count in droppedFrames.
+static JSValue
+js_analyser_read_frames(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  AnalyserFrameNode* an = get_analyser(ctx, this_val);
+  if(!an)
+    return JS_EXCEPTION;
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "readFrames requires a Float32Array");
+
+  // maxFrames first: its valueOf() could detach the array.
+  uint32_t n = UINT32_MAX;
+  if(argc > 1 && !JS_IsUndefined(argv[1]) && JS_ToUint32(ctx, &n, argv[1]))
+    return JS_EXCEPTION;
+  size_t length = 0;
+  float* out = float_array_data<float>(ctx, argv[0], &length, "frames");
+  if(!out)
+    return JS_EXCEPTION;
+
+  size_t maxFrames = std::min(length / an->frameSize(), size_t(n));
+  return JS_NewInt64(ctx, int64_t(an->readFrames(out, maxFrames)));
 }
 
+static const JSCFunctionListEntry js_analysernode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("fftSize", js_analyser_get, js_analyser_set, AN_PROP_FFTSIZE),
+    JS_CGETSET_MAGIC_DEF("frequencyBinCount", js_analyser_get, 0, AN_PROP_FREQUENCYBINCOUNT),
+    JS_CGETSET_MAGIC_DEF("minDecibels", js_analyser_get, js_analyser_set, AN_PROP_MINDECIBELS),
+    JS_CGETSET_MAGIC_DEF("maxDecibels", js_analyser_get, js_analyser_set, AN_PROP_MAXDECIBELS),
+    JS_CGETSET_MAGIC_DEF("smoothingTimeConstant", js_analyser_get, js_analyser_set, AN_PROP_SMOOTHINGTIMECONSTANT),
+    JS_CFUNC_MAGIC_DEF("getFloatFrequencyData", 1, js_analyser_method, AN_METHOD_GET_FLOAT_FREQUENCY_DATA),
+    JS_CFUNC_MAGIC_DEF("getByteFrequencyData", 1, js_analyser_method, AN_METHOD_GET_BYTE_FREQUENCY_DATA),
+    JS_CFUNC_MAGIC_DEF("getFloatTimeDomainData", 1, js_analyser_method, AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA),
+    JS_CFUNC_MAGIC_DEF("getByteTimeDomainData", 1, js_analyser_method, AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA),
+    JS_CFUNC_DEF("readFrames", 1, js_analyser_read_frames),
+    JS_CGETSET_MAGIC_DEF("frameSize", js_analyser_get, 0, AN_PROP_FRAME_SIZE),
+    JS_CGETSET_MAGIC_DEF("availableFrames", js_analyser_get, 0, AN_PROP_AVAILABLE_FRAMES),
+    JS_CGETSET_MAGIC_DEF("droppedFrames", js_analyser_get, 0, AN_PROP_DROPPED_FRAMES),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AnalyserNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- DynamicsCompressorNode ---------- */
+
 static JSValue
-js_noise_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_compressor_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "NoiseNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "DynamicsCompressorNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto n = std::make_shared<lab::NoiseNode>(*ac);
+  AudioContextPtr ac = jac->ac;
+  auto comp = std::make_shared<lab::DynamicsCompressorNode>(*ac);
 
   if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "type");
-    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
-      const char* s = JS_ToCString(ctx, v);
-      if(s) {
-        n->setType(parse_noise_type(s));
-        JS_FreeCString(ctx, s);
+    static const struct { const char* name; std::shared_ptr<lab::AudioParam> (lab::DynamicsCompressorNode::*getter)(); } params[] = {
+        {"threshold", &lab::DynamicsCompressorNode::threshold},
+        {"knee", &lab::DynamicsCompressorNode::knee},
+        {"ratio", &lab::DynamicsCompressorNode::ratio},
+        {"attack", &lab::DynamicsCompressorNode::attack},
+        {"release", &lab::DynamicsCompressorNode::release},
+    };
+    for(auto& p : params) {
+      JSValue v = JS_GetPropertyStr(ctx, argv[1], p.name);
+      if(JS_IsNumber(v)) {
+        double d; JS_ToFloat64(ctx, &d, v);
+        (comp.get()->*p.getter)()->setValue(static_cast<float>(d));
       }
+      JS_FreeValue(ctx, v);
     }
-    JS_FreeValue(ctx, v);
   }
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
@@ -1849,248 +4756,296 @@ js_noise_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueC
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, noisenode_proto);
+    proto = JS_DupValue(ctx, dynamicscompressornode_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_noisenode_class_id, std::static_pointer_cast<lab::AudioNode>(n), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_dynamicscompressornode_class_id, std::static_pointer_cast<lab::AudioNode>(comp), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
-static JSValue
-js_noise_get_type(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_noisenode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  auto n = std::dynamic_pointer_cast<lab::NoiseNode>(w->node);
-  if(!n)
-    return JS_ThrowInternalError(ctx, "not a NoiseNode");
-  return JS_NewString(ctx, noise_type_to_string(n->type()));
-}
+enum {
+  DC_PROP_THRESHOLD,
+  DC_PROP_KNEE,
+  DC_PROP_RATIO,
+  DC_PROP_ATTACK,
+  DC_PROP_RELEASE,
+  DC_PROP_REDUCTION,
+};
 
 static JSValue
-js_noise_set_type(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_noisenode_class_id));
+js_compressor_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_dynamicscompressornode_class_id);
   if(!w)
     return JS_EXCEPTION;
-  auto n = std::dynamic_pointer_cast<lab::NoiseNode>(w->node);
-  if(!n)
-    return JS_ThrowInternalError(ctx, "not a NoiseNode");
-  const char* s = JS_ToCString(ctx, value);
-  if(s) {
-    n->setType(parse_noise_type(s));
-    JS_FreeCString(ctx, s);
+  auto comp = std::dynamic_pointer_cast<lab::DynamicsCompressorNode>(w->node);
+  if(!comp)
+    return JS_ThrowInternalError(ctx, "not a DynamicsCompressorNode");
+  switch(magic) {
+    case DC_PROP_THRESHOLD: return make_audio_param_js(ctx, comp->threshold());
+    case DC_PROP_KNEE: return make_audio_param_js(ctx, comp->knee());
+    case DC_PROP_RATIO: return make_audio_param_js(ctx, comp->ratio());
+    case DC_PROP_ATTACK: return make_audio_param_js(ctx, comp->attack());
+    case DC_PROP_RELEASE: return make_audio_param_js(ctx, comp->release());
+    case DC_PROP_REDUCTION: return JS_NewFloat64(ctx, comp->reduction()->value());
   }
   return JS_UNDEFINED;
 }
 
-static void
-js_noisenode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_noisenode_class_id);
-}
-
-static JSClassDef js_noisenode_class = {
-    .class_name = "NoiseNode",
-    .finalizer = js_noisenode_finalizer,
-};
-
-static const JSCFunctionListEntry js_noisenode_funcs[] = {
-    JS_CGETSET_DEF("type", js_noise_get_type, js_noise_set_type),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "NoiseNode", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_dynamicscompressornode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("threshold", js_compressor_get, 0, DC_PROP_THRESHOLD),
+    JS_CGETSET_MAGIC_DEF("knee", js_compressor_get, 0, DC_PROP_KNEE),
+    JS_CGETSET_MAGIC_DEF("ratio", js_compressor_get, 0, DC_PROP_RATIO),
+    JS_CGETSET_MAGIC_DEF("attack", js_compressor_get, 0, DC_PROP_ATTACK),
+    JS_CGETSET_MAGIC_DEF("release", js_compressor_get, 0, DC_PROP_RELEASE),
+    JS_CGETSET_MAGIC_DEF("reduction", js_compressor_get, 0, DC_PROP_REDUCTION),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "DynamicsCompressorNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- AudioSetting (delayTime shim) ---------- */
-
-static JSValue
-js_audiosetting_get_value(JSContext* ctx, JSValueConst this_val) {
-  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque2(ctx, this_val, js_audiosetting_class_id));
-  if(!w || !w->setting)
-    return JS_EXCEPTION;
-  return JS_NewFloat64(ctx, w->setting->valueFloat());
-}
-
-static JSValue
-js_audiosetting_set_value(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque2(ctx, this_val, js_audiosetting_class_id));
-  if(!w || !w->setting)
-    return JS_EXCEPTION;
-  double d;
-  if(JS_ToFloat64(ctx, &d, value))
-    return JS_EXCEPTION;
-  w->setting->setFloat(static_cast<float>(d));
-  return JS_UNDEFINED;
-}
-
-// All AudioParam-like methods collapse to immediate setFloat. AudioSetting
-// has no scheduler in lab, so the time arg is ignored. This keeps scripts
-// that use setValueAtTime / linearRamp on DelayNode.delayTime running cleanly
-// in qjs even though they only get the final value, not a smooth ramp.
-static JSValue
-js_audiosetting_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
-  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque2(ctx, this_val, js_audiosetting_class_id));
-  if(!w || !w->setting)
-    return JS_EXCEPTION;
+/* ---------- ConstantSourceNode ---------- */
+
+static JSValue
+js_constantsource_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_DupValue(ctx, this_val);
-  double d;
-  if(JS_ToFloat64(ctx, &d, argv[0]))
+    return JS_ThrowTypeError(ctx, "ConstantSourceNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  w->setting->setFloat(static_cast<float>(d));
-  return JS_DupValue(ctx, this_val);
-}
+  AudioContextPtr ac = jac->ac;
+  auto cs = std::make_shared<lab::ConstantSourceNode>(*ac);
 
-static void
-js_audiosetting_finalizer(JSRuntime* rt, JSValue val) {
-  JsAudioSetting* w = static_cast<JsAudioSetting*>(JS_GetOpaque(val, js_audiosetting_class_id));
-  if(w) {
-    w->~JsAudioSetting();
-    js_free_rt(rt, w);
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "offset");
+    if(JS_IsNumber(v)) {
+      double d; JS_ToFloat64(ctx, &d, v);
+      cs->offset()->setValue(static_cast<float>(d));
+    }
+    JS_FreeValue(ctx, v);
+  }
+
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, constantsourcenode_proto);
   }
+  JSValue obj = make_audio_node_js(ctx, proto, js_constantsourcenode_class_id, std::static_pointer_cast<lab::AudioNode>(cs), ac);
+  JS_FreeValue(ctx, proto);
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
 }
 
-static JSClassDef js_audiosetting_class = {
-    .class_name = "AudioParam",
-    .finalizer = js_audiosetting_finalizer,
-};
+static JSValue
+js_constantsource_get_offset(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_constantsourcenode_class_id);
+  if(!w)
+    return JS_EXCEPTION;
+  auto cs = std::dynamic_pointer_cast<lab::ConstantSourceNode>(w->node);
+  if(!cs)
+    return JS_ThrowInternalError(ctx, "not a ConstantSourceNode");
+  return make_audio_param_js(ctx, cs->offset());
+}
 
-static const JSCFunctionListEntry js_audiosetting_funcs[] = {
-    JS_CGETSET_DEF("value", js_audiosetting_get_value, js_audiosetting_set_value),
-    JS_CFUNC_DEF("setValueAtTime", 2, js_audiosetting_method),
-    JS_CFUNC_DEF("linearRampToValueAtTime", 2, js_audiosetting_method),
-    JS_CFUNC_DEF("exponentialRampToValueAtTime", 2, js_audiosetting_method),
-    JS_CFUNC_DEF("setTargetAtTime", 3, js_audiosetting_method),
-    JS_CFUNC_DEF("cancelScheduledValues", 1, js_audiosetting_method),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioParam", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_constantsourcenode_funcs[] = {
+    JS_CGETSET_DEF("offset", js_constantsource_get_offset, NULL),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ConstantSourceNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- DelayNode ---------- */
+/* ---------- SamplerVoicePool (native, sampler-voice-pool.hpp) ---------- */
+//
+// Not a WebAudio interface: a pool of sample-playback voices in one node,
+// for high-rate one-shots where building an AudioBufferSourceNode (+ gain
+// + panner) per hit is what costs. trigger() only queues a command for the
+// render thread; voices are preallocated and stolen oldest-first.
 
 static JSValue
-js_delay_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_samplervoicepool_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "DelayNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "SamplerVoicePool requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
+  AudioContextPtr ac = jac->ac;
 
-  double maxDelay = 2.0;
-  double initialDelay = 0.0;
-  bool haveInitial = false;
+  int32_t voices = 32;
   if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "maxDelayTime");
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "voices");
     if(JS_IsNumber(v))
-      JS_ToFloat64(ctx, &maxDelay, v);
-    JS_FreeValue(ctx, v);
-
-    v = JS_GetPropertyStr(ctx, argv[1], "delayTime");
-    if(JS_IsNumber(v)) {
-      JS_ToFloat64(ctx, &initialDelay, v);
-      haveInitial = true;
-    }
+      JS_ToInt32(ctx, &voices, v);
     JS_FreeValue(ctx, v);
   }
+  if(voices < 1 || voices > 1024)
+    return JS_ThrowRangeError(ctx, "SamplerVoicePool: voices must be in [1, 1024]");
 
-  auto d = std::make_shared<lab::DelayNode>(*ac, maxDelay);
-
-  if(d->numberOfOutputs() == 0) {
-    lab::ContextGraphLock gLock(ac.get(), "DelayNode.addOutput");
-    d->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(d.get(), 2)));
+  auto pool = std::make_shared<SamplerVoicePoolNode>(*ac, voices);
+  {
+    lab::ContextGraphLock gLock(ac.get(), "SamplerVoicePool.addOutput");
+    pool->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(pool.get(), 2)));
   }
 
-  if(haveInitial)
-    d->delayTime()->setFloat(static_cast<float>(initialDelay));
-
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, delaynode_proto);
+    proto = JS_DupValue(ctx, samplervoicepool_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_delaynode_class_id, std::static_pointer_cast<lab::AudioNode>(d), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_samplervoicepool_class_id, std::static_pointer_cast<lab::AudioNode>(pool), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
-static JSValue
-js_delay_get_delaytime(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_delaynode_class_id));
+static SamplerVoicePoolNode*
+get_samplervoicepool(JSContext* ctx, JSValueConst this_val, JsAudioNode** pw = nullptr) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_samplervoicepool_class_id);
   if(!w)
-    return JS_EXCEPTION;
-  auto d = std::dynamic_pointer_cast<lab::DelayNode>(w->node);
-  if(!d)
-    return JS_ThrowInternalError(ctx, "not a DelayNode");
-  return make_audio_setting_js(ctx, d->delayTime());
+    return nullptr;
+  if(pw)
+    *pw = w;
+  return static_cast<SamplerVoicePoolNode*>(w->node.get());
 }
 
-static void
-js_delaynode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_delaynode_class_id);
-}
+// pool.trigger(buffer, when = 0, {gain, pan, rate, offset}) -> false if the
+// command queue was full and the hit was dropped.
+static JSValue
+js_samplervoicepool_trigger(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioNode* w;
+  SamplerVoicePoolNode* pool = get_samplervoicepool(ctx, this_val, &w);
+  if(!pool)
+    return JS_EXCEPTION;
+  if(argc < 1)
+    return JS_ThrowTypeError(ctx, "trigger requires an AudioBuffer");
+  JsAudioBuffer* ab = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, argv[0], js_audiobuffer_class_id));
+  if(!ab || !ab->bus)
+    return JS_EXCEPTION;
 
-static JSClassDef js_delaynode_class = {
-    .class_name = "DelayNode",
-    .finalizer = js_delaynode_finalizer,
-};
+  SamplerVoicePoolNode::Command cmd;
+  double when = 0;
+  if(argc > 1 && JS_ToFloat64(ctx, &when, argv[1]))
+    return JS_EXCEPTION;
+  cmd.frame = when > 0 ? uint64_t(std::llround(when * w->ctx->sampleRate())) : 0;
 
-static const JSCFunctionListEntry js_delaynode_funcs[] = {
-    JS_CGETSET_DEF("delayTime", js_delay_get_delaytime, NULL),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "DelayNode", JS_PROP_CONFIGURABLE),
-};
+  if(argc > 2 && JS_IsObject(argv[2])) {
+    static const char* const names[] = {"gain", "pan", "rate"};
+    float* fields[] = {&cmd.gain, &cmd.pan, &cmd.rate};
+    for(int i = 0; i < 3; i++) {
+      JSValue v = JS_GetPropertyStr(ctx, argv[2], names[i]);
+      if(JS_IsNumber(v)) {
+        double d;
+        JS_ToFloat64(ctx, &d, v);
+        *fields[i] = static_cast<float>(d);
+        if(fields[i] == &cmd.pan)
+          cmd.panned = true;
+      }
+      JS_FreeValue(ctx, v);
+    }
+    JSValue v = JS_GetPropertyStr(ctx, argv[2], "offset");
+    if(JS_IsNumber(v))
+      JS_ToFloat64(ctx, &cmd.offset, v);
+    JS_FreeValue(ctx, v);
+  }
 
-/* ---------- WaveShaperNode ---------- */
+  cmd.bus = acquire_audio_buffer(ctx, ab);
+  return JS_NewBool(ctx, pool->trigger(std::move(cmd)));
+}
 
-static lab::OverSampleType
-parse_oversample(const char* s) {
-  if(!s)
-    return lab::OverSampleType::NONE;
-  if(!strcmp(s, "none")) return lab::OverSampleType::NONE;
-  if(!strcmp(s, "2x"))   return lab::OverSampleType::_2X;
-  if(!strcmp(s, "4x"))   return lab::OverSampleType::_4X;
-  return lab::OverSampleType::NONE;
+static JSValue
+js_samplervoicepool_stop_all(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  SamplerVoicePoolNode* pool = get_samplervoicepool(ctx, this_val);
+  if(!pool)
+    return JS_EXCEPTION;
+  return JS_NewBool(ctx, pool->stopAll());
 }
 
-static const char*
-oversample_to_string(lab::OverSampleType t) {
-  switch(t) {
-    case lab::OverSampleType::_2X: return "2x";
-    case lab::OverSampleType::_4X: return "4x";
-    case lab::OverSampleType::NONE:
-    default: return "none";
+enum {
+  SVP_PROP_VOICES,
+  SVP_PROP_ACTIVE_VOICES,
+  SVP_PROP_STOLEN_VOICES,
+  SVP_PROP_DROPPED_TRIGGERS,
+};
+
+static JSValue
+js_samplervoicepool_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  SamplerVoicePoolNode* pool = get_samplervoicepool(ctx, this_val);
+  if(!pool)
+    return JS_EXCEPTION;
+  switch(magic) {
+    case SVP_PROP_VOICES: return JS_NewInt32(ctx, pool->voiceCount());
+    case SVP_PROP_ACTIVE_VOICES: return JS_NewInt32(ctx, pool->activeVoices());
+    case SVP_PROP_STOLEN_VOICES: return JS_NewInt64(ctx, int64_t(pool->stolenVoices()));
+    case SVP_PROP_DROPPED_TRIGGERS: return JS_NewInt64(ctx, int64_t(pool->droppedTriggers()));
   }
+  return JS_UNDEFINED;
 }
 
+static const JSCFunctionListEntry js_samplervoicepool_funcs[] = {
+    JS_CFUNC_DEF("trigger", 1, js_samplervoicepool_trigger),
+    JS_CFUNC_DEF("stopAll", 0, js_samplervoicepool_stop_all),
+    JS_CGETSET_MAGIC_DEF("voices", js_samplervoicepool_get, 0, SVP_PROP_VOICES),
+    JS_CGETSET_MAGIC_DEF("activeVoices", js_samplervoicepool_get, 0, SVP_PROP_ACTIVE_VOICES),
+    JS_CGETSET_MAGIC_DEF("stolenVoices", js_samplervoicepool_get, 0, SVP_PROP_STOLEN_VOICES),
+    JS_CGETSET_MAGIC_DEF("droppedTriggers", js_samplervoicepool_get, 0, SVP_PROP_DROPPED_TRIGGERS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "SamplerVoicePool", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- ADSRNode (lab::ADSRNode) ---------- */
+//
+// Not a WebAudio interface: LabSound's envelope generator, which multiplies
+// its input by an attack/decay/sustain/release envelope evaluated on the
+// render thread. The envelope follows the a-rate `gate` param -- rising
+// edge starts the attack, falling edge the release -- so noteOn()/noteOff()
+// are a single gate event each instead of a chain of ramps on a gain. Feed
+// it a ConstantSourceNode to use the envelope itself as a control signal.
+// The stage times/levels are lab AudioSettings (see the delayTime shim):
+// they apply immediately, not at a scheduled time.
+
 static JSValue
-js_waveshaper_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_adsr_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "WaveShaperNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "ADSRNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto ws = std::make_shared<lab::WaveShaperNode>(*ac);
+  AudioContextPtr ac = jac->ac;
 
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v;
+  auto adsr = std::make_shared<lab::ADSRNode>(*ac);
 
-    v = JS_GetPropertyStr(ctx, argv[1], "curve");
-    if(!JS_IsUndefined(v) && !JS_IsNull(v)) {
-      std::vector<float> curve;
-      if(read_float_array(ctx, v, curve) == 0 && !curve.empty())
-        ws->setCurve(curve);
-    }
-    JS_FreeValue(ctx, v);
+  if(adsr->numberOfOutputs() == 0) {
+    lab::ContextGraphLock gLock(ac.get(), "ADSRNode.addOutput");
+    adsr->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(adsr.get(), 2)));
+  }
 
-    v = JS_GetPropertyStr(ctx, argv[1], "oversample");
-    if(!JS_IsUndefined(v) && !JS_IsException(v)) {
-      const char* s = JS_ToCString(ctx, v);
-      if(s) {
-        ws->setOversample(parse_oversample(s));
-        JS_FreeCString(ctx, s);
-      }
+  // {attackTime, attackLevel, decayTime, sustainTime, sustainLevel,
+  //  releaseTime, oneShot}, also accepting attack/decay/sustain/release as
+  // the shorter names synth.js's ADSR uses (sustain being a level there).
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    static const struct {
+      const char* name;
+      std::shared_ptr<lab::AudioSetting> (lab::ADSRNode::*setting)() const;
+    } options[] = {
+        {"attack", &lab::ADSRNode::attackTime},
+        {"attackTime", &lab::ADSRNode::attackTime},
+        {"attackLevel", &lab::ADSRNode::attackLevel},
+        {"decay", &lab::ADSRNode::decayTime},
+        {"decayTime", &lab::ADSRNode::decayTime},
+        {"sustain", &lab::ADSRNode::sustainLevel},
+        {"sustainLevel", &lab::ADSRNode::sustainLevel},
+        {"sustainTime", &lab::ADSRNode::sustainTime},
+        {"release", &lab::ADSRNode::releaseTime},
+        {"releaseTime", &lab::ADSRNode::releaseTime},
+    };
+    for(const auto& opt : options) {
+      JSValue v = JS_GetPropertyStr(ctx, argv[1], opt.name);
+      double d;
+      if(JS_IsNumber(v) && !JS_ToFloat64(ctx, &d, v))
+        ((*adsr).*opt.setting)()->setFloat(static_cast<float>(d));
+      JS_FreeValue(ctx, v);
     }
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "oneShot");
+    if(!JS_IsUndefined(v))
+      adsr->oneShot()->setBool(JS_ToBool(ctx, v));
     JS_FreeValue(ctx, v);
   }
 
@@ -2099,156 +5054,326 @@ js_waveshaper_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSV
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, waveshapernode_proto);
+    proto = JS_DupValue(ctx, adsrnode_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_waveshapernode_class_id, std::static_pointer_cast<lab::AudioNode>(ws), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_adsrnode_class_id, std::static_pointer_cast<lab::AudioNode>(adsr), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
-static JSValue
-js_waveshaper_get_oversample(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_waveshapernode_class_id));
+static std::shared_ptr<lab::ADSRNode>
+get_adsr(JSContext* ctx, JSValueConst this_val, JsAudioNode** wp = nullptr) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_adsrnode_class_id);
   if(!w)
-    return JS_EXCEPTION;
-  auto ws = std::dynamic_pointer_cast<lab::WaveShaperNode>(w->node);
-  if(!ws)
-    return JS_ThrowInternalError(ctx, "not a WaveShaperNode");
-  return JS_NewString(ctx, oversample_to_string(ws->oversample()));
+    return nullptr;
+  auto adsr = std::dynamic_pointer_cast<lab::ADSRNode>(w->node);
+  if(!adsr) {
+    JS_ThrowInternalError(ctx, "not an ADSRNode");
+    return nullptr;
+  }
+  if(wp)
+    *wp = w;
+  return adsr;
 }
 
+enum {
+  ADSR_METHOD_NOTE_ON,
+  ADSR_METHOD_NOTE_OFF,
+  ADSR_METHOD_TRIGGER,
+};
+
+// noteOn(when = currentTime, retrigger = true), noteOff(when = currentTime),
+// trigger(when, duration, retrigger = true) for both at once. A retrigger
+// drops the gate for one sample first, so a held note restarts its attack.
 static JSValue
-js_waveshaper_set_oversample(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_waveshapernode_class_id));
-  if(!w)
+js_adsr_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JsAudioNode* w;
+  auto adsr = get_adsr(ctx, this_val, &w);
+  if(!adsr)
     return JS_EXCEPTION;
-  auto ws = std::dynamic_pointer_cast<lab::WaveShaperNode>(w->node);
-  if(!ws)
-    return JS_ThrowInternalError(ctx, "not a WaveShaperNode");
-  const char* s = JS_ToCString(ctx, value);
-  if(s) {
-    ws->setOversample(parse_oversample(s));
-    JS_FreeCString(ctx, s);
+
+  double when = w->ctx->currentTime(), duration = 0;
+  if(argc > 0 && !JS_IsUndefined(argv[0]) && JS_ToFloat64(ctx, &when, argv[0]))
+    return JS_EXCEPTION;
+  if(magic == ADSR_METHOD_TRIGGER) {
+    if(argc < 2)
+      return JS_ThrowTypeError(ctx, "trigger requires (when, duration)");
+    if(JS_ToFloat64(ctx, &duration, argv[1]))
+      return JS_EXCEPTION;
+    if(!(duration >= 0))
+      return JS_ThrowRangeError(ctx, "trigger: duration must be >= 0");
+  }
+  if(!(when >= 0))
+    return JS_ThrowRangeError(ctx, "when must be >= 0");
+
+  auto gate = adsr->gate();
+  if(magic == ADSR_METHOD_NOTE_OFF) {
+    gate->setValueAtTime(0.f, (float)when);
+    return JS_UNDEFINED;
   }
+
+  int retriggerArg = magic == ADSR_METHOD_TRIGGER ? 2 : 1;
+  bool retrigger = argc > retriggerArg && !JS_IsUndefined(argv[retriggerArg]) ? JS_ToBool(ctx, argv[retriggerArg]) : true;
+  double sample = 1.0 / w->ctx->sampleRate();
+  if(retrigger && when >= sample)
+    gate->setValueAtTime(0.f, (float)(when - sample));
+  gate->setValueAtTime(1.f, (float)when);
+  if(magic == ADSR_METHOD_TRIGGER)
+    gate->setValueAtTime(0.f, (float)(when + duration));
   return JS_UNDEFINED;
 }
 
+enum {
+  ADSR_PROP_GATE,
+  ADSR_PROP_ATTACK_TIME,
+  ADSR_PROP_ATTACK_LEVEL,
+  ADSR_PROP_DECAY_TIME,
+  ADSR_PROP_SUSTAIN_TIME,
+  ADSR_PROP_SUSTAIN_LEVEL,
+  ADSR_PROP_RELEASE_TIME,
+  ADSR_PROP_ONE_SHOT,
+  ADSR_PROP_FINISHED,
+};
+
 static JSValue
-js_waveshaper_set_curve(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_waveshapernode_class_id));
-  if(!w)
+js_adsr_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w;
+  auto adsr = get_adsr(ctx, this_val, &w);
+  if(!adsr)
     return JS_EXCEPTION;
-  auto ws = std::dynamic_pointer_cast<lab::WaveShaperNode>(w->node);
-  if(!ws)
-    return JS_ThrowInternalError(ctx, "not a WaveShaperNode");
-  std::vector<float> curve;
-  if(read_float_array(ctx, value, curve) == 0 && !curve.empty())
-    ws->setCurve(curve);
+  switch(magic) {
+    case ADSR_PROP_GATE: return make_audio_param_js(ctx, adsr->gate());
+    case ADSR_PROP_ATTACK_TIME: return make_audio_setting_js(ctx, adsr->attackTime());
+    case ADSR_PROP_ATTACK_LEVEL: return make_audio_setting_js(ctx, adsr->attackLevel());
+    case ADSR_PROP_DECAY_TIME: return make_audio_setting_js(ctx, adsr->decayTime());
+    case ADSR_PROP_SUSTAIN_TIME: return make_audio_setting_js(ctx, adsr->sustainTime());
+    case ADSR_PROP_SUSTAIN_LEVEL: return make_audio_setting_js(ctx, adsr->sustainLevel());
+    case ADSR_PROP_RELEASE_TIME: return make_audio_setting_js(ctx, adsr->releaseTime());
+    case ADSR_PROP_ONE_SHOT: return JS_NewBool(ctx, adsr->oneShot()->valueBool());
+    case ADSR_PROP_FINISHED: {
+      lab::ContextRenderLock r(w->ctx.get(), "ADSRNode.finished");
+      return JS_NewBool(ctx, adsr->finished(r));
+    }
+  }
   return JS_UNDEFINED;
 }
 
-static void
-js_waveshapernode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_waveshapernode_class_id);
+static JSValue
+js_adsr_set_oneshot(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  auto adsr = get_adsr(ctx, this_val);
+  if(!adsr)
+    return JS_EXCEPTION;
+  adsr->oneShot()->setBool(JS_ToBool(ctx, value));
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_waveshapernode_class = {
-    .class_name = "WaveShaperNode",
-    .finalizer = js_waveshapernode_finalizer,
+static const JSCFunctionListEntry js_adsrnode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("gate", js_adsr_get, 0, ADSR_PROP_GATE),
+    JS_CGETSET_MAGIC_DEF("attackTime", js_adsr_get, 0, ADSR_PROP_ATTACK_TIME),
+    JS_CGETSET_MAGIC_DEF("attackLevel", js_adsr_get, 0, ADSR_PROP_ATTACK_LEVEL),
+    JS_CGETSET_MAGIC_DEF("decayTime", js_adsr_get, 0, ADSR_PROP_DECAY_TIME),
+    JS_CGETSET_MAGIC_DEF("sustainTime", js_adsr_get, 0, ADSR_PROP_SUSTAIN_TIME),
+    JS_CGETSET_MAGIC_DEF("sustainLevel", js_adsr_get, 0, ADSR_PROP_SUSTAIN_LEVEL),
+    JS_CGETSET_MAGIC_DEF("releaseTime", js_adsr_get, 0, ADSR_PROP_RELEASE_TIME),
+    JS_CGETSET_MAGIC_DEF("oneShot", js_adsr_get, js_adsr_set_oneshot, ADSR_PROP_ONE_SHOT),
+    JS_CGETSET_MAGIC_DEF("finished", js_adsr_get, 0, ADSR_PROP_FINISHED),
+    JS_CFUNC_MAGIC_DEF("noteOn", 0, js_adsr_method, ADSR_METHOD_NOTE_ON),
+    JS_CFUNC_MAGIC_DEF("noteOff", 0, js_adsr_method, ADSR_METHOD_NOTE_OFF),
+    JS_CFUNC_MAGIC_DEF("trigger", 2, js_adsr_method, ADSR_METHOD_TRIGGER),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ADSRNode", JS_PROP_CONFIGURABLE),
 };
 
-static const JSCFunctionListEntry js_waveshapernode_funcs[] = {
-    JS_CGETSET_DEF("oversample", js_waveshaper_get_oversample, js_waveshaper_set_oversample),
-    JS_CGETSET_DEF("curve", NULL, js_waveshaper_set_curve),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "WaveShaperNode", JS_PROP_CONFIGURABLE),
-};
+/* ---------- Composite effects (native, composite-effects.hpp) ---------- */
+//
+// Not WebAudio interfaces: FeedbackDelayNode, PingPongDelayNode and
+// StereoWidthNode are the effects.js blocks as single nodes, one per-sample
+// loop each instead of a subgraph of delays, gains and panners. Their
+// parameters are ordinary a-rate AudioParams, set from the options object
+// by name; the delays also take maxDelayTime, fixed at construction.
 
-/* ---------- StereoPannerNode ---------- */
+enum {
+  FX_FEEDBACK_DELAY,
+  FX_PING_PONG_DELAY,
+  FX_STEREO_WIDTH,
+};
 
 static JSValue
-js_stereopanner_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_composite_effect_construct(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[], int kind) {
+  static const char* const names[] = {"FeedbackDelayNode", "PingPongDelayNode", "StereoWidthNode"};
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "StereoPannerNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "%s requires an AudioContext", names[kind]);
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto sp = std::make_shared<lab::StereoPannerNode>(*ac);
+  AudioContextPtr ac = jac->ac;
 
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "pan");
-    if(JS_IsNumber(v)) {
-      double d; JS_ToFloat64(ctx, &d, v);
-      sp->pan()->setValue(static_cast<float>(d));
-    }
+  double maxDelayTime = kind == FX_PING_PONG_DELAY ? 4.0 : 2.0;
+  if(kind != FX_STEREO_WIDTH && argc > 1 && JS_IsObject(argv[1])) {
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "maxDelayTime");
+    if(JS_IsNumber(v))
+      JS_ToFloat64(ctx, &maxDelayTime, v);
     JS_FreeValue(ctx, v);
+    if(!(maxDelayTime > 0 && maxDelayTime <= 180))
+      return JS_ThrowRangeError(ctx, "%s: maxDelayTime must be in (0, 180]", names[kind]);
+  }
+
+  std::shared_ptr<CompositeEffectNode> node;
+  JSClassID class_id;
+  JSValueConst default_proto;
+  switch(kind) {
+    case FX_FEEDBACK_DELAY:
+      node = std::make_shared<FeedbackDelayNode>(*ac, maxDelayTime);
+      class_id = js_feedbackdelaynode_class_id;
+      default_proto = feedbackdelaynode_proto;
+      break;
+    case FX_PING_PONG_DELAY:
+      node = std::make_shared<PingPongDelayNode>(*ac, maxDelayTime);
+      class_id = js_pingpongdelaynode_class_id;
+      default_proto = pingpongdelaynode_proto;
+      break;
+    default:
+      node = std::make_shared<StereoWidthNode>(*ac);
+      class_id = js_stereowidthnode_class_id;
+      default_proto = stereowidthnode_proto;
+      break;
   }
+  {
+    lab::ContextGraphLock gLock(ac.get(), "CompositeEffect.addInput");
+    node->addInput(gLock, std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(node.get())));
+    node->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(node.get(), 2)));
+  }
+
+  if(argc > 1 && JS_IsObject(argv[1]))
+    for(const lab::AudioParamDescriptor* p = node->paramDescriptors(); p && p->name; p++) {
+      JSValue v = JS_GetPropertyStr(ctx, argv[1], p->name);
+      if(JS_IsNumber(v)) {
+        double d;
+        JS_ToFloat64(ctx, &d, v);
+        node->param(p->name)->setValue(static_cast<float>(d));
+      }
+      JS_FreeValue(ctx, v);
+    }
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, stereopannernode_proto);
+    proto = JS_DupValue(ctx, default_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_stereopannernode_class_id, std::static_pointer_cast<lab::AudioNode>(sp), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, class_id, std::static_pointer_cast<lab::AudioNode>(node), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
 static JSValue
-js_stereopanner_get_pan(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_stereopannernode_class_id));
-  if(!w)
+js_feedbackdelaynode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  return js_composite_effect_construct(ctx, new_target, argc, argv, FX_FEEDBACK_DELAY);
+}
+
+static JSValue
+js_pingpongdelaynode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  return js_composite_effect_construct(ctx, new_target, argc, argv, FX_PING_PONG_DELAY);
+}
+
+static JSValue
+js_stereowidthnode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  return js_composite_effect_construct(ctx, new_target, argc, argv, FX_STEREO_WIDTH);
+}
+
+static CompositeEffectNode*
+get_composite_effect(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = any_audio_node(this_val);
+  if(w && (w->kind == js_feedbackdelaynode_class_id || w->kind == js_pingpongdelaynode_class_id || w->kind == js_stereowidthnode_class_id))
+    return static_cast<CompositeEffectNode*>(w->node.get());
+  JS_ThrowTypeError(ctx, "not a composite effect node");
+  return nullptr;
+}
+
+// magic = index into the node's parameter descriptor.
+static JSValue
+js_composite_effect_get_param(JSContext* ctx, JSValueConst this_val, int magic) {
+  CompositeEffectNode* node = get_composite_effect(ctx, this_val);
+  if(!node)
     return JS_EXCEPTION;
-  auto sp = std::dynamic_pointer_cast<lab::StereoPannerNode>(w->node);
-  if(!sp)
-    return JS_ThrowInternalError(ctx, "not a StereoPannerNode");
-  return make_audio_param_js(ctx, sp->pan());
+  return make_audio_param_js(ctx, node->effectParam(magic));
 }
 
-static void
-js_stereopannernode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_stereopannernode_class_id);
+static JSValue
+js_composite_effect_get_max_delay_time(JSContext* ctx, JSValueConst this_val) {
+  CompositeEffectNode* node = get_composite_effect(ctx, this_val);
+  if(!node)
+    return JS_EXCEPTION;
+  if(auto* fd = dynamic_cast<FeedbackDelayNode*>(node))
+    return JS_NewFloat64(ctx, fd->maxDelayTime());
+  if(auto* pp = dynamic_cast<PingPongDelayNode*>(node))
+    return JS_NewFloat64(ctx, pp->maxDelayTime());
+  return JS_UNDEFINED;
 }
 
-static JSClassDef js_stereopannernode_class = {
-    .class_name = "StereoPannerNode",
-    .finalizer = js_stereopannernode_finalizer,
+static const JSCFunctionListEntry js_feedbackdelaynode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("delayTime", js_composite_effect_get_param, 0, FeedbackDelayNode::DELAY_TIME),
+    JS_CGETSET_MAGIC_DEF("feedback", js_composite_effect_get_param, 0, FeedbackDelayNode::FEEDBACK),
+    JS_CGETSET_MAGIC_DEF("wet", js_composite_effect_get_param, 0, FeedbackDelayNode::WET),
+    JS_CGETSET_MAGIC_DEF("dry", js_composite_effect_get_param, 0, FeedbackDelayNode::DRY),
+    JS_CGETSET_DEF("maxDelayTime", js_composite_effect_get_max_delay_time, 0),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "FeedbackDelayNode", JS_PROP_CONFIGURABLE),
 };
 
-static const JSCFunctionListEntry js_stereopannernode_funcs[] = {
-    JS_CGETSET_DEF("pan", js_stereopanner_get_pan, NULL),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "StereoPannerNode", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_pingpongdelaynode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("delayTime", js_composite_effect_get_param, 0, PingPongDelayNode::DELAY_TIME),
+    JS_CGETSET_MAGIC_DEF("feedback", js_composite_effect_get_param, 0, PingPongDelayNode::FEEDBACK),
+    JS_CGETSET_MAGIC_DEF("wet", js_composite_effect_get_param, 0, PingPongDelayNode::WET),
+    JS_CGETSET_MAGIC_DEF("dry", js_composite_effect_get_param, 0, PingPongDelayNode::DRY),
+    JS_CGETSET_DEF("maxDelayTime", js_composite_effect_get_max_delay_time, 0),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "PingPongDelayNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- ConvolverNode ---------- */
+static const JSCFunctionListEntry js_stereowidthnode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("width", js_composite_effect_get_param, 0, StereoWidthNode::WIDTH),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "StereoWidthNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- ParallelMixerNode (native, parallel-mixer.hpp) ---------- */
+//
+// Not a WebAudio interface: a summing point whose inputs are rendered in
+// parallel. Connect independent branches (a drum bus, a synth bus) to it
+// instead of straight to a shared gain; connections that share an upstream
+// node are kept on one thread. `parallel: false` sums them serially, which
+// is the same as a GainNode at unity.
+
+enum {
+  PM_PROP_PARALLEL,
+  PM_PROP_BRANCHES,
+  PM_PROP_GROUPS,
+  PM_PROP_WORKERS,
+};
 
 static JSValue
-js_convolver_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_parallelmixernode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "ConvolverNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "ParallelMixerNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto conv = std::make_shared<lab::ConvolverNode>(*ac);
+  AudioContextPtr ac = jac->ac;
 
+  bool parallel = true;
   if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "buffer");
-    if(JS_IsObject(v)) {
-      JsAudioBuffer* buf = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, v, js_audiobuffer_class_id));
-      if(buf && buf->bus)
-        conv->setImpulse(buf->bus);
-    }
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "parallel");
+    if(!JS_IsUndefined(v))
+      parallel = JS_ToBool(ctx, v);
     JS_FreeValue(ctx, v);
+  }
 
-    v = JS_GetPropertyStr(ctx, argv[1], "normalize");
-    if(!JS_IsUndefined(v) && !JS_IsException(v))
-      conv->setNormalize(JS_ToBool(ctx, v));
-    JS_FreeValue(ctx, v);
+  auto node = std::make_shared<ParallelMixerNode>(*ac);
+  node->parallel.store(parallel, std::memory_order_relaxed);
+  {
+    lab::ContextGraphLock gLock(ac.get(), "ParallelMixer.addInput");
+    node->addInput(gLock, std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(node.get())));
+    node->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(node.get(), 2)));
   }
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
@@ -2256,326 +5381,519 @@ js_convolver_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSVa
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, convolvernode_proto);
+    proto = JS_DupValue(ctx, parallelmixernode_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_convolvernode_class_id, std::static_pointer_cast<lab::AudioNode>(conv), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_parallelmixernode_class_id, std::static_pointer_cast<lab::AudioNode>(node), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
-static JSValue
-js_convolver_get_buffer(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_convolvernode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  auto conv = std::dynamic_pointer_cast<lab::ConvolverNode>(w->node);
-  if(!conv)
-    return JS_ThrowInternalError(ctx, "not a ConvolverNode");
-  auto impulse = conv->getImpulse();
-  if(!impulse)
-    return JS_NULL;
-  return make_audio_buffer_js(ctx, impulse);
+static ParallelMixerNode*
+get_parallel_mixer(JSContext* ctx, JSValueConst this_val) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_parallelmixernode_class_id);
+  return w ? static_cast<ParallelMixerNode*>(w->node.get()) : nullptr;
 }
 
 static JSValue
-js_convolver_set_buffer(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_convolvernode_class_id));
-  if(!w)
+js_parallelmixernode_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  ParallelMixerNode* node = get_parallel_mixer(ctx, this_val);
+  if(!node)
     return JS_EXCEPTION;
-  auto conv = std::dynamic_pointer_cast<lab::ConvolverNode>(w->node);
-  if(!conv)
-    return JS_ThrowInternalError(ctx, "not a ConvolverNode");
-  JsAudioBuffer* buf = static_cast<JsAudioBuffer*>(JS_GetOpaque2(ctx, value, js_audiobuffer_class_id));
-  if(!buf)
-    return JS_EXCEPTION;
-  conv->setImpulse(buf->bus);
+  switch(magic) {
+    case PM_PROP_PARALLEL: return JS_NewBool(ctx, node->parallel.load(std::memory_order_relaxed));
+    case PM_PROP_BRANCHES: return JS_NewInt32(ctx, node->branchCount.load(std::memory_order_relaxed));
+    case PM_PROP_GROUPS: return JS_NewInt32(ctx, node->groupCount.load(std::memory_order_relaxed));
+    case PM_PROP_WORKERS: return JS_NewInt32(ctx, node->workerCount());
+  }
   return JS_UNDEFINED;
 }
 
 static JSValue
-js_convolver_get_normalize(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_convolvernode_class_id));
-  if(!w)
-    return JS_EXCEPTION;
-  auto conv = std::dynamic_pointer_cast<lab::ConvolverNode>(w->node);
-  if(!conv)
-    return JS_ThrowInternalError(ctx, "not a ConvolverNode");
-  return JS_NewBool(ctx, conv->normalize());
-}
-
-static JSValue
-js_convolver_set_normalize(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_convolvernode_class_id));
-  if(!w)
+js_parallelmixernode_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  ParallelMixerNode* node = get_parallel_mixer(ctx, this_val);
+  if(!node)
     return JS_EXCEPTION;
-  auto conv = std::dynamic_pointer_cast<lab::ConvolverNode>(w->node);
-  if(!conv)
-    return JS_ThrowInternalError(ctx, "not a ConvolverNode");
-  conv->setNormalize(JS_ToBool(ctx, value));
+  if(magic == PM_PROP_PARALLEL)
+    node->parallel.store(JS_ToBool(ctx, value), std::memory_order_relaxed);
   return JS_UNDEFINED;
 }
 
-static void
-js_convolvernode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_convolvernode_class_id);
-}
-
-static JSClassDef js_convolvernode_class = {
-    .class_name = "ConvolverNode",
-    .finalizer = js_convolvernode_finalizer,
+static const JSCFunctionListEntry js_parallelmixernode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("parallel", js_parallelmixernode_get, js_parallelmixernode_set, PM_PROP_PARALLEL),
+    JS_CGETSET_MAGIC_DEF("branches", js_parallelmixernode_get, 0, PM_PROP_BRANCHES),
+    JS_CGETSET_MAGIC_DEF("groups", js_parallelmixernode_get, 0, PM_PROP_GROUPS),
+    JS_CGETSET_MAGIC_DEF("workers", js_parallelmixernode_get, 0, PM_PROP_WORKERS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ParallelMixerNode", JS_PROP_CONFIGURABLE),
 };
 
-static const JSCFunctionListEntry js_convolvernode_funcs[] = {
-    JS_CGETSET_DEF("buffer", js_convolver_get_buffer, js_convolver_set_buffer),
-    JS_CGETSET_DEF("normalize", js_convolver_get_normalize, js_convolver_set_normalize),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ConvolverNode", JS_PROP_CONFIGURABLE),
+/* ---------- ExpressionNode (native, expression-node.hpp) ---------- */
+//
+// Not a WebAudio interface: per-sample math without ScriptProcessorNode's
+// callback into JS. The expression is compiled once, here, and a syntax
+// error is thrown from the constructor with its position:
+//
+//   new ExpressionNode(ctx, {expr: 'tanh(in0 * drive) * in1', params: [{name: 'drive', defaultValue: 4}]})
+//
+// `params` entries are a name, a default value (named pK) or
+// {name, defaultValue, minValue, maxValue}; each becomes an a-rate
+// AudioParam in `parameters`. `inputs` defaults to the highest inK the
+// expression reads, `channelCount` (default 2) is the output's width.
+
+enum {
+  EXPR_PROP_EXPR,
+  EXPR_PROP_PARAMETERS,
 };
 
-/* ---------- AnalyserNode ---------- */
+static int
+get_expression_params(JSContext* ctx, JSValueConst list, std::vector<DynamicParams::Spec>& specs) {
+  if(JS_IsUndefined(list))
+    return 0;
+  if(!JS_IsArray(ctx, list))
+    return JS_ThrowTypeError(ctx, "ExpressionNode: params must be an array"), -1;
+  uint32_t length = 0;
+  JSValue lenv = JS_GetPropertyStr(ctx, list, "length");
+  JS_ToUint32(ctx, &length, lenv);
+  JS_FreeValue(ctx, lenv);
+  if(length > 32)
+    return JS_ThrowRangeError(ctx, "ExpressionNode: at most 32 params"), -1;
+
+  for(uint32_t k = 0; k < length; k++) {
+    DynamicParams::Spec spec;
+    spec.name = "p" + std::to_string(k);
+    JSValue item = JS_GetPropertyUint32(ctx, list, k);
+    int ret = 0;
+    if(JS_IsString(item)) {
+      const char* s = JS_ToCString(ctx, item);
+      if(s)
+        spec.name = s;
+      JS_FreeCString(ctx, s);
+    } else if(JS_IsNumber(item)) {
+      double d;
+      JS_ToFloat64(ctx, &d, item);
+      spec.defaultValue = float(d);
+    } else if(JS_IsObject(item)) {
+      JSValue v = JS_GetPropertyStr(ctx, item, "name");
+      if(JS_IsString(v)) {
+        const char* s = JS_ToCString(ctx, v);
+        if(s)
+          spec.name = s;
+        JS_FreeCString(ctx, s);
+      }
+      JS_FreeValue(ctx, v);
+      static const char* const fields[] = {"defaultValue", "minValue", "maxValue"};
+      float* values[] = {&spec.defaultValue, &spec.minValue, &spec.maxValue};
+      for(int i = 0; i < 3; i++) {
+        JSValue v = JS_GetPropertyStr(ctx, item, fields[i]);
+        double d;
+        if(JS_IsNumber(v) && !JS_ToFloat64(ctx, &d, v))
+          *values[i] = float(d);
+        JS_FreeValue(ctx, v);
+      }
+    } else {
+      ret = -1;
+    }
+    JS_FreeValue(ctx, item);
+
+    bool ident = !spec.name.empty() && !isdigit((unsigned char)spec.name[0]);
+    for(char c : spec.name)
+      ident = ident && (isalnum((unsigned char)c) || c == '_');
+    if(ret || !ident)
+      return JS_ThrowTypeError(ctx, "ExpressionNode: params[%d] must be a name, a number or {name, defaultValue, minValue, maxValue}", int(k)), -1;
+    if(!(spec.minValue <= spec.maxValue))
+      return JS_ThrowRangeError(ctx, "ExpressionNode: params[%d] has minValue > maxValue", int(k)), -1;
+    spec.defaultValue = std::clamp(spec.defaultValue, spec.minValue, spec.maxValue);
+    for(const auto& s : specs)
+      if(s.name == spec.name)
+        return JS_ThrowTypeError(ctx, "ExpressionNode: duplicate param '%s'", spec.name.c_str()), -1;
+    specs.push_back(std::move(spec));
+  }
+  return 0;
+}
 
 static JSValue
-js_analyser_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_expressionnode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "AnalyserNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "ExpressionNode requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto an = std::make_shared<lab::AnalyserNode>(*ac);
+  AudioContextPtr ac = jac->ac;
 
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "fftSize");
-    if(JS_IsNumber(v)) {
-      int32_t fftSize = 2048;
-      JS_ToInt32(ctx, &fftSize, v);
-      lab::ContextRenderLock renderLock(ac.get(), "AnalyserNode.fftSize");
-      an->setFftSize(renderLock, fftSize);
-    }
-    JS_FreeValue(ctx, v);
+  if(argc < 2 || !JS_IsObject(argv[1]))
+    return JS_ThrowTypeError(ctx, "ExpressionNode requires an options object with expr");
 
-    v = JS_GetPropertyStr(ctx, argv[1], "minDecibels");
-    if(JS_IsNumber(v)) {
-      double d; JS_ToFloat64(ctx, &d, v);
-      an->setMinDecibels(d);
-    }
-    JS_FreeValue(ctx, v);
+  std::string expr;
+  JSValue v = JS_GetPropertyStr(ctx, argv[1], "expr");
+  if(JS_IsString(v)) {
+    const char* s = JS_ToCString(ctx, v);
+    if(s)
+      expr = s;
+    JS_FreeCString(ctx, s);
+  }
+  bool haveExpr = JS_IsString(v);
+  JS_FreeValue(ctx, v);
+  if(!haveExpr)
+    return JS_ThrowTypeError(ctx, "ExpressionNode: expr must be a string");
 
-    v = JS_GetPropertyStr(ctx, argv[1], "maxDecibels");
-    if(JS_IsNumber(v)) {
-      double d; JS_ToFloat64(ctx, &d, v);
-      an->setMaxDecibels(d);
-    }
-    JS_FreeValue(ctx, v);
+  std::vector<DynamicParams::Spec> specs;
+  v = JS_GetPropertyStr(ctx, argv[1], "params");
+  int ret = get_expression_params(ctx, v, specs);
+  JS_FreeValue(ctx, v);
+  if(ret < 0)
+    return JS_EXCEPTION;
 
-    v = JS_GetPropertyStr(ctx, argv[1], "smoothingTimeConstant");
-    if(JS_IsNumber(v)) {
-      double d; JS_ToFloat64(ctx, &d, v);
-      an->setSmoothingTimeConstant(d);
-    }
-    JS_FreeValue(ctx, v);
-  }
+  std::vector<std::string> names;
+  for(const auto& s : specs)
+    names.push_back(s.name);
+  auto program = std::make_shared<ExpressionProgram>();
+  std::string error;
+  if(!program->compile(expr, names, ac->sampleRate(), error))
+    return JS_ThrowSyntaxError(ctx, "ExpressionNode: %s", error.c_str());
 
-  // Per LabSound's AnalyserNode.h: an analyser not connected to destination
-  // must be registered as an automatic pull node, or it never processes.
-  ac->addAutomaticPullNode(an);
+  int32_t inputs = std::max(1, program->inputs), channels = 2;
+  v = JS_GetPropertyStr(ctx, argv[1], "inputs");
+  if(JS_IsNumber(v))
+    JS_ToInt32(ctx, &inputs, v);
+  JS_FreeValue(ctx, v);
+  v = JS_GetPropertyStr(ctx, argv[1], "channelCount");
+  if(JS_IsNumber(v))
+    JS_ToInt32(ctx, &channels, v);
+  JS_FreeValue(ctx, v);
+  if(inputs < program->inputs || inputs > ExpressionProgram::MAX_INPUTS)
+    return JS_ThrowRangeError(ctx, "ExpressionNode: inputs must be from %d to %d", std::max(1, program->inputs), int(ExpressionProgram::MAX_INPUTS));
+  if(channels < 1 || channels > 32)
+    return JS_ThrowRangeError(ctx, "ExpressionNode: channelCount must be from 1 to 32");
+
+  auto node = std::make_shared<ExpressionNode>(*ac, program, specs, channels);
+  {
+    lab::ContextGraphLock gLock(ac.get(), "Expression.addInput");
+    for(int i = 0; i < inputs; i++)
+      node->addInput(gLock, std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(node.get())));
+    node->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(node.get(), channels)));
+  }
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, analysernode_proto);
+    proto = JS_DupValue(ctx, expressionnode_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_analysernode_class_id, std::static_pointer_cast<lab::AudioNode>(an), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_expressionnode_class_id, std::static_pointer_cast<lab::AudioNode>(node), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
-enum {
-  AN_PROP_FFTSIZE,
-  AN_PROP_FREQUENCYBINCOUNT,
-  AN_PROP_MINDECIBELS,
-  AN_PROP_MAXDECIBELS,
-  AN_PROP_SMOOTHINGTIMECONSTANT,
-};
-
 static JSValue
-js_analyser_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_analysernode_class_id));
+js_expressionnode_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_expressionnode_class_id);
   if(!w)
     return JS_EXCEPTION;
-  auto an = std::dynamic_pointer_cast<lab::AnalyserNode>(w->node);
-  if(!an)
-    return JS_ThrowInternalError(ctx, "not an AnalyserNode");
+  ExpressionNode* node = static_cast<ExpressionNode*>(w->node.get());
   switch(magic) {
-    case AN_PROP_FFTSIZE: return JS_NewInt32(ctx, static_cast<int32_t>(an->fftSize()));
-    case AN_PROP_FREQUENCYBINCOUNT: return JS_NewInt32(ctx, static_cast<int32_t>(an->frequencyBinCount()));
-    case AN_PROP_MINDECIBELS: return JS_NewFloat64(ctx, an->minDecibels());
-    case AN_PROP_MAXDECIBELS: return JS_NewFloat64(ctx, an->maxDecibels());
-    case AN_PROP_SMOOTHINGTIMECONSTANT: return JS_NewFloat64(ctx, an->smoothingTimeConstant());
+    case EXPR_PROP_EXPR: return JS_NewString(ctx, node->expression().c_str());
+    case EXPR_PROP_PARAMETERS: {
+      JSValue obj = JS_NewObject(ctx);
+      for(int k = 0; k < node->numberOfParams(); k++)
+        JS_SetPropertyStr(ctx, obj, node->paramName(k).c_str(), make_audio_param_js(ctx, node->expressionParam(k)));
+      return obj;
+    }
   }
   return JS_UNDEFINED;
 }
 
+static const JSCFunctionListEntry js_expressionnode_funcs[] = {
+    JS_CGETSET_MAGIC_DEF("expr", js_expressionnode_get, 0, EXPR_PROP_EXPR),
+    JS_CGETSET_MAGIC_DEF("parameters", js_expressionnode_get, 0, EXPR_PROP_PARAMETERS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ExpressionNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- AudioWorkletNode (audio-worklet.hpp) ---------- */
+//
+// `new AudioWorkletNode(ctx, name, options)` for a processor registered by
+// ctx.audioWorklet.addModule(). Supports numberOfInputs, numberOfOutputs,
+// outputChannelCount and parameterData; the options object is passed to
+// the processor's constructor as well, as in the spec. `port` and
+// `parameters` (a Map of AudioParams) are own properties.
+
 static JSValue
-js_analyser_set(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_analysernode_class_id));
-  if(!w)
+js_audioworkletnode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 2)
+    return JS_ThrowTypeError(ctx, "AudioWorkletNode requires an AudioContext and a processor name");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  auto an = std::dynamic_pointer_cast<lab::AnalyserNode>(w->node);
-  if(!an)
-    return JS_ThrowInternalError(ctx, "not an AnalyserNode");
-  switch(magic) {
-    case AN_PROP_FFTSIZE: {
-      int32_t fftSize = 2048;
-      JS_ToInt32(ctx, &fftSize, value);
-      lab::ContextRenderLock renderLock(w->ctx.get(), "AnalyserNode.fftSize");
-      an->setFftSize(renderLock, fftSize);
-      break;
-    }
-    case AN_PROP_MINDECIBELS: {
-      double d; JS_ToFloat64(ctx, &d, value);
-      an->setMinDecibels(d);
-      break;
-    }
-    case AN_PROP_MAXDECIBELS: {
-      double d; JS_ToFloat64(ctx, &d, value);
-      an->setMaxDecibels(d);
-      break;
+  AudioContextPtr ac = jac->ac;
+
+  const char* s = JS_ToCString(ctx, argv[1]);
+  if(!s)
+    return JS_EXCEPTION;
+  std::string name = s;
+  JS_FreeCString(ctx, s);
+  std::shared_ptr<WorkletScope> scope = jac->worklet;
+  const WorkletScope::Definition* def = scope ? scope->definition(name) : nullptr;
+  if(!def)
+    return JS_ThrowRangeError(ctx, "AudioWorkletNode: no processor registered as '%s' (call ctx.audioWorklet.addModule() first)", name.c_str());
+
+  JSValueConst options = argc > 2 && JS_IsObject(argv[2]) ? argv[2] : JS_UNDEFINED;
+  int32_t inputs = 1, outputs = 1;
+  if(JS_IsObject(options)) {
+    JSValue v = JS_GetPropertyStr(ctx, options, "numberOfInputs");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &inputs, v);
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, options, "numberOfOutputs");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &outputs, v);
+    JS_FreeValue(ctx, v);
+  }
+  if(inputs < 0 || inputs > 32 || outputs < 0 || outputs > 32)
+    return JS_ThrowRangeError(ctx, "AudioWorkletNode: numberOfInputs and numberOfOutputs must be from 0 to 32");
+  if(!inputs && !outputs)
+    return JS_ThrowRangeError(ctx, "AudioWorkletNode: numberOfInputs and numberOfOutputs can't both be 0");
+
+  std::vector<int> outputChannels(outputs, 2);
+  if(JS_IsObject(options)) {
+    JSValue list = JS_GetPropertyStr(ctx, options, "outputChannelCount");
+    if(!JS_IsUndefined(list)) {
+      uint32_t len = 0;
+      JSValue lenv = JS_GetPropertyStr(ctx, list, "length");
+      JS_ToUint32(ctx, &len, lenv);
+      JS_FreeValue(ctx, lenv);
+      if(!JS_IsArray(ctx, list) || len != uint32_t(outputs)) {
+        JS_FreeValue(ctx, list);
+        return JS_ThrowRangeError(ctx, "AudioWorkletNode: outputChannelCount must be an array of numberOfOutputs counts");
+      }
+      for(uint32_t k = 0; k < len; k++) {
+        int32_t n = 0;
+        JSValue v = JS_GetPropertyUint32(ctx, list, k);
+        JS_ToInt32(ctx, &n, v);
+        JS_FreeValue(ctx, v);
+        if(n < 1 || n > 32) {
+          JS_FreeValue(ctx, list);
+          return JS_ThrowRangeError(ctx, "AudioWorkletNode: outputChannelCount[%u] must be from 1 to 32", k);
+        }
+        outputChannels[k] = n;
+      }
     }
-    case AN_PROP_SMOOTHINGTIMECONSTANT: {
-      double d; JS_ToFloat64(ctx, &d, value);
-      an->setSmoothingTimeConstant(d);
-      break;
+    JS_FreeValue(ctx, list);
+  }
+
+  // Serialized here, deserialized in the worklet runtime.
+  size_t size;
+  JSValue copy = JS_IsObject(options) ? JS_DupValue(ctx, options) : JS_NewObject(ctx);
+  uint8_t* bytes = JS_WriteObject(ctx, &size, copy, 0);
+  JS_FreeValue(ctx, copy);
+  if(!bytes)
+    return JS_EXCEPTION;
+  std::vector<uint8_t> serialized(bytes, bytes + size);
+  js_free(ctx, bytes);
+
+  std::vector<std::string> names;
+  for(const auto& spec : def->params)
+    names.push_back(spec.name);
+  scope->collect();
+  auto processor = WorkletProcessor::create(scope, *def, inputs, outputChannels);
+  std::string error;
+  if(!processor->construct(def->ctor, names, serialized.data(), serialized.size(), error))
+    return JS_ThrowInternalError(ctx, "AudioWorkletNode: '%s' constructor failed: %s", name.c_str(), error.c_str());
+
+  auto node = std::make_shared<AudioWorkletProcessorNode>(*ac, processor, def->params);
+  {
+    lab::ContextGraphLock gLock(ac.get(), "AudioWorklet.addInput");
+    for(int i = 0; i < inputs; i++)
+      node->addInput(gLock, std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(node.get())));
+    for(int channels : outputChannels)
+      node->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(node.get(), channels)));
+  }
+
+  if(JS_IsObject(options)) {
+    JSValue data = JS_GetPropertyStr(ctx, options, "parameterData");
+    if(JS_IsObject(data)) {
+      for(int k = 0; k < node->numberOfParams(); k++) {
+        JSValue v = JS_GetPropertyStr(ctx, data, node->paramName(k).c_str());
+        double value;
+        if(JS_IsNumber(v) && !JS_ToFloat64(ctx, &value, v))
+          node->workletParam(k)->setValue(float(value));
+        JS_FreeValue(ctx, v);
+      }
     }
+    JS_FreeValue(ctx, data);
   }
-  return JS_UNDEFINED;
-}
 
-enum {
-  AN_METHOD_GET_FLOAT_FREQUENCY_DATA,
-  AN_METHOD_GET_BYTE_FREQUENCY_DATA,
-  AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA,
-  AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA,
-};
+  JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
+  if(JS_IsException(proto))
+    return JS_EXCEPTION;
+  if(!JS_IsObject(proto)) {
+    JS_FreeValue(ctx, proto);
+    proto = JS_DupValue(ctx, audioworkletnode_proto);
+  }
+  JSValue obj = make_audio_node_js(ctx, proto, js_audioworkletnode_class_id, std::static_pointer_cast<lab::AudioNode>(node), ac);
+  JS_FreeValue(ctx, proto);
+  if(JS_IsException(obj))
+    return obj;
+
+  JSValue port = JS_NewObjectProtoClass(ctx, messageport_proto, js_messageport_class_id);
+  if(!JS_IsException(port)) {
+    auto* p = static_cast<JsMessagePort*>(js_mallocz(ctx, sizeof(JsMessagePort)));
+    new(p) JsMessagePort{processor};
+    JS_SetOpaque(port, p);
+  }
+  JS_DefinePropertyValueStr(ctx, obj, "port", port, JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE);
 
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue map_ctor = JS_GetPropertyStr(ctx, global, "Map");
+  JSValue map = JS_CallConstructor(ctx, map_ctor, 0, nullptr);
+  JSValue set = JS_GetPropertyStr(ctx, map, "set");
+  for(int k = 0; k < node->numberOfParams(); k++) {
+    JSValue args[2] = {JS_NewString(ctx, node->paramName(k).c_str()), make_audio_param_js(ctx, node->workletParam(k))};
+    JS_FreeValue(ctx, JS_Call(ctx, set, map, 2, args));
+    JS_FreeValue(ctx, args[0]);
+    JS_FreeValue(ctx, args[1]);
+  }
+  JS_FreeValue(ctx, set);
+  JS_FreeValue(ctx, map_ctor);
+  JS_FreeValue(ctx, global);
+  JS_DefinePropertyValueStr(ctx, obj, "parameters", map, JS_PROP_CONFIGURABLE | JS_PROP_ENUMERABLE);
+
+  anchor_node_in_context(ctx, argv[0], obj);
+  return obj;
+}
+
+// onprocessorerror lives on the port, which is what dispatches it.
 static JSValue
-js_analyser_method(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_analysernode_class_id));
-  if(!w)
+js_audioworkletnode_get_onprocessorerror(JSContext* ctx, JSValueConst this_val) {
+  if(!get_audio_node(ctx, this_val, js_audioworkletnode_class_id))
     return JS_EXCEPTION;
-  auto an = std::dynamic_pointer_cast<lab::AnalyserNode>(w->node);
-  if(!an)
-    return JS_ThrowInternalError(ctx, "not an AnalyserNode");
-  if(argc < 1)
-    return JS_ThrowTypeError(ctx, "requires a typed array argument");
+  JSValue port = JS_GetPropertyStr(ctx, this_val, "port");
+  JSValue ret = js_messageport_get(ctx, port, MP_PROP_ONPROCESSORERROR);
+  JS_FreeValue(ctx, port);
+  return ret;
+}
 
-  size_t byte_offset = 0, byte_length = 0, bytes_per_element = 0;
-  JSValue buf = JS_GetTypedArrayBuffer(ctx, argv[0], &byte_offset, &byte_length, &bytes_per_element);
-  if(JS_IsException(buf))
-    return JS_ThrowTypeError(ctx, "argument must be a typed array");
-  size_t ab_size = 0;
-  uint8_t* ab_data = JS_GetArrayBuffer(ctx, &ab_size, buf);
-  JS_FreeValue(ctx, buf);
-  if(!ab_data)
+static JSValue
+js_audioworkletnode_set_onprocessorerror(JSContext* ctx, JSValueConst this_val, JSValueConst value) {
+  if(!get_audio_node(ctx, this_val, js_audioworkletnode_class_id))
     return JS_EXCEPTION;
-
-  // required size per spec: frequencyBinCount for frequency-domain data,
-  // fftSize for time-domain data. Only fill as many values as the smaller
-  // of that and what the caller's array can hold, per spec.
-  switch(magic) {
-    case AN_METHOD_GET_FLOAT_FREQUENCY_DATA: {
-      size_t len = std::min(byte_length / sizeof(float), an->frequencyBinCount());
-      std::vector<float> data(len);
-      an->getFloatFrequencyData(data);
-      memcpy(reinterpret_cast<float*>(ab_data + byte_offset), data.data(), len * sizeof(float));
-      break;
-    }
-    case AN_METHOD_GET_BYTE_FREQUENCY_DATA: {
-      bool resample = argc > 1 ? JS_ToBool(ctx, argv[1]) : false;
-      size_t len = std::min(byte_length, an->frequencyBinCount());
-      std::vector<uint8_t> data(len);
-      an->getByteFrequencyData(data, resample);
-      memcpy(ab_data + byte_offset, data.data(), len);
-      break;
-    }
-    case AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA: {
-      size_t len = std::min(byte_length / sizeof(float), an->fftSize());
-      std::vector<float> data(len);
-      an->getFloatTimeDomainData(data);
-      memcpy(reinterpret_cast<float*>(ab_data + byte_offset), data.data(), len * sizeof(float));
-      break;
-    }
-    case AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA: {
-      size_t len = std::min(byte_length, an->fftSize());
-      std::vector<uint8_t> data(len);
-      an->getByteTimeDomainData(data);
-      memcpy(ab_data + byte_offset, data.data(), len);
-      break;
-    }
-  }
-  return JS_UNDEFINED;
+  JSValue port = JS_GetPropertyStr(ctx, this_val, "port");
+  JSValue ret = js_messageport_set(ctx, port, value, MP_PROP_ONPROCESSORERROR);
+  JS_FreeValue(ctx, port);
+  return ret;
 }
 
-static void
-js_analysernode_finalizer(JSRuntime* rt, JSValue val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque(val, js_analysernode_class_id));
-  if(w) {
-    if(w->ctx)
-      w->ctx->removeAutomaticPullNode(w->node);
-    w->~JsAudioNode();
-    js_free_rt(rt, w);
+static const JSCFunctionListEntry js_audioworkletnode_funcs[] = {
+    JS_CGETSET_DEF("onprocessorerror", js_audioworkletnode_get_onprocessorerror, js_audioworkletnode_set_onprocessorerror),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AudioWorkletNode", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- StkNode (native, stk-node.hpp) ---------- */
+//
+// Not a WebAudio interface: an STK instrument, effect, generator or filter
+// from the 'stk' module rendered inside the graph, one block per quantum.
+//
+//   const flute = new Flute(220);
+//   const node = new StkNode(ctx, flute);
+//   node.noteOn(440, 0.8, ctx.currentTime + 0.5);
+//
+// The STK object is shared, not copied. Effects and filters get one input;
+// the output has as many channels as the object produces. noteOn(),
+// noteOff(), controlChange() and setEffectMix() take an optional context
+// time and return false when the command queue was full.
+
+// qjs-stk's STK_SOURCE_LOOKUP. qjs loads native modules RTLD_LOCAL, out of
+// dlsym(RTLD_DEFAULT)'s reach, so look in each loaded object in turn. Null
+// until the 'stk' module is loaded; found once, for good.
+static StkSourceLookup*
+stk_source_lookup() {
+  static std::atomic<StkSourceLookup*> found{nullptr};
+  if(StkSourceLookup* fn = found.load(std::memory_order_acquire))
+    return fn;
+
+  void* sym = dlsym(RTLD_DEFAULT, STK_SOURCE_LOOKUP);
+  if(!sym) {
+    std::vector<std::string> objects;
+    dl_iterate_phdr(
+        [](struct dl_phdr_info* info, size_t, void* data) {
+          if(info->dlpi_name && *info->dlpi_name)
+            static_cast<std::vector<std::string>*>(data)->push_back(info->dlpi_name);
+          return 0;
+        },
+        &objects);
+    for(const auto& name : objects) {
+      if(void* handle = dlopen(name.c_str(), RTLD_NOW | RTLD_NOLOAD)) {
+        sym = dlsym(handle, STK_SOURCE_LOOKUP);
+        dlclose(handle);
+      }
+      if(sym)
+        break;
+    }
   }
+  StkSourceLookup* fn = reinterpret_cast<StkSourceLookup*>(sym);
+  if(fn)
+    found.store(fn, std::memory_order_release);
+  return fn;
 }
 
-static JSClassDef js_analysernode_class = {
-    .class_name = "AnalyserNode",
-    .finalizer = js_analysernode_finalizer,
-};
+// The object's StkSource, through the method quickjs-stk.cpp puts on STK
+// prototypes (see stk-source.hpp); null for anything else. The buffer the
+// method returns is only read for an id, which qjs-stk looks up itself.
+static std::shared_ptr<StkSource>
+get_stk_source(JSContext* ctx, JSValueConst obj) {
+  std::shared_ptr<StkSource> source;
+  if(!JS_IsObject(obj))
+    return source;
 
-static const JSCFunctionListEntry js_analysernode_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("fftSize", js_analyser_get, js_analyser_set, AN_PROP_FFTSIZE),
-    JS_CGETSET_MAGIC_DEF("frequencyBinCount", js_analyser_get, 0, AN_PROP_FREQUENCYBINCOUNT),
-    JS_CGETSET_MAGIC_DEF("minDecibels", js_analyser_get, js_analyser_set, AN_PROP_MINDECIBELS),
-    JS_CGETSET_MAGIC_DEF("maxDecibels", js_analyser_get, js_analyser_set, AN_PROP_MAXDECIBELS),
-    JS_CGETSET_MAGIC_DEF("smoothingTimeConstant", js_analyser_get, js_analyser_set, AN_PROP_SMOOTHINGTIMECONSTANT),
-    JS_CFUNC_MAGIC_DEF("getFloatFrequencyData", 1, js_analyser_method, AN_METHOD_GET_FLOAT_FREQUENCY_DATA),
-    JS_CFUNC_MAGIC_DEF("getByteFrequencyData", 1, js_analyser_method, AN_METHOD_GET_BYTE_FREQUENCY_DATA),
-    JS_CFUNC_MAGIC_DEF("getFloatTimeDomainData", 1, js_analyser_method, AN_METHOD_GET_FLOAT_TIME_DOMAIN_DATA),
-    JS_CFUNC_MAGIC_DEF("getByteTimeDomainData", 1, js_analyser_method, AN_METHOD_GET_BYTE_TIME_DOMAIN_DATA),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "AnalyserNode", JS_PROP_CONFIGURABLE),
-};
+  JSValue global = JS_GetGlobalObject(ctx);
+  JSValue symbol = JS_GetPropertyStr(ctx, global, "Symbol");
+  JSValue symbol_for = JS_GetPropertyStr(ctx, symbol, "for");
+  JSValue name = JS_NewString(ctx, STK_SOURCE_SYMBOL);
+  JSValue key = JS_Call(ctx, symbol_for, symbol, 1, &name);
+  JSAtom atom = JS_ValueToAtom(ctx, key);
+  for(JSValue v : {key, name, symbol_for, symbol, global})
+    JS_FreeValue(ctx, v);
 
-/* ---------- DynamicsCompressorNode ---------- */
+  JSValue fn = JS_GetProperty(ctx, obj, atom);
+  JS_FreeAtom(ctx, atom);
+  if(JS_IsFunction(ctx, fn)) {
+    JSValue buf = JS_Call(ctx, fn, obj, 0, nullptr);
+    size_t size = 0;
+    uint8_t* data = JS_IsException(buf) ? nullptr : JS_GetArrayBuffer(ctx, &size, buf);
+    uint64_t id;
+    StkSourceLookup* lookup = stk_source_lookup();
+    if(data && size == sizeof(id) && lookup) {
+      memcpy(&id, data, sizeof(id));
+      lookup(id, source);
+    }
+    JS_FreeValue(ctx, buf);
+  }
+  JS_FreeValue(ctx, fn);
+  return source;
+}
 
 static JSValue
-js_compressor_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
-  if(argc < 1)
-    return JS_ThrowTypeError(ctx, "DynamicsCompressorNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+js_stknode_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+  if(argc < 2)
+    return JS_ThrowTypeError(ctx, "StkNode requires an AudioContext and an STK object");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto comp = std::make_shared<lab::DynamicsCompressorNode>(*ac);
-
-  if(argc > 1 && JS_IsObject(argv[1])) {
-    static const struct { const char* name; std::shared_ptr<lab::AudioParam> (lab::DynamicsCompressorNode::*getter)(); } params[] = {
-        {"threshold", &lab::DynamicsCompressorNode::threshold},
-        {"knee", &lab::DynamicsCompressorNode::knee},
-        {"ratio", &lab::DynamicsCompressorNode::ratio},
-        {"attack", &lab::DynamicsCompressorNode::attack},
-        {"release", &lab::DynamicsCompressorNode::release},
-    };
-    for(auto& p : params) {
-      JSValue v = JS_GetPropertyStr(ctx, argv[1], p.name);
-      if(JS_IsNumber(v)) {
-        double d; JS_ToFloat64(ctx, &d, v);
-        (comp.get()->*p.getter)()->setValue(static_cast<float>(d));
-      }
-      JS_FreeValue(ctx, v);
-    }
+  AudioContextPtr ac = jac->ac;
+
+  std::shared_ptr<StkSource> source = get_stk_source(ctx, argv[1]);
+  if(!source)
+    return JS_ThrowTypeError(ctx, "StkNode: not an STK instrument, effect, generator or filter");
+  if(source->outputs() < 1 || source->outputs() > 32)
+    return JS_ThrowRangeError(ctx, "StkNode: unsupported channel count %u", source->outputs());
+  source->setSampleRate(ac->sampleRate());
+
+  auto node = std::make_shared<StkNode>(*ac, source);
+  {
+    lab::ContextGraphLock gLock(ac.get(), "StkNode.addOutput");
+    if(source->inputs())
+      node->addInput(gLock, std::unique_ptr<lab::AudioNodeInput>(new lab::AudioNodeInput(node.get())));
+    node->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(node.get(), int(source->outputs()))));
   }
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
@@ -2583,126 +5901,736 @@ js_compressor_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSV
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, dynamicscompressornode_proto);
+    proto = JS_DupValue(ctx, stknode_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_dynamicscompressornode_class_id, std::static_pointer_cast<lab::AudioNode>(comp), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_stknode_class_id, std::static_pointer_cast<lab::AudioNode>(node), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
+static StkNode*
+get_stknode(JSContext* ctx, JSValueConst this_val, JsAudioNode** pw = nullptr) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_stknode_class_id);
+  if(!w)
+    return nullptr;
+  if(pw)
+    *pw = w;
+  return static_cast<StkNode*>(w->node.get());
+}
+
+// noteOn(frequency, amplitude, when), noteOff(amplitude, when),
+// controlChange(number, value, when), setEffectMix(mix, when); `magic` is
+// the StkSource command.
+static JSValue
+js_stknode_control(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JsAudioNode* w;
+  StkNode* node = get_stknode(ctx, this_val, &w);
+  if(!node)
+    return JS_EXCEPTION;
+  if(!node->stkSource().accepts(magic))
+    return JS_ThrowTypeError(ctx, "StkNode: the STK object has no such method");
+
+  const int values = magic == StkSource::NOTE_OFF || magic == StkSource::EFFECT_MIX ? 1 : 2;
+  if(argc < values)
+    return JS_ThrowTypeError(ctx, "StkNode: expected %d arguments", values);
+  StkNode::Command cmd;
+  cmd.type = magic;
+  if(JS_ToFloat64(ctx, &cmd.a, argv[0]) || (values > 1 && JS_ToFloat64(ctx, &cmd.b, argv[1])))
+    return JS_EXCEPTION;
+  double when = 0;
+  if(argc > values && JS_ToFloat64(ctx, &when, argv[values]))
+    return JS_EXCEPTION;
+  cmd.frame = when > 0 ? uint64_t(std::llround(when * w->ctx->sampleRate())) : 0;
+  return JS_NewBool(ctx, node->send(cmd));
+}
+
 enum {
-  DC_PROP_THRESHOLD,
-  DC_PROP_KNEE,
-  DC_PROP_RATIO,
-  DC_PROP_ATTACK,
-  DC_PROP_RELEASE,
-  DC_PROP_REDUCTION,
+  STK_PROP_CHANNELS_IN,
+  STK_PROP_CHANNELS_OUT,
+  STK_PROP_DROPPED_COMMANDS,
 };
 
 static JSValue
-js_compressor_get(JSContext* ctx, JSValueConst this_val, int magic) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_dynamicscompressornode_class_id));
-  if(!w)
+js_stknode_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  StkNode* node = get_stknode(ctx, this_val);
+  if(!node)
     return JS_EXCEPTION;
-  auto comp = std::dynamic_pointer_cast<lab::DynamicsCompressorNode>(w->node);
-  if(!comp)
-    return JS_ThrowInternalError(ctx, "not a DynamicsCompressorNode");
   switch(magic) {
-    case DC_PROP_THRESHOLD: return make_audio_param_js(ctx, comp->threshold());
-    case DC_PROP_KNEE: return make_audio_param_js(ctx, comp->knee());
-    case DC_PROP_RATIO: return make_audio_param_js(ctx, comp->ratio());
-    case DC_PROP_ATTACK: return make_audio_param_js(ctx, comp->attack());
-    case DC_PROP_RELEASE: return make_audio_param_js(ctx, comp->release());
-    case DC_PROP_REDUCTION: return JS_NewFloat64(ctx, comp->reduction()->value());
+    case STK_PROP_CHANNELS_IN: return JS_NewUint32(ctx, node->stkSource().inputs());
+    case STK_PROP_CHANNELS_OUT: return JS_NewUint32(ctx, node->stkSource().outputs());
+    case STK_PROP_DROPPED_COMMANDS: return JS_NewInt64(ctx, int64_t(node->droppedCommands()));
   }
   return JS_UNDEFINED;
 }
 
-static void
-js_dynamicscompressornode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_dynamicscompressornode_class_id);
-}
-
-static JSClassDef js_dynamicscompressornode_class = {
-    .class_name = "DynamicsCompressorNode",
-    .finalizer = js_dynamicscompressornode_finalizer,
-};
-
-static const JSCFunctionListEntry js_dynamicscompressornode_funcs[] = {
-    JS_CGETSET_MAGIC_DEF("threshold", js_compressor_get, 0, DC_PROP_THRESHOLD),
-    JS_CGETSET_MAGIC_DEF("knee", js_compressor_get, 0, DC_PROP_KNEE),
-    JS_CGETSET_MAGIC_DEF("ratio", js_compressor_get, 0, DC_PROP_RATIO),
-    JS_CGETSET_MAGIC_DEF("attack", js_compressor_get, 0, DC_PROP_ATTACK),
-    JS_CGETSET_MAGIC_DEF("release", js_compressor_get, 0, DC_PROP_RELEASE),
-    JS_CGETSET_MAGIC_DEF("reduction", js_compressor_get, 0, DC_PROP_REDUCTION),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "DynamicsCompressorNode", JS_PROP_CONFIGURABLE),
+static const JSCFunctionListEntry js_stknode_funcs[] = {
+    JS_CFUNC_MAGIC_DEF("noteOn", 2, js_stknode_control, StkSource::NOTE_ON),
+    JS_CFUNC_MAGIC_DEF("noteOff", 1, js_stknode_control, StkSource::NOTE_OFF),
+    JS_CFUNC_MAGIC_DEF("controlChange", 2, js_stknode_control, StkSource::CONTROL_CHANGE),
+    JS_CFUNC_MAGIC_DEF("setEffectMix", 1, js_stknode_control, StkSource::EFFECT_MIX),
+    JS_CGETSET_MAGIC_DEF("channelsIn", js_stknode_get, 0, STK_PROP_CHANNELS_IN),
+    JS_CGETSET_MAGIC_DEF("channelsOut", js_stknode_get, 0, STK_PROP_CHANNELS_OUT),
+    JS_CGETSET_MAGIC_DEF("droppedCommands", js_stknode_get, 0, STK_PROP_DROPPED_COMMANDS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "StkNode", JS_PROP_CONFIGURABLE),
 };
 
-/* ---------- ConstantSourceNode ---------- */
+/* ---------- Sequencer (native, sequencer.hpp) ---------- */
+//
+// Not a WebAudio interface: a step sequencer whose clock runs on the render
+// thread, playing AudioBuffers through its own SamplerVoicePool voices.
+//
+//   const seq = new Sequencer(ctx, {voices: 32, bpm: 124});
+//   seq.setPattern({samples: [kick, snare, hihat], velocity, pan});
+//   seq.start(ctx.currentTime + 0.1);
+//
+// `velocity` has a value per step and sample, step-major (a Float32Array or
+// array; 0 is a rest), and `steps` defaults to its length over the number
+// of samples. `pan` is laid out the same, or holds one value per sample.
+// `stepsPerBeat` defaults to 4. setPattern(p, {immediate: true}) switches at
+// the next step instead of when the current pattern loops.
 
 static JSValue
-js_constantsource_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
+js_sequencer_constructor(JSContext* ctx, JSValueConst new_target, int argc, JSValueConst argv[]) {
   if(argc < 1)
-    return JS_ThrowTypeError(ctx, "ConstantSourceNode requires an AudioContext");
-  AudioContextPtr* acptr = static_cast<AudioContextPtr*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
-  if(!acptr)
+    return JS_ThrowTypeError(ctx, "Sequencer requires an AudioContext");
+  JsAudioContext* jac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, argv[0], js_audiocontext_class_id));
+  if(!jac)
     return JS_EXCEPTION;
-  AudioContextPtr ac = *acptr;
-  auto cs = std::make_shared<lab::ConstantSourceNode>(*ac);
+  AudioContextPtr ac = jac->ac;
 
+  int32_t voices = 32;
+  double bpm = 120;
   if(argc > 1 && JS_IsObject(argv[1])) {
-    JSValue v = JS_GetPropertyStr(ctx, argv[1], "offset");
-    if(JS_IsNumber(v)) {
-      double d; JS_ToFloat64(ctx, &d, v);
-      cs->offset()->setValue(static_cast<float>(d));
-    }
+    JSValue v = JS_GetPropertyStr(ctx, argv[1], "voices");
+    if(JS_IsNumber(v))
+      JS_ToInt32(ctx, &voices, v);
+    JS_FreeValue(ctx, v);
+    v = JS_GetPropertyStr(ctx, argv[1], "bpm");
+    if(JS_IsNumber(v))
+      JS_ToFloat64(ctx, &bpm, v);
     JS_FreeValue(ctx, v);
   }
+  if(voices < 1 || voices > 1024)
+    return JS_ThrowRangeError(ctx, "Sequencer: voices must be in [1, 1024]");
+  if(!(bpm > 0 && bpm <= 1000))
+    return JS_ThrowRangeError(ctx, "Sequencer: bpm must be in (0, 1000]");
+
+  auto seq = std::make_shared<SequencerNode>(*ac, voices, bpm);
+  {
+    lab::ContextGraphLock gLock(ac.get(), "Sequencer.addOutput");
+    seq->addOutput(gLock, std::unique_ptr<lab::AudioNodeOutput>(new lab::AudioNodeOutput(seq.get(), 2)));
+  }
 
   JSValue proto = JS_GetPropertyStr(ctx, new_target, "prototype");
   if(JS_IsException(proto))
     return JS_EXCEPTION;
   if(!JS_IsObject(proto)) {
     JS_FreeValue(ctx, proto);
-    proto = JS_DupValue(ctx, constantsourcenode_proto);
+    proto = JS_DupValue(ctx, sequencer_proto);
   }
-  JSValue obj = make_audio_node_js(ctx, proto, js_constantsourcenode_class_id, std::static_pointer_cast<lab::AudioNode>(cs), ac);
+  JSValue obj = make_audio_node_js(ctx, proto, js_sequencer_class_id, std::static_pointer_cast<lab::AudioNode>(seq), ac);
   JS_FreeValue(ctx, proto);
   anchor_node_in_context(ctx, argv[0], obj);
   return obj;
 }
 
-static JSValue
-js_constantsource_get_offset(JSContext* ctx, JSValueConst this_val) {
-  JsAudioNode* w = static_cast<JsAudioNode*>(JS_GetOpaque2(ctx, this_val, js_constantsourcenode_class_id));
+static SequencerNode*
+get_sequencer(JSContext* ctx, JSValueConst this_val, JsAudioNode** pw = nullptr) {
+  JsAudioNode* w = get_audio_node(ctx, this_val, js_sequencer_class_id);
   if(!w)
+    return nullptr;
+  if(pw)
+    *pw = w;
+  return static_cast<SequencerNode*>(w->node.get());
+}
+
+static int
+get_sequencer_samples(JSContext* ctx, JSValueConst list, SequencerNode::Pattern& p) {
+  if(!JS_IsArray(ctx, list))
+    return JS_ThrowTypeError(ctx, "setPattern: samples must be an array of AudioBuffers"), -1;
+  uint32_t length = 0;
+  JSValue lenv = JS_GetPropertyStr(ctx, list, "length");
+  JS_ToUint32(ctx, &length, lenv);
+  JS_FreeValue(ctx, lenv);
+  if(length < 1 || length > 256)
+    return JS_ThrowRangeError(ctx, "setPattern: 1 to 256 samples"), -1;
+
+  p.tracks = int(length);
+  p.buses.resize(length);
+  for(uint32_t k = 0; k < length; k++) {
+    JSValue item = JS_GetPropertyUint32(ctx, list, k);
+    // null mutes the track.
+    if(!JS_IsNull(item) && !JS_IsUndefined(item)) {
+      JsAudioBuffer* ab = static_cast<JsAudioBuffer*>(JS_GetOpaque(item, js_audiobuffer_class_id));
+      if(!ab || !ab->bus) {
+        JS_FreeValue(ctx, item);
+        return JS_ThrowTypeError(ctx, "setPattern: sample %u is not an AudioBuffer", k), -1;
+      }
+      if(ab->bus->length() > 0) {
+        p.buses[k] = acquire_audio_buffer(ctx, ab);
+        if(ab->bus->sampleRate() > 0)
+          p.longest = std::max(p.longest, double(ab->bus->length()) / ab->bus->sampleRate());
+      }
+    }
+    JS_FreeValue(ctx, item);
+  }
+  return 0;
+}
+
+static JSValue
+js_sequencer_set_pattern(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  SequencerNode* seq = get_sequencer(ctx, this_val);
+  if(!seq)
     return JS_EXCEPTION;
-  auto cs = std::dynamic_pointer_cast<lab::ConstantSourceNode>(w->node);
-  if(!cs)
-    return JS_ThrowInternalError(ctx, "not a ConstantSourceNode");
-  return make_audio_param_js(ctx, cs->offset());
+  if(argc < 1 || !JS_IsObject(argv[0]))
+    return JS_ThrowTypeError(ctx, "setPattern requires a pattern object");
+
+  auto p = std::make_shared<SequencerNode::Pattern>();
+  JSValue v = JS_GetPropertyStr(ctx, argv[0], "samples");
+  int ret = get_sequencer_samples(ctx, v, *p);
+  JS_FreeValue(ctx, v);
+  if(ret < 0)
+    return JS_EXCEPTION;
+
+  v = JS_GetPropertyStr(ctx, argv[0], "velocity");
+  ret = read_float_array(ctx, v, p->velocity);
+  JS_FreeValue(ctx, v);
+  if(ret < 0)
+    return JS_ThrowTypeError(ctx, "setPattern: velocity must be a Float32Array or array of numbers");
+
+  p->steps = int(p->velocity.size() / size_t(p->tracks));
+  v = JS_GetPropertyStr(ctx, argv[0], "steps");
+  if(JS_IsNumber(v))
+    JS_ToInt32(ctx, &p->steps, v);
+  JS_FreeValue(ctx, v);
+  if(p->steps < 1 || p->steps > 65536)
+    return JS_ThrowRangeError(ctx, "setPattern: steps must be in [1, 65536]");
+  const size_t cells = size_t(p->steps) * size_t(p->tracks);
+  if(p->velocity.size() != cells)
+    return JS_ThrowRangeError(ctx, "setPattern: velocity needs %zu values (steps x samples)", cells);
+
+  v = JS_GetPropertyStr(ctx, argv[0], "pan");
+  p->panned = !JS_IsUndefined(v);
+  if(!p->panned) {
+    p->pan.assign(cells, 0.f);
+  } else if(read_float_array(ctx, v, p->pan) < 0) {
+    JS_FreeValue(ctx, v);
+    return JS_ThrowTypeError(ctx, "setPattern: pan must be a Float32Array or array of numbers");
+  } else if(p->pan.size() == size_t(p->tracks)) {
+    // One per sample: repeat it on every step.
+    std::vector<float> perTrack = std::move(p->pan);
+    p->pan.resize(cells);
+    for(size_t i = 0; i < cells; i++)
+      p->pan[i] = perTrack[i % size_t(p->tracks)];
+  } else if(p->pan.size() != cells) {
+    JS_FreeValue(ctx, v);
+    return JS_ThrowRangeError(ctx, "setPattern: pan needs one value per sample or per step and sample");
+  }
+  JS_FreeValue(ctx, v);
+
+  v = JS_GetPropertyStr(ctx, argv[0], "stepsPerBeat");
+  if(JS_IsNumber(v))
+    JS_ToFloat64(ctx, &p->stepsPerBeat, v);
+  JS_FreeValue(ctx, v);
+  if(!(p->stepsPerBeat > 0 && p->stepsPerBeat <= 64))
+    return JS_ThrowRangeError(ctx, "setPattern: stepsPerBeat must be in (0, 64]");
+
+  SequencerNode::Command cmd;
+  cmd.type = SequencerNode::PATTERN;
+  if(argc > 1 && JS_IsObject(argv[1])) {
+    v = JS_GetPropertyStr(ctx, argv[1], "immediate");
+    if(JS_ToBool(ctx, v))
+      cmd.type = SequencerNode::PATTERN_NOW;
+    JS_FreeValue(ctx, v);
+  }
+  cmd.pattern = std::move(p);
+  return JS_NewBool(ctx, seq->send(std::move(cmd)));
 }
 
-static void
-js_constantsourcenode_finalizer(JSRuntime* rt, JSValue val) {
-  js_audionode_finalize_with(rt, val, js_constantsourcenode_class_id);
+// start(when = 0) / stop(when = 0) -> false if the command queue was full.
+static JSValue
+js_sequencer_transport(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[], int magic) {
+  JsAudioNode* w;
+  SequencerNode* seq = get_sequencer(ctx, this_val, &w);
+  if(!seq)
+    return JS_EXCEPTION;
+  double when = 0;
+  if(argc > 0 && !JS_IsUndefined(argv[0]) && JS_ToFloat64(ctx, &when, argv[0]))
+    return JS_EXCEPTION;
+
+  SequencerNode::Command cmd;
+  cmd.type = magic;
+  cmd.frame = when > 0 ? uint64_t(std::llround(when * w->ctx->sampleRate())) : 0;
+  return JS_NewBool(ctx, seq->send(std::move(cmd)));
 }
 
-static JSClassDef js_constantsourcenode_class = {
-    .class_name = "ConstantSourceNode",
-    .finalizer = js_constantsourcenode_finalizer,
+enum {
+  SEQ_PROP_BPM,
+  SEQ_PROP_STEP,
+  SEQ_PROP_LOOPS,
+  SEQ_PROP_PLAYING,
+  SEQ_PROP_VOICES,
+  SEQ_PROP_ACTIVE_VOICES,
+  SEQ_PROP_STOLEN_VOICES,
+  SEQ_PROP_DROPPED_COMMANDS,
 };
 
-static const JSCFunctionListEntry js_constantsourcenode_funcs[] = {
-    JS_CGETSET_DEF("offset", js_constantsource_get_offset, NULL),
-    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "ConstantSourceNode", JS_PROP_CONFIGURABLE),
+static JSValue
+js_sequencer_get(JSContext* ctx, JSValueConst this_val, int magic) {
+  SequencerNode* seq = get_sequencer(ctx, this_val);
+  if(!seq)
+    return JS_EXCEPTION;
+  switch(magic) {
+    case SEQ_PROP_BPM: return JS_NewFloat64(ctx, seq->currentTempo());
+    case SEQ_PROP_STEP: return JS_NewInt32(ctx, seq->currentStep());
+    case SEQ_PROP_LOOPS: return JS_NewInt64(ctx, int64_t(seq->completedLoops()));
+    case SEQ_PROP_PLAYING: return JS_NewBool(ctx, seq->isPlaying());
+    case SEQ_PROP_VOICES: return JS_NewInt32(ctx, seq->voiceCount());
+    case SEQ_PROP_ACTIVE_VOICES: return JS_NewInt32(ctx, seq->activeVoices());
+    case SEQ_PROP_STOLEN_VOICES: return JS_NewInt64(ctx, int64_t(seq->stolenVoices()));
+    case SEQ_PROP_DROPPED_COMMANDS: return JS_NewInt64(ctx, int64_t(seq->droppedCommands()));
+  }
+  return JS_UNDEFINED;
+}
+
+// Takes effect from the next step.
+static JSValue
+js_sequencer_set_bpm(JSContext* ctx, JSValueConst this_val, JSValueConst value, int magic) {
+  SequencerNode* seq = get_sequencer(ctx, this_val);
+  if(!seq)
+    return JS_EXCEPTION;
+  SequencerNode::Command cmd;
+  cmd.type = SequencerNode::TEMPO;
+  if(JS_ToFloat64(ctx, &cmd.bpm, value))
+    return JS_EXCEPTION;
+  if(!(cmd.bpm > 0 && cmd.bpm <= 1000))
+    return JS_ThrowRangeError(ctx, "Sequencer: bpm must be in (0, 1000]");
+  seq->send(std::move(cmd));
+  return JS_UNDEFINED;
+}
+
+static const JSCFunctionListEntry js_sequencer_funcs[] = {
+    JS_CFUNC_DEF("setPattern", 1, js_sequencer_set_pattern),
+    JS_CFUNC_MAGIC_DEF("start", 0, js_sequencer_transport, SequencerNode::START),
+    JS_CFUNC_MAGIC_DEF("stop", 0, js_sequencer_transport, SequencerNode::STOP),
+    JS_CGETSET_MAGIC_DEF("bpm", js_sequencer_get, js_sequencer_set_bpm, SEQ_PROP_BPM),
+    JS_CGETSET_MAGIC_DEF("step", js_sequencer_get, 0, SEQ_PROP_STEP),
+    JS_CGETSET_MAGIC_DEF("loops", js_sequencer_get, 0, SEQ_PROP_LOOPS),
+    JS_CGETSET_MAGIC_DEF("playing", js_sequencer_get, 0, SEQ_PROP_PLAYING),
+    JS_CGETSET_MAGIC_DEF("voices", js_sequencer_get, 0, SEQ_PROP_VOICES),
+    JS_CGETSET_MAGIC_DEF("activeVoices", js_sequencer_get, 0, SEQ_PROP_ACTIVE_VOICES),
+    JS_CGETSET_MAGIC_DEF("stolenVoices", js_sequencer_get, 0, SEQ_PROP_STOLEN_VOICES),
+    JS_CGETSET_MAGIC_DEF("droppedCommands", js_sequencer_get, 0, SEQ_PROP_DROPPED_COMMANDS),
+    JS_PROP_STRING_DEF("[Symbol.toStringTag]", "Sequencer", JS_PROP_CONFIGURABLE),
+};
+
+/* ---------- createGraph ---------- */
+//
+// Not in the spec: ctx.createGraph(descriptor) builds a whole subgraph --
+// typically a one-shot voice -- in one call and returns its nodes as an
+// array:
+//
+//   const [osc, amp] = ctx.createGraph({
+//     nodes: [['OscillatorNode', {frequency: 180}], ['GainNode', {gain: 0}]],
+//     connections: [0, 1, 1, out],
+//     automation: [[1, 'gain', 'linearRampToValueAtTime', 0.7, t + 0.003]],
+//     start: [[0, t, t + 0.35]],
+//   });
+//
+// A node is [type, options], type being the name of one of this module's
+// node constructors or a constructor itself; it's built through that
+// constructor, so options mean what they mean to `new`. Elsewhere a node
+// is its index in `nodes` or an AudioNode of the same context.
+//
+// `connections` holds (source, destination) pairs one after the other --
+// an Int32Array does when they're all indices -- and/or tuples
+// [source, destination, output, input], where the destination can also be
+// [node, 'param'] or an AudioParam. `automation` records are
+// [node, 'param', method, ...arguments], method being an AudioParam method
+// name or the matching schedule() op code. `start` entries are
+// [node, when, stopWhen] for scheduled sources. AudioWorkletNode and
+// StkNode take more than (context, options), so they're not node types.
+//
+// Everything is read and checked before anything is connected or
+// scheduled. The connections then go through lab's update thread the way
+// connect() does, so they are ordered with the connect()/disconnect()
+// calls around them.
+
+struct GraphEdge {
+  std::shared_ptr<lab::AudioNode> src, dst;
+  std::shared_ptr<lab::AudioParam> param;
+  int output = 0, input = 0;
+};
+
+struct GraphEvent {
+  std::shared_ptr<lab::AudioParam> param;
+  int op;
+  double a = 0, b = 0, c = 0;
+};
+
+struct GraphStart {
+  std::shared_ptr<lab::AudioScheduledSourceNode> node;
+  double when = 0, stop = -1;
+};
+
+static const struct {
+  const char* name;
+  JSValue* ctor;
+} graph_node_types[] = {
+    {"OscillatorNode", &oscillatornode_ctor},
+    {"GainNode", &gainnode_ctor},
+    {"BiquadFilterNode", &biquadfilternode_ctor},
+    {"AudioBufferSourceNode", &audiobuffersourcenode_ctor},
+    {"NoiseNode", &noisenode_ctor},
+    {"DelayNode", &delaynode_ctor},
+    {"WaveShaperNode", &waveshapernode_ctor},
+    {"StereoPannerNode", &stereopannernode_ctor},
+    {"ConvolverNode", &convolvernode_ctor},
+    {"AnalyserNode", &analysernode_ctor},
+    {"DynamicsCompressorNode", &dynamicscompressornode_ctor},
+    {"ConstantSourceNode", &constantsourcenode_ctor},
+    {"ADSRNode", &adsrnode_ctor},
+    {"FeedbackDelayNode", &feedbackdelaynode_ctor},
+    {"PingPongDelayNode", &pingpongdelaynode_ctor},
+    {"StereoWidthNode", &stereowidthnode_ctor},
+    {"ParallelMixerNode", &parallelmixernode_ctor},
+    {"ExpressionNode", &expressionnode_ctor},
+};
+
+static const char* const graph_methods[AP_METHOD_COUNT] = {
+    "setValueAtTime",
+    "linearRampToValueAtTime",
+    "exponentialRampToValueAtTime",
+    "setTargetAtTime",
+    "cancelScheduledValues",
 };
 
+static uint32_t
+graph_length(JSContext* ctx, JSValueConst list) {
+  uint32_t length = 0;
+  JSValue lenv = JS_GetPropertyStr(ctx, list, "length");
+  JS_ToUint32(ctx, &length, lenv);
+  JS_FreeValue(ctx, lenv);
+  return length;
+}
+
+// The node `ref` stands for; its wrapper if `obj` is given.
+static JsAudioNode*
+graph_node(JSContext* ctx, JSValueConst ref, const std::vector<JSValue>& nodes, const AudioContextPtr& ac, JSValue* obj = nullptr) {
+  JSValueConst val = ref;
+  if(JS_IsNumber(ref)) {
+    int32_t i;
+    if(JS_ToInt32(ctx, &i, ref))
+      return nullptr;
+    if(i < 0 || i >= int32_t(nodes.size()))
+      return JS_ThrowRangeError(ctx, "createGraph: no node %d", i), nullptr;
+    val = nodes[i];
+  }
+  JsAudioNode* w = any_audio_node(val);
+  if(!w)
+    return JS_ThrowTypeError(ctx, "createGraph: a node must be an index or an AudioNode"), nullptr;
+  if(w->ctx != ac)
+    return JS_ThrowTypeError(ctx, "createGraph: node belongs to another context"), nullptr;
+  if(obj)
+    *obj = JS_DupValue(ctx, val);
+  return w;
+}
+
+// `name` looked up on the node's wrapper, so it's the name JS uses.
+static std::shared_ptr<lab::AudioParam>
+graph_param(JSContext* ctx, JSValueConst node, JSValueConst name) {
+  const char* s = JS_ToCString(ctx, name);
+  if(!s)
+    return nullptr;
+  std::shared_ptr<lab::AudioParam> param;
+  JSValue v = JS_GetPropertyStr(ctx, node, s);
+  if(JsAudioParam* p = any_audio_param(v))
+    param = p->param;
+  else if(!JS_IsException(v))
+    JS_ThrowTypeError(ctx, "createGraph: no AudioParam '%s'", s);
+  JS_FreeValue(ctx, v);
+  JS_FreeCString(ctx, s);
+  return param;
+}
+
+static int
+graph_build_nodes(JSContext* ctx, JSValueConst ac_jsval, JSValueConst list, std::vector<JSValue>& nodes) {
+  if(JS_IsUndefined(list))
+    return 0;
+  if(!JS_IsArray(ctx, list))
+    return JS_ThrowTypeError(ctx, "createGraph: nodes must be an array"), -1;
+  uint32_t length = graph_length(ctx, list);
+  nodes.reserve(length);
+
+  for(uint32_t k = 0; k < length; k++) {
+    JSValue item = JS_GetPropertyUint32(ctx, list, k);
+    JSValue type = JS_GetPropertyUint32(ctx, item, 0);
+    JSValue args[2] = {JS_DupValue(ctx, ac_jsval), JS_GetPropertyUint32(ctx, item, 1)};
+    JSValue ctor = JS_UNDEFINED;
+    if(JS_IsString(type)) {
+      const char* s = JS_ToCString(ctx, type);
+      for(auto& t : graph_node_types)
+        if(s && !strcmp(s, t.name))
+          ctor = JS_DupValue(ctx, *t.ctor);
+      if(s && JS_IsUndefined(ctor))
+        JS_ThrowTypeError(ctx, "createGraph: unknown node type '%s'", s);
+      JS_FreeCString(ctx, s);
+    } else if(JS_IsConstructor(ctx, type)) {
+      ctor = JS_DupValue(ctx, type);
+    } else {
+      JS_ThrowTypeError(ctx, "createGraph: node %u needs a type", k);
+    }
+
+    JSValue node = JS_IsUndefined(ctor) ? JS_EXCEPTION : JS_CallConstructor(ctx, ctor, 2, args);
+    JS_FreeValue(ctx, ctor);
+    JS_FreeValue(ctx, args[0]);
+    JS_FreeValue(ctx, args[1]);
+    JS_FreeValue(ctx, type);
+    JS_FreeValue(ctx, item);
+    if(JS_IsException(node))
+      return -1;
+    nodes.push_back(node);
+    if(!any_audio_node(node))
+      return JS_ThrowTypeError(ctx, "createGraph: node %u is not an AudioNode", k), -1;
+  }
+  return 0;
+}
+
+static int
+graph_read_edge(JSContext* ctx, JSValueConst from, JSValueConst to, JSValueConst output, JSValueConst input, const std::vector<JSValue>& nodes, const AudioContextPtr& ac, GraphEdge& e) {
+  JsAudioNode* src = graph_node(ctx, from, nodes, ac);
+  if(!src)
+    return -1;
+  e.src = src->node;
+  if(!JS_IsUndefined(output) && JS_ToInt32(ctx, &e.output, output))
+    return -1;
+  if(e.output < 0 || e.output >= e.src->numberOfOutputs())
+    return JS_ThrowRangeError(ctx, "createGraph: %s has no output %d", e.src->name(), e.output), -1;
+
+  if(JsAudioParam* p = any_audio_param(to)) {
+    e.param = p->param;
+  } else if(JS_IsArray(ctx, to)) {
+    JSValue ref = JS_GetPropertyUint32(ctx, to, 0), name = JS_GetPropertyUint32(ctx, to, 1), obj = JS_UNDEFINED;
+    if(graph_node(ctx, ref, nodes, ac, &obj))
+      e.param = graph_param(ctx, obj, name);
+    JS_FreeValue(ctx, obj);
+    JS_FreeValue(ctx, name);
+    JS_FreeValue(ctx, ref);
+    if(!e.param)
+      return -1;
+  } else {
+    JsAudioNode* dst = graph_node(ctx, to, nodes, ac);
+    if(!dst)
+      return -1;
+    e.dst = dst->node;
+    if(!JS_IsUndefined(input) && JS_ToInt32(ctx, &e.input, input))
+      return -1;
+    if(e.input < 0 || e.input >= e.dst->numberOfInputs())
+      return JS_ThrowRangeError(ctx, "createGraph: %s has no input %d", e.dst->name(), e.input), -1;
+  }
+  return 0;
+}
+
+static int
+graph_read_connections(JSContext* ctx, JSValueConst list, const std::vector<JSValue>& nodes, const AudioContextPtr& ac, std::vector<GraphEdge>& edges) {
+  if(JS_IsUndefined(list))
+    return 0;
+  if(!JS_IsObject(list))
+    return JS_ThrowTypeError(ctx, "createGraph: connections must be an array or typed array"), -1;
+  uint32_t length = graph_length(ctx, list);
+  edges.reserve(length);
+
+  for(uint32_t k = 0; k < length;) {
+    JSValue item = JS_GetPropertyUint32(ctx, list, k);
+    GraphEdge e;
+    int ret;
+    if(JS_IsArray(ctx, item)) {
+      JSValue f[4];
+      for(uint32_t i = 0; i < 4; i++)
+        f[i] = JS_GetPropertyUint32(ctx, item, i);
+      ret = graph_read_edge(ctx, f[0], f[1], f[2], f[3], nodes, ac, e);
+      for(JSValue& v : f)
+        JS_FreeValue(ctx, v);
+      k++;
+    } else if(k + 1 < length) {
+      JSValue to = JS_GetPropertyUint32(ctx, list, k + 1);
+      ret = graph_read_edge(ctx, item, to, JS_UNDEFINED, JS_UNDEFINED, nodes, ac, e);
+      JS_FreeValue(ctx, to);
+      k += 2;
+    } else {
+      JS_ThrowTypeError(ctx, "createGraph: connection %u has no destination", k);
+      ret = -1;
+      k++;
+    }
+    JS_FreeValue(ctx, item);
+    if(ret < 0)
+      return -1;
+    edges.push_back(std::move(e));
+  }
+  return 0;
+}
+
+static int
+graph_read_automation(JSContext* ctx, JSValueConst list, const std::vector<JSValue>& nodes, const AudioContextPtr& ac, std::vector<GraphEvent>& events) {
+  if(JS_IsUndefined(list))
+    return 0;
+  if(!JS_IsArray(ctx, list))
+    return JS_ThrowTypeError(ctx, "createGraph: automation must be an array"), -1;
+  uint32_t length = graph_length(ctx, list);
+  events.reserve(length);
+
+  for(uint32_t k = 0; k < length; k++) {
+    JSValue item = JS_GetPropertyUint32(ctx, list, k);
+    JSValue f[6];
+    for(uint32_t i = 0; i < 6; i++)
+      f[i] = JS_GetPropertyUint32(ctx, item, i);
+    JS_FreeValue(ctx, item);
+
+    GraphEvent e;
+    e.op = -1;
+    JSValue obj = JS_UNDEFINED;
+    if(graph_node(ctx, f[0], nodes, ac, &obj))
+      e.param = graph_param(ctx, obj, f[1]);
+    JS_FreeValue(ctx, obj);
+
+    if(e.param && JS_IsString(f[2])) {
+      const char* s = JS_ToCString(ctx, f[2]);
+      for(int op = 0; s && op < AP_METHOD_COUNT; op++)
+        if(!strcmp(s, graph_methods[op]))
+          e.op = op;
+      if(s && e.op < 0)
+        JS_ThrowTypeError(ctx, "createGraph: unknown automation method '%s'", s);
+      JS_FreeCString(ctx, s);
+    } else if(e.param) {
+      int32_t op;
+      if(!JS_ToInt32(ctx, &op, f[2])) {
+        if(op >= 0 && op < AP_METHOD_COUNT)
+          e.op = op;
+        else
+          JS_ThrowRangeError(ctx, "createGraph: bad op %d in automation %u", op, k);
+      }
+    }
+
+    // The arguments as the method takes them; cancelScheduledValues() has
+    // only the time.
+    int ret = e.op < 0 ? -1 : 0;
+    if(e.op == AP_METHOD_CANCEL_SCHEDULED) {
+      ret = JS_ToFloat64(ctx, &e.b, f[3]);
+    } else if(e.op >= 0) {
+      ret = JS_ToFloat64(ctx, &e.a, f[3]) || JS_ToFloat64(ctx, &e.b, f[4]) ? -1 : 0;
+      if(!ret && e.op == AP_METHOD_SET_TARGET_AT_TIME)
+        ret = JS_ToFloat64(ctx, &e.c, f[5]);
+    }
+    for(JSValue& v : f)
+      JS_FreeValue(ctx, v);
+    if(ret < 0)
+      return -1;
+    if(!(e.b >= 0))
+      return JS_ThrowRangeError(ctx, "createGraph: negative time in automation %u", k), -1;
+    events.push_back(std::move(e));
+  }
+  return 0;
+}
+
+static int
+graph_read_starts(JSContext* ctx, JSValueConst list, const std::vector<JSValue>& nodes, const AudioContextPtr& ac, std::vector<GraphStart>& starts) {
+  if(JS_IsUndefined(list))
+    return 0;
+  if(!JS_IsArray(ctx, list))
+    return JS_ThrowTypeError(ctx, "createGraph: start must be an array"), -1;
+  uint32_t length = graph_length(ctx, list);
+  starts.reserve(length);
+
+  for(uint32_t k = 0; k < length; k++) {
+    JSValue item = JS_GetPropertyUint32(ctx, list, k);
+    JSValue f[3];
+    for(uint32_t i = 0; i < 3; i++)
+      f[i] = JS_GetPropertyUint32(ctx, item, i);
+    JS_FreeValue(ctx, item);
+
+    GraphStart s;
+    int ret = -1;
+    if(JsAudioNode* w = graph_node(ctx, f[0], nodes, ac)) {
+      s.node = std::dynamic_pointer_cast<lab::AudioScheduledSourceNode>(w->node);
+      if(!s.node)
+        JS_ThrowTypeError(ctx, "createGraph: %s can't be started", w->node->name());
+      else if((JS_IsUndefined(f[1]) || !JS_ToFloat64(ctx, &s.when, f[1])) && (JS_IsUndefined(f[2]) || !JS_ToFloat64(ctx, &s.stop, f[2])))
+        ret = 0;
+    }
+    for(JSValue& v : f)
+      JS_FreeValue(ctx, v);
+    if(ret < 0)
+      return -1;
+    if(!(s.when >= 0))
+      return JS_ThrowRangeError(ctx, "createGraph: negative start time in start %u", k), -1;
+    starts.push_back(std::move(s));
+  }
+  return 0;
+}
+
+static JSValue
+js_audiocontext_create_graph(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  JsAudioContext* sac = static_cast<JsAudioContext*>(JS_GetOpaque2(ctx, this_val, js_audiocontext_class_id));
+  if(!sac)
+    return JS_EXCEPTION;
+  if(argc < 1 || !JS_IsObject(argv[0]))
+    return JS_ThrowTypeError(ctx, "createGraph requires a descriptor object");
+
+  std::vector<JSValue> nodes;
+  std::vector<GraphEdge> edges;
+  std::vector<GraphEvent> events;
+  std::vector<GraphStart> starts;
+  static const char* const keys[] = {"nodes", "connections", "automation", "start"};
+  int ret = 0;
+  for(int i = 0; i < 4 && !ret; i++) {
+    JSValue list = JS_GetPropertyStr(ctx, argv[0], keys[i]);
+    if(JS_IsException(list))
+      ret = -1;
+    else if(i == 0)
+      ret = graph_build_nodes(ctx, this_val, list, nodes);
+    else if(i == 1)
+      ret = graph_read_connections(ctx, list, nodes, sac->ac, edges);
+    else if(i == 2)
+      ret = graph_read_automation(ctx, list, nodes, sac->ac, events);
+    else
+      ret = graph_read_starts(ctx, list, nodes, sac->ac, starts);
+    JS_FreeValue(ctx, list);
+  }
+
+  JSValue result = ret < 0 ? JS_EXCEPTION : JS_NewArray(ctx);
+  if(JS_IsException(result)) {
+    for(JSValue& v : nodes)
+      JS_FreeValue(ctx, v);
+    return JS_EXCEPTION;
+  }
+
+  // Queued like connect(), so they land after any disconnect() still
+  // waiting for lab's update thread.
+  for(auto& e : edges)
+    if(e.param)
+      sac->ac->connectParam(e.param, e.src, e.output);
+    else
+      sac->ac->connect(e.dst, e.src, e.input, e.output);
+  for(auto& e : events)
+    audioparam_apply(*e.param, e.op, e.a, e.b, e.c);
+  for(auto& s : starts) {
+    s.node->start(s.when);
+    if(s.stop >= 0)
+      s.node->stop(s.stop);
+  }
+
+  for(uint32_t k = 0; k < nodes.size(); k++)
+    JS_SetPropertyUint32(ctx, result, k, nodes[k]);
+  return result;
+}
+
 /* ---------- module init ---------- */
 
 int
 js_labsound_init(JSContext* ctx, JSModuleDef* m) {
+  JS_NewClassID(&js_audionode_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_audionode_class_id, &js_audionode_class);
   audionode_proto = JS_NewObject(ctx);
   JS_SetPropertyFunctionList(ctx, audionode_proto, js_audionode_funcs, countof(js_audionode_funcs));
 
@@ -2719,6 +6647,7 @@ js_labsound_init(JSContext* ctx, JSModuleDef* m) {
   JS_SetClassProto(ctx, js_audiocontext_class_id, audiocontext_proto);
   audiocontext_ctor = JS_NewCFunction2(ctx, js_audiocontext_constructor, "AudioContext", 0, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, audiocontext_ctor, audiocontext_proto);
+  JS_SetPropertyFunctionList(ctx, audiocontext_ctor, js_audiocontext_static_funcs, countof(js_audiocontext_static_funcs));
 
   // OfflineAudioContext shares js_audiocontext_class_id/finalizer with
   // AudioContext (both just wrap a lab::AudioContext), but gets its own
@@ -2730,12 +6659,10 @@ js_labsound_init(JSContext* ctx, JSModuleDef* m) {
   offlineaudiocontext_ctor = JS_NewCFunction2(ctx, js_offlineaudiocontext_constructor, "OfflineAudioContext", 3, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, offlineaudiocontext_ctor, offlineaudiocontext_proto);
 
-  JS_NewClassID(&js_audiodestinationnode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_audiodestinationnode_class_id, &js_audiodestinationnode_class);
+  new_audio_node_kind(&js_audiodestinationnode_class_id, "AudioDestinationNode");
   audiodestinationnode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, audiodestinationnode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, audiodestinationnode_proto, js_audiodestinationnode_funcs, countof(js_audiodestinationnode_funcs));
-  JS_SetClassProto(ctx, js_audiodestinationnode_class_id, audiodestinationnode_proto);
   audiodestinationnode_ctor = JS_NewCFunction2(ctx, js_audiodestinationnode_constructor, "AudioDestinationNode", 0, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, audiodestinationnode_ctor, audiodestinationnode_proto);
 
@@ -2755,30 +6682,24 @@ js_labsound_init(JSContext* ctx, JSModuleDef* m) {
   audiodevice_ctor = JS_NewCFunction2(ctx, js_audiodevice_constructor, "AudioDevice", 0, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, audiodevice_ctor, audiodevice_proto);
 
-  JS_NewClassID(&js_oscillatornode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_oscillatornode_class_id, &js_oscillatornode_class);
+  new_audio_node_kind(&js_oscillatornode_class_id, "OscillatorNode");
   oscillatornode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, oscillatornode_proto, audioscheduledsourcenode_proto);
   JS_SetPropertyFunctionList(ctx, oscillatornode_proto, js_oscillatornode_funcs, countof(js_oscillatornode_funcs));
-  JS_SetClassProto(ctx, js_oscillatornode_class_id, oscillatornode_proto);
   oscillatornode_ctor = JS_NewCFunction2(ctx, js_oscillator_constructor, "OscillatorNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, oscillatornode_ctor, oscillatornode_proto);
 
-  JS_NewClassID(&js_gainnode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_gainnode_class_id, &js_gainnode_class);
+  new_audio_node_kind(&js_gainnode_class_id, "GainNode");
   gainnode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, gainnode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, gainnode_proto, js_gainnode_funcs, countof(js_gainnode_funcs));
-  JS_SetClassProto(ctx, js_gainnode_class_id, gainnode_proto);
   gainnode_ctor = JS_NewCFunction2(ctx, js_gain_constructor, "GainNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, gainnode_ctor, gainnode_proto);
 
-  JS_NewClassID(&js_biquadfilternode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_biquadfilternode_class_id, &js_biquadfilternode_class);
+  new_audio_node_kind(&js_biquadfilternode_class_id, "BiquadFilterNode");
   biquadfilternode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, biquadfilternode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, biquadfilternode_proto, js_biquadfilternode_funcs, countof(js_biquadfilternode_funcs));
-  JS_SetClassProto(ctx, js_biquadfilternode_class_id, biquadfilternode_proto);
   biquadfilternode_ctor = JS_NewCFunction2(ctx, js_biquadfilter_constructor, "BiquadFilterNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, biquadfilternode_ctor, biquadfilternode_proto);
 
@@ -2787,90 +6708,153 @@ js_labsound_init(JSContext* ctx, JSModuleDef* m) {
   audiobuffer_proto = JS_NewObject(ctx);
   JS_SetPropertyFunctionList(ctx, audiobuffer_proto, js_audiobuffer_funcs, countof(js_audiobuffer_funcs));
   JS_SetClassProto(ctx, js_audiobuffer_class_id, audiobuffer_proto);
+
+  // The proto owns the reference (a non-configurable hidden property, so it
+  // can't be deleted out from under us and is released with the context);
+  // float32array_ctor just borrows it for make_float32_array_from().
+  {
+    JSValue global = JS_GetGlobalObject(ctx);
+    float32array_ctor = JS_GetPropertyStr(ctx, global, "Float32Array");
+    JS_FreeValue(ctx, global);
+    JS_DefinePropertyValueStr(ctx, audiobuffer_proto, "__Float32Array", JS_DupValue(ctx, float32array_ctor), 0);
+    JS_FreeValue(ctx, float32array_ctor);
+  }
   audiobuffer_ctor = JS_NewCFunction2(ctx, js_audiobuffer_constructor, "AudioBuffer", 1, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, audiobuffer_ctor, audiobuffer_proto);
 
-  JS_NewClassID(&js_audiobuffersourcenode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_audiobuffersourcenode_class_id, &js_audiobuffersourcenode_class);
+  new_audio_node_kind(&js_audiobuffersourcenode_class_id, "AudioBufferSourceNode");
   audiobuffersourcenode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, audiobuffersourcenode_proto, audioscheduledsourcenode_proto);
   JS_SetPropertyFunctionList(ctx, audiobuffersourcenode_proto, js_audiobuffersourcenode_funcs, countof(js_audiobuffersourcenode_funcs));
-  JS_SetClassProto(ctx, js_audiobuffersourcenode_class_id, audiobuffersourcenode_proto);
   audiobuffersourcenode_ctor = JS_NewCFunction2(ctx, js_absource_constructor, "AudioBufferSourceNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, audiobuffersourcenode_ctor, audiobuffersourcenode_proto);
 
-  JS_NewClassID(&js_noisenode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_noisenode_class_id, &js_noisenode_class);
+  new_audio_node_kind(&js_noisenode_class_id, "NoiseNode");
   noisenode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, noisenode_proto, audioscheduledsourcenode_proto);
   JS_SetPropertyFunctionList(ctx, noisenode_proto, js_noisenode_funcs, countof(js_noisenode_funcs));
-  JS_SetClassProto(ctx, js_noisenode_class_id, noisenode_proto);
   noisenode_ctor = JS_NewCFunction2(ctx, js_noise_constructor, "NoiseNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, noisenode_ctor, noisenode_proto);
 
-  JS_NewClassID(&js_delaynode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_delaynode_class_id, &js_delaynode_class);
+  new_audio_node_kind(&js_delaynode_class_id, "DelayNode");
   delaynode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, delaynode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, delaynode_proto, js_delaynode_funcs, countof(js_delaynode_funcs));
-  JS_SetClassProto(ctx, js_delaynode_class_id, delaynode_proto);
   delaynode_ctor = JS_NewCFunction2(ctx, js_delay_constructor, "DelayNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, delaynode_ctor, delaynode_proto);
 
-  JS_NewClassID(&js_waveshapernode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_waveshapernode_class_id, &js_waveshapernode_class);
+  new_audio_node_kind(&js_waveshapernode_class_id, "WaveShaperNode");
   waveshapernode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, waveshapernode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, waveshapernode_proto, js_waveshapernode_funcs, countof(js_waveshapernode_funcs));
-  JS_SetClassProto(ctx, js_waveshapernode_class_id, waveshapernode_proto);
   waveshapernode_ctor = JS_NewCFunction2(ctx, js_waveshaper_constructor, "WaveShaperNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, waveshapernode_ctor, waveshapernode_proto);
 
-  JS_NewClassID(&js_stereopannernode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_stereopannernode_class_id, &js_stereopannernode_class);
+  new_audio_node_kind(&js_stereopannernode_class_id, "StereoPannerNode");
   stereopannernode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, stereopannernode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, stereopannernode_proto, js_stereopannernode_funcs, countof(js_stereopannernode_funcs));
-  JS_SetClassProto(ctx, js_stereopannernode_class_id, stereopannernode_proto);
   stereopannernode_ctor = JS_NewCFunction2(ctx, js_stereopanner_constructor, "StereoPannerNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, stereopannernode_ctor, stereopannernode_proto);
 
-  JS_NewClassID(&js_convolvernode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_convolvernode_class_id, &js_convolvernode_class);
+  new_audio_node_kind(&js_convolvernode_class_id, "ConvolverNode");
   convolvernode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, convolvernode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, convolvernode_proto, js_convolvernode_funcs, countof(js_convolvernode_funcs));
-  JS_SetClassProto(ctx, js_convolvernode_class_id, convolvernode_proto);
   convolvernode_ctor = JS_NewCFunction2(ctx, js_convolver_constructor, "ConvolverNode", 2, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, convolvernode_ctor, convolvernode_proto);
 
-  JS_NewClassID(&js_analysernode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_analysernode_class_id, &js_analysernode_class);
+  new_audio_node_kind(&js_analysernode_class_id, "AnalyserNode");
   analysernode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, analysernode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, analysernode_proto, js_analysernode_funcs, countof(js_analysernode_funcs));
-  JS_SetClassProto(ctx, js_analysernode_class_id, analysernode_proto);
   analysernode_ctor = JS_NewCFunction2(ctx, js_analyser_constructor, "AnalyserNode", 1, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, analysernode_ctor, analysernode_proto);
 
-  JS_NewClassID(&js_dynamicscompressornode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_dynamicscompressornode_class_id, &js_dynamicscompressornode_class);
+  new_audio_node_kind(&js_dynamicscompressornode_class_id, "DynamicsCompressorNode");
   dynamicscompressornode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, dynamicscompressornode_proto, audionode_proto);
   JS_SetPropertyFunctionList(ctx, dynamicscompressornode_proto, js_dynamicscompressornode_funcs, countof(js_dynamicscompressornode_funcs));
-  JS_SetClassProto(ctx, js_dynamicscompressornode_class_id, dynamicscompressornode_proto);
   dynamicscompressornode_ctor = JS_NewCFunction2(ctx, js_compressor_constructor, "DynamicsCompressorNode", 1, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, dynamicscompressornode_ctor, dynamicscompressornode_proto);
 
-  JS_NewClassID(&js_constantsourcenode_class_id);
-  JS_NewClass(JS_GetRuntime(ctx), js_constantsourcenode_class_id, &js_constantsourcenode_class);
+  new_audio_node_kind(&js_constantsourcenode_class_id, "ConstantSourceNode");
   constantsourcenode_proto = JS_NewObject(ctx);
   JS_SetPrototype(ctx, constantsourcenode_proto, audioscheduledsourcenode_proto);
   JS_SetPropertyFunctionList(ctx, constantsourcenode_proto, js_constantsourcenode_funcs, countof(js_constantsourcenode_funcs));
-  JS_SetClassProto(ctx, js_constantsourcenode_class_id, constantsourcenode_proto);
   constantsourcenode_ctor = JS_NewCFunction2(ctx, js_constantsource_constructor, "ConstantSourceNode", 1, JS_CFUNC_constructor, 0);
   JS_SetConstructor(ctx, constantsourcenode_ctor, constantsourcenode_proto);
 
+  new_audio_node_kind(&js_samplervoicepool_class_id, "SamplerVoicePool");
+  samplervoicepool_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, samplervoicepool_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, samplervoicepool_proto, js_samplervoicepool_funcs, countof(js_samplervoicepool_funcs));
+  samplervoicepool_ctor = JS_NewCFunction2(ctx, js_samplervoicepool_constructor, "SamplerVoicePool", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, samplervoicepool_ctor, samplervoicepool_proto);
+
+  new_audio_node_kind(&js_adsrnode_class_id, "ADSRNode");
+  adsrnode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, adsrnode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, adsrnode_proto, js_adsrnode_funcs, countof(js_adsrnode_funcs));
+  adsrnode_ctor = JS_NewCFunction2(ctx, js_adsr_constructor, "ADSRNode", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, adsrnode_ctor, adsrnode_proto);
+
+  new_audio_node_kind(&js_feedbackdelaynode_class_id, "FeedbackDelayNode");
+  feedbackdelaynode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, feedbackdelaynode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, feedbackdelaynode_proto, js_feedbackdelaynode_funcs, countof(js_feedbackdelaynode_funcs));
+  feedbackdelaynode_ctor = JS_NewCFunction2(ctx, js_feedbackdelaynode_constructor, "FeedbackDelayNode", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, feedbackdelaynode_ctor, feedbackdelaynode_proto);
+
+  new_audio_node_kind(&js_pingpongdelaynode_class_id, "PingPongDelayNode");
+  pingpongdelaynode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, pingpongdelaynode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, pingpongdelaynode_proto, js_pingpongdelaynode_funcs, countof(js_pingpongdelaynode_funcs));
+  pingpongdelaynode_ctor = JS_NewCFunction2(ctx, js_pingpongdelaynode_constructor, "PingPongDelayNode", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, pingpongdelaynode_ctor, pingpongdelaynode_proto);
+
+  new_audio_node_kind(&js_stereowidthnode_class_id, "StereoWidthNode");
+  stereowidthnode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, stereowidthnode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, stereowidthnode_proto, js_stereowidthnode_funcs, countof(js_stereowidthnode_funcs));
+  stereowidthnode_ctor = JS_NewCFunction2(ctx, js_stereowidthnode_constructor, "StereoWidthNode", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, stereowidthnode_ctor, stereowidthnode_proto);
+
+  new_audio_node_kind(&js_parallelmixernode_class_id, "ParallelMixerNode");
+  parallelmixernode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, parallelmixernode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, parallelmixernode_proto, js_parallelmixernode_funcs, countof(js_parallelmixernode_funcs));
+  parallelmixernode_ctor = JS_NewCFunction2(ctx, js_parallelmixernode_constructor, "ParallelMixerNode", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, parallelmixernode_ctor, parallelmixernode_proto);
+
+  new_audio_node_kind(&js_expressionnode_class_id, "ExpressionNode");
+  expressionnode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, expressionnode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, expressionnode_proto, js_expressionnode_funcs, countof(js_expressionnode_funcs));
+  expressionnode_ctor = JS_NewCFunction2(ctx, js_expressionnode_constructor, "ExpressionNode", 2, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, expressionnode_ctor, expressionnode_proto);
+
+  new_audio_node_kind(&js_audioworkletnode_class_id, "AudioWorkletNode");
+  audioworkletnode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, audioworkletnode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, audioworkletnode_proto, js_audioworkletnode_funcs, countof(js_audioworkletnode_funcs));
+  audioworkletnode_ctor = JS_NewCFunction2(ctx, js_audioworkletnode_constructor, "AudioWorkletNode", 2, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, audioworkletnode_ctor, audioworkletnode_proto);
+
+  new_audio_node_kind(&js_stknode_class_id, "StkNode");
+  stknode_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, stknode_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, stknode_proto, js_stknode_funcs, countof(js_stknode_funcs));
+  stknode_ctor = JS_NewCFunction2(ctx, js_stknode_constructor, "StkNode", 2, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, stknode_ctor, stknode_proto);
+
+  new_audio_node_kind(&js_sequencer_class_id, "Sequencer");
+  sequencer_proto = JS_NewObject(ctx);
+  JS_SetPrototype(ctx, sequencer_proto, audionode_proto);
+  JS_SetPropertyFunctionList(ctx, sequencer_proto, js_sequencer_funcs, countof(js_sequencer_funcs));
+  sequencer_ctor = JS_NewCFunction2(ctx, js_sequencer_constructor, "Sequencer", 1, JS_CFUNC_constructor, 0);
+  JS_SetConstructor(ctx, sequencer_ctor, sequencer_proto);
+
   JS_NewClassID(&js_audiosetting_class_id);
   JS_NewClass(JS_GetRuntime(ctx), js_audiosetting_class_id, &js_audiosetting_class);
   audiosetting_proto = JS_NewObject(ctx);
@@ -2883,6 +6867,18 @@ js_labsound_init(JSContext* ctx, JSModuleDef* m) {
   JS_SetPropertyFunctionList(ctx, audioparam_proto, js_audioparam_funcs, countof(js_audioparam_funcs));
   JS_SetClassProto(ctx, js_audioparam_class_id, audioparam_proto);
 
+  JS_NewClassID(&js_audioworklet_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_audioworklet_class_id, &js_audioworklet_class);
+  audioworklet_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, audioworklet_proto, js_audioworklet_funcs, countof(js_audioworklet_funcs));
+  JS_SetClassProto(ctx, js_audioworklet_class_id, audioworklet_proto);
+
+  JS_NewClassID(&js_messageport_class_id);
+  JS_NewClass(JS_GetRuntime(ctx), js_messageport_class_id, &js_messageport_class);
+  messageport_proto = JS_NewObject(ctx);
+  JS_SetPropertyFunctionList(ctx, messageport_proto, js_messageport_funcs, countof(js_messageport_funcs));
+  JS_SetClassProto(ctx, js_messageport_class_id, messageport_proto);
+
   // audionode_proto/audioscheduledsourcenode_proto aren't a real node's
   // class proto (no JS_SetClassProto to hand off their JS_NewObject ref),
   // just shared link objects in the prototype chain — drop our extra ref
@@ -2909,6 +6905,16 @@ js_labsound_init(JSContext* ctx, JSModuleDef* m) {
     JS_SetModuleExport(ctx, m, "AnalyserNode", analysernode_ctor);
     JS_SetModuleExport(ctx, m, "DynamicsCompressorNode", dynamicscompressornode_ctor);
     JS_SetModuleExport(ctx, m, "ConstantSourceNode", constantsourcenode_ctor);
+    JS_SetModuleExport(ctx, m, "SamplerVoicePool", samplervoicepool_ctor);
+    JS_SetModuleExport(ctx, m, "ADSRNode", adsrnode_ctor);
+    JS_SetModuleExport(ctx, m, "FeedbackDelayNode", feedbackdelaynode_ctor);
+    JS_SetModuleExport(ctx, m, "PingPongDelayNode", pingpongdelaynode_ctor);
+    JS_SetModuleExport(ctx, m, "StereoWidthNode", stereowidthnode_ctor);
+    JS_SetModuleExport(ctx, m, "ParallelMixerNode", parallelmixernode_ctor);
+    JS_SetModuleExport(ctx, m, "ExpressionNode", expressionnode_ctor);
+    JS_SetModuleExport(ctx, m, "AudioWorkletNode", audioworkletnode_ctor);
+    JS_SetModuleExport(ctx, m, "StkNode", stknode_ctor);
+    JS_SetModuleExport(ctx, m, "Sequencer", sequencer_ctor);
   }
 
   return 0;
@@ -2934,6 +6940,16 @@ js_init_module_labsound(JSContext* ctx, JSModuleDef* m) {
   JS_AddModuleExport(ctx, m, "AnalyserNode");
   JS_AddModuleExport(ctx, m, "DynamicsCompressorNode");
   JS_AddModuleExport(ctx, m, "ConstantSourceNode");
+  JS_AddModuleExport(ctx, m, "SamplerVoicePool");
+  JS_AddModuleExport(ctx, m, "ADSRNode");
+  JS_AddModuleExport(ctx, m, "FeedbackDelayNode");
+  JS_AddModuleExport(ctx, m, "PingPongDelayNode");
+  JS_AddModuleExport(ctx, m, "StereoWidthNode");
+  JS_AddModuleExport(ctx, m, "ParallelMixerNode");
+  JS_AddModuleExport(ctx, m, "ExpressionNode");
+  JS_AddModuleExport(ctx, m, "AudioWorkletNode");
+  JS_AddModuleExport(ctx, m, "StkNode");
+  JS_AddModuleExport(ctx, m, "Sequencer");
 }
 
 extern "C" VISIBLE JSModuleDef*
@@ -3,10 +3,16 @@
 
 #include <vector>
 #include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
 #include <cmath>
 #include <cstring>
+#include <functional>
+#include <algorithm>
 
 #include "defines.h"
+#include "stk-source.hpp"
 #include "Stk.h"
 #include "Generator.h"
 #include "Filter.h"
@@ -140,6 +146,22 @@ js_symbol_tostringtag(JSContext* ctx) {
   return ret;
 }
 
+static JSAtom
+js_symbol_for(JSContext* ctx, const char* name) {
+  JSValue g = JS_GetGlobalObject(ctx);
+  JSValue sym = JS_GetPropertyStr(ctx, g, "Symbol");
+  JSValue fn = JS_GetPropertyStr(ctx, sym, "for");
+  JSValue key = JS_NewString(ctx, name);
+  JSValue val = JS_Call(ctx, fn, sym, 1, &key);
+  JS_FreeValue(ctx, key);
+  JS_FreeValue(ctx, fn);
+  JS_FreeValue(ctx, sym);
+  JS_FreeValue(ctx, g);
+  JSAtom ret = JS_ValueToAtom(ctx, val);
+  JS_FreeValue(ctx, val);
+  return ret;
+}
+
 static void
 js_set_tostringtag(JSContext* ctx, JSValueConst obj, const char* name) {
   JSAtom tst = js_symbol_tostringtag(ctx);
@@ -3467,6 +3489,168 @@ static const JSCFunctionListEntry js_rtaudio_funcs[] = {
     JS_PROP_STRING_DEF("[Symbol.toStringTag]", "RtAudio", JS_PROP_CONFIGURABLE),
 };
 
+/* ---------- StkSource (stk-source.hpp) ---------- */
+
+static_assert(sizeof(stk::StkFloat) == sizeof(double), "StkSource passes samples as double");
+
+class StkBlockSource : public StkSource {
+public:
+  typedef std::function<void(stk::StkFrames&)> Tick;
+
+  StkBlockSource(StkPtr owner, unsigned in, unsigned out, Tick fn, stk::Instrmnt* instrument = nullptr, stk::Effect* effect = nullptr)
+      : owner(std::move(owner)), in(in), out(out), fn(std::move(fn)), instrument(instrument), effect(effect), block(MAX_FRAMES, std::max(in, out)) {}
+
+  unsigned
+  inputs() const override {
+    return in;
+  }
+
+  unsigned
+  outputs() const override {
+    return out;
+  }
+
+  /* StkFrames only reallocates when it grows */
+  double*
+  frames(unsigned n) override {
+    block.resize(std::min(n, unsigned(MAX_FRAMES)), std::max(in, out));
+    return &block[0];
+  }
+
+  void
+  tick() override {
+    fn(block);
+  }
+
+  bool
+  accepts(int type) const override {
+    switch(type) {
+      case NOTE_ON:
+      case NOTE_OFF:
+      case CONTROL_CHANGE: return instrument != nullptr;
+      case EFFECT_MIX: return effect != nullptr;
+    }
+    return false;
+  }
+
+  void
+  control(int type, double a, double b) override {
+    switch(type) {
+      case NOTE_ON:
+        if(instrument)
+          instrument->noteOn(a, b);
+        break;
+      case NOTE_OFF:
+        if(instrument)
+          instrument->noteOff(a);
+        break;
+      case CONTROL_CHANGE:
+        if(instrument)
+          instrument->controlChange(int(a), b);
+        break;
+      case EFFECT_MIX:
+        if(effect)
+          effect->setEffectMix(a);
+        break;
+    }
+  }
+
+  void
+  setSampleRate(double rate) override {
+    if(rate != Stk::sampleRate())
+      Stk::setSampleRate(rate);
+  }
+
+private:
+  StkPtr owner;
+  unsigned in, out;
+  Tick fn;
+  stk::Instrmnt* instrument;
+  stk::Effect* effect;
+  stk::StkFrames block;
+};
+
+/* Sources handed out by js_stk_source(), by id. An entry lives as long as
+ * the ArrayBuffer holding its id; ids are never reused. */
+struct StkSourceToken {
+  uint64_t id;
+  std::shared_ptr<StkSource> source;
+};
+
+static std::mutex stk_sources_lock;
+static std::unordered_map<uint64_t, std::weak_ptr<StkSource>> stk_sources;
+static uint64_t stk_sources_next = 0;
+
+extern "C" VISIBLE bool
+qjs_stk_source_lookup(uint64_t id, std::shared_ptr<StkSource>& source) {
+  std::lock_guard<std::mutex> guard(stk_sources_lock);
+  auto it = stk_sources.find(id);
+  source = it == stk_sources.end() ? nullptr : it->second.lock();
+  return bool(source);
+}
+
+static_assert(std::is_same<decltype(qjs_stk_source_lookup), StkSourceLookup>::value, "qjs_stk_source_lookup must match StkSourceLookup");
+
+static void
+js_stk_source_free(JSRuntime* rt, void* opaque, void* ptr) {
+  StkSourceToken* token = static_cast<StkSourceToken*>(opaque);
+  {
+    std::lock_guard<std::mutex> guard(stk_sources_lock);
+    stk_sources.erase(token->id);
+  }
+  delete token;
+}
+
+/* Symbol.for(STK_SOURCE_SYMBOL) on instrument, effect, generator and filter
+ * objects: `this` as an StkSource, for StkNode in qjs-labsound. */
+static JSValue
+js_stk_source(JSContext* ctx, JSValueConst this_val, int argc, JSValueConst argv[]) {
+  std::shared_ptr<StkSource> source;
+
+  if(StkInstrmntPtr* i = static_cast<StkInstrmntPtr*>(JS_GetOpaque(this_val, js_stkinstrmnt_class_id))) {
+    stk::Instrmnt* p = i->get();
+    source = std::make_shared<StkBlockSource>(*i, 0, p->channelsOut(), [p](stk::StkFrames& f) { p->tick(f, 0); }, p);
+  } else if(StkGeneratorPtr* g = static_cast<StkGeneratorPtr*>(JS_GetOpaque(this_val, js_stkgenerator_class_id))) {
+    stk::Generator* p = g->get();
+    source = std::make_shared<StkBlockSource>(*g, 0, p->channelsOut(), [p](stk::StkFrames& f) { p->tick(f, 0); });
+  } else if(StkFilterPtr* fl = static_cast<StkFilterPtr*>(JS_GetOpaque(this_val, js_stkfilter_class_id))) {
+    stk::Filter* p = fl->get();
+    source = std::make_shared<StkBlockSource>(*fl, 1, 1, [p](stk::StkFrames& f) { p->tick(f, 0); });
+  } else if(StkEffectPtr* e = static_cast<StkEffectPtr*>(JS_GetOpaque(this_val, js_stkeffect_class_id))) {
+    stk::Effect* eff = e->get();
+
+    /* No common virtual tick() (see js_stkeffect_method); the reverbs and
+     * Chorus write a stereo pair from channel 0, FreeVerb also reads one. */
+    if(auto* p = dynamic_cast<stk::FreeVerb*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 2, 2, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::JCRev*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 2, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::PRCRev*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 2, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::NRev*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 2, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::Chorus*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 2, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::Echo*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 1, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::PitShift*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 1, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+    else if(auto* p = dynamic_cast<stk::LentPitShift*>(eff))
+      source = std::make_shared<StkBlockSource>(*e, 1, 1, [p](stk::StkFrames& f) { p->tick(f, 0); }, nullptr, eff);
+  }
+
+  if(!source)
+    return JS_ThrowTypeError(ctx, "not an STK instrument, effect, generator or filter");
+
+  StkSourceToken* token = new StkSourceToken{0, source};
+  {
+    std::lock_guard<std::mutex> guard(stk_sources_lock);
+    token->id = ++stk_sources_next;
+    stk_sources[token->id] = source;
+  }
+  return JS_NewArrayBuffer(ctx, reinterpret_cast<uint8_t*>(&token->id), sizeof(token->id), js_stk_source_free, token, false);
+}
+
 int
 js_stk_init(JSContext* ctx, JSModuleDef* m) {
   JS_NewClassID(&js_stk_class_id);
@@ -3797,6 +3981,12 @@ js_stk_init(JSContext* ctx, JSModuleDef* m) {
   JS_NewClassID(&js_rtaudio_class_id);
   JS_NewClass(JS_GetRuntime(ctx), js_rtaudio_class_id, &js_rtaudio_class);
 
+  /* see stk-source.hpp */
+  JSAtom source = js_symbol_for(ctx, STK_SOURCE_SYMBOL);
+  for(JSValue proto : {stkinstrmnt_proto, stkeffect_proto, stkgenerator_proto, stkfilter_proto})
+    JS_DefinePropertyValue(ctx, proto, source, JS_NewCFunction(ctx, js_stk_source, "StkSource", 0), JS_PROP_CONFIGURABLE);
+  JS_FreeAtom(ctx, source);
+
   rtaudio_proto = JS_NewObject(ctx);
   JS_SetPropertyFunctionList(ctx, rtaudio_proto, js_rtaudio_funcs, countof(js_rtaudio_funcs));
   JS_SetClassProto(ctx, js_rtaudio_class_id, rtaudio_proto);
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+
+/* ============================================================
+ * Render-thread health counters for a realtime context.
+ *
+ * AudioDevice_RtAudio only prints RtAudio's stream status, so
+ * RtAudioDevice (rtaudio-device.hpp) owns one of these and reports to it
+ * from its own callback:
+ *
+ *  - quantum() after each render quantum, with the time the graph took
+ *    to render it;
+ *  - callback() when a device callback returns, with RtAudio's status
+ *    for it and the times it started and ended. Its load is that span
+ *    over the period of audio it produced.
+ *
+ * An xrun is a callback RtAudio flagged with an output underflow or input
+ * overflow. The callback interval is the time between callback starts; its
+ * jitter is measured against the previous callback's period, and a late
+ * callback is one that arrived more than half a period after it.
+ *
+ * Everything the JS thread reads is atomic; the ring entries are written
+ * before the head that publishes them.
+ * ============================================================ */
+
+class RenderMonitor {
+public:
+  enum { DURATIONS = 1024, INTERVALS = 256 };
+  using clock = std::chrono::steady_clock;
+
+  RenderMonitor() {
+    for(auto& d : durations)
+      d.store(0, std::memory_order_relaxed);
+    for(auto& i : intervals)
+      i.store(0, std::memory_order_relaxed);
+  }
+
+  /* ---------- JS thread ---------- */
+
+  // Zeroes the counters; the rings keep their history.
+  void
+  clear() {
+    resetRequested.store(true, std::memory_order_release);
+  }
+
+  std::atomic<uint64_t> quanta{0}, callbacks{0}, xruns{0}, lateCallbacks{0};
+  std::atomic<double> jitterSum{0}, maxJitter{0}, loadSum{0}, peakLoad{0};
+  // Seconds; entry i of the ring is slot i % size, `*Head` counts writes.
+  std::atomic<float> durations[DURATIONS], intervals[INTERVALS];
+  std::atomic<uint64_t> durationsHead{0}, intervalsHead{0};
+
+  /* ---------- render thread ---------- */
+
+  // One quantum took `render` seconds to render.
+  void
+  quantum(double render) {
+    applyReset();
+
+    uint64_t h = durationsHead.load(std::memory_order_relaxed);
+    durations[h % DURATIONS].store(float(render), std::memory_order_relaxed);
+    durationsHead.store(h + 1, std::memory_order_release);
+    quanta.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  // A device callback for `period` seconds of audio ran from `start` to
+  // `end`; `status` is RtAudio's stream status it was called with.
+  void
+  callback(unsigned int status, clock::time_point start, clock::time_point end, double period) {
+    applyReset();
+
+    callbacks.fetch_add(1, std::memory_order_relaxed);
+    if(status)
+      xruns.fetch_add(1, std::memory_order_relaxed);
+
+    double load = std::chrono::duration<double>(end - start).count() / period;
+    loadSum.store(loadSum.load(std::memory_order_relaxed) + load, std::memory_order_relaxed);
+    if(load > peakLoad.load(std::memory_order_relaxed))
+      peakLoad.store(load, std::memory_order_relaxed);
+
+    if(lastPeriod > 0) {
+      double interval = std::chrono::duration<double>(start - lastStart).count();
+      double jitter = std::fabs(interval - lastPeriod);
+      if(interval > lastPeriod * 1.5)
+        lateCallbacks.fetch_add(1, std::memory_order_relaxed);
+      jitterSum.store(jitterSum.load(std::memory_order_relaxed) + jitter, std::memory_order_relaxed);
+      if(jitter > maxJitter.load(std::memory_order_relaxed))
+        maxJitter.store(jitter, std::memory_order_relaxed);
+
+      uint64_t h = intervalsHead.load(std::memory_order_relaxed);
+      intervals[h % INTERVALS].store(float(interval), std::memory_order_relaxed);
+      intervalsHead.store(h + 1, std::memory_order_release);
+    }
+    lastStart = start;
+    lastPeriod = period;
+  }
+
+private:
+  void
+  applyReset() {
+    if(!resetRequested.exchange(false, std::memory_order_acquire))
+      return;
+    for(auto* c : {&quanta, &callbacks, &xruns, &lateCallbacks})
+      c->store(0, std::memory_order_relaxed);
+    for(auto* c : {&jitterSum, &maxJitter, &loadSum, &peakLoad})
+      c->store(0, std::memory_order_relaxed);
+  }
+
+  std::atomic<bool> resetRequested{false};
+  clock::time_point lastStart;
+  double lastPeriod = 0;
+};
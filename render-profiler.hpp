@@ -0,0 +1,320 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/extended/AudioContextLock.h"
+#include "lockfree-ring.hpp"
+
+/* ============================================================
+ * Per-node render profiling.
+ *
+ * lab::AudioNode::processIfNecessary() already times every node it runs
+ * (`totalTime`, and `graphTime` for the part spent pulling inputs), but
+ * each quantum overwrites the previous one. This node accumulates them:
+ * it sits on the context's automatic-pull list, so it runs on the render
+ * thread once per quantum after the graph has been pulled, and folds each
+ * tracked node's self time (total - graph) into per-node and per-type
+ * totals, call counts and worst cases.
+ *
+ * Nodes arrive and leave through an SpscRing from the JS thread (the node
+ * registry feeds it), and removed nodes go back through a second ring so
+ * the render thread never drops the last reference. The node and type
+ * tables are fixed at construction: nodes past the node table's capacity
+ * are counted rather than tracked, and types past the type table's are
+ * summed as "other". With `interval` > 1 only every interval-th quantum is
+ * sampled, which is the always-on mode. Reads and resets happen on the JS
+ * thread under a ContextRenderLock.
+ * ============================================================ */
+
+class RenderProfilerNode : public lab::AudioNode {
+public:
+  struct NodeStats {
+    std::shared_ptr<lab::AudioNode> node;
+    uint32_t id = 0;
+    const char* type = nullptr;
+    // When lab last started timing the node, as of the previous sample: a
+    // node that wasn't pulled since still shows that run's times.
+    std::chrono::high_resolution_clock::time_point last;
+    double time = 0; // accumulated self time, us
+    uint64_t calls = 0;
+    float worst = 0;
+  };
+
+  struct TypeStats {
+    const char* type = nullptr;
+    double time = 0;
+    uint64_t calls = 0;
+    float worst = 0;
+  };
+
+  // Copied out under the render lock.
+  struct Snapshot {
+    int interval = 0;
+    uint64_t quanta = 0, sampled = 0;
+    double renderTime = 0; // us, sum over sampled quanta
+    float worstQuantum = 0;
+    int quantumFrames = 0;
+    uint64_t untracked = 0; // nodes the table had no room for
+    std::vector<NodeStats> nodes; // `node` left empty
+    std::vector<TypeStats> types;
+  };
+
+  explicit RenderProfilerNode(lab::AudioContext& ac, size_t capacity = 1024, size_t typeCapacity = 64)
+      : lab::AudioNode(ac, *desc()), commands(capacity), finished(capacity), nodeCapacity(capacity), typeCapacity(typeCapacity) {
+    nodes.reserve(nodeCapacity);
+    types.reserve(typeCapacity);
+    initialize();
+  }
+
+  virtual ~RenderProfilerNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioNodeDescriptor d{nullptr, nullptr, 0};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "RenderProfiler";
+  }
+
+  /* ---------- JS thread ---------- */
+
+  // 0 = off, 1 = every quantum, n = every n-th quantum.
+  void
+  setInterval(int n) {
+    interval.store(std::max(0, n), std::memory_order_relaxed);
+  }
+
+  int
+  getInterval() const {
+    return interval.load(std::memory_order_relaxed);
+  }
+
+  // Before the node is on the automatic-pull list nothing else touches
+  // it, so the initial population skips the ring.
+  void
+  track(std::shared_ptr<lab::AudioNode> node, uint32_t id) {
+    if(nodes.size() >= nodeCapacity) {
+      untracked++;
+      return;
+    }
+    NodeStats s;
+    s.type = node->name();
+    s.id = id;
+    s.last = node->totalTime.start;
+    s.node = std::move(node);
+    nodes.push_back(std::move(s));
+  }
+
+  void
+  add(lab::AudioContext* ac, std::shared_ptr<lab::AudioNode> node, uint32_t id) {
+    Command cmd;
+    cmd.node = std::move(node);
+    cmd.id = id;
+    post(ac, std::move(cmd));
+  }
+
+  void
+  remove(lab::AudioContext* ac, lab::AudioNode* node) {
+    Command cmd;
+    cmd.removed = node;
+    post(ac, std::move(cmd));
+  }
+
+  void
+  reset(lab::AudioContext* ac) {
+    lab::ContextRenderLock r(ac, "RenderProfiler.reset");
+    drain();
+    clear();
+  }
+
+  Snapshot
+  snapshot(lab::AudioContext* ac) {
+    Snapshot snap;
+    {
+      lab::ContextRenderLock r(ac, "RenderProfiler.snapshot");
+      drain();
+      snap.interval = getInterval();
+      snap.quanta = quanta;
+      snap.sampled = sampled;
+      snap.renderTime = renderTime;
+      snap.worstQuantum = worstQuantum;
+      snap.quantumFrames = quantumFrames;
+      snap.untracked = untracked;
+      snap.nodes.reserve(nodes.size());
+      for(const auto& n : nodes) {
+        snap.nodes.push_back(n);
+        snap.nodes.back().node.reset();
+      }
+      snap.types = types;
+      if(other.calls)
+        snap.types.push_back(other);
+    }
+    reclaim();
+    return snap;
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  process(lab::ContextRenderLock&, int bufferSize) override {
+    drain();
+    int n = interval.load(std::memory_order_relaxed);
+    if(n <= 0)
+      return;
+    quantumFrames = bufferSize;
+    if(quanta++ % uint64_t(n))
+      return;
+    sampled++;
+
+    float sum = 0;
+    for(auto& s : nodes) {
+      const lab::ProfileSample& sample = s.node->totalTime;
+      if(sample.start == s.last)
+        continue;
+      s.last = sample.start;
+      float total = sample.microseconds.count();
+      float self = std::max(0.f, total - s.node->graphTime.microseconds.count());
+      s.time += self;
+      s.calls++;
+      s.worst = std::max(s.worst, self);
+      sum += self;
+
+      TypeStats& t = typeStats(s.type);
+      t.time += self;
+      t.calls++;
+      t.worst = std::max(t.worst, self);
+    }
+    renderTime += sum;
+    worstQuantum = std::max(worstQuantum, sum);
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {}
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // No inputs, so the default would skip process() entirely.
+  bool
+  propagatesSilence(lab::ContextRenderLock&) const override {
+    return false;
+  }
+
+private:
+  struct Command {
+    std::shared_ptr<lab::AudioNode> node; // add
+    lab::AudioNode* removed = nullptr;    // or remove
+    uint32_t id = 0;
+  };
+
+  // A full ring means the render thread is stalled or not running (e.g. an
+  // offline context that isn't rendering); apply the backlog ourselves
+  // under the render lock, which makes this thread the consumer meanwhile.
+  void
+  post(lab::AudioContext* ac, Command&& cmd) {
+    reclaim();
+    if(commands.push(std::move(cmd)))
+      return;
+    {
+      lab::ContextRenderLock r(ac, "RenderProfiler.post");
+      drain();
+      commands.push(std::move(cmd));
+    }
+    reclaim();
+  }
+
+  void
+  reclaim() {
+    std::shared_ptr<lab::AudioNode> node;
+    while(finished.pop(node))
+      node.reset();
+  }
+
+  void
+  drain() {
+    Command cmd;
+    while(commands.pop(cmd)) {
+      if(cmd.node) {
+        if(nodes.size() >= nodeCapacity) {
+          untracked++;
+          finished.push(std::move(cmd.node));
+          continue;
+        }
+        NodeStats s;
+        s.type = cmd.node->name();
+        s.id = cmd.id;
+        s.node = std::move(cmd.node);
+        s.last = s.node->totalTime.start;
+        // Within the reserve, so this never allocates.
+        nodes.push_back(std::move(s));
+      } else if(cmd.removed) {
+        for(size_t i = 0; i < nodes.size(); i++)
+          if(nodes[i].node.get() == cmd.removed) {
+            finished.push(std::move(nodes[i].node));
+            nodes[i] = std::move(nodes.back());
+            nodes.pop_back();
+            break;
+          }
+      }
+    }
+  }
+
+  void
+  clear() {
+    quanta = sampled = 0;
+    renderTime = 0;
+    worstQuantum = 0;
+    for(auto& s : nodes) {
+      s.time = 0;
+      s.calls = 0;
+      s.worst = 0;
+    }
+    for(auto& t : types)
+      t = TypeStats{t.type};
+    other = TypeStats{"other"};
+  }
+
+  // lab node names are string literals, so the pointer identifies the type.
+  TypeStats&
+  typeStats(const char* type) {
+    for(auto& t : types)
+      if(t.type == type || !strcmp(t.type, type))
+        return t;
+    if(types.size() >= typeCapacity)
+      return other;
+    types.push_back(TypeStats{type});
+    return types.back();
+  }
+
+  std::atomic<int> interval{0};
+  SpscRing<Command> commands;
+  SpscRing<std::shared_ptr<lab::AudioNode>> finished;
+  const size_t nodeCapacity, typeCapacity;
+  std::vector<NodeStats> nodes;
+  std::vector<TypeStats> types;
+  TypeStats other{"other"};
+  uint64_t untracked = 0;
+  uint64_t quanta = 0, sampled = 0;
+  double renderTime = 0;
+  float worstQuantum = 0;
+  int quantumFrames = 0;
+};
@@ -0,0 +1,78 @@
+// Render quantum size: throughput vs. latency.
+//
+// Renders the same offline graph -- VOICES detuned saws through a lowpass
+// each, summed into a compressor -- once per renderQuantumSize and prints
+// how fast each pass ran against realtime. Larger passes amortize the
+// per-pass work (cancel/progress checks, handing frames to the result or
+// the file writer); the graph itself is still pulled one 128-frame quantum
+// at a time by lab, so don't expect the gain to scale with the size.
+// Sizes below 128 round up to it: the first rows show the size in effect.
+//
+// The last column is the latency a realtime callback of that size adds:
+// `new AudioContext({renderQuantumSize})` sets the device's frames per
+// callback, and ctx.renderQuantumSize / ctx.baseLatency report what the
+// device settled on.
+
+const isBrowser = typeof globalThis.window !== 'undefined';
+
+const SR = 48000;
+const SECONDS = 20;
+const VOICES = 24;
+const SIZES = [32, 64, 128, 256, 512, 1024, 2048, 4096];
+
+function buildGraph(env, ctx) {
+  const comp = new env.DynamicsCompressorNode(ctx, { threshold: -18, ratio: 4 });
+  comp.connect(ctx.destination);
+
+  for(let i = 0; i < VOICES; i++) {
+    const osc = new env.OscillatorNode(ctx, { type: 'sawtooth', frequency: 55 * (1 + i / 7) });
+    const lp = new env.BiquadFilterNode(ctx, { type: 'lowpass', frequency: 800 + i * 150, Q: 4 });
+    const g = new env.GainNode(ctx, { gain: 0.6 / VOICES });
+    osc.connect(lp);
+    lp.connect(g);
+    g.connect(comp);
+    osc.start(0);
+  }
+}
+
+async function bench(env, size) {
+  const length = SR * SECONDS;
+  const ctx = new env.OfflineAudioContext({ numberOfChannels: 2, length, sampleRate: SR, renderQuantumSize: size });
+  buildGraph(env, ctx);
+
+  const t0 = Date.now();
+  await ctx.startRendering();
+  const ms = Math.max(1, Date.now() - t0);
+
+  return { size: ctx.renderQuantumSize ?? size, ms, speed: (SECONDS * 1000) / ms };
+}
+
+async function main() {
+  const env = isBrowser ? globalThis : await import('labsound');
+
+  console.log(`${VOICES} voices, ${SECONDS}s at ${SR} Hz\n`);
+  console.log(' asked  in effect    render ms   x realtime   callback latency');
+
+  let base;
+  for(const size of SIZES) {
+    const r = await bench(env, size);
+    if(r.size === 128)
+      base ??= r.ms;
+    const latency = ((r.size / SR) * 1000).toFixed(2);
+    console.log(
+      `${String(size).padStart(6)}  ${String(r.size).padStart(9)}  ${String(r.ms).padStart(10)}  ${r.speed.toFixed(1).padStart(10)}x  ${latency.padStart(10)} ms` +
+        (base ? `   (${((base / r.ms - 1) * 100).toFixed(1)}% vs 128)` : ''),
+    );
+  }
+
+  if(!isBrowser) {
+    const live = new env.AudioContext({ renderQuantumSize: 64 });
+    console.log(
+      `\nrealtime: asked for 64, device runs ${live.renderQuantumSize}-frame callbacks` +
+        ` (base ${(live.baseLatency * 1000).toFixed(2)} ms, output ${(live.outputLatency * 1000).toFixed(2)} ms)`,
+    );
+    await live.close?.();
+  }
+}
+
+main();
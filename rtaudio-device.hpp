@@ -0,0 +1,321 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioBus.h"
+
+#include "render-monitor.hpp"
+
+#if __has_include("LabSound/backends/RtAudio.h")
+#include "LabSound/backends/RtAudio.h"
+#else
+#include "RtAudio.h" // third_party/LabSound/src/backends/RtAudio
+#endif
+
+/* ============================================================
+ * RtAudio device with configurable buffering.
+ *
+ * lab::AudioDevice_RtAudio opens its stream with one render quantum per
+ * callback and RtAudio's default buffer count, and keeps its RtAudio
+ * object private, so neither the buffering nor the latency RtAudio
+ * reports for the open stream can be reached through it. RtAudioDevice
+ * is the same device with both exposed:
+ *
+ *  - `frames` per callback and `buffers` (RtAudio's numberOfBuffers) are
+ *    requested at open time, at least one render quantum; RtAudio may
+ *    adjust the frame count, and bufferFrames() returns what it settled on;
+ *  - the graph is still pulled ProcessingSizeInFrames at a time, so a
+ *    callback renders as many quanta as it needs and carries what's left
+ *    of the last one over to the next callback. Input goes through a
+ *    small FIFO for the same reason;
+ *  - baseLatency() is one callback's worth of frames, or one quantum if
+ *    RtAudio settled on less; outputLatency() is RtAudio's own figure for
+ *    the stream (its buffers plus the driver's);
+ *  - monitor() gets each callback's stream status and timing, and each
+ *    quantum's render time (render-monitor.hpp).
+ * ============================================================ */
+
+class RtAudioDevice : public lab::AudioDevice {
+public:
+  struct Buffering {
+    unsigned int frames = lab::AudioNode::ProcessingSizeInFrames;
+    unsigned int buffers = 2;
+    bool minimizeLatency = true;
+  };
+
+  RtAudioDevice(const lab::AudioStreamConfig& input, const lab::AudioStreamConfig& output, const Buffering& buffering)
+      : inputConfig(input), outputConfig(output) {
+    RtAudio::StreamParameters out;
+    out.deviceId = output.device_index;
+    out.nChannels = output.desired_channels;
+    out.firstChannel = 0;
+
+    RtAudio::StreamParameters in;
+    in.deviceId = input.device_index;
+    in.nChannels = input.device_index >= 0 ? input.desired_channels : 0;
+    in.firstChannel = 0;
+
+    RtAudio::StreamOptions options;
+    options.flags = RTAUDIO_NONINTERLEAVED | RTAUDIO_SCHEDULE_REALTIME;
+    if(buffering.minimizeLatency)
+      options.flags |= RTAUDIO_MINIMIZE_LATENCY;
+    options.numberOfBuffers = std::max(2u, buffering.buffers);
+    options.streamName = "qjs-sound";
+
+    unsigned int frames = std::max<unsigned int>(lab::AudioNode::ProcessingSizeInFrames, buffering.frames);
+    // RtAudio 5 throws RtAudioError (a std::runtime_error); 6 returns an
+    // error code instead. isStreamOpen() covers both.
+    try {
+      rtaudio.openStream(&out, in.nChannels ? &in : nullptr, RTAUDIO_FLOAT32, unsigned(output.desired_samplerate), &frames, &RtAudioDevice::callback, this, &options);
+    } catch(const std::exception& e) {
+      errorText = e.what();
+    }
+    if(!rtaudio.isStreamOpen()) {
+      if(errorText.empty())
+        errorText = "cannot open audio stream";
+      return;
+    }
+
+    bufferSize = frames;
+    outputConfig.desired_samplerate = float(rtaudio.getStreamSampleRate());
+    inputConfig.desired_samplerate = outputConfig.desired_samplerate;
+    inputConfig.desired_channels = in.nChannels;
+
+    const int quantum = lab::AudioNode::ProcessingSizeInFrames;
+    renderBus = std::make_unique<lab::AudioBus>(int(outputConfig.desired_channels), quantum, true);
+    renderBus->setSampleRate(outputConfig.desired_samplerate);
+    if(in.nChannels) {
+      inputBus = std::make_unique<lab::AudioBus>(int(in.nChannels), quantum, true);
+      inputBus->setSampleRate(outputConfig.desired_samplerate);
+      // Room for a callback's input plus the quantum not yet consumed.
+      size_t size = 1;
+      while(size < 2 * (frames + quantum))
+        size <<= 1;
+      fifo.assign(size * in.nChannels, 0.f);
+      fifoSize = size;
+    }
+    samplingInfo = lab::SamplingInfo{};
+    samplingInfo.sampling_rate = outputConfig.desired_samplerate;
+  }
+
+  // The default device for one direction, without enumerating the rest:
+  // lab::AudioDevice_RtAudio::MakeAudioDeviceList() probes every device on
+  // the host, this only the one asked for. `index` is -1 if there is none.
+  static lab::AudioDeviceInfo
+  defaultDevice(bool input) {
+    lab::AudioDeviceInfo info;
+    try {
+      RtAudio rtaudio;
+      if(!rtaudio.getDeviceCount())
+        return info;
+      unsigned int id = input ? rtaudio.getDefaultInputDevice() : rtaudio.getDefaultOutputDevice();
+      RtAudio::DeviceInfo d = rtaudio.getDeviceInfo(id);
+      if(!(input ? d.inputChannels : d.outputChannels))
+        return info;
+      info.index = int32_t(id);
+      info.identifier = d.name;
+      info.num_output_channels = d.outputChannels;
+      info.num_input_channels = d.inputChannels;
+      for(unsigned int rate : d.sampleRates)
+        info.supported_samplerates.push_back(float(rate));
+      info.nominal_samplerate = float(d.preferredSampleRate);
+      info.is_default_output = d.isDefaultOutput;
+      info.is_default_input = d.isDefaultInput;
+    } catch(const std::exception&) {
+      info.index = -1;
+    }
+    return info;
+  }
+
+  virtual ~RtAudioDevice() {
+    stop();
+    if(rtaudio.isStreamOpen())
+      rtaudio.closeStream();
+  }
+
+  bool
+  isOpen() const {
+    return bufferSize > 0;
+  }
+
+  const std::string&
+  error() const {
+    return errorText;
+  }
+
+  unsigned int
+  bufferFrames() const {
+    return bufferSize;
+  }
+
+  // Seconds of audio the context hands the device at a time.
+  double
+  baseLatency() const {
+    // A callback RtAudio shrank below a quantum still waits on a whole one.
+    const unsigned int frames = std::max<unsigned int>(bufferSize, lab::AudioNode::ProcessingSizeInFrames);
+    return isOpen() ? frames / double(outputConfig.desired_samplerate) : 0;
+  }
+
+  // Seconds from a frame leaving the graph to it reaching the DAC, as far
+  // as RtAudio knows: 0 where the API doesn't report it.
+  double
+  outputLatency() {
+    if(!isOpen())
+      return 0;
+    long frames = 0;
+    try {
+      frames = rtaudio.getStreamLatency();
+    } catch(const std::exception&) {}
+    return std::max(0L, frames) / double(outputConfig.desired_samplerate);
+  }
+
+  RenderMonitor&
+  monitor() {
+    return renderMonitor;
+  }
+
+  void
+  setDestinationNode(std::shared_ptr<lab::AudioDestinationNode> node) override {
+    destination = std::move(node);
+  }
+
+  void
+  start() override {
+    if(!isOpen() || rtaudio.isStreamRunning())
+      return;
+    try {
+      rtaudio.startStream();
+    } catch(const std::exception& e) {
+      errorText = e.what();
+    }
+  }
+
+  void
+  stop() override {
+    if(!isOpen() || !rtaudio.isStreamRunning())
+      return;
+    try {
+      rtaudio.stopStream();
+    } catch(const std::exception& e) {
+      errorText = e.what();
+    }
+  }
+
+  bool
+  isRunning() const override {
+    return isOpen() && rtaudio.isStreamRunning();
+  }
+
+  void
+  backendReinitialize() override {}
+
+  lab::AudioStreamConfig
+  getOutputConfig() const override {
+    return outputConfig;
+  }
+
+  lab::AudioStreamConfig
+  getInputConfig() const override {
+    return inputConfig;
+  }
+
+  lab::SamplingInfo
+  getSamplingInfo() const override {
+    return samplingInfo;
+  }
+
+private:
+  static int
+  callback(void* outputBuffer, void* inputBuffer, unsigned int frames, double, RtAudioStreamStatus status, void* userData) {
+    auto* device = static_cast<RtAudioDevice*>(userData);
+    const RenderMonitor::clock::time_point start = RenderMonitor::clock::now();
+    device->render(static_cast<float*>(outputBuffer), static_cast<const float*>(inputBuffer), int(frames));
+    device->renderMonitor.callback(status, start, RenderMonitor::clock::now(), frames / double(device->samplingInfo.sampling_rate));
+    return 0;
+  }
+
+  // Non-interleaved buffers: channel c starts at buffer + c * frames.
+  void
+  render(float* out, const float* in, int frames) {
+    const int quantum = lab::AudioNode::ProcessingSizeInFrames;
+    const int outChannels = int(outputConfig.desired_channels);
+
+    if(in && inputBus) {
+      const int inChannels = inputBus->numberOfChannels();
+      for(int i = 0; i < frames; i++, fifoHead++)
+        for(int c = 0; c < inChannels; c++)
+          fifo[c * fifoSize + (fifoHead & (fifoSize - 1))] = in[c * frames + i];
+      // An overrun drops the oldest input rather than stalling output.
+      if(fifoHead - fifoTail > fifoSize)
+        fifoTail = fifoHead - fifoSize;
+    }
+
+    for(int done = 0; done < frames;) {
+      if(carried == 0) {
+        renderQuantum(quantum);
+        carried = quantum;
+      }
+      int n = std::min(carried, frames - done);
+      int offset = quantum - carried;
+      for(int c = 0; c < outChannels; c++) {
+        const float* src = renderBus->channel(c)->data() + offset;
+        float* dst = out + c * frames + done;
+        // Clip at 0 dBFS on the way out, as lab's own device does.
+        for(int i = 0; i < n; i++)
+          dst[i] = std::clamp(src[i], -1.f, 1.f);
+      }
+      carried -= n;
+      done += n;
+    }
+  }
+
+  void
+  renderQuantum(int quantum) {
+    if(inputBus) {
+      const bool ready = fifoHead - fifoTail >= size_t(quantum);
+      for(int c = 0; c < inputBus->numberOfChannels(); c++) {
+        float* dst = inputBus->channel(c)->mutableData();
+        for(int i = 0; i < quantum; i++)
+          dst[i] = ready ? fifo[c * fifoSize + ((fifoTail + i) & (fifoSize - 1))] : 0.f;
+      }
+      if(ready)
+        fifoTail += quantum;
+    }
+
+    // Same bookkeeping as lab's device: the low bit of the frame count says
+    // which epoch slot is current, so readers on other threads see a
+    // consistent (frame, time) pair.
+    const int32_t index = 1 - int32_t(samplingInfo.current_sample_frame & 1);
+    const uint64_t t = samplingInfo.current_sample_frame & ~uint64_t(1);
+    samplingInfo.current_sample_frame = t + quantum + index;
+    samplingInfo.current_time = samplingInfo.current_sample_frame / double(samplingInfo.sampling_rate);
+    samplingInfo.epoch[index] = std::chrono::high_resolution_clock::now();
+
+    const RenderMonitor::clock::time_point start = RenderMonitor::clock::now();
+    if(destination)
+      destination->render(inputBus.get(), renderBus.get(), quantum, samplingInfo);
+    else
+      renderBus->zero();
+    renderMonitor.quantum(std::chrono::duration<double>(RenderMonitor::clock::now() - start).count());
+  }
+
+  lab::AudioStreamConfig inputConfig, outputConfig;
+  lab::SamplingInfo samplingInfo{};
+  std::shared_ptr<lab::AudioDestinationNode> destination;
+  RtAudio rtaudio;
+  std::string errorText;
+  unsigned int bufferSize = 0;
+  RenderMonitor renderMonitor;
+
+  std::unique_ptr<lab::AudioBus> renderBus, inputBus;
+  int carried = 0; // frames of renderBus not yet handed to RtAudio
+  std::vector<float> fifo; // planar, fifoSize frames per channel
+  size_t fifoSize = 0, fifoHead = 0, fifoTail = 0;
+};
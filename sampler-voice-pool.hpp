@@ -0,0 +1,289 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/extended/AudioContextLock.h"
+#include "lockfree-ring.hpp"
+
+/* ============================================================
+ * Pooled sample-playback voices.
+ *
+ * One lab::AudioNode owning a fixed set of voices, each playing an
+ * AudioBus with its own gain, pan and rate -- what DrumSampler.trigger()
+ * otherwise builds as AudioBufferSourceNode + GainNode + StereoPannerNode
+ * per hit. Triggers reach the render thread through an SpscRing, so a hit
+ * costs no node construction, no graph lock and no allocation on the render
+ * thread; a voice is claimed at the start of the render quantum that
+ * contains its start frame, stealing the longest-running voice when all are
+ * busy. (Triggering acquires the AudioBuffer, detaching its
+ * getChannelData() views, so the bus is shared as-is: see
+ * acquire_audio_buffer.)
+ *
+ * The render thread never drops the last reference to a bus: buses leave
+ * through a second ring and are released on the JS thread by reclaim().
+ * A borrowed bus, one its sender keeps alive for as long as the voice can
+ * play it (SequencerNode's patterns), is dropped on the render thread.
+ * ============================================================ */
+
+class SamplerVoicePoolNode : public lab::AudioNode {
+public:
+  enum { TRIGGER = 0, STOP_ALL = 1 };
+
+  struct Command {
+    int type = TRIGGER;
+    std::shared_ptr<lab::AudioBus> bus;
+    uint64_t frame = 0;  // context sample frame to start at
+    float gain = 1, pan = 0, rate = 1;
+    double offset = 0;   // seconds into the buffer
+    bool panned = false; // mono: pan with equal power rather than upmix at unity
+    bool borrowed = false;
+  };
+
+  SamplerVoicePoolNode(lab::AudioContext& ac, int numVoices, size_t queueSize = 256)
+      : lab::AudioNode(ac, *desc()), voices(std::max(1, numVoices)), commands(queueSize), finished(queueSize + voices.size()) {
+    initialize();
+  }
+
+  virtual ~SamplerVoicePoolNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioNodeDescriptor d{nullptr, nullptr, 0};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "SamplerVoicePool";
+  }
+
+  /* ---------- JS thread ---------- */
+
+  bool
+  trigger(Command&& cmd) {
+    reclaim();
+    if(!commands.push(std::move(cmd))) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  bool
+  stopAll() {
+    reclaim();
+    Command cmd;
+    cmd.type = STOP_ALL;
+    return commands.push(std::move(cmd));
+  }
+
+  // Release buses the render thread is done with.
+  void
+  reclaim() {
+    std::shared_ptr<lab::AudioBus> bus;
+    while(finished.pop(bus))
+      bus.reset();
+  }
+
+  int
+  voiceCount() const {
+    return int(voices.size());
+  }
+
+  int
+  activeVoices() const {
+    return active.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  stolenVoices() const {
+    return stolen.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  droppedTriggers() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    lab::AudioBus* out = output(0)->bus(r);
+    out->zero();
+
+    uint64_t now = r.context()->currentSampleFrame();
+    float sampleRate = r.context()->sampleRate();
+
+    Command cmd;
+    while(commands.pop(cmd)) {
+      if(cmd.type == STOP_ALL) {
+        for(auto& v : voices)
+          release(v);
+        continue;
+      }
+      if(cmd.bus && cmd.bus->length() > 0)
+        start(cmd, sampleRate);
+      else if(cmd.bus)
+        finished.push(std::move(cmd.bus));
+    }
+
+    float* left = out->channel(0)->mutableData();
+    float* right = out->channel(1)->mutableData();
+    int playing = 0;
+
+    for(auto& v : voices) {
+      if(!v.bus)
+        continue;
+      playing++;
+
+      int begin = 0;
+      if(v.frame > now) {
+        if(v.frame >= now + uint64_t(bufferSize))
+          continue;
+        begin = int(v.frame - now);
+      }
+
+      const lab::AudioBus& src = *v.bus;
+      const float* in0 = src.channel(0)->data();
+      const float* in1 = src.numberOfChannels() > 1 ? src.channel(1)->data() : nullptr;
+      const double last = double(src.length() - 1);
+
+      for(int i = begin; i < bufferSize; i++) {
+        if(v.pos >= last) {
+          release(v);
+          break;
+        }
+        size_t i0 = size_t(v.pos);
+        float frac = float(v.pos - double(i0));
+        float a = in0[i0] + (in0[i0 + 1] - in0[i0]) * frac;
+        if(in1) {
+          float b = in1[i0] + (in1[i0 + 1] - in1[i0]) * frac;
+          left[i] += a * v.ll + b * v.rl;
+          right[i] += a * v.lr + b * v.rr;
+        } else {
+          left[i] += a * v.ll;
+          right[i] += a * v.lr;
+        }
+        v.pos += v.step;
+      }
+    }
+
+    active.store(playing, std::memory_order_relaxed);
+    out->clearSilentFlag();
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {
+    for(auto& v : voices)
+      release(v);
+  }
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // No inputs, so the default would skip process() entirely; it may once
+  // no voice is left and no command is waiting. This is also what keeps an
+  // unwrapped pool registered while it plays (node_registry_busy).
+  bool
+  propagatesSilence(lab::ContextRenderLock&) const override {
+    return active.load(std::memory_order_relaxed) == 0 && commands.size() == 0;
+  }
+
+protected:
+  struct Voice {
+    std::shared_ptr<lab::AudioBus> bus;
+    uint64_t frame = 0;
+    uint64_t serial = 0;
+    double pos = 0, step = 1;
+    // Stereo matrix: left/right input to left/right output.
+    float ll = 0, lr = 0, rl = 0, rr = 0;
+    bool borrowed = false;
+  };
+
+  // `finished` is sized for every bus trigger() can put in flight between
+  // two reclaim() calls. Should it be full anyway, dropping the bus here
+  // beats a voice that stays busy past its end.
+  void
+  release(Voice& v) {
+    if(v.bus && (v.borrowed || !finished.push(std::move(v.bus))))
+      v.bus.reset();
+  }
+
+  // Render thread; also how a subclass plays a hit it generated itself.
+  void
+  start(Command& cmd, float sampleRate) {
+    Voice* v = nullptr;
+    for(auto& candidate : voices)
+      if(!candidate.bus) {
+        v = &candidate;
+        break;
+      }
+    if(!v) {
+      v = &voices[0];
+      for(auto& candidate : voices)
+        if(candidate.serial < v->serial)
+          v = &candidate;
+      release(*v);
+      stolen.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    float busRate = cmd.bus->sampleRate() > 0 ? cmd.bus->sampleRate() : sampleRate;
+    v->frame = cmd.frame;
+    v->serial = ++serial;
+    v->borrowed = cmd.borrowed;
+    v->step = std::max(0.0, double(cmd.rate) * busRate / sampleRate);
+    v->pos = std::max(0.0, cmd.offset * busRate);
+
+    // Same laws as StereoPannerNode: equal-power for a mono source, and for
+    // stereo the far channel is folded into the near one. Without a pan the
+    // hit sounds as AudioBufferSourceNode -> GainNode would.
+    float pan = std::clamp(cmd.pan, -1.f, 1.f);
+    if(cmd.bus->numberOfChannels() > 1) {
+      float x = pan <= 0 ? pan + 1 : pan;
+      float gl = std::cos(x * float(M_PI) / 2), gr = std::sin(x * float(M_PI) / 2);
+      if(pan <= 0) {
+        v->ll = cmd.gain, v->lr = 0;
+        v->rl = cmd.gain * gl, v->rr = cmd.gain * gr;
+      } else {
+        v->ll = cmd.gain * gl, v->lr = cmd.gain * gr;
+        v->rl = 0, v->rr = cmd.gain;
+      }
+    } else if(!cmd.panned) {
+      // Unpanned, a mono source is up-mixed like any mono connection.
+      v->ll = v->lr = cmd.gain;
+      v->rl = v->rr = 0;
+    } else {
+      float x = (pan + 1) / 2;
+      v->ll = cmd.gain * std::cos(x * float(M_PI) / 2);
+      v->lr = cmd.gain * std::sin(x * float(M_PI) / 2);
+      v->rl = v->rr = 0;
+    }
+    v->bus = std::move(cmd.bus);
+  }
+
+private:
+  std::vector<Voice> voices;
+  uint64_t serial = 0;
+  SpscRing<Command> commands;
+  SpscRing<std::shared_ptr<lab::AudioBus>> finished;
+  std::atomic<int> active{0};
+  std::atomic<uint64_t> stolen{0}, dropped{0};
+};
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "sampler-voice-pool.hpp"
+
+/* ============================================================
+ * Step sequencer on the render thread.
+ *
+ * A SamplerVoicePoolNode that plays its own hits: a Pattern is a loop of
+ * steps over tracks, one AudioBus per track and a velocity and pan per
+ * cell, and process() walks it against the context's sample clock, so
+ * every hit starts on its exact frame no matter how busy the JS thread
+ * is. Memory is that of the pattern, however long the song runs.
+ *
+ * start/stop, tempo and pattern changes reach the render thread through an
+ * SpscRing. A new pattern takes over when the current one loops back to
+ * step 0 (or at the next step, if immediate); a tempo change from the next
+ * step. Patterns the render thread is done with leave through a second
+ * ring, stamped with the frame their last hit ends on, and reclaim() on
+ * the JS thread releases them once the render has passed it. Until then
+ * the pattern holds its buses, so hits borrow them: a voice drops its
+ * reference on the render thread instead of queueing it for the JS thread,
+ * and a song with no JS calls can't fill the pool's ring.
+ * ============================================================ */
+
+class SequencerNode : public SamplerVoicePoolNode {
+public:
+  enum { START = 0, STOP, TEMPO, PATTERN, PATTERN_NOW };
+
+  struct Pattern {
+    int steps = 16, tracks = 0;
+    double stepsPerBeat = 4;
+    std::vector<std::shared_ptr<lab::AudioBus>> buses; // per track; null is a muted track
+    std::vector<float> velocity, pan;                  // [step * tracks + track]; 0 velocity is a rest
+    bool panned = false;                               // pan given: equal-power, else mono up-mixes at unity
+    double longest = 0;                                // seconds
+  };
+
+  struct Command {
+    int type = START;
+    uint64_t frame = 0;
+    double bpm = 120;
+    std::shared_ptr<Pattern> pattern;
+  };
+
+  SequencerNode(lab::AudioContext& ac, int numVoices, double bpm, size_t queueSize = 64)
+      : SamplerVoicePoolNode(ac, numVoices), commands(queueSize), retired(queueSize + 2), tempo(bpm), bpm(bpm) {}
+
+  const char*
+  name() const override {
+    return "Sequencer";
+  }
+
+  /* ---------- JS thread ---------- */
+
+  bool
+  send(Command&& cmd) {
+    reclaim();
+    if(cmd.type == TEMPO)
+      tempo.store(cmd.bpm, std::memory_order_relaxed);
+    if(!commands.push(std::move(cmd))) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  // Release patterns, and the pool's buses, the render thread is done with.
+  void
+  reclaim() {
+    SamplerVoicePoolNode::reclaim();
+    Retired r;
+    while(retired.pop(r))
+      draining.push_back(std::move(r));
+    const uint64_t done = rendered.load(std::memory_order_acquire);
+    draining.erase(std::remove_if(draining.begin(), draining.end(), [done](const Retired& r) { return r.until <= done; }), draining.end());
+  }
+
+  double
+  currentTempo() const {
+    return tempo.load(std::memory_order_relaxed);
+  }
+
+  int
+  currentStep() const {
+    return position.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  completedLoops() const {
+    return loops.load(std::memory_order_relaxed);
+  }
+
+  bool
+  isPlaying() const {
+    return playing.load(std::memory_order_relaxed);
+  }
+
+  uint64_t
+  droppedCommands() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    const uint64_t now = r.context()->currentSampleFrame();
+    const float sampleRate = r.context()->sampleRate();
+
+    Command cmd;
+    while(commands.pop(cmd))
+      apply(cmd, now, sampleRate);
+
+    const double end = double(now + uint64_t(bufferSize));
+    while(running && next < end) {
+      if(uint64_t(next) >= stopFrame) {
+        running = false;
+        break;
+      }
+      if(queued && (step == 0 || immediate))
+        swap(sampleRate);
+      if(!pattern) {
+        // Nothing to play yet: idle the clock on the step grid.
+        next += framesPerStep(sampleRate);
+        continue;
+      }
+      play(uint64_t(std::llround(next)), sampleRate);
+      if(++step >= pattern->steps) {
+        step = 0;
+        loops.fetch_add(1, std::memory_order_relaxed);
+      }
+      next += framesPerStep(sampleRate);
+    }
+
+    position.store(step, std::memory_order_relaxed);
+    playing.store(running, std::memory_order_relaxed);
+    SamplerVoicePoolNode::process(r, bufferSize);
+    rendered.store(now + uint64_t(bufferSize), std::memory_order_release);
+  }
+
+  void
+  reset(lab::ContextRenderLock& r) override {
+    running = false;
+    SamplerVoicePoolNode::reset(r);
+  }
+
+  bool
+  propagatesSilence(lab::ContextRenderLock& r) const override {
+    return !running && commands.size() == 0 && SamplerVoicePoolNode::propagatesSilence(r);
+  }
+
+private:
+  double
+  framesPerStep(float sampleRate) const {
+    double stepsPerBeat = pattern ? pattern->stepsPerBeat : 4;
+    return double(sampleRate) * 60 / (bpm * stepsPerBeat);
+  }
+
+  void
+  apply(Command& cmd, uint64_t now, float sampleRate) {
+    switch(cmd.type) {
+      case START:
+        running = true;
+        step = 0;
+        next = double(std::max(cmd.frame, now));
+        stopFrame = std::numeric_limits<uint64_t>::max();
+        if(queued)
+          swap(sampleRate);
+        break;
+      case STOP: stopFrame = std::max(cmd.frame, now); break;
+      case TEMPO: bpm = cmd.bpm; break;
+      case PATTERN:
+      case PATTERN_NOW:
+        // A pattern still waiting its turn is superseded, never played.
+        if(queued)
+          retired.push(Retired{std::move(queued), 0});
+        queued = std::move(cmd.pattern);
+        immediate = cmd.type == PATTERN_NOW;
+        if(!running)
+          swap(sampleRate);
+        break;
+    }
+  }
+
+  void
+  swap(float sampleRate) {
+    if(pattern)
+      retired.push(Retired{std::move(pattern), lastHit + uint64_t(std::ceil(pattern->longest * sampleRate))});
+    pattern = std::move(queued);
+    immediate = false;
+    if(step >= pattern->steps)
+      step = 0;
+  }
+
+  void
+  play(uint64_t frame, float sampleRate) {
+    const size_t row = size_t(step) * pattern->tracks;
+    lastHit = frame;
+    for(int t = 0; t < pattern->tracks; t++) {
+      float velocity = pattern->velocity[row + t];
+      if(velocity <= 0 || !pattern->buses[t])
+        continue;
+      SamplerVoicePoolNode::Command hit;
+      hit.bus = pattern->buses[t];
+      hit.frame = frame;
+      hit.gain = velocity;
+      hit.pan = pattern->pan[row + t];
+      hit.panned = pattern->panned;
+      hit.borrowed = true;
+      start(hit, sampleRate);
+    }
+  }
+
+  // A pattern on its way out, and the context frame its last hit ends on.
+  struct Retired {
+    std::shared_ptr<Pattern> pattern;
+    uint64_t until = 0;
+  };
+
+  // Render thread.
+  std::shared_ptr<Pattern> pattern, queued;
+  bool immediate = false, running = false;
+  int step = 0;
+  double next = 0; // context frame of `step`, fractional so tempo doesn't drift
+  uint64_t stopFrame = std::numeric_limits<uint64_t>::max();
+  uint64_t lastHit = 0; // context frame of the current pattern's latest step
+
+  SpscRing<Command> commands;
+  // Sized for every pattern that can be retired between two reclaim()
+  // calls: the ones in `commands`, plus the current and the queued one.
+  SpscRing<Retired> retired;
+  std::vector<Retired> draining;     // JS thread: retired, their hits may still sound
+  std::atomic<uint64_t> rendered{0}; // context frame the render has reached
+  std::atomic<double> tempo;         // last requested, for the JS getter
+  double bpm;                        // render thread's
+  std::atomic<int> position{0};
+  std::atomic<uint64_t> loops{0};
+  std::atomic<bool> playing{false};
+  std::atomic<uint64_t> dropped{0};
+};
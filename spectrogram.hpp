@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/core/FFTFrame.h"
+#include "LabSound/core/WindowFunctions.h"
+
+// 1 / the DC bin of a block of ones through `fft`: scales its magnitudes
+// by 1 / fftSize, as the spec's analyser does, whichever way the FFT
+// backend scales its own output. Allocates; not for the render thread.
+inline float
+fft_magnitude_scale(lab::FFTFrame& fft, int fftSize) {
+  std::vector<float> ones(size_t(fftSize), 1.f);
+  fft.doFFT(ones.data());
+  const float dc = std::fabs(fft.realData()[0]);
+  return dc != 0 ? 1.f / dc : 1.f / fftSize;
+}
+
+/* ============================================================
+ * Short-time Fourier transform of a whole AudioBus.
+ *
+ * Frame k covers samples [k * hop, k * hop + fftSize), zero-padded past
+ * the end, and yields fftSize / 2 + 1 magnitudes, DC to Nyquist, scaled
+ * by 1 / fftSize like the spec's analyser before it goes to dB. Frames
+ * are independent, so any range of them can be computed on any thread:
+ * compute() only reads the bus and the shared window, and has its own
+ * FFTFrame and scratch.
+ * ============================================================ */
+
+class Spectrogram {
+public:
+  // channel < 0 mixes all channels down.
+  Spectrogram(std::shared_ptr<lab::AudioBus> bus, int fftSize, int hop, lab::WindowType type, int channel)
+      : bus(std::move(bus)), fftSize(fftSize), hop(hop), channel(channel), window(size_t(fftSize), 1.f) {
+    lab::ApplyWindowFunctionInplace(type, window.data(), fftSize);
+    lab::FFTFrame fft(fftSize);
+    scale = fft_magnitude_scale(fft, fftSize);
+  }
+
+  int
+  bins() const {
+    return fftSize / 2 + 1;
+  }
+
+  size_t
+  frames() const {
+    size_t length = bus->length();
+    return length <= size_t(fftSize) ? 1 : 1 + (length - size_t(fftSize) + size_t(hop) - 1) / size_t(hop);
+  }
+
+  // Frames [first, last) into out[(k - first) * bins()].
+  void
+  compute(size_t first, size_t last, float* out) const {
+    lab::FFTFrame fft(fftSize);
+    std::vector<float> block(static_cast<size_t>(fftSize));
+    const size_t length = bus->length();
+    const int channels = bus->numberOfChannels();
+    const int c0 = channel < 0 ? 0 : channel, c1 = channel < 0 ? channels : channel + 1;
+    const float gain = 1.f / float(c1 - c0);
+
+    for(size_t k = first; k < last; k++, out += bins()) {
+      const size_t start = k * size_t(hop);
+      const size_t n = start < length ? std::min(size_t(fftSize), length - start) : 0;
+      std::fill(block.begin(), block.end(), 0.f);
+      for(int c = c0; c < c1; c++) {
+        const float* src = bus->channel(c)->data() + start;
+        for(size_t i = 0; i < n; i++)
+          block[i] += src[i];
+      }
+      for(int i = 0; i < fftSize; i++)
+        block[size_t(i)] *= window[size_t(i)] * gain;
+
+      fft.doFFT(block.data());
+      const float* re = fft.realData();
+      const float* im = fft.imagData();
+      // FFTFrame packs the Nyquist bin into imag[0].
+      out[0] = std::fabs(re[0]) * scale;
+      for(int b = 1; b < fftSize / 2; b++)
+        out[b] = std::sqrt(re[b] * re[b] + im[b] * im[b]) * scale;
+      out[fftSize / 2] = std::fabs(im[0]) * scale;
+    }
+  }
+
+private:
+  std::shared_ptr<lab::AudioBus> bus;
+  int fftSize, hop, channel;
+  std::vector<float> window;
+  float scale = 1;
+};
@@ -0,0 +1,53 @@
+// StkNode: STK instruments and effects inside a LabSound graph.
+//
+// A Mandolin arpeggio, its notes sent ahead of time with noteOn(when), goes
+// through a LabSound lowpass into an STK FreeVerb and out. Both STK objects
+// are ticked on the render thread, a block per quantum; nothing is copied
+// through JS. Rendered offline first (and timed), then played live.
+//
+// The STK objects come from the 'stk' module. StkNode sets STK's sample
+// rate, which is global to that module, to the context's.
+
+import * as stk from 'stk';
+
+const SECONDS = 6;
+const mtof = n => 440 * Math.pow(2, (n - 69) / 12);
+const ARPEGGIO = [52, 59, 64, 67, 71, 67, 64, 59];
+
+function buildGraph(env, ctx, t0) {
+  const mandolin = new env.StkNode(ctx, new stk.Mandolin(55));
+  const lowpass = new env.BiquadFilterNode(ctx, { type: 'lowpass', frequency: 2400, Q: 0.7 });
+  const reverb = new env.StkNode(ctx, new stk.FreeVerb());
+  reverb.setEffectMix(0.3);
+  mandolin.connect(lowpass).connect(reverb).connect(ctx.destination);
+
+  const step = 0.18;
+  for(let i = 0; i * step < SECONDS - 1.5; i++) {
+    const t = t0 + i * step;
+    mandolin.noteOn(mtof(ARPEGGIO[i % ARPEGGIO.length]), 0.6 + 0.3 * (i % 4 === 0), t);
+    // Sweep the pluck position (MIDI control 4) across the phrase.
+    mandolin.controlChange(4, (i * 11) % 128, t);
+  }
+  mandolin.noteOff(0.5, t0 + SECONDS - 1.5);
+  return { mandolin, reverb };
+}
+
+async function main() {
+  const env = await import('labsound');
+
+  const SR = 48000;
+  const offline = new env.OfflineAudioContext({ numberOfChannels: 2, length: SR * SECONDS, sampleRate: SR });
+  const { mandolin } = buildGraph(env, offline, 0);
+  const t = Date.now();
+  const buffer = await offline.startRendering();
+  const left = buffer.getChannelData(0);
+  const peak = left.reduce((m, x) => Math.max(m, Math.abs(x)), 0);
+  console.log(`offline: ${SECONDS}s in ${Date.now() - t} ms, peak ${peak.toFixed(3)}, ${mandolin.droppedCommands} dropped commands`);
+
+  const { setTimeout } = await import('os');
+  const ctx = new env.AudioContext();
+  buildGraph(env, ctx, ctx.currentTime + 0.1);
+  setTimeout(() => ctx.close?.(), SECONDS * 1000);
+}
+
+main();
@@ -0,0 +1,208 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "LabSound/LabSound.h"
+#include "LabSound/core/AudioNodeInput.h"
+#include "LabSound/core/AudioNodeOutput.h"
+#include "LabSound/core/AudioBus.h"
+#include "LabSound/extended/AudioContextLock.h"
+#include "lockfree-ring.hpp"
+#include "stk-source.hpp"
+
+/* ============================================================
+ * An STK instrument, effect, generator or filter inside the graph.
+ *
+ * StkNode pulls an StkSource (stk-source.hpp) one block at a time on the
+ * render thread: the input, mixed down to the channels the source reads,
+ * goes into its frame-interleaved double buffer, one tick() runs the whole
+ * block, and the result is converted back to the output bus's float
+ * channels. The conversions are plain strided loops with the stride fixed
+ * at compile time for one and two channels, which is what the compiler
+ * vectorizes.
+ *
+ * noteOn()/noteOff()/controlChange()/setEffectMix() reach the render
+ * thread through an SpscRing, each with the context frame it takes effect
+ * at. The block is split at that frame, so control is sample-accurate; a
+ * command for the past applies at the start of the next quantum. Calling
+ * the STK object's own methods while the node renders it races with the
+ * render thread.
+ * ============================================================ */
+
+class StkNode : public lab::AudioNode {
+public:
+  struct Command {
+    int type = StkSource::NOTE_ON;
+    uint64_t frame = 0; // context sample frame
+    double a = 0, b = 0;
+  };
+
+  StkNode(lab::AudioContext& ac, std::shared_ptr<StkSource> source, size_t queueSize = 256)
+      : lab::AudioNode(ac, *desc()), source(std::move(source)), commands(queueSize) {
+    pending.reserve(commands.capacity());
+    initialize();
+  }
+
+  virtual ~StkNode() {
+    uninitialize();
+  }
+
+  static lab::AudioNodeDescriptor*
+  desc() {
+    static lab::AudioNodeDescriptor d{nullptr, nullptr, 0};
+    return &d;
+  }
+
+  const char*
+  name() const override {
+    return "StkNode";
+  }
+
+  /* ---------- JS thread ---------- */
+
+  const StkSource&
+  stkSource() const {
+    return *source;
+  }
+
+  bool
+  send(const Command& cmd) {
+    if(!commands.push(cmd)) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    return true;
+  }
+
+  uint64_t
+  droppedCommands() const {
+    return dropped.load(std::memory_order_relaxed);
+  }
+
+  /* ---------- render thread ---------- */
+
+  void
+  process(lab::ContextRenderLock& r, int bufferSize) override {
+    lab::AudioBus* out = output(0)->bus(r);
+    const uint64_t now = r.context()->currentSampleFrame();
+    const int n = std::min(bufferSize, int(ProcessingSizeInFrames));
+
+    Command cmd;
+    while(pending.size() < pending.capacity() && commands.pop(cmd))
+      pending.push_back(cmd);
+
+    lab::AudioBus* in = numberOfInputs() && input(0)->isConnected() ? input(0)->bus(r) : nullptr;
+    int pos = 0;
+    while(pos < n) {
+      // Apply what's due, in the order it was sent, and render up to the
+      // next command inside this quantum.
+      int next = n;
+      for(size_t k = 0; k < pending.size();) {
+        if(pending[k].frame <= now + uint64_t(pos)) {
+          source->control(pending[k].type, pending[k].a, pending[k].b);
+          pending.erase(pending.begin() + k);
+          continue;
+        }
+        if(pending[k].frame < now + uint64_t(n))
+          next = std::min(next, int(pending[k].frame - now));
+        k++;
+      }
+      render(in, out, pos, next - pos);
+      pos = next;
+    }
+    out->clearSilentFlag();
+  }
+
+  void
+  reset(lab::ContextRenderLock&) override {}
+
+  double
+  tailTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  double
+  latencyTime(lab::ContextRenderLock&) const override {
+    return 0;
+  }
+
+  // Instruments ring on after noteOff() and effects after their input
+  // stops; STK doesn't say for how long.
+  bool
+  propagatesSilence(lab::ContextRenderLock&) const override {
+    return false;
+  }
+
+private:
+  template<int W>
+  static void
+  interleave(const float* src, double* dst, int c, int n) {
+    for(int i = 0; i < n; i++)
+      dst[i * W + c] = src[i];
+  }
+
+  template<int W>
+  static void
+  deinterleave(const double* src, float* dst, int c, int n) {
+    for(int i = 0; i < n; i++)
+      dst[i] = float(src[i * W + c]);
+  }
+
+  void
+  render(lab::AudioBus* in, lab::AudioBus* out, int offset, int n) {
+    const int inputs = int(source->inputs()), outputs = int(source->outputs());
+    const int width = std::max(inputs, outputs);
+    double* frames = source->frames(unsigned(n));
+
+    if(inputs) {
+      const int channels = in ? int(in->numberOfChannels()) : 0;
+      if(!channels) {
+        std::fill(frames, frames + size_t(n) * width, 0.0);
+      } else if(inputs == 1 && channels > 1) {
+        // Mono source: mix down.
+        const float gain = 1.f / channels;
+        for(int i = 0; i < n; i++) {
+          double sum = 0;
+          for(int c = 0; c < channels; c++)
+            sum += in->channel(c)->data()[offset + i];
+          frames[size_t(i) * width] = sum * gain;
+        }
+      } else {
+        for(int c = 0; c < inputs; c++) {
+          const float* src = in->channel(std::min(c, channels - 1))->data() + offset;
+          if(width == 1)
+            interleave<1>(src, frames, c, n);
+          else if(width == 2)
+            interleave<2>(src, frames, c, n);
+          else
+            for(int i = 0; i < n; i++)
+              frames[size_t(i) * width + c] = src[i];
+        }
+      }
+    }
+
+    source->tick();
+
+    for(int c = 0; c < int(out->numberOfChannels()); c++) {
+      float* dst = out->channel(c)->mutableData() + offset;
+      if(c >= outputs)
+        std::fill(dst, dst + n, 0.f);
+      else if(width == 1)
+        deinterleave<1>(frames, dst, c, n);
+      else if(width == 2)
+        deinterleave<2>(frames, dst, c, n);
+      else
+        for(int i = 0; i < n; i++)
+          dst[i] = float(frames[size_t(i) * width + c]);
+    }
+  }
+
+  std::shared_ptr<StkSource> source;
+  SpscRing<Command> commands;
+  std::vector<Command> pending; // render thread; never grows past its reserve
+  std::atomic<uint64_t> dropped{0};
+};
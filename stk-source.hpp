@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+
+/* ============================================================
+ * STK object as a block source, shared by qjs-stk and qjs-labsound.
+ *
+ * The two are separate modules, each with its own class ids and its own
+ * copy of whatever it links, so StkNode (stk-node.hpp) can't unwrap an STK
+ * object itself. Instead every instrument, effect, generator and filter
+ * prototype in qjs-stk has a method under Symbol.for(STK_SOURCE_SYMBOL)
+ * returning an ArrayBuffer that holds a uint64_t id, and keeps the source
+ * alive for as long as the buffer is. Any script can call that method or
+ * make such a buffer, so the id is all it carries: qjs-labsound resolves
+ * it through STK_SOURCE_LOOKUP, a C entry point qjs-stk exports over its
+ * registry of the sources it issued. The interface below is implemented
+ * in quickjs-stk.cpp, so all STK code -- ticking, noteOn(), setting the
+ * sample rate -- runs in the module that owns it.
+ *
+ * Samples are frame-interleaved doubles, STK's StkFloat.
+ * ============================================================ */
+
+#define STK_SOURCE_SYMBOL "qjs-sound.StkSource"
+
+class StkSource {
+public:
+  enum { NOTE_ON = 0, NOTE_OFF, CONTROL_CHANGE, EFFECT_MIX };
+
+  // Largest block frames() hands out without allocating.
+  static constexpr unsigned MAX_FRAMES = 128;
+
+  virtual ~StkSource() {}
+
+  // Input channels tick() reads from the start of each frame (0 for an
+  // instrument or generator), and output channels it leaves there. A frame
+  // is max(inputs(), outputs()) wide.
+  virtual unsigned inputs() const = 0;
+  virtual unsigned outputs() const = 0;
+
+  // Render thread: the block for the next tick() of `n` frames.
+  virtual double* frames(unsigned n) = 0;
+  virtual void tick() = 0;
+
+  // Whether control() does anything for `type`; JS thread.
+  virtual bool accepts(int type) const = 0;
+  // NOTE_ON (frequency, amplitude), NOTE_OFF (amplitude),
+  // CONTROL_CHANGE (number, value), EFFECT_MIX (mix); render thread.
+  virtual void control(int type, double a, double b) = 0;
+
+  // STK's sample rate is global to the module; JS thread.
+  virtual void setSampleRate(double rate) = 0;
+};
+
+// extern "C" bool qjs_stk_source_lookup(uint64_t, std::shared_ptr<StkSource>&):
+// the live source issued under an id, if any; any thread.
+#define STK_SOURCE_LOOKUP "qjs_stk_source_lookup"
+
+typedef bool StkSourceLookup(uint64_t id, std::shared_ptr<StkSource>& source);
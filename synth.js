@@ -4,7 +4,16 @@
 // Wraps several AudioParams so automation broadcasts to all of them.
 // Used by VCF when cascading multiple BiquadFilter stages.
 export class BroadcastParam {
-  constructor(params) { this.params = params; }
+  constructor(params) {
+    this.params = params;
+    // Packed automation (see ADSR.trigger) only where the params support it,
+    // with the op codes they take.
+    if(params[0].schedule) {
+      this.schedule = (ev, n) => { for(const p of this.params) p.schedule(ev, n); return this; };
+      for(const op of ['SET_VALUE_AT_TIME', 'LINEAR_RAMP', 'SET_TARGET_AT_TIME', 'CANCEL_SCHEDULED'])
+        this[op] = params[0][op];
+    }
+  }
   get value() { return this.params[0].value; }
   set value(v) { for(const p of this.params) p.value = v; }
   setValueAtTime(v, t)              { for(const p of this.params) p.setValueAtTime(v, t);              return this; }
@@ -12,6 +21,19 @@ export class BroadcastParam {
   exponentialRampToValueAtTime(v, t){ for(const p of this.params) p.exponentialRampToValueAtTime(v, t);return this; }
   setTargetAtTime(v, t, k)          { for(const p of this.params) p.setTargetAtTime(v, t, k);          return this; }
   cancelScheduledValues(t)          { for(const p of this.params) p.cancelScheduledValues(t);          return this; }
+  setValueCurveAtTime(c, t, d)      { for(const p of this.params) p.setValueCurveAtTime(c, t, d);      return this; }
+}
+
+// One packed record of AudioParam.prototype.schedule() (qjs-labsound only):
+// [op, value, time, timeConstant], op being one of the AudioParam's own
+// SET_VALUE_AT_TIME, LINEAR_RAMP, ... constants.
+function putEvent(ev, n, op, value, time, timeConstant = 0) {
+  const i = n * 4;
+  ev[i] = op;
+  ev[i + 1] = value;
+  ev[i + 2] = time;
+  ev[i + 3] = timeConstant;
+  return n + 1;
 }
 
 // ADSR envelope as AudioParam automation. Works on any AudioParam.
@@ -26,6 +48,7 @@ export class ADSR {
     this.decay = decay;
     this.sustain = sustain;
     this.release = release;
+    this.events = new Float64Array(6 * 4);
   }
 
   trigger(param, t, gateLen, { peak = 1.0, base = 0.0 } = {}) {
@@ -34,6 +57,21 @@ export class ADSR {
     const rStart = Math.max(t + gateLen, dEnd);
     const sustainLevel = base + (peak - base) * this.sustain;
 
+    // One native call for the whole envelope where the runtime offers it.
+    if(param.schedule) {
+      const ev = this.events;
+      const { SET_VALUE_AT_TIME, LINEAR_RAMP, SET_TARGET_AT_TIME, CANCEL_SCHEDULED } = param;
+      let n = 0;
+      n = putEvent(ev, n, CANCEL_SCHEDULED, 0, t);
+      n = putEvent(ev, n, SET_VALUE_AT_TIME, base, t);
+      n = putEvent(ev, n, LINEAR_RAMP, peak, aEnd);
+      n = putEvent(ev, n, LINEAR_RAMP, sustainLevel, dEnd);
+      if(rStart > dEnd) n = putEvent(ev, n, SET_VALUE_AT_TIME, sustainLevel, rStart);
+      n = putEvent(ev, n, SET_TARGET_AT_TIME, base, rStart, this.release / 4);
+      param.schedule(ev, n);
+      return;
+    }
+
     param.cancelScheduledValues(t);
     param.setValueAtTime(base, t);
     param.linearRampToValueAtTime(peak, aEnd);
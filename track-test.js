@@ -2,10 +2,13 @@
 //
 // Bus layout:
 //
-//   Synth ─► WaveShaper (dist) ─┬─► synthBus ─► master ─► destination
+//   Synth ─► WaveShaper (dist) ─┬─► synthBus ─► mix ─► master ─► destination
 //                               └─► PingPongDelay ─► wetSend ─► synthBus
 //
-//   Drums (kick/snare/hihat samples + procedural tom/cymbal) ─► drumBus ─► master
+//   Drums (kick/snare/hihat samples + procedural tom/cymbal) ─► drumBus ─► mix
+//
+// `mix` is a ParallelMixerNode where available (the two buses share no
+// nodes, so they render on separate cores), otherwise master itself.
 //
 // 4 bars at 124 BPM. Drums per-hit panned across the stereo field; synth runs
 // through distortion + an 8th-dotted ping-pong delay.
@@ -40,24 +43,34 @@ async function main() {
   const master = new env.GainNode(ctx, { gain: 0.7 });
   master.connect(ctx.destination);
 
+  let mix = master;
+  if(env.ParallelMixerNode) {
+    mix = new env.ParallelMixerNode(ctx);
+    mix.connect(master);
+  }
+
   /* ---------- drums ---------- */
 
   const drumBus = new env.GainNode(ctx, { gain: 0.9 });
-  drumBus.connect(master);
+  drumBus.connect(mix);
 
   const drums = new DrumSampler(ctx, env, { gain: 1.0 });
   drums.connect(drumBus);
 
-  drums.loadSample('kick',  await loadBuffer(ctx, `${SAMPLES_DIR}/kick.wav`));
-  drums.loadSample('snare', await loadBuffer(ctx, `${SAMPLES_DIR}/snare.wav`));
-  drums.loadSample('hihat', await loadBuffer(ctx, `${SAMPLES_DIR}/hihat.wav`));
+  const samples = {
+    kick:  await loadBuffer(ctx, `${SAMPLES_DIR}/kick.wav`),
+    snare: await loadBuffer(ctx, `${SAMPLES_DIR}/snare.wav`),
+    hihat: await loadBuffer(ctx, `${SAMPLES_DIR}/hihat.wav`),
+  };
+  for(const [name, buffer] of Object.entries(samples))
+    drums.loadSample(name, buffer);
   drums.defineVoice('tom',    tom);
   drums.defineVoice('cymbal', cymbal);
 
   /* ---------- synth bus: distortion + ping-pong delay ---------- */
 
   const synthBus = new env.GainNode(ctx, { gain: 0.55 });
-  synthBus.connect(master);
+  synthBus.connect(mix);
 
   const dist = new env.WaveShaperNode(ctx, {
     curve: makeDistortionCurve(4.5),
@@ -83,7 +96,7 @@ async function main() {
     output: dist,
   });
 
-  globalThis.__track_keepalive = { ctx, drums, synth, master, drumBus, synthBus, dist, ppd, wetSend };
+  globalThis.__track_keepalive = { ctx, drums, synth, master, mix, drumBus, synthBus, dist, ppd, wetSend };
 
   /* ---------- patterns ---------- */
 
@@ -120,13 +133,39 @@ async function main() {
   const totalSteps = bars * stepsPerBar;
   const t0 = ctx.currentTime + 0.2;
 
+  // Where the runtime has a native Sequencer (qjs-labsound), the sample
+  // rows become one 16-step pattern it loops on the render thread; nothing
+  // is scheduled ahead for them.
+  let sequenced = {};
+  if(env.Sequencer) {
+    const names = Object.keys(samples);
+    const velocity = new Float32Array(stepsPerBar * names.length);
+    for(let step = 0; step < stepsPerBar; step++)
+      names.forEach((name, k) => {
+        if(drumPattern[name][step] !== '-')
+          velocity[step * names.length + k] = name === 'hihat' ? 0.4 : 1.0;
+      });
+
+    const seq = new env.Sequencer(ctx, { bpm });
+    seq.connect(drumBus);
+    seq.setPattern({
+      samples: names.map(name => samples[name]),
+      velocity,
+      pan: new Float32Array(names.map(name => drumPan[name])),
+    });
+    seq.start(t0);
+    seq.stop(t0 + totalSteps * stepDur);
+    globalThis.__track_keepalive.seq = seq;
+    sequenced = samples;
+  }
+
   for(let i = 0; i < totalSteps; i++) {
     const t = t0 + i * stepDur;
     const stepInBar = i % stepsPerBar;
 
     // Drums
     for(const [name, row] of Object.entries(drumPattern)) {
-      if(row[stepInBar] !== '-') {
+      if(!(name in sequenced) && row[stepInBar] !== '-') {
         drums.trigger(name, t, {
           gain: name === 'hihat' ? 0.4 : 1.0,
           pan: drumPan[name],
@@ -0,0 +1,53 @@
+// Processors for worklet-test.js, loaded with ctx.audioWorklet.addModule().
+// Runs in the worklet scope: registerProcessor, AudioWorkletProcessor,
+// sampleRate, currentTime and console are its globals, nothing else is.
+
+// Sample-rate reduction plus quantization. `bits` and `hold` are AudioParams;
+// `bits` is k-rate, so its array always has one value.
+class Crusher extends AudioWorkletProcessor {
+  static get parameterDescriptors() {
+    return [
+      { name: 'bits', defaultValue: 8, minValue: 1, maxValue: 16, automationRate: 'k-rate' },
+      { name: 'hold', defaultValue: 1, minValue: 1, maxValue: 64 },
+    ];
+  }
+
+  constructor(options) {
+    super();
+    this.held = [];
+    this.phase = 0;
+    this.peak = 0;
+    this.quanta = 0;
+    this.report = options.processorOptions?.reportEvery ?? 100;
+    this.port.onmessage = ({ data }) => {
+      if(data === 'reset') this.peak = 0;
+    };
+  }
+
+  process([input], [output], { bits, hold }) {
+    const step = 2 ** (1 - bits[0]);
+    for(let c = 0; c < output.length; c++) {
+      const src = input[c] ?? input[0];
+      const dst = output[c];
+      if(!src) {
+        dst.fill(0);
+        continue;
+      }
+      let held = this.held[c] ?? 0, phase = this.phase;
+      for(let i = 0; i < dst.length; i++) {
+        if(++phase >= (hold.length > 1 ? hold[i] : hold[0])) {
+          phase = 0;
+          held = step * Math.round(src[i] / step);
+        }
+        dst[i] = held;
+        this.peak = Math.max(this.peak, Math.abs(held));
+      }
+      this.held[c] = held;
+      if(c === output.length - 1) this.phase = phase;
+    }
+    if(++this.quanta % this.report === 0) this.port.postMessage({ time: currentTime, peak: this.peak });
+    return true;
+  }
+}
+
+registerProcessor('crusher', Crusher);
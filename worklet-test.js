@@ -0,0 +1,61 @@
+// AudioWorklet: a JS processor on the render thread.
+//
+// Loads worklet-processor.js and runs a sawtooth through its 'crusher'
+// processor, sweeping `hold` (a-rate) and `bits` (k-rate) while the processor
+// reports its peak level over the port. Offline first, which waits for the
+// worklet runtime, then a few seconds live, where a busy runtime means a
+// silent quantum (audioWorklet.skippedQuanta) instead of a late one. Run it
+// from the repository root, where the processor module is.
+
+const isBrowser = typeof globalThis.window !== 'undefined';
+
+const SR = 48000;
+const SECONDS = 4;
+
+function buildGraph(env, ctx, t0) {
+  const osc = new env.OscillatorNode(ctx, { type: 'sawtooth', frequency: 110 });
+  const crush = new env.AudioWorkletNode(ctx, 'crusher', {
+    outputChannelCount: [1],
+    parameterData: { bits: 6, hold: 1 },
+    processorOptions: { reportEvery: Math.round(SR / 128 / 2) },
+  });
+  const gain = new env.GainNode(ctx, { gain: 0.3 });
+  osc.connect(crush).connect(gain).connect(ctx.destination);
+
+  crush.parameters.get('hold').setValueAtTime(1, t0);
+  crush.parameters.get('hold').linearRampToValueAtTime(32, t0 + SECONDS);
+  crush.parameters.get('bits').setValueAtTime(6, t0);
+  crush.parameters.get('bits').setValueAtTime(3, t0 + SECONDS / 2);
+
+  crush.port.onmessage = ({ data }) => console.log(`  t=${data.time.toFixed(2)}s  peak ${data.peak.toFixed(3)}`);
+  crush.onprocessorerror = e => console.log('processor failed:', e.message);
+  osc.start(t0);
+  osc.stop(t0 + SECONDS);
+  return crush;
+}
+
+async function main() {
+  const env = isBrowser ? globalThis : await import('labsound');
+  const setTimeout = isBrowser ? globalThis.setTimeout : (await import('os')).setTimeout;
+  const module = 'worklet-processor.js';
+
+  const offline = new env.OfflineAudioContext({ numberOfChannels: 1, length: SR * SECONDS, sampleRate: SR });
+  await offline.audioWorklet.addModule(module);
+  const crush = buildGraph(env, offline, 0);
+  const t = Date.now();
+  const buffer = await offline.startRendering();
+  console.log(`offline: ${SECONDS}s in ${Date.now() - t} ms, ${buffer.length} frames`);
+  crush.port.close();
+
+  if(!isBrowser) {
+    const ctx = new env.AudioContext({ sampleRate: SR });
+    await ctx.audioWorklet.addModule(module);
+    const live = buildGraph(env, ctx, ctx.currentTime + 0.1);
+    await new Promise(resolve => setTimeout(resolve, (SECONDS + 0.5) * 1000));
+    console.log(`live: ${ctx.audioWorklet.skippedQuanta} skipped quanta, ${ctx.audioWorklet.gcRuns} worklet GCs`);
+    live.port.close();
+    await ctx.close?.();
+  }
+}
+
+main();